@@ -2,6 +2,7 @@
 #define JX_BASE64_H
 
 #include <stdint.h>
+#include <stddef.h> // size_t
 
 namespace bx
 {
@@ -10,7 +11,10 @@ struct AllocatorI;
 
 namespace jx
 {
+struct WorkerPool;
+
 uint8_t* base64Encode(const uint8_t* src, size_t len, size_t* out_len, bx::AllocatorI* allocator);
+uint8_t* base64EncodeParallel(WorkerPool* pool, const uint8_t* src, size_t len, size_t* out_len, bx::AllocatorI* allocator);
 uint8_t* base64Decode(const uint8_t* src, size_t len, size_t* out_len, bx::AllocatorI* allocator);
 }
 
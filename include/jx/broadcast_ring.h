@@ -0,0 +1,56 @@
+#ifndef JX_BROADCAST_RING_H
+#define JX_BROADCAST_RING_H
+
+#include <stdint.h>
+
+namespace bx
+{
+struct AllocatorI;
+}
+
+namespace jx
+{
+struct BroadcastRing;
+
+#define JX_BROADCAST_RING_INVALID_CONSUMER UINT32_MAX
+
+struct BroadcastRingFlags
+{
+	enum Enum : uint32_t
+	{
+		None = 0,
+
+		// When the ring is full, push skips the slowest consumers ahead instead of failing.
+		// Skipped items are reported through broadcastRingGetNumDropped().
+		DropSlowConsumers = 1u << 0,
+	};
+};
+
+// Single-producer/multi-consumer ring. Every item is written once and read by all consumers,
+// each one having its own read cursor. Slots are reused only after all consumers have read
+// them (unless DropSlowConsumers is set).
+// capacity must be a power of 2.
+BroadcastRing* createBroadcastRing(bx::AllocatorI* allocator, uint32_t itemSize, uint32_t capacity, uint32_t maxConsumers, uint32_t flags = BroadcastRingFlags::None);
+void destroyBroadcastRing(BroadcastRing* ring);
+
+// Consumers start reading from the current producer position.
+uint32_t broadcastRingAddConsumer(BroadcastRing* ring);
+void broadcastRingRemoveConsumer(BroadcastRing* ring, uint32_t consumerID);
+
+// Producer
+bool broadcastRingPush(BroadcastRing* ring, const void* item);
+bool broadcastRingPushMessage(BroadcastRing* ring, uint32_t msgID, const void* data, uint32_t sz);
+
+// Consumers
+bool broadcastRingPop(BroadcastRing* ring, uint32_t consumerID, void* item);
+void broadcastRingSkip(BroadcastRing* ring, uint32_t consumerID, uint32_t numItems);
+void broadcastRingSkipToLatest(BroadcastRing* ring, uint32_t consumerID);
+
+// Monitoring (any thread)
+uint32_t broadcastRingGetLag(const BroadcastRing* ring, uint32_t consumerID);
+uint64_t broadcastRingGetNumDropped(const BroadcastRing* ring, uint32_t consumerID);
+uint32_t broadcastRingFindSlowestConsumer(const BroadcastRing* ring, uint32_t* lag);
+uint32_t broadcastRingGetCapacity(const BroadcastRing* ring);
+}
+
+#endif
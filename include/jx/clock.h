@@ -0,0 +1,41 @@
+#ifndef JX_CLOCK_H
+#define JX_CLOCK_H
+
+#include <stdint.h>
+
+namespace jx
+{
+struct ClockSource
+{
+	enum Enum : uint32_t
+	{
+		Monotonic,       // bx::getHPCounter()
+		TSC,             // rdtsc, calibrated against the monotonic clock
+		MonotonicScaled, // The TSC stopped being trusted after calibration; monotonic clock scaled to the TSC frequency
+	};
+};
+
+// Timestamp source for the profiler and other instrumentation. On x86 CPUs with an invariant
+// TSC, ticks are read directly from the TSC (no system call); the frequency is calibrated
+// against the monotonic clock and refined by clockResync(). Otherwise (no invariant TSC,
+// calibration mismatch, or the OS has marked the TSC unstable) the monotonic clock is used.
+//
+// If a resync finds that the TSC drifted away from the monotonic clock, the clock switches
+// to MonotonicScaled: ticks keep the same unit and remain continuous, so timestamps taken
+// before and after the switch can still be compared.
+//
+// clockInit() calibrates the TSC (takes a few milliseconds) and is called by initSystem().
+// The first clockGetTicks() call initializes the clock if it hasn't been initialized yet.
+void clockInit();
+
+// Refines the TSC frequency and checks it against the monotonic clock, at most once every
+// JX_CONFIG_CLOCK_RESYNC_INTERVAL_MS. Called by jx::frame().
+void clockResync();
+
+int64_t clockGetTicks();
+int64_t clockGetFrequency();
+int64_t clockTicksToNs(int64_t ticks);
+ClockSource::Enum clockGetSource();
+}
+
+#endif
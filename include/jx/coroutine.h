@@ -0,0 +1,299 @@
+#ifndef JX_COROUTINE_H
+#define JX_COROUTINE_H
+
+#include <jx/sys.h>
+
+#if JX_CONFIG_COROUTINES
+#include <stdint.h>
+#include <coroutine>
+#include <jx/allocator.h>
+#include <jx/thread.h>
+
+namespace bx
+{
+struct AllocatorI;
+}
+
+namespace jx
+{
+struct CoScheduler;
+struct TimerService;
+
+// Message IDs >= JX_CO_MSG_ID_FIRST_RESERVED are used internally by the scheduler.
+#define JX_CO_MSG_ID_FIRST_RESERVED 0xFFFFFF00u
+#define JX_CO_ANY_MESSAGE           UINT32_MAX
+
+typedef int32_t (*CoWorkFn)(void* userData);
+
+struct CoWaitNode
+{
+	CoWaitNode* m_Next;
+	std::coroutine_handle<> m_Handle;
+	ThreadMessage m_Msg;
+	uint32_t m_MsgID;
+};
+
+// A scheduler resumes coroutines on the jx::Thread it has been created for. The thread's
+// ThreadFn should forward every message it pops from its input queue to coSchedulerDispatch().
+// If the function returns false the message hasn't been consumed by any coroutine and it's
+// up to the caller to handle/release it.
+//
+// int32_t workerFunc(Thread* self, void* userData)
+// {
+//     CoScheduler* sched = (CoScheduler*)userData;
+//     ThreadMessage* msg = threadInQueuePop(self, -1);
+//     if (msg && !coSchedulerDispatch(sched, msg)) {
+//         ...
+//         threadReleaseMessage(self, msg);
+//     }
+//     return 1;
+// }
+//
+// Timers (coSleep()) require a TimerService. Work submitted with coRunOn() is executed by
+// the target thread's scheduler, so the target thread must dispatch its messages through
+// coSchedulerDispatch() as well.
+CoScheduler* createCoScheduler(bx::AllocatorI* allocator, Thread* thread, TimerService* timers = nullptr);
+void destroyCoScheduler(CoScheduler* sched);
+
+bool coSchedulerDispatch(CoScheduler* sched, ThreadMessage* msg);
+Thread* coSchedulerGetThread(const CoScheduler* sched);
+uint32_t coSchedulerGetNumWaiters(const CoScheduler* sched);
+
+// Internal (used by the awaiters below)
+void coSchedulerAddWaiter(CoScheduler* sched, CoWaitNode* node);
+bool coSchedulerPostResume(CoScheduler* sched, std::coroutine_handle<> handle);
+bool coSchedulerResumeAfter(CoScheduler* sched, std::coroutine_handle<> handle, uint32_t delay_msec);
+bool coSchedulerRunOn(CoScheduler* sched, Thread* worker, CoWorkFn func, void* userData, std::coroutine_handle<> handle, int32_t* result);
+
+template<typename T = void>
+class CoTask;
+
+namespace internal
+{
+struct CoPromiseBase
+{
+	std::coroutine_handle<> m_Continuation;
+	bool m_Detached = false;
+
+	struct FinalAwaiter
+	{
+		bool await_ready() const noexcept { return false; }
+
+		template<typename PromiseT>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<PromiseT> handle) noexcept
+		{
+			CoPromiseBase& promise = handle.promise();
+			if (promise.m_Continuation) {
+				return promise.m_Continuation;
+			}
+
+			if (promise.m_Detached) {
+				handle.destroy();
+			}
+
+			return std::noop_coroutine();
+		}
+
+		void await_resume() const noexcept {}
+	};
+
+	std::suspend_always initial_suspend() const noexcept { return {}; }
+	FinalAwaiter final_suspend() const noexcept { return {}; }
+	void unhandled_exception() noexcept { JX_CHECK(false, "Unhandled exception in coroutine"); }
+
+	// Coroutine frames are allocated from the global allocator.
+	static void* operator new(size_t sz) noexcept { return JX_ALLOC(sz); }
+	static void operator delete(void* ptr) noexcept { JX_FREE(ptr); }
+};
+
+template<typename T>
+struct CoPromise : CoPromiseBase
+{
+	T m_Value {};
+
+	void return_value(T value) { m_Value = static_cast<T&&>(value); }
+	T getValue() { return static_cast<T&&>(m_Value); }
+};
+
+template<>
+struct CoPromise<void> : CoPromiseBase
+{
+	void return_void() noexcept {}
+	void getValue() {}
+};
+}
+
+// Lazily started coroutine. Either co_await it from another coroutine or hand it over to
+// a scheduler with coSpawn().
+template<typename T>
+class CoTask
+{
+public:
+	struct promise_type : internal::CoPromise<T>
+	{
+		CoTask get_return_object() noexcept { return CoTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		static CoTask get_return_object_on_allocation_failure() noexcept { return CoTask(nullptr); }
+	};
+
+	CoTask() : m_Handle(nullptr) {}
+	explicit CoTask(std::coroutine_handle<promise_type> handle) : m_Handle(handle) {}
+	CoTask(CoTask&& other) noexcept : m_Handle(other.m_Handle) { other.m_Handle = nullptr; }
+	CoTask(const CoTask&) = delete;
+	CoTask& operator = (const CoTask&) = delete;
+
+	CoTask& operator = (CoTask&& other) noexcept
+	{
+		if (this != &other) {
+			if (m_Handle) {
+				m_Handle.destroy();
+			}
+			m_Handle = other.m_Handle;
+			other.m_Handle = nullptr;
+		}
+		return *this;
+	}
+
+	~CoTask()
+	{
+		if (m_Handle) {
+			m_Handle.destroy();
+		}
+	}
+
+	bool isValid() const { return (bool)m_Handle; }
+	bool isDone() const { return !m_Handle || m_Handle.done(); }
+
+	// Releases ownership of the coroutine frame. The frame destroys itself when the coroutine completes.
+	std::coroutine_handle<promise_type> detach()
+	{
+		std::coroutine_handle<promise_type> handle = m_Handle;
+		m_Handle = nullptr;
+		if (handle) {
+			handle.promise().m_Detached = true;
+		}
+		return handle;
+	}
+
+	// Awaiting an empty (default-constructed, moved-from or detached) task is an error. In
+	// release builds it resumes the awaiter immediately with a default-constructed value.
+	bool await_ready() const noexcept { return m_Handle && m_Handle.done(); }
+
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept
+	{
+		JX_CHECK(m_Handle, "Awaiting an empty CoTask");
+		if (!m_Handle) {
+			return awaiter;
+		}
+
+		m_Handle.promise().m_Continuation = awaiter;
+		return m_Handle;
+	}
+
+	T await_resume()
+	{
+		JX_CHECK(m_Handle, "Awaiting an empty CoTask");
+		if (!m_Handle) {
+			return T();
+		}
+
+		return m_Handle.promise().getValue();
+	}
+
+private:
+	std::coroutine_handle<promise_type> m_Handle;
+};
+
+struct CoRecvAwaiter
+{
+	CoScheduler* m_Sched;
+	CoWaitNode m_Node;
+
+	bool await_ready() const noexcept { return false; }
+
+	void await_suspend(std::coroutine_handle<> handle)
+	{
+		m_Node.m_Handle = handle;
+		coSchedulerAddWaiter(m_Sched, &m_Node);
+	}
+
+	ThreadMessage await_resume() const noexcept { return m_Node.m_Msg; }
+};
+
+struct CoSleepAwaiter
+{
+	CoScheduler* m_Sched;
+	uint32_t m_Delay;
+	bool m_Scheduled;
+
+	bool await_ready() const noexcept { return false; }
+
+	bool await_suspend(std::coroutine_handle<> handle)
+	{
+		m_Scheduled = coSchedulerResumeAfter(m_Sched, handle, m_Delay);
+		return m_Scheduled;
+	}
+
+	bool await_resume() const noexcept { return m_Scheduled; }
+};
+
+struct CoWorkAwaiter
+{
+	CoScheduler* m_Sched;
+	Thread* m_Worker;
+	CoWorkFn m_Func;
+	void* m_UserData;
+	int32_t m_Result;
+
+	bool await_ready() const noexcept { return false; }
+
+	bool await_suspend(std::coroutine_handle<> handle)
+	{
+		return coSchedulerRunOn(m_Sched, m_Worker, m_Func, m_UserData, handle, &m_Result);
+	}
+
+	int32_t await_resume() const noexcept { return m_Result; }
+};
+
+// Suspends until the scheduler's thread receives a message with the specified ID.
+inline CoRecvAwaiter coRecv(CoScheduler* sched, uint32_t msgID = JX_CO_ANY_MESSAGE)
+{
+	CoRecvAwaiter awaiter;
+	awaiter.m_Sched = sched;
+	awaiter.m_Node.m_Next = nullptr;
+	awaiter.m_Node.m_MsgID = msgID;
+	return awaiter;
+}
+
+// Suspends for (at least) the specified number of milliseconds. Returns false if the timer
+// couldn't be scheduled (the coroutine isn't suspended in this case).
+inline CoSleepAwaiter coSleep(CoScheduler* sched, uint32_t delay_msec)
+{
+	return CoSleepAwaiter { sched, delay_msec, false };
+}
+
+// Executes func(userData) on the worker thread and resumes on the scheduler's thread
+// with func's return value. Returns INT32_MIN if the request couldn't be submitted.
+inline CoWorkAwaiter coRunOn(CoScheduler* sched, Thread* worker, CoWorkFn func, void* userData)
+{
+	return CoWorkAwaiter { sched, worker, func, userData, INT32_MIN };
+}
+
+// Starts the task on the scheduler's thread. Can be called from any thread.
+inline bool coSpawn(CoScheduler* sched, CoTask<void>&& task)
+{
+	std::coroutine_handle<CoTask<void>::promise_type> handle = task.detach();
+	if (!handle) {
+		return false;
+	}
+
+	if (!coSchedulerPostResume(sched, handle)) {
+		handle.destroy();
+		return false;
+	}
+
+	return true;
+}
+}
+#endif // JX_CONFIG_COROUTINES
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef JX_CPU_H
+#define JX_CPU_H
+
+#include <stdint.h>
+#include <jx/sys.h> // JX_CONFIG_MAX_CPUS
+
+namespace bx
+{
+struct AllocatorI;
+}
+
+namespace jx
+{
+// Fixed-size set of logical CPU indices (as numbered by the OS).
+struct CPUSet
+{
+	uint64_t m_Bits[(JX_CONFIG_MAX_CPUS + 63) / 64];
+};
+
+struct CPUCacheType
+{
+	enum Enum : uint32_t
+	{
+		Unified,
+		Data,
+		Instruction
+	};
+};
+
+struct CPUCache
+{
+	CPUSet m_SharedCPUs;      // Logical CPUs sharing this cache
+	CPUCacheType::Enum m_Type;
+	uint32_t m_Level;
+	uint32_t m_Size;          // In bytes
+	uint32_t m_LineSize;      // In bytes
+	uint32_t m_Associativity;
+};
+
+struct CPULogicalCore
+{
+	uint32_t m_ID;            // OS CPU index (use this with CPUSet)
+	uint32_t m_PhysicalCoreID; // Index into the topology's physical core list
+	uint32_t m_PackageID;
+	uint32_t m_NUMANodeID;    // Index into the topology's NUMA node list
+};
+
+struct CPUPhysicalCore
+{
+	CPUSet m_SMTSiblings;     // All logical CPUs running on this core
+	uint32_t m_PackageID;
+	uint32_t m_NUMANodeID;
+	uint32_t m_NumLogicalCores;
+};
+
+struct CPUNUMANode
+{
+	CPUSet m_CPUs;
+	uint32_t m_ID;            // OS node index
+};
+
+struct CPUTopology;
+
+// Linux: read from /sys/devices/system/{cpu,node}. Windows: GetLogicalProcessorInformationEx(),
+// limited to the first processor group (64 logical CPUs). Other platforms report a flat topology
+// (one core per logical CPU, no caches).
+CPUTopology* createCPUTopology(bx::AllocatorI* allocator);
+void destroyCPUTopology(CPUTopology* topo);
+
+uint32_t cpuTopoGetNumLogicalCores(const CPUTopology* topo);
+uint32_t cpuTopoGetNumPhysicalCores(const CPUTopology* topo);
+uint32_t cpuTopoGetNumPackages(const CPUTopology* topo);
+uint32_t cpuTopoGetNumCaches(const CPUTopology* topo);
+uint32_t cpuTopoGetNumNUMANodes(const CPUTopology* topo);
+
+const CPULogicalCore* cpuTopoGetLogicalCore(const CPUTopology* topo, uint32_t id);
+const CPUPhysicalCore* cpuTopoGetPhysicalCore(const CPUTopology* topo, uint32_t id);
+const CPUCache* cpuTopoGetCache(const CPUTopology* topo, uint32_t id);
+const CPUNUMANode* cpuTopoGetNUMANode(const CPUTopology* topo, uint32_t id);
+
+// Returns the largest cache of the specified level the CPU belongs to or nullptr if not found.
+const CPUCache* cpuTopoFindCache(const CPUTopology* topo, uint32_t cpuID, uint32_t level);
+
+// Set of all online logical CPUs.
+void cpuTopoGetAllCPUs(const CPUTopology* topo, CPUSet* set);
+
+// Set containing the first logical CPU of each physical core (i.e. no SMT siblings).
+void cpuTopoGetPhysicalCoreSet(const CPUTopology* topo, CPUSet* set);
+
+uint32_t getCurrentCPU();
+
+// Spin-wait hint (PAUSE on x86, YIELD on ARM).
+void cpuPause();
+
+void cpuSetClear(CPUSet* set);
+void cpuSetAdd(CPUSet* set, uint32_t cpu);
+void cpuSetRemove(CPUSet* set, uint32_t cpu);
+bool cpuSetContains(const CPUSet* set, uint32_t cpu);
+bool cpuSetIsEmpty(const CPUSet* set);
+bool cpuSetEqual(const CPUSet* a, const CPUSet* b);
+uint32_t cpuSetCount(const CPUSet* set);
+
+// Returns the first CPU in the set with index >= first, or UINT32_MAX if there is none.
+uint32_t cpuSetNext(const CPUSet* set, uint32_t first);
+
+// Parses a Linux cpulist string (e.g. "0-3,8,10-11").
+bool cpuSetFromString(CPUSet* set, const char* str);
+}
+
+#include "inline/cpu.inl"
+
+#endif
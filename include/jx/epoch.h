@@ -0,0 +1,54 @@
+#ifndef JX_EPOCH_H
+#define JX_EPOCH_H
+
+#include <stdint.h>
+
+namespace bx
+{
+struct AllocatorI;
+}
+
+namespace jx
+{
+struct EpochDomain;
+
+#define JX_EPOCH_INVALID_THREAD UINT32_MAX
+
+typedef void (*EpochRetireFn)(void* ptr, void* userData);
+
+// Quiescent-state based reclamation. Readers access shared data through epochRead()
+// without taking locks or writing to shared memory. Writers publish a new version with
+// epochPublish() and hand the old one to epochRetire(). Retired objects are destroyed by
+// epochReclaim() once every registered (online) thread has announced a quiescent state
+// (i.e. a point where it doesn't hold any pointer obtained through epochRead()) after
+// the object has been retired.
+//
+// Threads which might block for a long time (e.g. waiting on their message queue) should
+// go offline first, otherwise they delay reclamation.
+EpochDomain* createEpochDomain(bx::AllocatorI* allocator, uint32_t maxThreads);
+void destroyEpochDomain(EpochDomain* domain);
+
+uint32_t epochRegisterThread(EpochDomain* domain);
+void epochUnregisterThread(EpochDomain* domain, uint32_t threadID);
+
+void epochQuiescent(EpochDomain* domain, uint32_t threadID);
+void epochThreadOffline(EpochDomain* domain, uint32_t threadID);
+void epochThreadOnline(EpochDomain* domain, uint32_t threadID);
+
+// Can be called from any thread. fn(ptr, userData) is called from the thread which
+// reclaims the object and must not call back into the domain.
+bool epochRetire(EpochDomain* domain, void* ptr, EpochRetireFn fn, void* userData);
+
+// Returns the number of destroyed objects.
+uint32_t epochReclaim(EpochDomain* domain);
+uint32_t epochGetNumRetired(EpochDomain* domain);
+
+// Snapshot access
+void* epochRead(void* const volatile* slot);
+void* epochPublish(void* volatile* slot, void* ptr);
+bool epochPublishAndRetire(EpochDomain* domain, void* volatile* slot, void* ptr, EpochRetireFn fn, void* userData);
+}
+
+#include "inline/epoch.inl"
+
+#endif
@@ -63,6 +63,7 @@ struct FileTimeType
 };
 
 struct File;
+struct MappedFile;
 
 typedef void (*EnumFilesCallback)(const char* relPath, bool isFile, void* userData);
 
@@ -84,11 +85,24 @@ File* fsFileOpenWrite(BaseDir::Enum baseDir, const char* relPath);
 void fsFileClose(File* f);
 uint32_t fsFileReadBytes(File* f, void* buffer, uint32_t len);
 uint32_t fsFileWriteBytes(File* f, const void* buffer, uint32_t len);
+bool fsFileFlush(File* f);
+
+// Reserves disk space for the file without changing its size, so subsequent writes don't
+// have to allocate blocks. Returns false if the platform/file system doesn't support it.
+bool fsFileReserve(File* f, uint64_t size);
 uint64_t fsFileGetSize(File* f);
 void fsFileSeek(File* f, int64_t offset, SeekOrigin::Enum origin);
 int64_t fsFileTell(File* f);
 bool fsFileGetTime(File* f, jx::FileTimeType::Enum type, FileTime* t);
 
+// Creates the file (truncating an existing one) with the specified size and maps it into
+// memory with write access. Modified pages are written back by the OS even if the process
+// crashes.
+MappedFile* fsMappedFileOpenWrite(BaseDir::Enum baseDir, const char* relPath, uint64_t size);
+void fsMappedFileClose(MappedFile* mf);
+void* fsMappedFileGetPtr(MappedFile* mf);
+uint64_t fsMappedFileGetSize(MappedFile* mf);
+
 bool fsRemoveFile(BaseDir::Enum baseDir, const char* relPath);
 bool fsCopyFile(BaseDir::Enum srcBaseDir, const char* srcPath, BaseDir::Enum dstBaseDir, const char* dstPath);
 bool fsMoveFile(BaseDir::Enum srcBaseDir, const char* srcPath, BaseDir::Enum dstBaseDir, const char* dstPath);
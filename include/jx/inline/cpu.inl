@@ -0,0 +1,96 @@
+#ifndef JX_CPU_H
+#error "Must be included from jx/cpu.h"
+#endif
+
+#include <bx/uint32_t.h>
+
+#if BX_CPU_X86
+#include <emmintrin.h> // _mm_pause()
+#endif
+
+namespace jx
+{
+inline void cpuPause()
+{
+#if BX_CPU_X86
+	_mm_pause();
+#elif BX_CPU_ARM && (BX_COMPILER_GCC || BX_COMPILER_CLANG)
+	__asm__ __volatile__("yield" ::: "memory");
+#endif
+}
+
+inline void cpuSetClear(CPUSet* set)
+{
+	for (uint32_t i = 0; i < BX_COUNTOF(set->m_Bits); ++i) {
+		set->m_Bits[i] = 0;
+	}
+}
+
+inline void cpuSetAdd(CPUSet* set, uint32_t cpu)
+{
+	JX_CHECK(cpu < JX_CONFIG_MAX_CPUS, "Invalid CPU index");
+	set->m_Bits[cpu >> 6] |= (1ull << (cpu & 63));
+}
+
+inline void cpuSetRemove(CPUSet* set, uint32_t cpu)
+{
+	JX_CHECK(cpu < JX_CONFIG_MAX_CPUS, "Invalid CPU index");
+	set->m_Bits[cpu >> 6] &= ~(1ull << (cpu & 63));
+}
+
+inline bool cpuSetContains(const CPUSet* set, uint32_t cpu)
+{
+	return cpu < JX_CONFIG_MAX_CPUS
+		&& (set->m_Bits[cpu >> 6] & (1ull << (cpu & 63))) != 0
+		;
+}
+
+inline bool cpuSetIsEmpty(const CPUSet* set)
+{
+	for (uint32_t i = 0; i < BX_COUNTOF(set->m_Bits); ++i) {
+		if (set->m_Bits[i] != 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+inline bool cpuSetEqual(const CPUSet* a, const CPUSet* b)
+{
+	for (uint32_t i = 0; i < BX_COUNTOF(a->m_Bits); ++i) {
+		if (a->m_Bits[i] != b->m_Bits[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+inline uint32_t cpuSetCount(const CPUSet* set)
+{
+	uint32_t n = 0;
+	for (uint32_t i = 0; i < BX_COUNTOF(set->m_Bits); ++i) {
+		const uint64_t qword = set->m_Bits[i];
+		n += bx::uint32_cntbits((uint32_t)(qword & 0xFFFFFFFF)) + bx::uint32_cntbits((uint32_t)(qword >> 32));
+	}
+
+	return n;
+}
+
+inline uint32_t cpuSetNext(const CPUSet* set, uint32_t first)
+{
+	for (uint32_t qwordID = first >> 6; qwordID < BX_COUNTOF(set->m_Bits); ++qwordID) {
+		uint64_t qword = set->m_Bits[qwordID];
+		if (qwordID == (first >> 6)) {
+			qword &= ~((1ull << (first & 63)) - 1);
+		}
+
+		if (qword != 0) {
+			return qwordID * 64 + (uint32_t)bx::uint64_cnttz(qword);
+		}
+	}
+
+	return UINT32_MAX;
+}
+}
@@ -0,0 +1,28 @@
+#ifndef JX_EPOCH_H
+#error "Must be included from jx/epoch.h"
+#endif
+
+#include <bx/cpu.h>
+
+namespace jx
+{
+inline void* epochRead(void* const volatile* slot)
+{
+	void* ptr = *slot;
+	bx::readBarrier();
+	return ptr;
+}
+
+// Returns the previous version.
+inline void* epochPublish(void* volatile* slot, void* ptr)
+{
+	bx::memoryBarrier();
+	return bx::atomicExchangePtr((void**)slot, ptr);
+}
+
+inline bool epochPublishAndRetire(EpochDomain* domain, void* volatile* slot, void* ptr, EpochRetireFn fn, void* userData)
+{
+	void* oldPtr = epochPublish(slot, ptr);
+	return oldPtr ? epochRetire(domain, oldPtr, fn, userData) : true;
+}
+}
@@ -0,0 +1,106 @@
+#ifndef JX_LOGGER_H
+#error "Must be included from jx/logger.h"
+#endif
+
+#include <bx/bx.h>
+
+namespace jx
+{
+inline void logArgPush(LogArgBuffer* buf, LogArgType::Enum type, const void* value, uint32_t sz)
+{
+	// Arguments which don't fit are dropped; the formatter prints their conversion
+	// specifications as-is.
+	if (buf->m_Size + 1 + sz > JX_LOGGER_MAX_DEFERRED_ARGS_SIZE) {
+		buf->m_Size = JX_LOGGER_MAX_DEFERRED_ARGS_SIZE;
+		return;
+	}
+
+	buf->m_Data[buf->m_Size] = (uint8_t)type;
+	bx::memCopy(&buf->m_Data[buf->m_Size + 1], value, sz);
+	buf->m_Size += 1 + sz;
+}
+
+inline void logArgEncode(LogArgBuffer* buf, int32_t v)            { logArgPush(buf, LogArgType::Int32, &v, sizeof(v)); }
+inline void logArgEncode(LogArgBuffer* buf, uint32_t v)           { logArgPush(buf, LogArgType::UInt32, &v, sizeof(v)); }
+inline void logArgEncode(LogArgBuffer* buf, long long v)          { logArgPush(buf, LogArgType::Int64, &v, sizeof(v)); }
+inline void logArgEncode(LogArgBuffer* buf, unsigned long long v) { logArgPush(buf, LogArgType::UInt64, &v, sizeof(v)); }
+inline void logArgEncode(LogArgBuffer* buf, double v)             { logArgPush(buf, LogArgType::Double, &v, sizeof(v)); }
+inline void logArgEncode(LogArgBuffer* buf, bool v)               { logArgEncode(buf, (int32_t)v); }
+inline void logArgEncode(LogArgBuffer* buf, char v)               { logArgEncode(buf, (int32_t)v); }
+inline void logArgEncode(LogArgBuffer* buf, signed char v)        { logArgEncode(buf, (int32_t)v); }
+inline void logArgEncode(LogArgBuffer* buf, unsigned char v)      { logArgEncode(buf, (int32_t)v); }
+inline void logArgEncode(LogArgBuffer* buf, short v)              { logArgEncode(buf, (int32_t)v); }
+inline void logArgEncode(LogArgBuffer* buf, unsigned short v)     { logArgEncode(buf, (int32_t)v); }
+inline void logArgEncode(LogArgBuffer* buf, float v)              { logArgEncode(buf, (double)v); }
+
+inline void logArgEncode(LogArgBuffer* buf, long v)
+{
+	if (sizeof(long) == sizeof(int32_t)) {
+		logArgEncode(buf, (int32_t)v);
+	} else {
+		logArgEncode(buf, (long long)v);
+	}
+}
+
+inline void logArgEncode(LogArgBuffer* buf, unsigned long v)
+{
+	if (sizeof(unsigned long) == sizeof(uint32_t)) {
+		logArgEncode(buf, (uint32_t)v);
+	} else {
+		logArgEncode(buf, (unsigned long long)v);
+	}
+}
+
+inline void logArgEncode(LogArgBuffer* buf, const char* str)
+{
+	if (!str) {
+		str = "(null)";
+	}
+
+	uint32_t len = 0;
+	while (str[len] != '\0' && len < JX_LOGGER_MAX_STRING_ARG_LENGTH) {
+		++len;
+	}
+
+	const uint16_t sz = (uint16_t)(len + 1);
+	if (buf->m_Size + 1 + sizeof(uint16_t) + sz > JX_LOGGER_MAX_DEFERRED_ARGS_SIZE) {
+		buf->m_Size = JX_LOGGER_MAX_DEFERRED_ARGS_SIZE;
+		return;
+	}
+
+	uint8_t* dst = &buf->m_Data[buf->m_Size];
+	dst[0] = (uint8_t)LogArgType::String;
+	bx::memCopy(&dst[1], &sz, sizeof(uint16_t));
+	bx::memCopy(&dst[1 + sizeof(uint16_t)], str, len);
+	dst[1 + sizeof(uint16_t) + len] = '\0';
+	buf->m_Size += 1 + sizeof(uint16_t) + sz;
+}
+
+inline void logArgEncode(LogArgBuffer* buf, char* str)
+{
+	logArgEncode(buf, (const char*)str);
+}
+
+template<typename T>
+inline void logArgEncode(LogArgBuffer* buf, T* ptr)
+{
+	const uint64_t v = (uint64_t)(uintptr_t)ptr;
+	logArgPush(buf, LogArgType::Pointer, &v, sizeof(v));
+}
+
+template<typename... ArgsT>
+inline void logb(Logger* logger, LogLevel::Enum level, uint32_t fmtID, ArgsT... args)
+{
+	if (!loggerIsLevelEnabled(logger, level) || fmtID == JX_LOGGER_INVALID_FORMAT_ID) {
+		return;
+	}
+
+	LogArgBuffer buf;
+	buf.m_Size = 0;
+
+	const int encoded[] = { 0, (logArgEncode(&buf, args), 0)... };
+	BX_UNUSED(encoded);
+
+	logDeferred(logger, level, fmtID, &buf);
+}
+}
@@ -0,0 +1,95 @@
+#ifndef JX_LATENCY_H
+#define JX_LATENCY_H
+
+#include <stdint.h>
+
+namespace bx
+{
+struct AllocatorI;
+}
+
+namespace jx
+{
+struct LatencyTracker;
+
+struct LatencyTrackerFlags
+{
+	enum Enum : uint32_t
+	{
+		Multithreaded = 1u << 0,
+
+		// Spikes call profilerTriggerCapture() (see ProfilerCaptureMode::Triggered) so the
+		// frames around them can be inspected.
+		TriggerCapture = 1u << 1,
+		LogSpikes = 1u << 2,
+	};
+};
+
+// Samples are kept in m_NumSubWindows log-linear histograms (~3% relative error), each one
+// covering m_Window_ms / m_NumSubWindows. The oldest one is cleared when the window slides,
+// so memory usage doesn't depend on the number of samples.
+struct LatencyTrackerDesc
+{
+	uint32_t m_Flags;
+	uint32_t m_Window_ms;
+	uint32_t m_NumSubWindows;
+};
+
+// A sample is a spike if it exceeds the absolute threshold, or the median of the window
+// (updated every sub-window) multiplied by the median factor (0: disabled).
+struct LatencySpikeDesc
+{
+	int64_t m_Threshold_ns;
+	float m_MedianFactor;
+};
+
+struct LatencyStats
+{
+	uint64_t m_Count;
+	int64_t m_Min_ns;
+	int64_t m_Max_ns;
+	int64_t m_Avg_ns;
+	int64_t m_P50_ns;
+	int64_t m_P90_ns;
+	int64_t m_P99_ns;
+	int64_t m_P999_ns;
+	uint32_t m_NumSpikes;     // In the current window
+	uint32_t m_TotalSpikes;   // Since the tracker has been created
+	int64_t m_LastSpike_ns;   // Duration of the last spike
+};
+
+// name must stay alive for the lifetime of the tracker.
+LatencyTracker* createLatencyTracker(bx::AllocatorI* allocator, const char* name, const LatencyTrackerDesc* desc);
+void destroyLatencyTracker(LatencyTracker* tracker);
+
+const char* latencyTrackerGetName(const LatencyTracker* tracker);
+void latencyTrackerSetSpikeDesc(LatencyTracker* tracker, const LatencySpikeDesc* desc);
+
+// Returns true if the sample is a spike.
+bool latencyTrackerAddSample(LatencyTracker* tracker, int64_t duration_ns);
+bool latencyTrackerGetStats(LatencyTracker* tracker, LatencyStats* stats);
+int64_t latencyTrackerGetPercentile(LatencyTracker* tracker, float percentile);
+void latencyTrackerReset(LatencyTracker* tracker);
+
+// Named intervals. The returned timestamp should be passed to latencyIntervalEnd() on the
+// same tracker.
+int64_t latencyIntervalBegin();
+bool latencyIntervalEnd(LatencyTracker* tracker, int64_t beginTime);
+
+struct LatencyScope
+{
+	LatencyScope(LatencyTracker* tracker) : m_Tracker(tracker), m_BeginTime(latencyIntervalBegin())
+	{
+	}
+
+	~LatencyScope()
+	{
+		latencyIntervalEnd(m_Tracker, m_BeginTime);
+	}
+
+	LatencyTracker* m_Tracker;
+	int64_t m_BeginTime;
+};
+}
+
+#endif
@@ -3,10 +3,12 @@
 
 #include <stdint.h>
 #include "fs.h"
+#include "sys.h" // JX_CONFIG_LOG_MIN_LEVEL
 
 namespace jx
 {
 struct Logger;
+struct LogSink;
 
 struct LogLevel
 {
@@ -23,22 +25,247 @@ struct LoggerFlags
 {
 	enum Enum : uint32_t
 	{
+		// The file is flushed after every record (after every batch for Async loggers).
+		// Slow; see loggerEnableFlightRecorder() for a cheaper way to keep the last records
+		// if the process crashes.
 		FlushOnEveryLog = 1 << 0,
+
+		// Local date and time with microsecond resolution (YYYY-MM-DD HH:MM:SS.uuuuuu).
+		// Timestamps come from the monotonic high-resolution timer, anchored to the
+		// wall clock when the logger is created.
 		AppendTimestamp = 1 << 1,
 		Multithreaded = 1 << 2,
+
+		// Callers format the line and append it to a per-thread ring buffer
+		// (JX_CONFIG_LOGGER_THREAD_BUFFER_SIZE bytes). A background thread collects the
+		// records, writes them to the file in large batches and forwards them to the
+		// sinks. Callbacks and other sinks run on their own threads (see LogSinkDesc), so
+		// they may run concurrently with the thread which logged the record and with each
+		// other. Records from the same thread are written in order. Every sink receives
+		// records in file order, but sinks don't wait for each other. The file is flushed
+		// after Error records and when the logger is destroyed. Implies Multithreaded.
+		Async = 1 << 3,
+
+		// Writes <name>.jxlog instead of <name>.log. Deferred records (logb()) are stored
+		// unformatted; use logDecodeBinary() to convert the file to text. Implies Async.
+		Binary = 1 << 4,
+
+		// Microseconds since the Unix epoch as an integer, in front of the date/time
+		// (if any), for tools which parse the log.
+		NumericTimestamp = 1 << 5,
+	};
+};
+
+#define JX_LOGGER_MAX_DEFERRED_ARGS_SIZE 1024
+#define JX_LOGGER_MAX_STRING_ARG_LENGTH  512
+#define JX_LOGGER_INVALID_FORMAT_ID      UINT32_MAX
+
+struct LogArgType
+{
+	enum Enum : uint8_t
+	{
+		Int32,
+		UInt32,
+		Int64,
+		UInt64,
+		Double,
+		Pointer,
+		String, // uint16_t length (including the terminator) followed by the characters
 	};
 };
 
+// Arguments of a deferred record. Each one is stored as its LogArgType followed by the
+// raw value, using the type the argument would have after the default argument promotions.
+struct LogArgBuffer
+{
+	uint8_t m_Data[JX_LOGGER_MAX_DEFERRED_ARGS_SIZE];
+	uint32_t m_Size;
+};
+
+// Rotating loggers write to a sequence of segments named <name>.NNNNNN.log (.jxlog for
+// Binary loggers). Numbering continues after the segments found on disk when the logger is
+// created. The next segment is opened and preallocated ahead of time, so rotating only
+// switches to the other file. Async loggers rotate on the writer thread, which also prepares
+// the next segment and deletes old ones. Other loggers rotate inside the logf() call which
+// crosses the limit; a background thread closes the previous segment, prepares the next
+// one and deletes old ones, so logging threads never wait for them. If the next segment
+// isn't ready yet, records keep going to the current one.
+struct LogRotationDesc
+{
+	uint64_t m_MaxSegmentSize;         // Bytes (0: no size limit). A record is never split between segments.
+	uint32_t m_MaxSegmentDuration_sec; // Checked when a record is written (0: no time limit)
+	uint32_t m_MaxSegments;            // Older segments are deleted, including ones from previous runs (0: keep all)
+	uint64_t m_PreallocSize;           // Disk space reserved for each segment (0: m_MaxSegmentSize)
+};
+
+// Storm suppression. Every call site gets a token bucket which holds up to m_Burst records
+// and refills at m_RecordsPerSec. Records which find the bucket empty are dropped before
+// they are formatted. Dropped records are reported as "Suppressed N similar messages" at
+// most every m_SummaryInterval_sec while the storm lasts, and once after it ends.
+struct LogRateLimitDesc
+{
+	uint32_t m_Burst;
+	uint32_t m_RecordsPerSec; // 0: rate limiting disabled
+	uint32_t m_SummaryInterval_sec; // At least 1
+};
+
+// Static description of a JX_LOG/JX_LOGB call site. The fingerprint combines the format
+// string and the source location.
+struct LogSite
+{
+	const char* m_Format;
+	const char* m_File;
+	uint32_t m_Line;
+	uint64_t m_Fingerprint;
+};
+
 typedef void (*LoggingCallback)(LogLevel::Enum level, const char* str, void* userData);
 
-Logger* createLog(jx::BaseDir::Enum baseDir, const char* name, uint32_t flags);
+// A formatted record as delivered to sinks. m_Line is null-terminated and includes the
+// level symbol and the timestamp; the message itself starts at m_TextOffset.
+struct LogRecord
+{
+	const char* m_Line;
+	uint32_t m_LineLen;
+	uint32_t m_TextOffset;
+	LogLevel::Enum m_Level;
+};
+
+typedef void (*LogSinkWriteCallback)(const LogRecord* records, uint32_t numRecords, void* userData);
+typedef void (*LogSinkDestroyCallback)(void* userData);
+
+// Every sink has its own thread and record queue (m_QueueSize bytes, 0 for
+// JX_CONFIG_LOGGER_SINK_QUEUE_SIZE). Records are copied to the queues of all interested
+// sinks after they have been written to the logger's file, and the sink thread consumes
+// them in batches. Records are dropped, not waited for, if a sink can't keep up; the sink
+// gets a record with the number of dropped records when it catches up.
+// m_DestroyFunc (optional) is called on the sink thread after the last batch.
+struct LogSinkDesc
+{
+	LogSinkWriteCallback m_WriteFunc;
+	LogSinkDestroyCallback m_DestroyFunc;
+	void* m_UserData;
+	const char* m_Name;
+	LogLevel::Enum m_MinLevel;
+	uint32_t m_QueueSize;
+};
+
+Logger* createLog(jx::BaseDir::Enum baseDir, const char* name, uint32_t flags, const LogRotationDesc* rotation = nullptr);
 void destroyLog(Logger* logger);
 
 const char* loggerGetName(Logger* logger);
+
+// Name of the file currently written to, relative to the logger's base dir.
+// Returns false if the logger doesn't write to a file.
+bool loggerGetFilename(Logger* logger, char* buffer, uint32_t maxLen);
+
+// Sinks can be added and removed at any time from Multithreaded/Async loggers. Other
+// loggers must only be modified from the thread which logs.
+// Returns nullptr if JX_CONFIG_LOGGER_MAX_SINKS has been reached.
+LogSink* loggerAddSink(Logger* logger, const LogSinkDesc* desc);
+void loggerRemoveSink(Logger* logger, LogSink* sink); // Waits for the sink to process its queue
+void logSinkSetLevel(LogSink* sink, LogLevel::Enum level);
+uint32_t logSinkGetNumDropped(const LogSink* sink);
+
+// Built-in sinks
+LogSink* loggerAddFileSink(Logger* logger, jx::BaseDir::Enum baseDir, const char* relPath, LogLevel::Enum minLevel);
+LogSink* loggerAddStdoutSink(Logger* logger, LogLevel::Enum minLevel);
+LogSink* loggerAddCallbackSink(Logger* logger, LoggingCallback cb, void* userData, LogLevel::Enum minLevel);
+
+// Keeps the most recent records (up to capacity bytes) in memory, e.g. to show them in
+// an in-game console or attach them to a crash report.
+LogSink* loggerAddMemorySink(Logger* logger, uint32_t capacity, LogLevel::Enum minLevel);
+
+// Copies the most recent complete lines which fit in the buffer (null-terminated). Can be
+// called from any thread. Returns the number of characters copied.
+uint32_t logMemorySinkRead(LogSink* sink, char* buffer, uint32_t maxLen);
+
+// Callback sinks receiving every level. The callback runs on the sink's thread and
+// receives the message text without the level symbol and the timestamp.
 uint32_t loggerRegisterCallback(Logger* logger, LoggingCallback cb, void* userData);
 void loggerUnregisterCallback(Logger* logger, uint32_t cbID);
 
+// Records below the logger's level are discarded before any formatting takes place. The
+// level can be changed at any time, from any thread. New loggers log everything.
+void loggerSetLevel(Logger* logger, LogLevel::Enum level);
+LogLevel::Enum loggerGetLevel(const Logger* logger);
+bool loggerIsLevelEnabled(const Logger* logger, LogLevel::Enum level);
+
+// Only records logged through JX_LOG/JX_LOGB (or checked manually with
+// loggerCheckRateLimit()) are rate limited. Should be called before other threads start
+// logging; desc can be nullptr to disable rate limiting.
+void loggerSetRateLimit(Logger* logger, const LogRateLimitDesc* desc);
+uint64_t loggerMakeFingerprint(const char* fmt, const char* file, uint32_t line);
+
+// Flight recorder. Every record is also copied to a ring buffer (capacity bytes, rounded up
+// to a power of 2) in a memory-mapped file by the thread which logs it. Writing is a memory
+// copy without system calls, and the OS writes the pages to the file even if the process
+// crashes (but not if the machine loses power). Async loggers format deferred records on
+// the calling thread while the recorder is enabled.
+// The file is recreated, so dump the previous one (logDumpFlightRecorder()) first. Should
+// be called before other threads start logging; relPath can be nullptr to disable the
+// recorder.
+bool loggerEnableFlightRecorder(Logger* logger, jx::BaseDir::Enum baseDir, const char* relPath, uint32_t capacity);
+
+// Returns false if the record should be dropped. May log a summary of the records
+// suppressed so far.
+bool loggerCheckRateLimit(Logger* logger, LogLevel::Enum level, const LogSite* site);
+
 void logf(Logger* logger, LogLevel::Enum level, const char* fmt, ...);
+
+// Deferred formatting. The caller only stores the format ID, the raw arguments and a
+// timestamp; the text is produced by the writer thread (Async loggers), by
+// logDecodeBinary() (Binary loggers) or immediately (all other loggers).
+// Format strings must stay alive for the lifetime of the process (i.e. string literals).
+// Returns JX_LOGGER_INVALID_FORMAT_ID if JX_CONFIG_LOGGER_MAX_FORMATS has been reached or
+// the format is longer than a log line.
+uint32_t loggerRegisterFormat(const char* fmt);
+const char* loggerGetFormat(uint32_t fmtID);
+void logDeferred(Logger* logger, LogLevel::Enum level, uint32_t fmtID, const LogArgBuffer* args);
+
+template<typename... ArgsT>
+void logb(Logger* logger, LogLevel::Enum level, uint32_t fmtID, ArgsT... args);
+
+// Converts a Binary log to text (same line format as a text log with a timestamp).
+// A truncated last record (e.g. after a crash) ends the log. Returns false if the file
+// isn't a Binary log or contains a malformed record.
+bool logDecodeBinary(File* src, File* dst);
+
+// Writes the last maxRecords complete records of a flight recorder file (oldest first).
+// Records which were being written when the process died are skipped.
+bool logDumpFlightRecorder(File* src, File* dst, uint32_t maxRecords);
 }
 
+// The level and the rate limit are checked before the arguments are evaluated. Levels below
+// JX_CONFIG_LOG_MIN_LEVEL are compiled out when _level is a constant.
+// _fmt must be a string literal: the call site (and the format ID of JX_LOGB) is set up
+// on the first call only, so a format which changes between calls would be misreported.
+// Anything else fails to compile; use logf()/logDeferred() directly for dynamic formats.
+#define JX_LOG(_logger, _level, _fmt, ...) \
+	do { \
+		jx::Logger* _jxLogger = (_logger); \
+		if ((_level) >= JX_CONFIG_LOG_MIN_LEVEL && jx::loggerIsLevelEnabled(_jxLogger, _level)) { \
+			static const jx::LogSite s_LogSite = { "" _fmt, __FILE__, __LINE__, jx::loggerMakeFingerprint("" _fmt, __FILE__, __LINE__) }; \
+			if (jx::loggerCheckRateLimit(_jxLogger, _level, &s_LogSite)) { \
+				jx::logf(_jxLogger, _level, _fmt, ##__VA_ARGS__); \
+			} \
+		} \
+	} while (0)
+
+// Same as JX_LOG (string literal formats only) for deferred records. Registers the format
+// on first use.
+#define JX_LOGB(_logger, _level, _fmt, ...) \
+	do { \
+		jx::Logger* _jxLogger = (_logger); \
+		if ((_level) >= JX_CONFIG_LOG_MIN_LEVEL && jx::loggerIsLevelEnabled(_jxLogger, _level)) { \
+			static const jx::LogSite s_LogSite = { "" _fmt, __FILE__, __LINE__, jx::loggerMakeFingerprint("" _fmt, __FILE__, __LINE__) }; \
+			static const uint32_t s_LogFormatID = jx::loggerRegisterFormat("" _fmt); \
+			if (jx::loggerCheckRateLimit(_jxLogger, _level, &s_LogSite)) { \
+				jx::logb(_jxLogger, _level, s_LogFormatID, ##__VA_ARGS__); \
+			} \
+		} \
+	} while (0)
+
+#include "inline/logger.inl"
+
 #endif
@@ -11,6 +11,8 @@ struct AllocatorI;
 
 namespace jx
 {
+struct WorkerPool;
+
 static const double kPid = 3.1415926535897932384626433832795;
 
 uint32_t nextPowerOf2(uint32_t v);
@@ -45,6 +47,10 @@ uint32_t locate2d(const double* arr, uint32_t n, double val);
 void interp1f(const float* x, const float* y, uint32_t n, const float* xq, float* yq, uint32_t nq);
 void interp1d(const double* x, const double* y, uint32_t n, const double* xq, double* yq, uint32_t nq);
 
+// Same as above but the queries are split across the pool's workers. pool can be nullptr.
+void interp1fParallel(WorkerPool* pool, const float* x, const float* y, uint32_t n, const float* xq, float* yq, uint32_t nq);
+void interp1dParallel(WorkerPool* pool, const double* x, const double* y, uint32_t n, const double* xq, double* yq, uint32_t nq);
+
 bool cubicSplineInterp1f(const float* x, const float* y, uint32_t n, const float* resX, float* resY, uint32_t resN, bx::AllocatorI* allocator);
 
 double toDeg(double rad);
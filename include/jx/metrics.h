@@ -0,0 +1,89 @@
+#ifndef JX_METRICS_H
+#define JX_METRICS_H
+
+#include <stdint.h>
+#include <jx/sys.h> // JX_CONFIG_METRICS_xxx
+
+namespace bx
+{
+struct AllocatorI;
+}
+
+namespace jx
+{
+#define JX_METRICS_INVALID_ID UINT32_MAX
+
+struct MetricType
+{
+	enum Enum : uint32_t
+	{
+		Counter, // Values are added up (e.g. bytes processed)
+		Gauge,   // Values replace each other (e.g. queue depth)
+	};
+};
+
+// Values reported during a single interval. For counters m_Sum is the interval's total;
+// for gauges m_Sum / m_Count is the average. Gauges which haven't been set during an
+// interval keep their previous value (m_Count is 0).
+struct MetricSample
+{
+	int64_t m_Time_ns;     // End of the interval, relative to metricsInit()
+	int64_t m_Duration_ns;
+	double m_Min;
+	double m_Max;
+	double m_Sum;
+	uint32_t m_Count;
+};
+
+// Aggregate of the last N intervals.
+struct MetricSummary
+{
+	double m_Min;
+	double m_Max;
+	double m_Avg;   // Average value (gauges) or average total per interval (counters)
+	double m_Rate;  // Counters: total per second
+	uint32_t m_NumSamples;
+};
+
+// Every thread accumulates its values in its own slots (no locks; the only shared writes
+// are a per-thread call counter, which lets metricsShutdown() wait for updates in progress).
+// metricsMerge() combines the slots of all threads into a sample per metric and appends it
+// to the metric's history (JX_CONFIG_METRICS_HISTORY samples). Updates which race with a
+// merge end up in the next sample, so counter totals are never lost.
+bool metricsInit(bx::AllocatorI* allocator);
+void metricsShutdown();
+
+// Ends the current interval. Called by jx::frame() if the system has been initialized with
+// SystemInitFlags::InitMetrics. While a profiler capture is being recorded, the merged
+// values are also written to it as counters.
+void metricsMerge();
+
+// Metrics are shared by all threads and can be registered before metricsInit(). Names must
+// stay alive for the lifetime of the process (i.e. string literals). Returns
+// JX_METRICS_INVALID_ID if JX_CONFIG_METRICS_MAX has been reached.
+uint32_t metricsRegister(const char* name, MetricType::Enum type);
+uint32_t metricsGetNumMetrics();
+const char* metricsGetName(uint32_t id);
+MetricType::Enum metricsGetType(uint32_t id);
+
+void metricsAdd(uint32_t id, double value); // Counters
+void metricsSet(uint32_t id, double value); // Gauges
+
+// Can be called from any thread. Samples are returned oldest first.
+uint32_t metricsGetHistory(uint32_t id, MetricSample* samples, uint32_t maxSamples);
+bool metricsGetSummary(uint32_t id, uint32_t numIntervals, MetricSummary* summary);
+}
+
+#define JX_METRIC_ADD(_name, _value) \
+	do { \
+		static const uint32_t s_MetricID = jx::metricsRegister(_name, jx::MetricType::Counter); \
+		jx::metricsAdd(s_MetricID, (double)(_value)); \
+	} while (0)
+
+#define JX_METRIC_SET(_name, _value) \
+	do { \
+		static const uint32_t s_MetricID = jx::metricsRegister(_name, jx::MetricType::Gauge); \
+		jx::metricsSet(s_MetricID, (double)(_value)); \
+	} while (0)
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef JX_MUTEX_H
+#define JX_MUTEX_H
+
+#include <stdint.h>
+
+namespace jx
+{
+// Contention statistics. Only recorded for named primitives. Counters are updated by the
+// thread which acquired the lock, while holding it, so recording them doesn't add any
+// extra atomic operations. Reading them while the lock is in use returns approximate values.
+struct LockStats
+{
+	const char* m_Name;
+	uint64_t m_NumAcquires;
+	uint64_t m_NumContendedAcquires; // Acquires which didn't succeed on the first try
+	int64_t m_WaitTime;              // Total time spent in contended acquires (bx::getHPCounter() ticks)
+};
+
+typedef void (*LockStatsCallback)(const LockStats* stats, void* userData);
+
+// Calls cb for every live named Mutex. The callback must not create or destroy named mutexes.
+void lockStatsEnumerate(LockStatsCallback cb, void* userData);
+
+// Counters of idle mutexes are cleared immediately. Mutexes which are locked at the time of
+// the call are cleared by the next thread which acquires them.
+void lockStatsReset();
+
+// Futex-based mutex (WaitOnAddress on Windows). Contended lock attempts spin for an adaptive
+// number of iterations before putting the thread to sleep. The spin count tracks the number
+// of iterations it took to acquire the lock in the recent past.
+// NOTE: Unlike bx::Mutex, the mutex isn't recursive. Locking it again from the thread which
+// holds it deadlocks (JX_CHECK in debug builds).
+class Mutex
+{
+public:
+	explicit Mutex(const char* statsName = nullptr);
+	~Mutex();
+
+	void lock();
+	bool tryLock();
+	void unlock();
+
+	const LockStats* getStats() const;
+
+private:
+	Mutex(const Mutex&);
+	Mutex& operator = (const Mutex&);
+
+	void onAcquired(bool contended, int64_t waitTime);
+
+	volatile int32_t m_State; // 0: unlocked, 1: locked, 2: locked with (possible) waiters
+	int32_t m_SpinCount;
+	volatile int32_t m_StatsResetPending;
+	const void* m_Owner;      // Debug builds only
+	LockStats m_Stats;
+	Mutex* m_PrevStats;
+	Mutex* m_NextStats;
+
+	friend void lockStatsEnumerate(LockStatsCallback cb, void* userData);
+	friend void lockStatsReset();
+};
+
+class MutexScope
+{
+public:
+	explicit MutexScope(Mutex& mutex);
+	~MutexScope();
+
+private:
+	MutexScope(const MutexScope&);
+	MutexScope& operator = (const MutexScope&);
+
+	Mutex& m_Mutex;
+};
+
+// Auto-reset events wake a single waiter and reset themselves. Manual-reset events stay
+// signaled (waking all waiters) until reset() is called.
+class Event
+{
+public:
+	explicit Event(bool autoReset = true);
+	~Event();
+
+	void set();
+	void reset();
+	bool wait(int32_t msecs = -1);
+
+private:
+	Event(const Event&);
+	Event& operator = (const Event&);
+
+	volatile int32_t m_State;
+	volatile int32_t m_NumWaiters;
+	bool m_AutoReset;
+};
+
+class Semaphore
+{
+public:
+	Semaphore();
+	~Semaphore();
+
+	void post(uint32_t count = 1);
+	bool wait(int32_t msecs = -1);
+
+private:
+	Semaphore(const Semaphore&);
+	Semaphore& operator = (const Semaphore&);
+
+	volatile int32_t m_Count;
+	volatile int32_t m_NumWaiters;
+};
+}
+
+#endif
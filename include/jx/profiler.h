@@ -1,13 +1,180 @@
 #ifndef JX_PROFILER_H
 #define JX_PROFILER_H
 
-#include <jx/logger.h>
-#include <jx/sys.h>
-#include <bx/timer.h>
-
-#define JX_PROFILE_START(id) int64_t __profileStart_##id = bx::getHPCounter();
-#define JX_PROFILE_END(id, text) \
-    int64_t __profileDelta_##id = bx::getHPCounter() - __profileStart_##id; \
-    JX_LOG_DEBUG("%s took %.2f msec\n", text, 1000.0 * (double)__profileDelta_##id / (double)bx::getHPFrequency())
+#include <stdint.h>
+#include <jx/sys.h> // JX_CONFIG_PROFILER
+#include <jx/fs.h> // BaseDir
+#include <bx/macros.h> // BX_CONCATENATE
+
+namespace bx
+{
+struct AllocatorI;
+}
+
+namespace jx
+{
+// Static description of a profile zone (or instant event/counter). Zones are identified by
+// the address of their descriptor, so it must stay alive for the lifetime of the process.
+struct ProfilerZoneDesc
+{
+	const char* m_Name;
+	const char* m_File;
+	uint32_t m_Line;
+};
+
+// Hardware performance counters sampled at the boundaries of profile zones (see
+// profilerEnableHWCounters()).
+struct ProfilerHWCounter
+{
+	enum Enum : uint32_t
+	{
+		Cycles,
+		Instructions,
+		CacheMisses,
+		BranchMisses,
+		PageFaults,
+
+		Count
+	};
+};
+
+// Statistics of a zone, in a specific position of a thread's zone hierarchy, during a
+// frame. Self time excludes the time spent in child zones. Zones are attributed to the
+// frame in which they end.
+struct ProfilerZoneStats
+{
+	const ProfilerZoneDesc* m_Zone;
+	uint32_t m_ThreadID;
+	uint32_t m_ParentID; // Index of the parent zone in the same stats array (UINT32_MAX for top-level zones)
+	uint32_t m_Depth;
+	uint32_t m_Count;
+	int64_t m_Total_ns;
+	int64_t m_Self_ns;
+	int64_t m_Min_ns;
+	int64_t m_Max_ns;
+
+	// Totals of the instances which have been sampled (m_NumHWSamples out of m_Count), including
+	// child zones. Bit N of m_HWCounterMask is set if m_HWCounters[N] is valid.
+	uint32_t m_HWCounterMask;
+	uint32_t m_NumHWSamples;
+	uint64_t m_HWCounters[ProfilerHWCounter::Count];
+};
+
+struct ProfilerCaptureMode
+{
+	enum Enum : uint32_t
+	{
+		Continuous, // Records from profilerBeginCapture() until profilerEndCapture() or a limit is reached
+		Triggered,  // Records a window every time profilerTriggerCapture() is called
+	};
+};
+
+// Limits of a Continuous capture or of every window of a Triggered capture (0: no limit).
+struct ProfilerCaptureDesc
+{
+	ProfilerCaptureMode::Enum m_Mode;
+	uint32_t m_MaxFrames;
+	uint32_t m_MaxDuration_ms;
+};
+
+struct ProfilerFrameInfo
+{
+	uint64_t m_FrameID;
+	int64_t m_Duration_ns;
+	uint32_t m_NumZones;
+	uint32_t m_NumDroppedZones; // Zones which didn't fit in the thread buffers or the zone trees
+};
+
+// Zones are recorded only while the profiler is initialized. Each thread appends the
+// begin/end timestamps of its zones to its own buffer (JX_CONFIG_PROFILER_THREAD_BUFFER_SIZE
+// events); profilerFrame() collects the events of all threads and aggregates them.
+// Zones are dropped (whole subtrees, so nesting is preserved) if a thread buffer is full.
+// profilerShutdown() can be called while other threads are still instrumented. It waits for
+// the profiler calls in progress to return; later calls are ignored.
+bool profilerInit(bx::AllocatorI* allocator);
+void profilerShutdown();
+bool profilerIsInitialized();
+
+// Ends the current frame. Called by jx::frame() if the system has been initialized with
+// SystemInitFlags::InitProfiler.
+void profilerFrame();
+
+// Name of the calling thread in the stats and the exported traces. Defaults to the OS
+// thread name (the name of a jx::Thread) where available.
+void profilerSetThreadName(const char* name);
+uint32_t profilerGetNumThreads();
+bool profilerGetThreadName(uint32_t threadID, char* buffer, uint32_t maxLen);
+
+// Statistics of the last completed frame. Zones are listed depth-first, grouped by thread.
+// Can be called from any thread. Returns the number of entries written to stats.
+uint32_t profilerGetFrameStats(ProfilerZoneStats* stats, uint32_t maxStats, ProfilerFrameInfo* info);
+
+// Captures are written as Chrome trace event JSON (chrome://tracing, Perfetto), with a
+// track per thread. profilerFrame() converts the events it collects and streams them to
+// the file through a fixed-size buffer, so memory usage doesn't depend on the length of
+// the capture. Only one capture can be open at a time.
+bool profilerBeginCapture(BaseDir::Enum baseDir, const char* relPath, const ProfilerCaptureDesc* desc);
+void profilerEndCapture();
+bool profilerIsCapturing(); // true while a capture (or a window of a Triggered capture) is being recorded
+
+// Starts a window of the open Triggered capture on the next profilerFrame(). Ignored while
+// a window is being recorded. Can be called from any thread.
+void profilerTriggerCapture();
+
+// Samples hardware counters (a bit per ProfilerHWCounter) when the calling thread's zones
+// begin and end. Linux only (perf_event_open). Counters the kernel doesn't give access to
+// (e.g. perf_event_paranoid, containers, VMs without a PMU) are skipped; returns the mask of
+// the counters which have been enabled (0 if none).
+// Every sample costs a system call at both ends of a zone, so this is meant for targeted
+// investigations rather than always-on profiling.
+uint32_t profilerEnableHWCounters(uint32_t counterMask);
+void profilerDisableHWCounters();
+
+void profilerZoneBegin(const ProfilerZoneDesc* zone);
+void profilerZoneEnd(const ProfilerZoneDesc* zone);
+
+// Instant events and counters only show up in captures.
+void profilerInstant(const ProfilerZoneDesc* desc);
+void profilerCounter(const ProfilerZoneDesc* desc, double value);
+
+struct ProfilerScope
+{
+	ProfilerScope(const ProfilerZoneDesc* zone) : m_Zone(zone)
+	{
+		profilerZoneBegin(zone);
+	}
+
+	~ProfilerScope()
+	{
+		profilerZoneEnd(m_Zone);
+	}
+
+	const ProfilerZoneDesc* m_Zone;
+};
+}
+
+#if JX_CONFIG_PROFILER
+#define JX_PROFILE_ZONE(_name) \
+	static const jx::ProfilerZoneDesc BX_CONCATENATE(s_ProfilerZone, __LINE__) = { _name, __FILE__, __LINE__ }; \
+	jx::ProfilerScope BX_CONCATENATE(_profilerScope, __LINE__)(&BX_CONCATENATE(s_ProfilerZone, __LINE__))
+
+#define JX_PROFILE_INSTANT(_name) \
+	do { \
+		static const jx::ProfilerZoneDesc s_ProfilerEvent = { _name, __FILE__, __LINE__ }; \
+		jx::profilerInstant(&s_ProfilerEvent); \
+	} while (0)
+
+#define JX_PROFILE_COUNTER(_name, _value) \
+	do { \
+		static const jx::ProfilerZoneDesc s_ProfilerCounter = { _name, __FILE__, __LINE__ }; \
+		jx::profilerCounter(&s_ProfilerCounter, (double)(_value)); \
+	} while (0)
+#else
+#define JX_PROFILE_ZONE(_name) BX_NOOP()
+#define JX_PROFILE_INSTANT(_name) BX_NOOP()
+#define JX_PROFILE_COUNTER(_name, _value) BX_NOOP()
+#endif
+
+#define JX_PROFILE_FUNCTION() JX_PROFILE_ZONE(__FUNCTION__)
 
 #endif
@@ -7,6 +7,7 @@
 namespace jx
 {
 struct Vec2f;
+struct WorkerPool;
 
 struct Rect
 {
@@ -28,6 +29,12 @@ void rectSoAToAoS(const RectSoA* soa, uint32_t numRects, Rect* aos);
 void rectIntersect(const RectSoA* soa, uint32_t numRects, const Rect* test, bool* results);
 void rectIntersectBitset(const RectSoA* soa, uint32_t numRects, const Rect* test, uint8_t* bitset);
 
+// Same as above but the work is split across the pool's workers. Results are identical
+// to the serial versions. pool can be nullptr.
+void rectAoSToSoAParallel(WorkerPool* pool, const Rect* aos, uint32_t numRects, RectSoA* soa);
+void rectIntersectParallel(WorkerPool* pool, const RectSoA* soa, uint32_t numRects, const Rect* test, bool* results);
+void rectIntersectBitsetParallel(WorkerPool* pool, const RectSoA* soa, uint32_t numRects, const Rect* test, uint8_t* bitset);
+
 void rectCalcFromPointList(const float* points, uint32_t numPoints, Rect* rect);
 
 bool rectLineSegmentIntersection(const Rect* rect, const jx::Vec2f& s, const jx::Vec2f& e);
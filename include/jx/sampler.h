@@ -0,0 +1,47 @@
+#ifndef JX_SAMPLER_H
+#define JX_SAMPLER_H
+
+#include <stdint.h>
+#include <jx/fs.h> // BaseDir
+
+namespace bx
+{
+struct AllocatorI;
+}
+
+namespace jx
+{
+struct SamplerDesc
+{
+	uint32_t m_Frequency_hz; // Samples per second of CPU time consumed by the process
+	uint32_t m_MaxSamples;   // Samples taken after the buffer is full are dropped
+};
+
+// Sampling CPU profiler. A CPU-time timer interrupts the process m_Frequency_hz times per
+// second of CPU time and the signal handler records the call stack of the interrupted thread
+// (up to JX_CONFIG_SAMPLER_MAX_DEPTH frames) into a buffer allocated by samplerInit(). The
+// handler only uses async-signal-safe operations: it walks the frame pointer chain of the
+// interrupted context (checking every page with a system call before reading it) and
+// appends to the buffer with atomics.
+// Linux only (x86, x86-64 and AArch64); samplerInit() returns false on other platforms.
+// Code built without frame pointers (-fomit-frame-pointer, the default at -O2 on x86-64)
+// produces truncated stacks; build with -fno-omit-frame-pointer for complete ones.
+// The functions below must be called from a single thread.
+bool samplerInit(bx::AllocatorI* allocator, const SamplerDesc* desc);
+void samplerShutdown();
+
+bool samplerStart();
+void samplerStop();
+bool samplerIsRunning();
+
+// Discards all samples. The sampler must be stopped.
+void samplerReset();
+uint32_t samplerGetNumSamples();
+uint32_t samplerGetNumDropped();
+
+// Writes the samples in the collapsed stack format ("root;caller;callee count" per line),
+// which flame graph tools (flamegraph.pl, speedscope, etc.) read. The sampler must be stopped.
+bool samplerWriteCollapsedStacks(BaseDir::Enum baseDir, const char* relPath);
+}
+
+#endif
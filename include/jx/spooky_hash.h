@@ -35,6 +35,8 @@
 
 namespace jx
 {
+struct WorkerPool;
+
 //
 // SpookyHash: hash a single message in one call, produce 128-bit output
 //
@@ -50,6 +52,15 @@ uint64_t spookyHash64(const void* message, size_t length, uint64_t seed);
 //
 uint32_t spookyHash32(const void* message, size_t length, uint32_t seed);
 
+//
+// Hash128Batch: hash many independent messages, splitting them across the pool's workers.
+// hashes holds 2 values per message; seeds on input and the 128-bit hash on output (same
+// as spookyHash128()). pool can be nullptr.
+// NOTE: A single message can't be split because every block is mixed into the state of
+// the previous one.
+//
+void spookyHash128Batch(WorkerPool* pool, const void* const* messages, const size_t* lengths, uint32_t numMessages, uint64_t* hashes);
+
 }
 
 #endif
@@ -20,6 +20,110 @@
 #	define JX_CONFIG_FRAME_ALLOCATOR_CAPACITY (4 << 20)
 #endif
 
+#ifndef JX_CONFIG_MAX_CPUS
+#	define JX_CONFIG_MAX_CPUS 256
+#endif
+
+#ifndef JX_CONFIG_EPOCH_MAX_THREADS
+#	define JX_CONFIG_EPOCH_MAX_THREADS 64
+#endif
+
+#ifndef JX_CONFIG_THREAD_QUEUE_STATS
+#	define JX_CONFIG_THREAD_QUEUE_STATS 0
+#endif
+
+#ifndef JX_CONFIG_THREAD_RECORDER
+#	define JX_CONFIG_THREAD_RECORDER 0
+#endif
+
+#ifndef JX_CONFIG_LOGGER_THREAD_BUFFER_SIZE
+#	define JX_CONFIG_LOGGER_THREAD_BUFFER_SIZE (64 << 10)
+#endif
+
+#ifndef JX_CONFIG_LOGGER_MAX_FORMATS
+#	define JX_CONFIG_LOGGER_MAX_FORMATS 4096
+#endif
+
+#ifndef JX_CONFIG_LOGGER_MAX_SINKS
+#	define JX_CONFIG_LOGGER_MAX_SINKS 16
+#endif
+
+// Default size of a sink's record queue (power of 2)
+#ifndef JX_CONFIG_LOGGER_SINK_QUEUE_SIZE
+#	define JX_CONFIG_LOGGER_SINK_QUEUE_SIZE (128 << 10)
+#endif
+
+// Number of call sites tracked by each rate limited logger (power of 2)
+#ifndef JX_CONFIG_LOGGER_RATE_LIMIT_SITES
+#	define JX_CONFIG_LOGGER_RATE_LIMIT_SITES 1024
+#endif
+
+// Lowest jx::LogLevel compiled into the JX_LOG_xxx/JX_LOGB_xxx macros
+// (0: Debug, 1: Info, 2: Warning, 3: Error, 4: none)
+#ifndef JX_CONFIG_LOG_MIN_LEVEL
+#	define JX_CONFIG_LOG_MIN_LEVEL 0
+#endif
+
+// Compiles the JX_PROFILE_xxx macros in
+#ifndef JX_CONFIG_PROFILER
+#	define JX_CONFIG_PROFILER 1
+#endif
+
+// Number of events in each thread's profiler buffer (power of 2)
+#ifndef JX_CONFIG_PROFILER_THREAD_BUFFER_SIZE
+#	define JX_CONFIG_PROFILER_THREAD_BUFFER_SIZE (16 << 10)
+#endif
+
+// Distinct zone paths (zone + parents) tracked per thread
+#ifndef JX_CONFIG_PROFILER_MAX_ZONES_PER_THREAD
+#	define JX_CONFIG_PROFILER_MAX_ZONES_PER_THREAD 1024
+#endif
+
+#ifndef JX_CONFIG_PROFILER_MAX_DEPTH
+#	define JX_CONFIG_PROFILER_MAX_DEPTH 64
+#endif
+
+// Number of counters/gauges which can be registered
+#ifndef JX_CONFIG_METRICS_MAX
+#	define JX_CONFIG_METRICS_MAX 256
+#endif
+
+// Number of merged intervals kept per metric
+#ifndef JX_CONFIG_METRICS_HISTORY
+#	define JX_CONFIG_METRICS_HISTORY 120
+#endif
+
+// Read timestamps from the invariant TSC on x86 (see jx/clock.h)
+#ifndef JX_CONFIG_CLOCK_TSC
+#	define JX_CONFIG_CLOCK_TSC 1
+#endif
+
+#ifndef JX_CONFIG_CLOCK_RESYNC_INTERVAL_MS
+#	define JX_CONFIG_CLOCK_RESYNC_INTERVAL_MS 1000
+#endif
+
+// Frames recorded per sample by the sampling profiler
+#ifndef JX_CONFIG_SAMPLER_MAX_DEPTH
+#	define JX_CONFIG_SAMPLER_MAX_DEPTH 64
+#endif
+
+// Sliding window of the frame time tracker (see SystemInitFlags::InitFrameLatency)
+#ifndef JX_CONFIG_FRAME_LATENCY_WINDOW_MS
+#	define JX_CONFIG_FRAME_LATENCY_WINDOW_MS 10000
+#endif
+
+#ifndef JX_CONFIG_FRAME_LATENCY_SUB_WINDOWS
+#	define JX_CONFIG_FRAME_LATENCY_SUB_WINDOWS 10
+#endif
+
+#ifndef JX_CONFIG_COROUTINES
+#	if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#		define JX_CONFIG_COROUTINES 1
+#	else
+#		define JX_CONFIG_COROUTINES 0
+#	endif
+#endif
+
 #if JX_CONFIG_DEBUG
 #include <bx/debug.h>
 
@@ -58,18 +162,26 @@ struct AllocatorI;
 namespace jx
 {
 struct Logger;
+struct EpochDomain;
+struct LatencyTracker;
 
 struct SystemInitFlags
 {
 	enum Enum : uint32_t
 	{
 		None = 0,
-		InitLog = 1u << 0
+		InitLog = 1u << 0,
+		InitProfiler = 1u << 1,
+		InitMetrics = 1u << 2,
+		InitFrameLatency = 1u << 3
 	};
 };
 
 bool initSystem(const char* appName, uint32_t sysFlags, uint32_t fsFlags);
 void shutdownSystem();
+
+// Must be called from the thread which initialized the system. Marks a quiescent state
+// for that thread in the global epoch domain and reclaims retired objects.
 void frame();
 
 void setSystemLogger(Logger* logger);
@@ -81,6 +193,14 @@ bx::AllocatorI* getGlobalAllocator();
 bx::AllocatorI* getFrameAllocator();
 Logger* getGlobalLogger();
 
+// The thread which called initSystem() is registered automatically. Other threads
+// must call epochRegisterThread() before reading shared snapshots.
+EpochDomain* getGlobalEpochDomain();
+
+// Time between consecutive frame() calls. nullptr if the system hasn't been initialized with
+// SystemInitFlags::InitFrameLatency.
+LatencyTracker* getFrameLatencyTracker();
+
 #if BX_PLATFORM_WINDOWS
 void getLogFullPathW(Logger* logger, wchar_t* path, uint32_t maxLen);
 #endif
@@ -95,9 +215,36 @@ size_t memTracerGetTotalAllocatedMemory(uint32_t id);
 #endif
 }
 
-#define JX_LOG_DEBUG(fmt, ...)   jx::logf(jx::getGlobalLogger(), jx::LogLevel::Debug, fmt, ##__VA_ARGS__)
-#define JX_LOG_INFO(fmt, ...)    jx::logf(jx::getGlobalLogger(), jx::LogLevel::Info, fmt, ##__VA_ARGS__)
-#define JX_LOG_WARN(fmt, ...)    jx::logf(jx::getGlobalLogger(), jx::LogLevel::Warning, fmt, ##__VA_ARGS__)
-#define JX_LOG_ERROR(fmt, ...)   jx::logf(jx::getGlobalLogger(), jx::LogLevel::Error, fmt, ##__VA_ARGS__)
+#if JX_CONFIG_LOG_MIN_LEVEL <= 0
+#define JX_LOG_DEBUG(fmt, ...)   JX_LOG(jx::getGlobalLogger(), jx::LogLevel::Debug, fmt, ##__VA_ARGS__)
+#define JX_LOGB_DEBUG(fmt, ...)  JX_LOGB(jx::getGlobalLogger(), jx::LogLevel::Debug, fmt, ##__VA_ARGS__)
+#else
+#define JX_LOG_DEBUG(fmt, ...)   do {} while (0)
+#define JX_LOGB_DEBUG(fmt, ...)  do {} while (0)
+#endif
+
+#if JX_CONFIG_LOG_MIN_LEVEL <= 1
+#define JX_LOG_INFO(fmt, ...)    JX_LOG(jx::getGlobalLogger(), jx::LogLevel::Info, fmt, ##__VA_ARGS__)
+#define JX_LOGB_INFO(fmt, ...)   JX_LOGB(jx::getGlobalLogger(), jx::LogLevel::Info, fmt, ##__VA_ARGS__)
+#else
+#define JX_LOG_INFO(fmt, ...)    do {} while (0)
+#define JX_LOGB_INFO(fmt, ...)   do {} while (0)
+#endif
+
+#if JX_CONFIG_LOG_MIN_LEVEL <= 2
+#define JX_LOG_WARN(fmt, ...)    JX_LOG(jx::getGlobalLogger(), jx::LogLevel::Warning, fmt, ##__VA_ARGS__)
+#define JX_LOGB_WARN(fmt, ...)   JX_LOGB(jx::getGlobalLogger(), jx::LogLevel::Warning, fmt, ##__VA_ARGS__)
+#else
+#define JX_LOG_WARN(fmt, ...)    do {} while (0)
+#define JX_LOGB_WARN(fmt, ...)   do {} while (0)
+#endif
+
+#if JX_CONFIG_LOG_MIN_LEVEL <= 3
+#define JX_LOG_ERROR(fmt, ...)   JX_LOG(jx::getGlobalLogger(), jx::LogLevel::Error, fmt, ##__VA_ARGS__)
+#define JX_LOGB_ERROR(fmt, ...)  JX_LOGB(jx::getGlobalLogger(), jx::LogLevel::Error, fmt, ##__VA_ARGS__)
+#else
+#define JX_LOG_ERROR(fmt, ...)   do {} while (0)
+#define JX_LOGB_ERROR(fmt, ...)  do {} while (0)
+#endif
 
 #endif
@@ -7,6 +7,7 @@
 namespace jx
 {
 #define JX_THREAD_MESSAGE_BUFFER_SIZE 60
+#define JX_THREAD_QUEUE_LATENCY_NUM_BUCKETS 32
 
 struct ThreadMessage
 {
@@ -16,8 +17,55 @@ struct ThreadMessage
 BX_STATIC_ASSERT(sizeof(ThreadMessage) == 64, "Invalid ThreadMessage size");
 
 struct Thread;
+struct CPUSet;
+
+struct ThreadQueue
+{
+	enum Enum : uint32_t
+	{
+		In,
+		Out
+	};
+};
+
+// How a consumer waits for messages when its queue is empty: busy-spin (with a pause
+// hint) for m_NumSpins iterations, then yield the CPU for m_NumYields iterations and
+// finally park on the queue's semaphore until a message arrives or the pop timeout
+// expires. Producers only signal the semaphore when the consumer is parked.
+// The default strategy parks immediately.
+struct ThreadWaitStrategy
+{
+	uint32_t m_NumSpins;
+	uint32_t m_NumYields;
+};
+
+// Per-queue counters (requires JX_CONFIG_THREAD_QUEUE_STATS). Latency is measured from push
+// to pop. Bucket i of the latency histogram counts messages which spent [2^i, 2^(i+1))
+// nanoseconds in the queue (bucket 0 includes 0 ns and the last bucket includes everything
+// above its lower bound).
+struct ThreadQueueStats
+{
+	uint64_t m_NumEnqueued;
+	uint64_t m_NumDequeued;
+	uint32_t m_Depth;
+	uint32_t m_MaxDepth;
+	uint64_t m_LatencyHistogram[JX_THREAD_QUEUE_LATENCY_NUM_BUCKETS];
+};
+
+struct ThreadPriority
+{
+	enum Enum : uint32_t
+	{
+		Lowest,
+		Low,
+		Normal,
+		High,
+		Highest
+	};
+};
 
 typedef int32_t (*ThreadFn)(Thread* self, void* userData);
+typedef void (*ThreadEnumCallback)(Thread* thread, void* userData);
 
 Thread* createThread(bx::AllocatorI* allocator, ThreadFn func, void* userData = nullptr, uint32_t stackSize = 0u, const char* name = nullptr);
 void destroyThread(Thread* thread);
@@ -27,6 +75,26 @@ bool threadInQueuePush(Thread* thread, uint32_t msgID, const void* data, uint32_
 ThreadMessage* threadOutQueuePop(Thread* thread, int32_t timeout_msec);
 bool threadOutQueuePush(Thread* thread, uint32_t msgID, const void* data, uint32_t sz);
 void threadReleaseMessage(Thread* thread, ThreadMessage* msg);
+
+void threadSetWaitStrategy(Thread* thread, ThreadQueue::Enum queue, const ThreadWaitStrategy* strategy);
+void threadGetWaitStrategy(Thread* thread, ThreadQueue::Enum queue, ThreadWaitStrategy* strategy);
+
+const char* threadGetName(const Thread* thread);
+
+// Counters are sampled without stopping the producer/consumer so the values might be
+// slightly out of sync with each other. Returns false if queue stats are disabled.
+bool threadGetQueueStats(const Thread* thread, ThreadQueue::Enum queue, ThreadQueueStats* stats);
+
+// Calls cb for every live jx::Thread. The callback must not create or destroy threads.
+void threadEnumerate(ThreadEnumCallback cb, void* userData);
+
+bool threadSetAffinity(Thread* thread, const CPUSet* cpus);
+bool threadGetAffinity(Thread* thread, CPUSet* cpus);
+bool threadSetPriority(Thread* thread, ThreadPriority::Enum priority);
+
+bool setCurrentThreadAffinity(const CPUSet* cpus);
+bool getCurrentThreadAffinity(CPUSet* cpus);
+bool setCurrentThreadPriority(ThreadPriority::Enum priority);
 }
 
 #endif
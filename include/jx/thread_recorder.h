@@ -0,0 +1,91 @@
+#ifndef JX_THREAD_RECORDER_H
+#define JX_THREAD_RECORDER_H
+
+#include <stdint.h>
+#include <jx/thread.h>
+
+namespace bx
+{
+struct AllocatorI;
+}
+
+namespace jx
+{
+struct File;
+struct ThreadRecorder;
+
+struct ThreadRecorderFlags
+{
+	enum Enum : uint32_t
+	{
+		None = 0,
+		RecordPayload = 1u << 0, // Store message data in addition to msgID/size
+	};
+};
+
+struct ThreadRecordEvent
+{
+	enum Enum : uint8_t
+	{
+		Push,
+		Pop
+	};
+};
+
+struct ThreadRecordFlags
+{
+	enum Enum : uint8_t
+	{
+		None = 0,
+		HasPayload = 1u << 0
+	};
+};
+
+struct ThreadRecord
+{
+	int64_t m_Time_ns;  // Relative to the recorder's creation
+	uint32_t m_MsgID;
+	uint16_t m_Size;
+	uint8_t m_Queue;    // ThreadQueue::Enum
+	uint8_t m_Event;    // ThreadRecordEvent::Enum
+	uint8_t m_Flags;    // ThreadRecordFlags
+	uint8_t m_Data[JX_THREAD_MESSAGE_BUFFER_SIZE];
+};
+
+struct ThreadReplayMode
+{
+	enum Enum : uint32_t
+	{
+		RealTime,        // Reproduce the recorded inter-message timing
+		AsFastAsPossible
+	};
+};
+
+// Records every push/pop on the queues of the threads it's attached to (requires
+// JX_CONFIG_THREAD_RECORDER) into a ring of capacity fixed-size slots. When the ring is
+// full the oldest records are overwritten. capacity must be a power of 2.
+ThreadRecorder* createThreadRecorder(bx::AllocatorI* allocator, uint32_t capacity, uint32_t flags = ThreadRecorderFlags::None);
+void destroyThreadRecorder(ThreadRecorder* recorder);
+
+// recorder can be nullptr to stop recording. The recorder must outlive the thread or be
+// detached before it's destroyed.
+bool threadSetRecorder(Thread* thread, ThreadRecorder* recorder);
+
+// Copies the records currently in the ring, oldest first. Returns the number of records
+// written to records.
+uint32_t threadRecorderGetRecords(ThreadRecorder* recorder, ThreadRecord* records, uint32_t maxRecords);
+uint64_t threadRecorderGetNumRecorded(const ThreadRecorder* recorder);
+
+// Load returns nullptr (and sets numRecords to 0) if the file is invalid or truncated.
+bool threadRecordsSave(File* f, const ThreadRecord* records, uint32_t numRecords);
+ThreadRecord* threadRecordsLoad(File* f, bx::AllocatorI* allocator, uint32_t* numRecords);
+
+// Pushes every recorded Push event of the specified queue to the target thread. Blocks
+// until all messages have been pushed and returns the number of successful pushes.
+uint32_t threadReplay(Thread* target, ThreadQueue::Enum queue, const ThreadRecord* records, uint32_t numRecords, ThreadReplayMode::Enum mode);
+
+// Internal (called by jx::Thread)
+void threadRecorderRecord(ThreadRecorder* recorder, ThreadRecordEvent::Enum ev, ThreadQueue::Enum queue, uint32_t msgID, const void* data, uint32_t sz);
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef JX_TIMER_SERVICE_H
+#define JX_TIMER_SERVICE_H
+
+#include <stdint.h>
+
+namespace bx
+{
+struct AllocatorI;
+}
+
+namespace jx
+{
+struct Thread;
+struct TimerService;
+
+#define JX_TIMER_INVALID_ID UINT32_MAX
+
+// Timers are kept in a hierarchical timing wheel (4 levels x 256 slots) driven by a
+// dedicated jx::Thread. Adding and cancelling a timer is O(1). When a timer expires
+// a message with the specified ID and payload is pushed to the target thread's input
+// queue (see threadInQueuePop()).
+TimerService* createTimerService(bx::AllocatorI* allocator, uint32_t tickDuration_msec = 1, const char* name = "Timer Service");
+void destroyTimerService(TimerService* ts);
+
+// period_msec == 0 creates a one-shot timer. Returns JX_TIMER_INVALID_ID on failure.
+uint32_t timerServiceAdd(TimerService* ts, Thread* target, uint32_t delay_msec, uint32_t period_msec, uint32_t msgID, const void* data = nullptr, uint32_t sz = 0);
+
+// Returns false if the timer has already fired (one-shot) or has already been cancelled.
+bool timerServiceCancel(TimerService* ts, uint32_t timerID);
+
+uint32_t timerServiceGetNumPending(TimerService* ts);
+}
+
+#endif
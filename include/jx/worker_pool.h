@@ -0,0 +1,33 @@
+#ifndef JX_WORKER_POOL_H
+#define JX_WORKER_POOL_H
+
+#include <stdint.h>
+
+namespace bx
+{
+struct AllocatorI;
+}
+
+namespace jx
+{
+struct WorkerPool;
+
+// Processes items [first, last).
+typedef void (*ParallelForFn)(uint32_t first, uint32_t last, void* userData);
+
+// A fixed set of jx::Threads used for fork/join data-parallel work.
+WorkerPool* createWorkerPool(bx::AllocatorI* allocator, uint32_t numWorkers, const char* name = "Worker");
+void destroyWorkerPool(WorkerPool* pool);
+
+uint32_t workerPoolGetNumWorkers(const WorkerPool* pool);
+
+// Splits [0, numItems) into at most (numWorkers + 1) contiguous ranges and executes them on
+// the pool's workers and the calling thread. Range boundaries are multiples of granularity
+// and no range is smaller than granularity items (except the last one), so callers can
+// pick it to keep each range SIMD-aligned and on its own cache lines.
+// Blocks until all ranges have been processed. If pool is nullptr everything is executed on
+// the calling thread. Must not be called from one of the pool's workers.
+void parallelFor(WorkerPool* pool, uint32_t numItems, uint32_t granularity, ParallelForFn func, void* userData);
+}
+
+#endif
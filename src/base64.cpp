@@ -1,4 +1,5 @@
 #include <jx/base64.h>
+#include <jx/worker_pool.h>
 #include <bx/allocator.h>
 
 namespace jx
@@ -33,6 +34,23 @@ static const uint8_t kBase64CharOffset[256] = {
 };
 #undef _
 
+// Input bytes per output line (18 blocks of 3 bytes produce 72 characters + '\n').
+#define BASE64_LINE_INPUT_BYTES  54
+#define BASE64_LINE_OUTPUT_BYTES 73
+
+// Lines per parallel range
+static const uint32_t kBase64ParallelGranularity = 256;
+
+struct Base64EncodeJob
+{
+	const uint8_t* m_Src;
+	uint8_t* m_Out;
+};
+
+static size_t base64CalcMaxEncodedLength(size_t len);
+static uint8_t* base64EncodeRange(const uint8_t* src, size_t len, uint8_t* out);
+static void base64EncodeLines(uint32_t first, uint32_t last, void* userData);
+
 /**
  * base64_encode - Base64 encode
  * @src: Data to be encoded
@@ -47,9 +65,7 @@ static const uint8_t kBase64CharOffset[256] = {
  */
 uint8_t* base64Encode(const uint8_t* src, size_t len, size_t* out_len, bx::AllocatorI* allocator)
 {
-	size_t olen = len * 4 / 3 + 4; /* 3-byte blocks to 4-byte */
-	olen += olen / 72; /* line feeds */
-	olen++; /* nul termination */
+	const size_t olen = base64CalcMaxEncodedLength(len);
 	if (olen < len) {
 		return nullptr; /* integer overflow */
 	}
@@ -59,42 +75,44 @@ uint8_t* base64Encode(const uint8_t* src, size_t len, size_t* out_len, bx::Alloc
 		return nullptr;
 	}
 
-	const uint8_t* end = src + len;
-	const uint8_t* in = src;
-	uint8_t* pos = out;
-	int line_len = 0;
-	while (end - in >= 3) {
-		*pos++ = kBase64Table[in[0] >> 2];
-		*pos++ = kBase64Table[((in[0] & 0x03) << 4) | (in[1] >> 4)];
-		*pos++ = kBase64Table[((in[1] & 0x0f) << 2) | (in[2] >> 6)];
-		*pos++ = kBase64Table[in[2] & 0x3f];
+	uint8_t* pos = base64EncodeRange(src, len, out);
 
-		in += 3;
+	*pos = '\0';
+	if (out_len) {
+		*out_len = pos - out;
+	}
 
-		line_len += 4;
-		if (line_len >= 72) {
-			*pos++ = '\n';
-			line_len = 0;
-		}
+	return out;
+}
+
+// Same output as base64Encode(). The input is split on line boundaries so every range
+// can be encoded directly to its final position in the output buffer.
+uint8_t* base64EncodeParallel(WorkerPool* pool, const uint8_t* src, size_t len, size_t* out_len, bx::AllocatorI* allocator)
+{
+	const size_t numLines = len / BASE64_LINE_INPUT_BYTES;
+	if (numLines > UINT32_MAX) {
+		return base64Encode(src, len, out_len, allocator);
 	}
 
-	if (end - in) {
-		*pos++ = kBase64Table[in[0] >> 2];
-		if (end - in == 1) {
-			*pos++ = kBase64Table[(in[0] & 0x03) << 4];
-			*pos++ = '=';
-		} else {
-			*pos++ = kBase64Table[((in[0] & 0x03) << 4) | (in[1] >> 4)];
-			*pos++ = kBase64Table[(in[1] & 0x0f) << 2];
-		}
-		*pos++ = '=';
-		line_len += 4;
+	const size_t olen = base64CalcMaxEncodedLength(len);
+	if (olen < len) {
+		return nullptr; /* integer overflow */
 	}
 
-	if (line_len) {
-		*pos++ = '\n';
+	uint8_t* out = (uint8_t*)BX_ALLOC(allocator, olen);
+	if (out == nullptr) {
+		return nullptr;
 	}
 
+	Base64EncodeJob job;
+	job.m_Src = src;
+	job.m_Out = out;
+	parallelFor(pool, (uint32_t)numLines, kBase64ParallelGranularity, base64EncodeLines, &job);
+
+	// Partial last line and padding
+	const size_t numFullLineBytes = numLines * BASE64_LINE_INPUT_BYTES;
+	uint8_t* pos = base64EncodeRange(src + numFullLineBytes, len - numFullLineBytes, out + numLines * BASE64_LINE_OUTPUT_BYTES);
+
 	*pos = '\0';
 	if (out_len) {
 		*out_len = pos - out;
@@ -175,4 +193,67 @@ uint8_t* base64Decode(const uint8_t* src, size_t len, size_t* out_len, bx::Alloc
 
 	return out;
 }
+
+//////////////////////////////////////////////////////////////////////////
+// Internal
+//
+static size_t base64CalcMaxEncodedLength(size_t len)
+{
+	size_t olen = len * 4 / 3 + 4; /* 3-byte blocks to 4-byte */
+	olen += olen / 72; /* line feeds */
+	olen++; /* nul termination */
+	return olen;
+}
+
+// Encodes src starting at the beginning of an output line. Returns the end of the
+// encoded data (not nul terminated).
+static uint8_t* base64EncodeRange(const uint8_t* src, size_t len, uint8_t* out)
+{
+	const uint8_t* end = src + len;
+	const uint8_t* in = src;
+	uint8_t* pos = out;
+	int line_len = 0;
+	while (end - in >= 3) {
+		*pos++ = kBase64Table[in[0] >> 2];
+		*pos++ = kBase64Table[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+		*pos++ = kBase64Table[((in[1] & 0x0f) << 2) | (in[2] >> 6)];
+		*pos++ = kBase64Table[in[2] & 0x3f];
+
+		in += 3;
+
+		line_len += 4;
+		if (line_len >= 72) {
+			*pos++ = '\n';
+			line_len = 0;
+		}
+	}
+
+	if (end - in) {
+		*pos++ = kBase64Table[in[0] >> 2];
+		if (end - in == 1) {
+			*pos++ = kBase64Table[(in[0] & 0x03) << 4];
+			*pos++ = '=';
+		} else {
+			*pos++ = kBase64Table[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+			*pos++ = kBase64Table[(in[1] & 0x0f) << 2];
+		}
+		*pos++ = '=';
+		line_len += 4;
+	}
+
+	if (line_len) {
+		*pos++ = '\n';
+	}
+
+	return pos;
+}
+
+static void base64EncodeLines(uint32_t first, uint32_t last, void* userData)
+{
+	const Base64EncodeJob* job = (const Base64EncodeJob*)userData;
+
+	const uint8_t* src = job->m_Src + (size_t)first * BASE64_LINE_INPUT_BYTES;
+	uint8_t* out = job->m_Out + (size_t)first * BASE64_LINE_OUTPUT_BYTES;
+	base64EncodeRange(src, (size_t)(last - first) * BASE64_LINE_INPUT_BYTES, out);
+}
 }
@@ -0,0 +1,341 @@
+#include <jx/broadcast_ring.h>
+#include <jx/thread.h>
+#include <jx/sys.h>
+#include <bx/allocator.h>
+#include <bx/cpu.h>
+
+namespace jx
+{
+#define BROADCAST_RING_CACHE_LINE_SIZE 64
+
+struct ConsumerState
+{
+	enum Enum : int32_t
+	{
+		Free = 0,
+		Active = 1,
+		Claimed = -1
+	};
+};
+
+// Each consumer lives in its own cache line so cursor updates don't interfere with each other.
+struct BroadcastConsumer
+{
+	volatile uint64_t m_ReadSeq;
+	volatile uint64_t m_NumDropped;
+	volatile int32_t m_State;
+	uint8_t m_Padding[BROADCAST_RING_CACHE_LINE_SIZE - sizeof(uint64_t) * 2 - sizeof(int32_t)];
+};
+BX_STATIC_ASSERT(sizeof(BroadcastConsumer) == BROADCAST_RING_CACHE_LINE_SIZE, "Invalid BroadcastConsumer size");
+
+struct BroadcastRing
+{
+	// Producer data
+	volatile uint64_t m_WriteSeq;
+	uint64_t m_CachedMinReadSeq;
+	uint8_t m_Padding[BROADCAST_RING_CACHE_LINE_SIZE - sizeof(uint64_t) * 2];
+
+	// Read-only data
+	bx::AllocatorI* m_Allocator;
+	BroadcastConsumer* m_Consumers;
+	uint8_t* m_Items;
+	uint32_t m_ItemSize;
+	uint32_t m_Capacity;
+	uint32_t m_Mask;
+	uint32_t m_MaxConsumers;
+	uint32_t m_Flags;
+};
+
+static uint64_t brCalcMinReadSeq(BroadcastRing* ring, uint64_t writeSeq);
+static void brDropSlowConsumers(BroadcastRing* ring, uint64_t writeSeq);
+static bool brConsumerAdvance(BroadcastRing* ring, BroadcastConsumer* consumer, uint64_t readSeq, uint64_t newReadSeq);
+
+inline uint32_t brAlignSize(uint32_t sz, uint32_t alignment)
+{
+	const uint32_t mask = alignment - 1;
+	return (sz & (~mask)) + ((sz & mask) != 0 ? alignment : 0);
+}
+
+BroadcastRing* createBroadcastRing(bx::AllocatorI* allocator, uint32_t itemSize, uint32_t capacity, uint32_t maxConsumers, uint32_t flags)
+{
+	JX_CHECK(bx::isPowerOf2<uint32_t>(capacity), "Broadcast ring capacity must be a power of 2");
+	JX_CHECK(itemSize != 0 && maxConsumers != 0, "Invalid broadcast ring parameters");
+
+	const uint32_t totalMem = 0
+		+ brAlignSize(sizeof(BroadcastRing), BROADCAST_RING_CACHE_LINE_SIZE)
+		+ sizeof(BroadcastConsumer) * maxConsumers
+		+ brAlignSize(itemSize * capacity, BROADCAST_RING_CACHE_LINE_SIZE)
+		;
+
+	uint8_t* mem = (uint8_t*)BX_ALIGNED_ALLOC(allocator, totalMem, BROADCAST_RING_CACHE_LINE_SIZE);
+	if (!mem) {
+		return nullptr;
+	}
+
+	bx::memSet(mem, 0, totalMem);
+
+	uint8_t* ptr = mem;
+	BroadcastRing* ring = (BroadcastRing*)ptr;  ptr += brAlignSize(sizeof(BroadcastRing), BROADCAST_RING_CACHE_LINE_SIZE);
+	ring->m_Consumers = (BroadcastConsumer*)ptr; ptr += sizeof(BroadcastConsumer) * maxConsumers;
+	ring->m_Items = ptr;                         ptr += brAlignSize(itemSize * capacity, BROADCAST_RING_CACHE_LINE_SIZE);
+
+	ring->m_Allocator = allocator;
+	ring->m_ItemSize = itemSize;
+	ring->m_Capacity = capacity;
+	ring->m_Mask = capacity - 1;
+	ring->m_MaxConsumers = maxConsumers;
+	ring->m_Flags = flags;
+	ring->m_WriteSeq = 0;
+	ring->m_CachedMinReadSeq = 0;
+
+	return ring;
+}
+
+void destroyBroadcastRing(BroadcastRing* ring)
+{
+	BX_ALIGNED_FREE(ring->m_Allocator, ring, BROADCAST_RING_CACHE_LINE_SIZE);
+}
+
+uint32_t broadcastRingAddConsumer(BroadcastRing* ring)
+{
+	const uint32_t maxConsumers = ring->m_MaxConsumers;
+	for (uint32_t i = 0; i < maxConsumers; ++i) {
+		BroadcastConsumer* consumer = &ring->m_Consumers[i];
+		if (consumer->m_State != ConsumerState::Free) {
+			continue;
+		}
+
+		// Claim the slot before publishing the cursor. The producer ignores consumers
+		// which aren't active, so the cursor must be valid before the state changes.
+		if (bx::atomicCompareAndSwap<int32_t>(&consumer->m_State, ConsumerState::Free, ConsumerState::Claimed) != ConsumerState::Free) {
+			continue;
+		}
+
+		consumer->m_ReadSeq = ring->m_WriteSeq;
+		consumer->m_NumDropped = 0;
+		bx::memoryBarrier();
+		consumer->m_State = ConsumerState::Active;
+		bx::memoryBarrier();
+
+		// The producer might still be using a minimum read position calculated before the
+		// consumer became active, which allows it to overwrite items older than that position.
+		// Such a minimum can't be past the write position observed after activation, so
+		// start from there. Later scans see the consumer and won't overwrite its items.
+		for (;;) {
+			const uint64_t readSeq = consumer->m_ReadSeq;
+			const uint64_t writeSeq = ring->m_WriteSeq;
+			if (readSeq >= writeSeq || bx::atomicCompareAndSwap<uint64_t>(&consumer->m_ReadSeq, readSeq, writeSeq) == readSeq) {
+				break;
+			}
+		}
+
+		return i;
+	}
+
+	return JX_BROADCAST_RING_INVALID_CONSUMER;
+}
+
+void broadcastRingRemoveConsumer(BroadcastRing* ring, uint32_t consumerID)
+{
+	JX_CHECK(consumerID < ring->m_MaxConsumers, "Invalid consumer ID");
+	BroadcastConsumer* consumer = &ring->m_Consumers[consumerID];
+
+	bx::memoryBarrier();
+	consumer->m_State = ConsumerState::Free;
+}
+
+bool broadcastRingPush(BroadcastRing* ring, const void* item)
+{
+	const uint64_t writeSeq = ring->m_WriteSeq;
+	if (writeSeq - ring->m_CachedMinReadSeq >= ring->m_Capacity) {
+		ring->m_CachedMinReadSeq = brCalcMinReadSeq(ring, writeSeq);
+		if (writeSeq - ring->m_CachedMinReadSeq >= ring->m_Capacity) {
+			if ((ring->m_Flags & BroadcastRingFlags::DropSlowConsumers) == 0) {
+				return false;
+			}
+
+			brDropSlowConsumers(ring, writeSeq);
+			ring->m_CachedMinReadSeq = writeSeq - ring->m_Capacity + 1;
+		}
+	}
+
+	bx::memCopy(&ring->m_Items[(writeSeq & ring->m_Mask) * ring->m_ItemSize], item, ring->m_ItemSize);
+
+	// Publish the item.
+	bx::writeBarrier();
+	ring->m_WriteSeq = writeSeq + 1;
+
+	return true;
+}
+
+bool broadcastRingPushMessage(BroadcastRing* ring, uint32_t msgID, const void* data, uint32_t sz)
+{
+	JX_CHECK(ring->m_ItemSize == sizeof(ThreadMessage), "Broadcast ring item isn't a ThreadMessage");
+
+	if (sz > JX_THREAD_MESSAGE_BUFFER_SIZE) {
+		JX_CHECK(false, "Thread message data too large!");
+		return false;
+	}
+
+	ThreadMessage msg;
+	msg.m_MsgID = msgID;
+	bx::memCopy(msg.m_Data, data, sz);
+
+	return broadcastRingPush(ring, &msg);
+}
+
+bool broadcastRingPop(BroadcastRing* ring, uint32_t consumerID, void* item)
+{
+	JX_CHECK(consumerID < ring->m_MaxConsumers, "Invalid consumer ID");
+	BroadcastConsumer* consumer = &ring->m_Consumers[consumerID];
+
+	for (;;) {
+		const uint64_t readSeq = consumer->m_ReadSeq;
+		if (readSeq == ring->m_WriteSeq) {
+			return false;
+		}
+		bx::readBarrier();
+
+		bx::memCopy(item, &ring->m_Items[(readSeq & ring->m_Mask) * ring->m_ItemSize], ring->m_ItemSize);
+
+		// If the producer has skipped this consumer ahead in the meantime the copy might
+		// be torn; discard it and retry from the new position.
+		if (brConsumerAdvance(ring, consumer, readSeq, readSeq + 1)) {
+			return true;
+		}
+	}
+}
+
+void broadcastRingSkip(BroadcastRing* ring, uint32_t consumerID, uint32_t numItems)
+{
+	JX_CHECK(consumerID < ring->m_MaxConsumers, "Invalid consumer ID");
+	BroadcastConsumer* consumer = &ring->m_Consumers[consumerID];
+
+	for (;;) {
+		const uint64_t readSeq = consumer->m_ReadSeq;
+		const uint64_t writeSeq = ring->m_WriteSeq;
+		const uint64_t targetSeq = readSeq + numItems;
+		const uint64_t newReadSeq = bx::min<uint64_t>(targetSeq, writeSeq);
+		if (brConsumerAdvance(ring, consumer, readSeq, newReadSeq)) {
+			break;
+		}
+	}
+}
+
+void broadcastRingSkipToLatest(BroadcastRing* ring, uint32_t consumerID)
+{
+	broadcastRingSkip(ring, consumerID, UINT32_MAX);
+}
+
+uint32_t broadcastRingGetLag(const BroadcastRing* ring, uint32_t consumerID)
+{
+	JX_CHECK(consumerID < ring->m_MaxConsumers, "Invalid consumer ID");
+	const BroadcastConsumer* consumer = &ring->m_Consumers[consumerID];
+	if (consumer->m_State != ConsumerState::Active) {
+		return 0;
+	}
+
+	const uint64_t readSeq = consumer->m_ReadSeq;
+	const uint64_t writeSeq = ring->m_WriteSeq;
+	return writeSeq > readSeq ? (uint32_t)(writeSeq - readSeq) : 0;
+}
+
+uint64_t broadcastRingGetNumDropped(const BroadcastRing* ring, uint32_t consumerID)
+{
+	JX_CHECK(consumerID < ring->m_MaxConsumers, "Invalid consumer ID");
+	return ring->m_Consumers[consumerID].m_NumDropped;
+}
+
+uint32_t broadcastRingFindSlowestConsumer(const BroadcastRing* ring, uint32_t* lag)
+{
+	uint32_t slowestID = JX_BROADCAST_RING_INVALID_CONSUMER;
+	uint32_t maxLag = 0;
+
+	const uint32_t maxConsumers = ring->m_MaxConsumers;
+	for (uint32_t i = 0; i < maxConsumers; ++i) {
+		if (ring->m_Consumers[i].m_State != ConsumerState::Active) {
+			continue;
+		}
+
+		const uint32_t consumerLag = broadcastRingGetLag(ring, i);
+		if (slowestID == JX_BROADCAST_RING_INVALID_CONSUMER || consumerLag > maxLag) {
+			slowestID = i;
+			maxLag = consumerLag;
+		}
+	}
+
+	if (lag) {
+		*lag = maxLag;
+	}
+
+	return slowestID;
+}
+
+uint32_t broadcastRingGetCapacity(const BroadcastRing* ring)
+{
+	return ring->m_Capacity;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Internal
+//
+// Consumers which are being added (Claimed) are skipped. broadcastRingAddConsumer()
+// moves their cursor past anything this scan allows the producer to overwrite.
+static uint64_t brCalcMinReadSeq(BroadcastRing* ring, uint64_t writeSeq)
+{
+	uint64_t minReadSeq = writeSeq;
+
+	const uint32_t maxConsumers = ring->m_MaxConsumers;
+	for (uint32_t i = 0; i < maxConsumers; ++i) {
+		const BroadcastConsumer* consumer = &ring->m_Consumers[i];
+		if (consumer->m_State == ConsumerState::Active) {
+			const uint64_t readSeq = consumer->m_ReadSeq;
+			minReadSeq = bx::min<uint64_t>(minReadSeq, readSeq);
+		}
+	}
+
+	return minReadSeq;
+}
+
+static void brDropSlowConsumers(BroadcastRing* ring, uint64_t writeSeq)
+{
+	// Move every consumer which would block the producer to the oldest slot which
+	// won't be overwritten by this push.
+	const uint64_t minAllowedSeq = writeSeq - ring->m_Capacity + 1;
+
+	const uint32_t maxConsumers = ring->m_MaxConsumers;
+	for (uint32_t i = 0; i < maxConsumers; ++i) {
+		BroadcastConsumer* consumer = &ring->m_Consumers[i];
+		if (consumer->m_State != ConsumerState::Active) {
+			continue;
+		}
+
+		for (;;) {
+			const uint64_t readSeq = consumer->m_ReadSeq;
+			if (readSeq >= minAllowedSeq) {
+				break;
+			}
+
+			if (bx::atomicCompareAndSwap<uint64_t>(&consumer->m_ReadSeq, readSeq, minAllowedSeq) == readSeq) {
+				bx::atomicFetchAndAdd<uint64_t>(&consumer->m_NumDropped, minAllowedSeq - readSeq);
+				break;
+			}
+		}
+	}
+}
+
+// Releases the items in [readSeq, newReadSeq). Only the consumer writes its cursor unless
+// the producer is allowed to skip slow consumers ahead, so a plain store is enough in that case.
+static bool brConsumerAdvance(BroadcastRing* ring, BroadcastConsumer* consumer, uint64_t readSeq, uint64_t newReadSeq)
+{
+	if ((ring->m_Flags & BroadcastRingFlags::DropSlowConsumers) == 0) {
+		// Make sure the item has been copied before the slot is released.
+		bx::readWriteBarrier();
+		consumer->m_ReadSeq = newReadSeq;
+		return true;
+	}
+
+	bx::memoryBarrier();
+	return bx::atomicCompareAndSwap<uint64_t>(&consumer->m_ReadSeq, readSeq, newReadSeq) == readSeq;
+}
+}
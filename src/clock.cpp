@@ -0,0 +1,363 @@
+#include <jx/clock.h>
+#include <jx/cpu.h>
+#include <jx/sys.h>
+#include <bx/cpu.h>
+#include <bx/timer.h>
+
+#if JX_CONFIG_CLOCK_TSC && BX_CPU_X86
+#	define CLOCK_TSC_SUPPORTED 1
+#	if BX_PLATFORM_WINDOWS
+#		include <intrin.h> // __rdtsc(), __cpuid()
+#	else
+#		include <cpuid.h>     // __get_cpuid()
+#		include <x86intrin.h> // __rdtsc()
+#	endif
+#	if BX_PLATFORM_LINUX
+#		include <fcntl.h>  // open()
+#		include <unistd.h> // read(), close()
+#		include <bx/string.h>
+#	endif
+#else
+#	define CLOCK_TSC_SUPPORTED 0
+#endif
+
+namespace jx
+{
+#define CLOCK_CALIBRATION_ROUNDS       2
+#define CLOCK_CALIBRATION_ROUND_NS     5000000 // 5ms
+#define CLOCK_CALIBRATION_TOLERANCE    0.005   // Max relative difference between calibration rounds
+#define CLOCK_MAX_DRIFT                0.01    // Max relative difference between the calibrated and the measured TSC frequency
+#define CLOCK_MIN_TSC_FREQUENCY        100000000ll
+#define CLOCK_MAX_TSC_FREQUENCY        20000000000ll
+#define CLOCK_PAIR_SAMPLES             5
+
+struct ClockState
+{
+	enum Enum : int32_t
+	{
+		Uninitialized = 0,
+		Initializing,
+		Ready,
+	};
+};
+
+// ns = (ticks * m_Mult) >> m_Shift, with m_Mult < 2^32 so the multiplications don't overflow.
+struct ClockConversion
+{
+	int64_t m_Frequency;
+	uint64_t m_Mult;
+	uint32_t m_Shift;
+};
+
+struct Clock
+{
+	volatile int32_t m_State;
+	volatile uint32_t m_Source;
+
+	// Readers use the conversion selected by m_ConversionID; clockResync() updates the other
+	// one and flips the ID.
+	ClockConversion m_Conversion[2];
+	volatile uint32_t m_ConversionID;
+
+	int64_t m_HPCFrequency;
+
+	// TSC and monotonic clock readings taken at the same time, at calibration and at the
+	// last resync.
+	int64_t m_AnchorTSC;
+	int64_t m_AnchorHPC;
+	int64_t m_LastResyncTSC;
+	int64_t m_LastResyncHPC;
+
+	// ClockSource::MonotonicScaled
+	int64_t m_ScaledBaseTicks;
+	int64_t m_ScaledBaseHPC;
+	double m_TicksPerHPCTick;
+};
+
+static Clock s_Clock;
+
+static void clockSetConversion(ClockConversion* conv, int64_t frequency);
+static int64_t clockConvert(const ClockConversion* conv, int64_t ticks);
+#if CLOCK_TSC_SUPPORTED
+static bool clockIsTSCTrusted();
+static bool clockCalibrateTSC(int64_t* frequency, int64_t* tsc, int64_t* hpc);
+static void clockSamplePair(int64_t* tsc, int64_t* hpc);
+#endif
+
+void clockInit()
+{
+	Clock* clock = &s_Clock;
+	if (bx::atomicCompareAndSwap<int32_t>(&clock->m_State, ClockState::Uninitialized, ClockState::Initializing) != ClockState::Uninitialized) {
+		// Another thread might be calibrating.
+		while (clock->m_State != ClockState::Ready) {
+			jx::cpuPause();
+		}
+
+		return;
+	}
+
+	clock->m_HPCFrequency = bx::getHPFrequency();
+
+	ClockSource::Enum source = ClockSource::Monotonic;
+	int64_t frequency = clock->m_HPCFrequency;
+
+#if CLOCK_TSC_SUPPORTED
+	int64_t tscFrequency = 0;
+	if (clockIsTSCTrusted() && clockCalibrateTSC(&tscFrequency, &clock->m_AnchorTSC, &clock->m_AnchorHPC)) {
+		source = ClockSource::TSC;
+		frequency = tscFrequency;
+		clock->m_LastResyncTSC = clock->m_AnchorTSC;
+		clock->m_LastResyncHPC = clock->m_AnchorHPC;
+	}
+#endif
+
+	clockSetConversion(&clock->m_Conversion[0], frequency);
+	clock->m_ConversionID = 0;
+	clock->m_Source = source;
+
+	bx::memoryBarrier();
+	clock->m_State = ClockState::Ready;
+}
+
+void clockResync()
+{
+	Clock* clock = &s_Clock;
+	if (clock->m_State != ClockState::Ready || clock->m_Source != ClockSource::TSC) {
+		return;
+	}
+
+#if CLOCK_TSC_SUPPORTED
+	int64_t tsc, hpc;
+	clockSamplePair(&tsc, &hpc);
+
+	const int64_t interval = (clock->m_HPCFrequency * JX_CONFIG_CLOCK_RESYNC_INTERVAL_MS) / 1000;
+	if (hpc - clock->m_LastResyncHPC < interval) {
+		return;
+	}
+
+	const ClockConversion* cur = &clock->m_Conversion[clock->m_ConversionID & 1];
+
+	// The frequency is measured over the whole time since calibration, so it gets more
+	// accurate with every resync.
+	const double elapsed_sec = (double)(hpc - clock->m_AnchorHPC) / (double)clock->m_HPCFrequency;
+	const double measuredFrequency = (double)(tsc - clock->m_AnchorTSC) / elapsed_sec;
+	const double delta = measuredFrequency - (double)cur->m_Frequency;
+	const double drift = (delta < 0.0 ? -delta : delta) / (double)cur->m_Frequency;
+
+	if (tsc < clock->m_LastResyncTSC || drift > CLOCK_MAX_DRIFT) {
+		// Keep the tick unit (and the current frequency) so timestamps stay comparable.
+		clock->m_ScaledBaseTicks = tsc;
+		clock->m_ScaledBaseHPC = hpc;
+		clock->m_TicksPerHPCTick = (double)cur->m_Frequency / (double)clock->m_HPCFrequency;
+		bx::memoryBarrier();
+		clock->m_Source = ClockSource::MonotonicScaled;
+
+		JX_WARN(false, "TSC can't be trusted anymore (drift: %.3f%%). Falling back to the monotonic clock.", drift * 100.0);
+		return;
+	}
+
+	const uint32_t nextID = (clock->m_ConversionID + 1) & 1;
+	clockSetConversion(&clock->m_Conversion[nextID], (int64_t)(measuredFrequency + 0.5));
+	bx::writeBarrier();
+	clock->m_ConversionID = nextID;
+
+	clock->m_LastResyncTSC = tsc;
+	clock->m_LastResyncHPC = hpc;
+#endif
+}
+
+int64_t clockGetTicks()
+{
+	const Clock* clock = &s_Clock;
+	if (clock->m_State != ClockState::Ready) {
+		clockInit();
+	}
+
+	const uint32_t source = clock->m_Source;
+#if CLOCK_TSC_SUPPORTED
+	if (source == ClockSource::TSC) {
+		return (int64_t)__rdtsc();
+	}
+#endif
+
+	if (source == ClockSource::MonotonicScaled) {
+		return clock->m_ScaledBaseTicks + (int64_t)((double)(bx::getHPCounter() - clock->m_ScaledBaseHPC) * clock->m_TicksPerHPCTick);
+	}
+
+	return bx::getHPCounter();
+}
+
+int64_t clockGetFrequency()
+{
+	const Clock* clock = &s_Clock;
+	if (clock->m_State != ClockState::Ready) {
+		clockInit();
+	}
+
+	return clock->m_Conversion[clock->m_ConversionID & 1].m_Frequency;
+}
+
+int64_t clockTicksToNs(int64_t ticks)
+{
+	const Clock* clock = &s_Clock;
+	if (clock->m_State != ClockState::Ready) {
+		clockInit();
+	}
+
+	const ClockConversion* conv = &clock->m_Conversion[clock->m_ConversionID & 1];
+	return ticks >= 0
+		? clockConvert(conv, ticks)
+		: -clockConvert(conv, -ticks)
+		;
+}
+
+ClockSource::Enum clockGetSource()
+{
+	const Clock* clock = &s_Clock;
+	if (clock->m_State != ClockState::Ready) {
+		clockInit();
+	}
+
+	return (ClockSource::Enum)clock->m_Source;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Internal
+//
+static void clockSetConversion(ClockConversion* conv, int64_t frequency)
+{
+	// Largest shift (i.e. best precision) which keeps the multiplier below 2^32.
+	uint32_t shift = 32;
+	uint64_t mult = (1000000000ull << shift) / (uint64_t)frequency;
+	while (mult >= (1ull << 32) && shift != 0) {
+		--shift;
+		mult = (1000000000ull << shift) / (uint64_t)frequency;
+	}
+
+	conv->m_Frequency = frequency;
+	conv->m_Mult = mult;
+	conv->m_Shift = shift;
+}
+
+static int64_t clockConvert(const ClockConversion* conv, int64_t ticks)
+{
+	const uint64_t hi = (uint64_t)ticks >> 32;
+	const uint64_t lo = (uint64_t)ticks & 0xFFFFFFFFull;
+	return (int64_t)(((hi * conv->m_Mult) << (32 - conv->m_Shift)) + ((lo * conv->m_Mult) >> conv->m_Shift));
+}
+
+#if CLOCK_TSC_SUPPORTED
+// The TSC must tick at a constant rate in all P/C-states (invariant TSC). On Linux the kernel
+// also removes it from the available clock sources if it isn't synchronized between CPUs.
+static bool clockIsTSCTrusted()
+{
+#if BX_PLATFORM_WINDOWS
+	int cpuInfo[4];
+	__cpuid(cpuInfo, 0x80000000);
+	if ((uint32_t)cpuInfo[0] < 0x80000007) {
+		return false;
+	}
+
+	__cpuid(cpuInfo, 0x80000007);
+	const bool invariantTSC = (cpuInfo[3] & (1 << 8)) != 0;
+#else
+	uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
+	if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+		return false;
+	}
+
+	const bool invariantTSC = (edx & (1u << 8)) != 0;
+#endif
+
+	if (!invariantTSC) {
+		return false;
+	}
+
+#if BX_PLATFORM_LINUX
+	const int fd = ::open("/sys/devices/system/clocksource/clocksource0/available_clocksource", O_RDONLY);
+	if (fd >= 0) {
+		char buffer[256];
+		const ssize_t len = ::read(fd, buffer, sizeof(buffer) - 1);
+		::close(fd);
+
+		if (len > 0) {
+			buffer[len] = '\0';
+			if (bx::strFind(buffer, "tsc").isEmpty()) {
+				return false;
+			}
+		}
+	}
+#endif
+
+	return true;
+}
+
+// Measures the TSC frequency over a few short rounds against the monotonic clock. The rounds
+// must agree; otherwise the TSC isn't ticking at a constant rate.
+static bool clockCalibrateTSC(int64_t* frequency, int64_t* tsc, int64_t* hpc)
+{
+	const int64_t hpcFrequency = bx::getHPFrequency();
+	const int64_t roundTicks = (hpcFrequency * CLOCK_CALIBRATION_ROUND_NS) / 1000000000ll;
+
+	int64_t startTSC, startHPC;
+	clockSamplePair(&startTSC, &startHPC);
+
+	double frequencies[CLOCK_CALIBRATION_ROUNDS];
+	for (uint32_t i = 0; i < CLOCK_CALIBRATION_ROUNDS; ++i) {
+		while (bx::getHPCounter() - startHPC < roundTicks) {
+			jx::cpuPause();
+		}
+
+		int64_t endTSC, endHPC;
+		clockSamplePair(&endTSC, &endHPC);
+
+		frequencies[i] = (double)(endTSC - startTSC) * (double)hpcFrequency / (double)(endHPC - startHPC);
+
+		*tsc = endTSC;
+		*hpc = endHPC;
+		startTSC = endTSC;
+		startHPC = endHPC;
+	}
+
+	double minFrequency = frequencies[0];
+	double maxFrequency = frequencies[0];
+	for (uint32_t i = 1; i < CLOCK_CALIBRATION_ROUNDS; ++i) {
+		minFrequency = bx::min<double>(minFrequency, frequencies[i]);
+		maxFrequency = bx::max<double>(maxFrequency, frequencies[i]);
+	}
+
+	const bool valid = true
+		&& minFrequency >= (double)CLOCK_MIN_TSC_FREQUENCY
+		&& maxFrequency <= (double)CLOCK_MAX_TSC_FREQUENCY
+		&& (maxFrequency - minFrequency) / minFrequency <= CLOCK_CALIBRATION_TOLERANCE
+		;
+	if (!valid) {
+		return false;
+	}
+
+	// The last round is the most accurate guess of the current frequency; clockResync()
+	// refines it over longer periods.
+	*frequency = (int64_t)(frequencies[CLOCK_CALIBRATION_ROUNDS - 1] + 0.5);
+
+	return true;
+}
+
+// Reads the monotonic clock between two TSC reads and keeps the tightest pair, so that
+// preemption or a slow system call doesn't skew the result.
+static void clockSamplePair(int64_t* tsc, int64_t* hpc)
+{
+	int64_t bestDelta = INT64_MAX;
+	for (uint32_t i = 0; i < CLOCK_PAIR_SAMPLES; ++i) {
+		const int64_t tsc0 = (int64_t)__rdtsc();
+		const int64_t hpcNow = bx::getHPCounter();
+		const int64_t tsc1 = (int64_t)__rdtsc();
+
+		if (tsc1 - tsc0 < bestDelta) {
+			bestDelta = tsc1 - tsc0;
+			*tsc = tsc0 + (tsc1 - tsc0) / 2;
+			*hpc = hpcNow;
+		}
+	}
+}
+#endif
+}
@@ -0,0 +1,177 @@
+#include <jx/coroutine.h>
+
+#if JX_CONFIG_COROUTINES
+#include <jx/timer_service.h>
+#include <bx/allocator.h>
+
+namespace jx
+{
+static const uint32_t kMsgResume   = JX_CO_MSG_ID_FIRST_RESERVED + 0;
+static const uint32_t kMsgRunWork  = JX_CO_MSG_ID_FIRST_RESERVED + 1;
+static const uint32_t kMsgWorkDone = JX_CO_MSG_ID_FIRST_RESERVED + 2;
+
+struct CoScheduler
+{
+	bx::AllocatorI* m_Allocator;
+	Thread* m_Thread;
+	TimerService* m_Timers;
+	CoWaitNode* m_Waiters;
+	CoWaitNode** m_WaitersTail;
+	uint32_t m_NumWaiters;
+};
+
+struct CoWorkRequest
+{
+	CoWorkFn m_Func;
+	void* m_UserData;
+	Thread* m_ReplyThread;
+	void* m_Handle;
+	int32_t* m_Result;
+};
+
+struct CoWorkReply
+{
+	void* m_Handle;
+	int32_t* m_Result;
+	int32_t m_Value;
+};
+
+BX_STATIC_ASSERT(sizeof(CoWorkRequest) <= JX_THREAD_MESSAGE_BUFFER_SIZE, "CoWorkRequest doesn't fit in a ThreadMessage");
+BX_STATIC_ASSERT(sizeof(CoWorkReply) <= JX_THREAD_MESSAGE_BUFFER_SIZE, "CoWorkReply doesn't fit in a ThreadMessage");
+
+CoScheduler* createCoScheduler(bx::AllocatorI* allocator, Thread* thread, TimerService* timers)
+{
+	CoScheduler* sched = (CoScheduler*)BX_ALLOC(allocator, sizeof(CoScheduler));
+	if (!sched) {
+		return nullptr;
+	}
+
+	bx::memSet(sched, 0, sizeof(CoScheduler));
+	sched->m_Allocator = allocator;
+	sched->m_Thread = thread;
+	sched->m_Timers = timers;
+	sched->m_Waiters = nullptr;
+	sched->m_WaitersTail = &sched->m_Waiters;
+
+	return sched;
+}
+
+void destroyCoScheduler(CoScheduler* sched)
+{
+	// NOTE: Suspended coroutines are owned by their awaiters (or are detached). The scheduler
+	// doesn't destroy them.
+	JX_CHECK(sched->m_NumWaiters == 0, "Destroying scheduler with suspended coroutines");
+
+	BX_FREE(sched->m_Allocator, sched);
+}
+
+Thread* coSchedulerGetThread(const CoScheduler* sched)
+{
+	return sched->m_Thread;
+}
+
+uint32_t coSchedulerGetNumWaiters(const CoScheduler* sched)
+{
+	return sched->m_NumWaiters;
+}
+
+bool coSchedulerDispatch(CoScheduler* sched, ThreadMessage* msg)
+{
+	Thread* thread = sched->m_Thread;
+
+	const uint32_t msgID = msg->m_MsgID;
+	if (msgID == kMsgResume) {
+		void* addr = nullptr;
+		bx::memCopy(&addr, msg->m_Data, sizeof(void*));
+		threadReleaseMessage(thread, msg);
+
+		std::coroutine_handle<>::from_address(addr).resume();
+		return true;
+	} else if (msgID == kMsgRunWork) {
+		CoWorkRequest req;
+		bx::memCopy(&req, msg->m_Data, sizeof(CoWorkRequest));
+		threadReleaseMessage(thread, msg);
+
+		CoWorkReply reply;
+		reply.m_Handle = req.m_Handle;
+		reply.m_Result = req.m_Result;
+		reply.m_Value = req.m_Func(req.m_UserData);
+
+		if (!threadInQueuePush(req.m_ReplyThread, kMsgWorkDone, &reply, sizeof(CoWorkReply))) {
+			JX_CHECK(false, "Failed to send work completion message. Coroutine will never be resumed.");
+		}
+
+		return true;
+	} else if (msgID == kMsgWorkDone) {
+		CoWorkReply reply;
+		bx::memCopy(&reply, msg->m_Data, sizeof(CoWorkReply));
+		threadReleaseMessage(thread, msg);
+
+		*reply.m_Result = reply.m_Value;
+		std::coroutine_handle<>::from_address(reply.m_Handle).resume();
+		return true;
+	}
+
+	// Wake up the first coroutine waiting for this message.
+	CoWaitNode** prev = &sched->m_Waiters;
+	while (*prev) {
+		CoWaitNode* node = *prev;
+		if (node->m_MsgID == JX_CO_ANY_MESSAGE || node->m_MsgID == msgID) {
+			*prev = node->m_Next;
+			if (!node->m_Next) {
+				sched->m_WaitersTail = prev;
+			}
+			node->m_Next = nullptr;
+			--sched->m_NumWaiters;
+
+			bx::memCopy(&node->m_Msg, msg, sizeof(ThreadMessage));
+			threadReleaseMessage(thread, msg);
+
+			node->m_Handle.resume();
+			return true;
+		}
+
+		prev = &node->m_Next;
+	}
+
+	return false;
+}
+
+void coSchedulerAddWaiter(CoScheduler* sched, CoWaitNode* node)
+{
+	node->m_Next = nullptr;
+	*sched->m_WaitersTail = node;
+	sched->m_WaitersTail = &node->m_Next;
+	++sched->m_NumWaiters;
+}
+
+bool coSchedulerPostResume(CoScheduler* sched, std::coroutine_handle<> handle)
+{
+	void* addr = handle.address();
+	return threadInQueuePush(sched->m_Thread, kMsgResume, &addr, sizeof(void*));
+}
+
+bool coSchedulerResumeAfter(CoScheduler* sched, std::coroutine_handle<> handle, uint32_t delay_msec)
+{
+	if (!sched->m_Timers) {
+		JX_CHECK(false, "Scheduler has been created without a timer service");
+		return false;
+	}
+
+	void* addr = handle.address();
+	return JX_TIMER_INVALID_ID != timerServiceAdd(sched->m_Timers, sched->m_Thread, delay_msec, 0, kMsgResume, &addr, sizeof(void*));
+}
+
+bool coSchedulerRunOn(CoScheduler* sched, Thread* worker, CoWorkFn func, void* userData, std::coroutine_handle<> handle, int32_t* result)
+{
+	CoWorkRequest req;
+	req.m_Func = func;
+	req.m_UserData = userData;
+	req.m_ReplyThread = sched->m_Thread;
+	req.m_Handle = handle.address();
+	req.m_Result = result;
+
+	return threadInQueuePush(worker, kMsgRunWork, &req, sizeof(CoWorkRequest));
+}
+}
+#endif // JX_CONFIG_COROUTINES
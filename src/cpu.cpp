@@ -0,0 +1,689 @@
+#include <jx/cpu.h>
+#include <jx/sys.h>
+#include <bx/allocator.h>
+#include <bx/string.h>
+
+#if BX_PLATFORM_LINUX || BX_PLATFORM_RPI
+#include <sched.h>    // sched_getcpu()
+#include <fcntl.h>    // open()
+#include <unistd.h>   // read(), close(), sysconf()
+#include <dirent.h>   // opendir()
+#elif BX_PLATFORM_WINDOWS
+#include <Windows.h>
+#else
+#include <thread>     // std::thread::hardware_concurrency()
+#endif
+
+namespace jx
+{
+#define CPU_CONFIG_MAX_CACHES_PER_CPU 8
+
+struct CPUTopology
+{
+	bx::AllocatorI* m_Allocator;
+	CPULogicalCore* m_LogicalCores;
+	CPUPhysicalCore* m_PhysicalCores;
+	CPUCache* m_Caches;
+	CPUNUMANode* m_NUMANodes;
+	uint32_t m_NumLogicalCores;
+	uint32_t m_NumPhysicalCores;
+	uint32_t m_NumCaches;
+	uint32_t m_NumNUMANodes;
+	uint32_t m_NumPackages;
+};
+
+static bool cpuTopoInit(CPUTopology* topo, bx::AllocatorI* allocator, uint32_t numLogicalCores, uint32_t numNUMANodes);
+static uint32_t cpuTopoFindOrAddPhysicalCore(CPUTopology* topo, const CPUSet* siblings, uint32_t packageID);
+static void cpuTopoAddCache(CPUTopology* topo, const CPUCache* cache);
+static void cpuTopoCountPackages(CPUTopology* topo);
+#if BX_PLATFORM_LINUX || BX_PLATFORM_RPI
+static bool readSysFile(const char* path, char* buffer, uint32_t maxLen);
+static bool readSysFileU32(const char* path, uint32_t* val);
+static bool readSysFileCPUSet(const char* path, CPUSet* set);
+static uint32_t parseCacheSize(const char* str);
+static uint32_t countNUMANodes(uint32_t* maxNodeID);
+#elif BX_PLATFORM_WINDOWS
+static void cpuSetFromGroupAffinity(CPUSet* set, const GROUP_AFFINITY* affinity);
+#endif
+
+CPUTopology* createCPUTopology(bx::AllocatorI* allocator)
+{
+	CPUTopology* topo = (CPUTopology*)BX_ALLOC(allocator, sizeof(CPUTopology));
+	if (!topo) {
+		return nullptr;
+	}
+
+	bx::memSet(topo, 0, sizeof(CPUTopology));
+	topo->m_Allocator = allocator;
+
+#if BX_PLATFORM_LINUX || BX_PLATFORM_RPI
+	CPUSet online;
+	if (!readSysFileCPUSet("/sys/devices/system/cpu/online", &online)) {
+		// Fall back to the number of configured processors (assumes contiguous IDs)
+		cpuSetClear(&online);
+		const long numCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+		for (long i = 0; i < numCPUs && i < JX_CONFIG_MAX_CPUS; ++i) {
+			cpuSetAdd(&online, (uint32_t)i);
+		}
+	}
+
+	uint32_t maxNodeID = 0;
+	const uint32_t numNodes = countNUMANodes(&maxNodeID);
+	if (!cpuTopoInit(topo, allocator, cpuSetCount(&online), bx::max<uint32_t>(numNodes, 1))) {
+		destroyCPUTopology(topo);
+		return nullptr;
+	}
+
+	// NUMA nodes. If the kernel has been built without NUMA support, all CPUs belong to node 0.
+	if (numNodes != 0) {
+		for (uint32_t nodeID = 0; nodeID <= maxNodeID; ++nodeID) {
+			char path[256];
+			bx::snprintf(path, BX_COUNTOF(path), "/sys/devices/system/node/node%u/cpulist", nodeID);
+
+			CPUSet nodeCPUs;
+			if (!readSysFileCPUSet(path, &nodeCPUs)) {
+				continue;
+			}
+
+			CPUNUMANode* node = &topo->m_NUMANodes[topo->m_NumNUMANodes++];
+			node->m_ID = nodeID;
+			node->m_CPUs = nodeCPUs;
+		}
+	}
+
+	if (topo->m_NumNUMANodes == 0) {
+		CPUNUMANode* node = &topo->m_NUMANodes[topo->m_NumNUMANodes++];
+		node->m_ID = 0;
+		node->m_CPUs = online;
+	}
+
+	for (uint32_t cpu = cpuSetNext(&online, 0); cpu != UINT32_MAX; cpu = cpuSetNext(&online, cpu + 1)) {
+		char path[256];
+
+		uint32_t packageID = 0;
+		bx::snprintf(path, BX_COUNTOF(path), "/sys/devices/system/cpu/cpu%u/topology/physical_package_id", cpu);
+		readSysFileU32(path, &packageID);
+
+		CPUSet siblings;
+		bx::snprintf(path, BX_COUNTOF(path), "/sys/devices/system/cpu/cpu%u/topology/thread_siblings_list", cpu);
+		if (!readSysFileCPUSet(path, &siblings)) {
+			cpuSetClear(&siblings);
+			cpuSetAdd(&siblings, cpu);
+		}
+
+		uint32_t nodeID = 0;
+		for (uint32_t i = 0; i < topo->m_NumNUMANodes; ++i) {
+			if (cpuSetContains(&topo->m_NUMANodes[i].m_CPUs, cpu)) {
+				nodeID = i;
+				break;
+			}
+		}
+
+		const uint32_t physicalCoreID = cpuTopoFindOrAddPhysicalCore(topo, &siblings, packageID);
+		CPUPhysicalCore* physicalCore = &topo->m_PhysicalCores[physicalCoreID];
+		physicalCore->m_NUMANodeID = nodeID;
+		physicalCore->m_NumLogicalCores++;
+
+		CPULogicalCore* logicalCore = &topo->m_LogicalCores[topo->m_NumLogicalCores++];
+		logicalCore->m_ID = cpu;
+		logicalCore->m_PhysicalCoreID = physicalCoreID;
+		logicalCore->m_PackageID = packageID;
+		logicalCore->m_NUMANodeID = nodeID;
+
+		for (uint32_t cacheIndex = 0; cacheIndex < CPU_CONFIG_MAX_CACHES_PER_CPU; ++cacheIndex) {
+			CPUCache cache;
+			bx::memSet(&cache, 0, sizeof(CPUCache));
+
+			bx::snprintf(path, BX_COUNTOF(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/level", cpu, cacheIndex);
+			if (!readSysFileU32(path, &cache.m_Level)) {
+				break;
+			}
+
+			char str[64];
+			bx::snprintf(path, BX_COUNTOF(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/type", cpu, cacheIndex);
+			if (readSysFile(path, str, BX_COUNTOF(str))) {
+				cache.m_Type = str[0] == 'D'
+					? CPUCacheType::Data
+					: (str[0] == 'I' ? CPUCacheType::Instruction : CPUCacheType::Unified)
+					;
+			}
+
+			bx::snprintf(path, BX_COUNTOF(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/size", cpu, cacheIndex);
+			if (readSysFile(path, str, BX_COUNTOF(str))) {
+				cache.m_Size = parseCacheSize(str);
+			}
+
+			bx::snprintf(path, BX_COUNTOF(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/coherency_line_size", cpu, cacheIndex);
+			readSysFileU32(path, &cache.m_LineSize);
+
+			bx::snprintf(path, BX_COUNTOF(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/ways_of_associativity", cpu, cacheIndex);
+			readSysFileU32(path, &cache.m_Associativity);
+
+			bx::snprintf(path, BX_COUNTOF(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/shared_cpu_list", cpu, cacheIndex);
+			if (!readSysFileCPUSet(path, &cache.m_SharedCPUs)) {
+				cpuSetClear(&cache.m_SharedCPUs);
+				cpuSetAdd(&cache.m_SharedCPUs, cpu);
+			}
+
+			cpuTopoAddCache(topo, &cache);
+		}
+	}
+#elif BX_PLATFORM_WINDOWS
+	DWORD bufferSize = 0;
+	::GetLogicalProcessorInformationEx(RelationAll, nullptr, &bufferSize);
+	if (bufferSize == 0) {
+		destroyCPUTopology(topo);
+		return nullptr;
+	}
+
+	uint8_t* buffer = (uint8_t*)BX_ALLOC(allocator, bufferSize);
+	if (!buffer) {
+		destroyCPUTopology(topo);
+		return nullptr;
+	}
+
+	if (!::GetLogicalProcessorInformationEx(RelationAll, (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)buffer, &bufferSize)) {
+		BX_FREE(allocator, buffer);
+		destroyCPUTopology(topo);
+		return nullptr;
+	}
+
+	// NOTE: Only the first processor group (64 CPUs) is supported (see setNativeThreadAffinity()).
+	uint32_t numCPUs = 0;
+	uint32_t numNodes = 0;
+	for (DWORD offset = 0; offset < bufferSize; ) {
+		const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX* info = (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*)&buffer[offset];
+		offset += info->Size;
+
+		if (info->Relationship == RelationProcessorCore) {
+			CPUSet siblings;
+			cpuSetFromGroupAffinity(&siblings, &info->Processor.GroupMask[0]);
+			numCPUs += cpuSetCount(&siblings);
+		} else if (info->Relationship == RelationNumaNode) {
+			++numNodes;
+		}
+	}
+
+	if (!cpuTopoInit(topo, allocator, numCPUs, bx::max<uint32_t>(numNodes, 1))) {
+		BX_FREE(allocator, buffer);
+		destroyCPUTopology(topo);
+		return nullptr;
+	}
+
+	// Packages and NUMA nodes first, because the order of the entries in the buffer isn't specified.
+	uint32_t cpuPackageID[JX_CONFIG_MAX_CPUS];
+	bx::memSet(cpuPackageID, 0, sizeof(cpuPackageID));
+
+	uint32_t numPackages = 0;
+	for (DWORD offset = 0; offset < bufferSize; ) {
+		const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX* info = (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*)&buffer[offset];
+		offset += info->Size;
+
+		if (info->Relationship == RelationProcessorPackage) {
+			CPUSet packageCPUs;
+			cpuSetFromGroupAffinity(&packageCPUs, &info->Processor.GroupMask[0]);
+			for (uint32_t cpu = cpuSetNext(&packageCPUs, 0); cpu != UINT32_MAX; cpu = cpuSetNext(&packageCPUs, cpu + 1)) {
+				cpuPackageID[cpu] = numPackages;
+			}
+
+			++numPackages;
+		} else if (info->Relationship == RelationNumaNode) {
+			CPUSet nodeCPUs;
+			cpuSetFromGroupAffinity(&nodeCPUs, &info->NumaNode.GroupMask);
+			if (cpuSetIsEmpty(&nodeCPUs)) {
+				continue;
+			}
+
+			CPUNUMANode* node = &topo->m_NUMANodes[topo->m_NumNUMANodes++];
+			node->m_ID = (uint32_t)info->NumaNode.NodeNumber;
+			node->m_CPUs = nodeCPUs;
+		}
+	}
+
+	if (topo->m_NumNUMANodes == 0) {
+		CPUNUMANode* node = &topo->m_NUMANodes[topo->m_NumNUMANodes++];
+		node->m_ID = 0;
+		cpuSetClear(&node->m_CPUs);
+		for (uint32_t cpu = 0; cpu < numCPUs; ++cpu) {
+			cpuSetAdd(&node->m_CPUs, cpu);
+		}
+	}
+
+	for (DWORD offset = 0; offset < bufferSize; ) {
+		const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX* info = (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*)&buffer[offset];
+		offset += info->Size;
+
+		if (info->Relationship == RelationProcessorCore) {
+			CPUSet siblings;
+			cpuSetFromGroupAffinity(&siblings, &info->Processor.GroupMask[0]);
+
+			const uint32_t firstCPU = cpuSetNext(&siblings, 0);
+			if (firstCPU == UINT32_MAX) {
+				continue;
+			}
+
+			const uint32_t packageID = cpuPackageID[firstCPU];
+
+			uint32_t nodeID = 0;
+			for (uint32_t i = 0; i < topo->m_NumNUMANodes; ++i) {
+				if (cpuSetContains(&topo->m_NUMANodes[i].m_CPUs, firstCPU)) {
+					nodeID = i;
+					break;
+				}
+			}
+
+			const uint32_t physicalCoreID = cpuTopoFindOrAddPhysicalCore(topo, &siblings, packageID);
+			CPUPhysicalCore* physicalCore = &topo->m_PhysicalCores[physicalCoreID];
+			physicalCore->m_NUMANodeID = nodeID;
+
+			for (uint32_t cpu = firstCPU; cpu != UINT32_MAX; cpu = cpuSetNext(&siblings, cpu + 1)) {
+				physicalCore->m_NumLogicalCores++;
+
+				CPULogicalCore* logicalCore = &topo->m_LogicalCores[topo->m_NumLogicalCores++];
+				logicalCore->m_ID = cpu;
+				logicalCore->m_PhysicalCoreID = physicalCoreID;
+				logicalCore->m_PackageID = packageID;
+				logicalCore->m_NUMANodeID = nodeID;
+			}
+		} else if (info->Relationship == RelationCache) {
+			const CACHE_RELATIONSHIP* rel = &info->Cache;
+			if (rel->Type == CacheTrace) {
+				continue;
+			}
+
+			CPUCache cache;
+			bx::memSet(&cache, 0, sizeof(CPUCache));
+			cpuSetFromGroupAffinity(&cache.m_SharedCPUs, &rel->GroupMask);
+			if (cpuSetIsEmpty(&cache.m_SharedCPUs)) {
+				continue;
+			}
+
+			cache.m_Type = rel->Type == CacheData
+				? CPUCacheType::Data
+				: (rel->Type == CacheInstruction ? CPUCacheType::Instruction : CPUCacheType::Unified)
+				;
+			cache.m_Level = (uint32_t)rel->Level;
+			cache.m_Size = (uint32_t)rel->CacheSize;
+			cache.m_LineSize = (uint32_t)rel->LineSize;
+			cache.m_Associativity = (uint32_t)rel->Associativity;
+
+			cpuTopoAddCache(topo, &cache);
+		}
+	}
+
+	BX_FREE(allocator, buffer);
+#else
+	const uint32_t numCPUs = bx::clamp<uint32_t>(std::thread::hardware_concurrency(), 1, JX_CONFIG_MAX_CPUS);
+	if (!cpuTopoInit(topo, allocator, numCPUs, 1)) {
+		destroyCPUTopology(topo);
+		return nullptr;
+	}
+
+	CPUNUMANode* node = &topo->m_NUMANodes[topo->m_NumNUMANodes++];
+	node->m_ID = 0;
+	cpuSetClear(&node->m_CPUs);
+	for (uint32_t cpu = 0; cpu < numCPUs; ++cpu) {
+		cpuSetAdd(&node->m_CPUs, cpu);
+
+		CPUSet siblings;
+		cpuSetClear(&siblings);
+		cpuSetAdd(&siblings, cpu);
+
+		const uint32_t physicalCoreID = cpuTopoFindOrAddPhysicalCore(topo, &siblings, 0);
+		topo->m_PhysicalCores[physicalCoreID].m_NumLogicalCores++;
+
+		CPULogicalCore* logicalCore = &topo->m_LogicalCores[topo->m_NumLogicalCores++];
+		logicalCore->m_ID = cpu;
+		logicalCore->m_PhysicalCoreID = physicalCoreID;
+		logicalCore->m_PackageID = 0;
+		logicalCore->m_NUMANodeID = 0;
+	}
+#endif
+
+	cpuTopoCountPackages(topo);
+
+	return topo;
+}
+
+void destroyCPUTopology(CPUTopology* topo)
+{
+	bx::AllocatorI* allocator = topo->m_Allocator;
+
+	BX_FREE(allocator, topo->m_LogicalCores);
+	BX_FREE(allocator, topo);
+}
+
+uint32_t cpuTopoGetNumLogicalCores(const CPUTopology* topo)
+{
+	return topo->m_NumLogicalCores;
+}
+
+uint32_t cpuTopoGetNumPhysicalCores(const CPUTopology* topo)
+{
+	return topo->m_NumPhysicalCores;
+}
+
+uint32_t cpuTopoGetNumPackages(const CPUTopology* topo)
+{
+	return topo->m_NumPackages;
+}
+
+uint32_t cpuTopoGetNumCaches(const CPUTopology* topo)
+{
+	return topo->m_NumCaches;
+}
+
+uint32_t cpuTopoGetNumNUMANodes(const CPUTopology* topo)
+{
+	return topo->m_NumNUMANodes;
+}
+
+const CPULogicalCore* cpuTopoGetLogicalCore(const CPUTopology* topo, uint32_t id)
+{
+	JX_CHECK(id < topo->m_NumLogicalCores, "Invalid logical core index");
+	return &topo->m_LogicalCores[id];
+}
+
+const CPUPhysicalCore* cpuTopoGetPhysicalCore(const CPUTopology* topo, uint32_t id)
+{
+	JX_CHECK(id < topo->m_NumPhysicalCores, "Invalid physical core index");
+	return &topo->m_PhysicalCores[id];
+}
+
+const CPUCache* cpuTopoGetCache(const CPUTopology* topo, uint32_t id)
+{
+	JX_CHECK(id < topo->m_NumCaches, "Invalid cache index");
+	return &topo->m_Caches[id];
+}
+
+const CPUNUMANode* cpuTopoGetNUMANode(const CPUTopology* topo, uint32_t id)
+{
+	JX_CHECK(id < topo->m_NumNUMANodes, "Invalid NUMA node index");
+	return &topo->m_NUMANodes[id];
+}
+
+const CPUCache* cpuTopoFindCache(const CPUTopology* topo, uint32_t cpuID, uint32_t level)
+{
+	const CPUCache* res = nullptr;
+
+	const uint32_t numCaches = topo->m_NumCaches;
+	for (uint32_t i = 0; i < numCaches; ++i) {
+		const CPUCache* cache = &topo->m_Caches[i];
+		if (cache->m_Level != level || !cpuSetContains(&cache->m_SharedCPUs, cpuID)) {
+			continue;
+		}
+
+		if (!res || cache->m_Size > res->m_Size) {
+			res = cache;
+		}
+	}
+
+	return res;
+}
+
+void cpuTopoGetAllCPUs(const CPUTopology* topo, CPUSet* set)
+{
+	cpuSetClear(set);
+
+	const uint32_t numLogicalCores = topo->m_NumLogicalCores;
+	for (uint32_t i = 0; i < numLogicalCores; ++i) {
+		cpuSetAdd(set, topo->m_LogicalCores[i].m_ID);
+	}
+}
+
+void cpuTopoGetPhysicalCoreSet(const CPUTopology* topo, CPUSet* set)
+{
+	cpuSetClear(set);
+
+	const uint32_t numPhysicalCores = topo->m_NumPhysicalCores;
+	for (uint32_t i = 0; i < numPhysicalCores; ++i) {
+		const uint32_t firstCPU = cpuSetNext(&topo->m_PhysicalCores[i].m_SMTSiblings, 0);
+		if (firstCPU != UINT32_MAX) {
+			cpuSetAdd(set, firstCPU);
+		}
+	}
+}
+
+uint32_t getCurrentCPU()
+{
+#if BX_PLATFORM_LINUX || BX_PLATFORM_RPI
+	const int cpu = sched_getcpu();
+	return cpu < 0 ? UINT32_MAX : (uint32_t)cpu;
+#elif BX_PLATFORM_WINDOWS
+	return (uint32_t)::GetCurrentProcessorNumber();
+#else
+	return UINT32_MAX;
+#endif
+}
+
+bool cpuSetFromString(CPUSet* set, const char* str)
+{
+	cpuSetClear(set);
+
+	const char* ptr = str;
+	while (*ptr != '\0' && *ptr != '\n') {
+		if (*ptr < '0' || *ptr > '9') {
+			return false;
+		}
+
+		uint32_t first = 0;
+		while (*ptr >= '0' && *ptr <= '9') {
+			first = first * 10 + (uint32_t)(*ptr - '0');
+			++ptr;
+		}
+
+		uint32_t last = first;
+		if (*ptr == '-') {
+			++ptr;
+
+			last = 0;
+			while (*ptr >= '0' && *ptr <= '9') {
+				last = last * 10 + (uint32_t)(*ptr - '0');
+				++ptr;
+			}
+		}
+
+		for (uint32_t cpu = first; cpu <= last && cpu < JX_CONFIG_MAX_CPUS; ++cpu) {
+			cpuSetAdd(set, cpu);
+		}
+
+		if (*ptr == ',') {
+			++ptr;
+		}
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Internal
+//
+static bool cpuTopoInit(CPUTopology* topo, bx::AllocatorI* allocator, uint32_t numLogicalCores, uint32_t numNUMANodes)
+{
+	const uint32_t maxCaches = numLogicalCores * CPU_CONFIG_MAX_CACHES_PER_CPU;
+
+	const size_t totalMem = 0
+		+ sizeof(CPULogicalCore) * numLogicalCores
+		+ sizeof(CPUPhysicalCore) * numLogicalCores
+		+ sizeof(CPUCache) * maxCaches
+		+ sizeof(CPUNUMANode) * numNUMANodes
+		;
+
+	uint8_t* mem = (uint8_t*)BX_ALLOC(allocator, totalMem);
+	if (!mem) {
+		return false;
+	}
+
+	bx::memSet(mem, 0, totalMem);
+
+	uint8_t* ptr = mem;
+	topo->m_LogicalCores = (CPULogicalCore*)ptr;   ptr += sizeof(CPULogicalCore) * numLogicalCores;
+	topo->m_PhysicalCores = (CPUPhysicalCore*)ptr; ptr += sizeof(CPUPhysicalCore) * numLogicalCores;
+	topo->m_Caches = (CPUCache*)ptr;               ptr += sizeof(CPUCache) * maxCaches;
+	topo->m_NUMANodes = (CPUNUMANode*)ptr;         ptr += sizeof(CPUNUMANode) * numNUMANodes;
+
+	return true;
+}
+
+static uint32_t cpuTopoFindOrAddPhysicalCore(CPUTopology* topo, const CPUSet* siblings, uint32_t packageID)
+{
+	const uint32_t numPhysicalCores = topo->m_NumPhysicalCores;
+	for (uint32_t i = 0; i < numPhysicalCores; ++i) {
+		const CPUPhysicalCore* core = &topo->m_PhysicalCores[i];
+		if (core->m_PackageID == packageID && cpuSetEqual(&core->m_SMTSiblings, siblings)) {
+			return i;
+		}
+	}
+
+	CPUPhysicalCore* core = &topo->m_PhysicalCores[topo->m_NumPhysicalCores];
+	core->m_SMTSiblings = *siblings;
+	core->m_PackageID = packageID;
+	core->m_NUMANodeID = 0;
+	core->m_NumLogicalCores = 0;
+
+	return topo->m_NumPhysicalCores++;
+}
+
+static void cpuTopoAddCache(CPUTopology* topo, const CPUCache* cache)
+{
+	// Shared caches are reported by every CPU sharing them. Keep only one copy.
+	const uint32_t numCaches = topo->m_NumCaches;
+	for (uint32_t i = 0; i < numCaches; ++i) {
+		const CPUCache* other = &topo->m_Caches[i];
+		if (other->m_Level == cache->m_Level && other->m_Type == cache->m_Type && cpuSetEqual(&other->m_SharedCPUs, &cache->m_SharedCPUs)) {
+			return;
+		}
+	}
+
+	JX_CHECK(topo->m_NumCaches < topo->m_NumLogicalCores * CPU_CONFIG_MAX_CACHES_PER_CPU, "Too many caches");
+	topo->m_Caches[topo->m_NumCaches++] = *cache;
+}
+
+static void cpuTopoCountPackages(CPUTopology* topo)
+{
+	CPUSet packages;
+	cpuSetClear(&packages);
+
+	const uint32_t numLogicalCores = topo->m_NumLogicalCores;
+	for (uint32_t i = 0; i < numLogicalCores; ++i) {
+		const uint32_t packageID = topo->m_LogicalCores[i].m_PackageID;
+		if (packageID < JX_CONFIG_MAX_CPUS) {
+			cpuSetAdd(&packages, packageID);
+		}
+	}
+
+	topo->m_NumPackages = bx::max<uint32_t>(cpuSetCount(&packages), 1);
+}
+
+#if BX_PLATFORM_LINUX || BX_PLATFORM_RPI
+static bool readSysFile(const char* path, char* buffer, uint32_t maxLen)
+{
+	const int fd = ::open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	const ssize_t len = ::read(fd, buffer, maxLen - 1);
+	::close(fd);
+
+	if (len <= 0) {
+		return false;
+	}
+
+	buffer[len] = '\0';
+
+	return true;
+}
+
+static bool readSysFileU32(const char* path, uint32_t* val)
+{
+	char str[64];
+	if (!readSysFile(path, str, BX_COUNTOF(str))) {
+		return false;
+	}
+
+	int32_t v = 0;
+	if (!bx::fromString(&v, bx::strTrimSpace(str))) {
+		return false;
+	}
+
+	*val = (uint32_t)v;
+
+	return true;
+}
+
+static bool readSysFileCPUSet(const char* path, CPUSet* set)
+{
+	char str[1024];
+	if (!readSysFile(path, str, BX_COUNTOF(str))) {
+		return false;
+	}
+
+	return cpuSetFromString(set, str) && !cpuSetIsEmpty(set);
+}
+
+// E.g. "32K", "1024K", "8M"
+static uint32_t parseCacheSize(const char* str)
+{
+	uint32_t size = 0;
+	const char* ptr = str;
+	while (*ptr >= '0' && *ptr <= '9') {
+		size = size * 10 + (uint32_t)(*ptr - '0');
+		++ptr;
+	}
+
+	switch (*ptr) {
+	case 'K': size <<= 10; break;
+	case 'M': size <<= 20; break;
+	case 'G': size <<= 30; break;
+	default: break;
+	}
+
+	return size;
+}
+
+static uint32_t countNUMANodes(uint32_t* maxNodeID)
+{
+	DIR* dir = opendir("/sys/devices/system/node");
+	if (!dir) {
+		return 0;
+	}
+
+	uint32_t numNodes = 0;
+	struct dirent* entry = nullptr;
+	while ((entry = readdir(dir)) != nullptr) {
+		const char* name = entry->d_name;
+		if (name[0] != 'n' || name[1] != 'o' || name[2] != 'd' || name[3] != 'e' || name[4] < '0' || name[4] > '9') {
+			continue;
+		}
+
+		uint32_t nodeID = 0;
+		for (const char* ptr = &name[4]; *ptr >= '0' && *ptr <= '9'; ++ptr) {
+			nodeID = nodeID * 10 + (uint32_t)(*ptr - '0');
+		}
+
+		*maxNodeID = bx::max<uint32_t>(*maxNodeID, nodeID);
+		++numNodes;
+	}
+
+	closedir(dir);
+
+	return numNodes;
+}
+#elif BX_PLATFORM_WINDOWS
+static void cpuSetFromGroupAffinity(CPUSet* set, const GROUP_AFFINITY* affinity)
+{
+	cpuSetClear(set);
+	if (affinity->Group != 0) {
+		return;
+	}
+
+	const uint64_t mask = (uint64_t)affinity->Mask;
+	for (uint32_t cpu = 0; cpu < 64 && cpu < JX_CONFIG_MAX_CPUS; ++cpu) {
+		if ((mask & (1ull << cpu)) != 0) {
+			cpuSetAdd(set, cpu);
+		}
+	}
+}
+#endif
+}
@@ -0,0 +1,272 @@
+#include <jx/epoch.h>
+#include <jx/object_pool.h>
+#include <jx/mutex.h>
+#include <jx/sys.h>
+#include <bx/allocator.h>
+#include <bx/cpu.h>
+
+namespace jx
+{
+#define EPOCH_CACHE_LINE_SIZE 64
+#define EPOCH_OFFLINE         UINT64_MAX
+
+static const uint32_t kRetiredNodePoolBlockSize = 256;
+
+struct EpochSlotState
+{
+	enum Enum : int32_t
+	{
+		Free = 0,
+		Claimed = 1,
+		Active = 2
+	};
+};
+
+// Every thread writes its epoch to its own cache line.
+struct EpochThreadSlot
+{
+	volatile uint64_t m_Epoch;
+	volatile int32_t m_State;
+	uint8_t m_Padding[EPOCH_CACHE_LINE_SIZE - sizeof(uint64_t) - sizeof(int32_t)];
+};
+BX_STATIC_ASSERT(sizeof(EpochThreadSlot) == EPOCH_CACHE_LINE_SIZE, "Invalid EpochThreadSlot size");
+
+struct RetiredNode
+{
+	RetiredNode* m_Next;
+	void* m_Ptr;
+	EpochRetireFn m_Func;
+	void* m_UserData;
+	uint64_t m_Epoch;
+};
+
+struct EpochDomain
+{
+	volatile uint64_t m_GlobalEpoch;
+	uint8_t m_Padding[EPOCH_CACHE_LINE_SIZE - sizeof(uint64_t)];
+
+	bx::AllocatorI* m_Allocator;
+	EpochThreadSlot* m_Slots;
+	uint32_t m_MaxThreads;
+
+	// Retired objects, in increasing epoch order.
+	Mutex m_RetireMutex;
+	ObjectPool* m_NodePool;
+	RetiredNode* m_RetiredHead;
+	RetiredNode* m_RetiredTail;
+	uint32_t m_NumRetired;
+};
+
+static uint64_t epochCalcMinThreadEpoch(const EpochDomain* domain);
+
+inline uint32_t epochAlignSize(uint32_t sz, uint32_t alignment)
+{
+	const uint32_t mask = alignment - 1;
+	return (sz & (~mask)) + ((sz & mask) != 0 ? alignment : 0);
+}
+
+EpochDomain* createEpochDomain(bx::AllocatorI* allocator, uint32_t maxThreads)
+{
+	const uint32_t totalMem = 0
+		+ epochAlignSize(sizeof(EpochDomain), EPOCH_CACHE_LINE_SIZE)
+		+ sizeof(EpochThreadSlot) * maxThreads
+		;
+
+	uint8_t* mem = (uint8_t*)BX_ALIGNED_ALLOC(allocator, totalMem, EPOCH_CACHE_LINE_SIZE);
+	if (!mem) {
+		return nullptr;
+	}
+
+	bx::memSet(mem, 0, totalMem);
+
+	EpochDomain* domain = (EpochDomain*)mem;
+	domain->m_Allocator = allocator;
+	domain->m_Slots = (EpochThreadSlot*)(mem + epochAlignSize(sizeof(EpochDomain), EPOCH_CACHE_LINE_SIZE));
+	domain->m_MaxThreads = maxThreads;
+	domain->m_GlobalEpoch = 1;
+
+	BX_PLACEMENT_NEW(&domain->m_RetireMutex, Mutex)("Epoch Retire List");
+
+	domain->m_NodePool = createObjectPool(sizeof(RetiredNode), kRetiredNodePoolBlockSize, allocator);
+	if (!domain->m_NodePool) {
+		destroyEpochDomain(domain);
+		return nullptr;
+	}
+
+	return domain;
+}
+
+void destroyEpochDomain(EpochDomain* domain)
+{
+	// No thread should be accessing the domain at this point. Destroy everything.
+	RetiredNode* node = domain->m_RetiredHead;
+	while (node) {
+		RetiredNode* next = node->m_Next;
+		node->m_Func(node->m_Ptr, node->m_UserData);
+		node = next;
+	}
+
+	if (domain->m_NodePool) {
+		destroyObjectPool(domain->m_NodePool);
+		domain->m_NodePool = nullptr;
+	}
+
+	domain->m_RetireMutex.~Mutex();
+
+	BX_ALIGNED_FREE(domain->m_Allocator, domain, EPOCH_CACHE_LINE_SIZE);
+}
+
+uint32_t epochRegisterThread(EpochDomain* domain)
+{
+	const uint32_t maxThreads = domain->m_MaxThreads;
+	for (uint32_t i = 0; i < maxThreads; ++i) {
+		EpochThreadSlot* slot = &domain->m_Slots[i];
+		if (slot->m_State != EpochSlotState::Free) {
+			continue;
+		}
+
+		if (bx::atomicCompareAndSwap<int32_t>(&slot->m_State, EpochSlotState::Free, EpochSlotState::Claimed) != EpochSlotState::Free) {
+			continue;
+		}
+
+		slot->m_Epoch = domain->m_GlobalEpoch;
+		bx::memoryBarrier();
+		slot->m_State = EpochSlotState::Active;
+
+		return i;
+	}
+
+	JX_CHECK(false, "Too many threads registered to epoch domain");
+	return JX_EPOCH_INVALID_THREAD;
+}
+
+void epochUnregisterThread(EpochDomain* domain, uint32_t threadID)
+{
+	JX_CHECK(threadID < domain->m_MaxThreads, "Invalid epoch thread ID");
+	EpochThreadSlot* slot = &domain->m_Slots[threadID];
+
+	bx::memoryBarrier();
+	slot->m_State = EpochSlotState::Free;
+}
+
+void epochQuiescent(EpochDomain* domain, uint32_t threadID)
+{
+	JX_CHECK(threadID < domain->m_MaxThreads, "Invalid epoch thread ID");
+	EpochThreadSlot* slot = &domain->m_Slots[threadID];
+
+	// All reads of shared snapshots must complete before the new epoch becomes visible.
+	bx::memoryBarrier();
+	slot->m_Epoch = domain->m_GlobalEpoch;
+}
+
+void epochThreadOffline(EpochDomain* domain, uint32_t threadID)
+{
+	JX_CHECK(threadID < domain->m_MaxThreads, "Invalid epoch thread ID");
+	EpochThreadSlot* slot = &domain->m_Slots[threadID];
+
+	bx::memoryBarrier();
+	slot->m_Epoch = EPOCH_OFFLINE;
+}
+
+void epochThreadOnline(EpochDomain* domain, uint32_t threadID)
+{
+	JX_CHECK(threadID < domain->m_MaxThreads, "Invalid epoch thread ID");
+	EpochThreadSlot* slot = &domain->m_Slots[threadID];
+
+	slot->m_Epoch = domain->m_GlobalEpoch;
+	bx::memoryBarrier();
+}
+
+bool epochRetire(EpochDomain* domain, void* ptr, EpochRetireFn fn, void* userData)
+{
+	MutexScope ms(domain->m_RetireMutex);
+
+	RetiredNode* node = (RetiredNode*)objPoolAlloc(domain->m_NodePool);
+	if (!node) {
+		return false;
+	}
+
+	// Readers which announce a quiescent state after this point can't hold a reference to
+	// ptr because it's no longer reachable.
+	node->m_Next = nullptr;
+	node->m_Ptr = ptr;
+	node->m_Func = fn;
+	node->m_UserData = userData;
+	node->m_Epoch = bx::atomicAddAndFetch<uint64_t>(&domain->m_GlobalEpoch, 1);
+
+	if (domain->m_RetiredTail) {
+		domain->m_RetiredTail->m_Next = node;
+	} else {
+		domain->m_RetiredHead = node;
+	}
+	domain->m_RetiredTail = node;
+	++domain->m_NumRetired;
+
+	return true;
+}
+
+uint32_t epochReclaim(EpochDomain* domain)
+{
+	MutexScope ms(domain->m_RetireMutex);
+
+	if (!domain->m_RetiredHead) {
+		return 0;
+	}
+
+	const uint64_t minEpoch = epochCalcMinThreadEpoch(domain);
+
+	uint32_t numReclaimed = 0;
+	RetiredNode* node = domain->m_RetiredHead;
+	while (node && node->m_Epoch <= minEpoch) {
+		RetiredNode* next = node->m_Next;
+
+		node->m_Func(node->m_Ptr, node->m_UserData);
+		objPoolFree(domain->m_NodePool, node);
+		++numReclaimed;
+
+		node = next;
+	}
+
+	domain->m_RetiredHead = node;
+	if (!node) {
+		domain->m_RetiredTail = nullptr;
+	}
+	domain->m_NumRetired -= numReclaimed;
+
+	return numReclaimed;
+}
+
+uint32_t epochGetNumRetired(EpochDomain* domain)
+{
+	MutexScope ms(domain->m_RetireMutex);
+	return domain->m_NumRetired;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Internal
+//
+static uint64_t epochCalcMinThreadEpoch(const EpochDomain* domain)
+{
+	uint64_t minEpoch = EPOCH_OFFLINE;
+
+	const uint32_t maxThreads = domain->m_MaxThreads;
+	for (uint32_t i = 0; i < maxThreads; ++i) {
+		const EpochThreadSlot* slot = &domain->m_Slots[i];
+		if (slot->m_State == EpochSlotState::Free) {
+			continue;
+		}
+
+		// Claimed slots are about to become active with the current global epoch. Treating
+		// them as active is conservative.
+		const uint64_t epoch = slot->m_State == EpochSlotState::Active
+			? slot->m_Epoch
+			: domain->m_GlobalEpoch
+			;
+		minEpoch = bx::min<uint64_t>(minEpoch, epoch);
+	}
+
+	bx::readBarrier();
+
+	return minEpoch;
+}
+}
@@ -170,6 +170,17 @@ uint32_t fsFileWriteBytes(File* f, const void* buffer, uint32_t len)
 	return (uint32_t)fwrite(buffer, 1, len, f->m_Handle);
 }
 
+bool fsFileFlush(File* f)
+{
+	return fflush(f->m_Handle) == 0;
+}
+
+bool fsFileReserve(File* f, uint64_t size)
+{
+	BX_UNUSED(f, size);
+	return false;
+}
+
 uint64_t fsFileGetSize(File* f)
 {
 	int curPos = ftell(f->m_Handle);
@@ -186,6 +197,29 @@ void fsFileSeek(File* f, int offset, SeekOrigin::Enum origin)
 	fseek(f->m_Handle, offset, origin);
 }
 
+MappedFile* fsMappedFileOpenWrite(BaseDir::Enum baseDir, const char* relPath, uint64_t size)
+{
+	BX_UNUSED(baseDir, relPath, size);
+	return nullptr;
+}
+
+void fsMappedFileClose(MappedFile* mf)
+{
+	BX_UNUSED(mf);
+}
+
+void* fsMappedFileGetPtr(MappedFile* mf)
+{
+	BX_UNUSED(mf);
+	return nullptr;
+}
+
+uint64_t fsMappedFileGetSize(MappedFile* mf)
+{
+	BX_UNUSED(mf);
+	return 0;
+}
+
 bool fsFileRemove(BaseDir::Enum baseDir, const char* relPath)
 {
 	JX_LOG_DEBUG("fsFileRemove(%d, \"%s\")\n", baseDir, relPath);
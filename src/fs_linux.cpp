@@ -11,7 +11,9 @@
 #include <dirent.h>
 #include <pwd.h>
 #include <sys/stat.h> // S_IRWXU
+#include <sys/mman.h> // mmap()
 #include <stdio.h>
+#include <fcntl.h> // fallocate()
 
 namespace jx
 {
@@ -37,6 +39,13 @@ struct File
 	uint32_t m_Flags;
 };
 
+struct MappedFile
+{
+	void* m_Ptr;
+	uint64_t m_Size;
+	int m_FD;
+};
+
 static FileSystem* s_FS = nullptr;
 
 static char* getInstallFolder();
@@ -156,6 +165,24 @@ uint32_t fsFileWriteBytes(File* f, const void* buffer, uint32_t len)
     return fwrite(buffer, 1, len, f->m_Handle);
 }
 
+bool fsFileFlush(File* f)
+{
+	JX_CHECK(f != nullptr && f->m_Handle != nullptr, "Trying to flush a null file");
+	JX_CHECK((f->m_Flags & FileFlags::Write) != 0, "Trying to flush a file opened for reading");
+
+	return fflush(f->m_Handle) == 0;
+}
+
+bool fsFileReserve(File* f, uint64_t size)
+{
+	JX_CHECK(f != nullptr && f->m_Handle != nullptr, "Trying to reserve space for a null file");
+	JX_CHECK((f->m_Flags & FileFlags::Write) != 0, "Trying to reserve space for a file opened for reading");
+
+	// FALLOC_FL_KEEP_SIZE allocates the blocks but leaves the file size unchanged, so the
+	// unused part of the reservation never shows up as zeros at the end of the file.
+	return fallocate(fileno(f->m_Handle), FALLOC_FL_KEEP_SIZE, 0, (off_t)size) == 0;
+}
+
 uint64_t fsFileGetSize(File* f)
 {
 	JX_CHECK(f != nullptr && f->m_Handle != nullptr, "Trying to read from a null file");
@@ -175,7 +202,66 @@ void fsFileSeek(File* f, int offset, SeekOrigin::Enum origin)
     fseek(f->m_Handle, (long)offset, origin == SeekOrigin::Begin ? SEEK_SET : origin == SeekOrigin::Current ? SEEK_CUR : SEEK_END);
 }
 
-bool fsFileRemove(BaseDir::Enum baseDir, const char* relPath)
+MappedFile* fsMappedFileOpenWrite(BaseDir::Enum baseDir, const char* relPath, uint64_t size)
+{
+	if (baseDir != BaseDir::UserData) {
+		JX_CHECK(false, "Can only write to user data folder");
+		return nullptr;
+	}
+
+	if (!setCurrentDirectory(BaseDir::UserData)) {
+		JX_CHECK(false, "Failed to set current working directory");
+		return nullptr;
+	}
+
+	const int fd = open(relPath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1) {
+		return nullptr;
+	}
+
+	if (ftruncate(fd, (off_t)size) != 0) {
+		close(fd);
+		return nullptr;
+	}
+
+	void* ptr = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED) {
+		close(fd);
+		return nullptr;
+	}
+
+	MappedFile* mf = (MappedFile*)JX_ALLOC(sizeof(MappedFile));
+	if (!mf) {
+		munmap(ptr, (size_t)size);
+		close(fd);
+		return nullptr;
+	}
+
+	mf->m_Ptr = ptr;
+	mf->m_Size = size;
+	mf->m_FD = fd;
+	return mf;
+}
+
+void fsMappedFileClose(MappedFile* mf)
+{
+	JX_CHECK(mf != nullptr, "Cannot close NULL mapped file");
+	munmap(mf->m_Ptr, (size_t)mf->m_Size);
+	close(mf->m_FD);
+	JX_FREE(mf);
+}
+
+void* fsMappedFileGetPtr(MappedFile* mf)
+{
+	return mf->m_Ptr;
+}
+
+uint64_t fsMappedFileGetSize(MappedFile* mf)
+{
+	return mf->m_Size;
+}
+
+bool fsRemoveFile(BaseDir::Enum baseDir, const char* relPath)
 {
 	if (baseDir != BaseDir::UserData) {
 		JX_CHECK(false, "Can only remove files from user data folder");
@@ -223,7 +309,7 @@ bool fsCreateFolderTree(BaseDir::Enum baseDir, const char* relPath)
 	return createDirectory(relPath);
 }
 
-bool fsEnumerateFiles(BaseDir::Enum baseDir, const char* relPath, EnumerateFilesCallback callback)
+bool fsEnumerateFiles(BaseDir::Enum baseDir, const char* relPath, EnumFilesCallback callback, void* userData)
 {
 	const bool setcwdResult = setCurrentDirectory(baseDir);
 	if (!setcwdResult) {
@@ -242,15 +328,19 @@ bool fsEnumerateFiles(BaseDir::Enum baseDir, const char* relPath, EnumerateFiles
 	folder[len] = '\0';
 
 	DIR* d = opendir(folder);
-	if(d) {
-		struct dirent* dir = nullptr;
-		while((dir = readdir(d)) != nullptr) {
-			if(dir->d_type == DT_REG) {
-				callback(dir->d_name, true);
-			}
+	if (!d) {
+		return false;
+	}
+
+	struct dirent* dir = nullptr;
+	while ((dir = readdir(d)) != nullptr) {
+		if (dir->d_type == DT_REG) {
+			callback(dir->d_name, true, userData);
 		}
 	}
 
+	closedir(d);
+
 	return true;
 }
 
@@ -37,6 +37,14 @@ struct File
 	uint32_t m_Flags;
 };
 
+struct MappedFile
+{
+	HANDLE m_File;
+	HANDLE m_Mapping;
+	void* m_Ptr;
+	uint64_t m_Size;
+};
+
 static FileSystem* s_FS = nullptr;
 
 static wchar_t* getInstallFolder();
@@ -212,6 +220,25 @@ uint32_t fsFileWriteBytes(File* f, const void* buffer, uint32_t len)
 	return (uint32_t)numBytesWritten;
 }
 
+bool fsFileFlush(File* f)
+{
+	JX_CHECK(f != nullptr && f->m_Handle != INVALID_HANDLE_VALUE, "Trying to flush a null file");
+	JX_CHECK((f->m_Flags & FileFlags::Write) != 0, "Trying to flush a file opened for reading");
+
+	return ::FlushFileBuffers(f->m_Handle) != 0;
+}
+
+bool fsFileReserve(File* f, uint64_t size)
+{
+	JX_CHECK(f != nullptr && f->m_Handle != INVALID_HANDLE_VALUE, "Trying to reserve space for a null file");
+	JX_CHECK((f->m_Flags & FileFlags::Write) != 0, "Trying to reserve space for a file opened for reading");
+
+	// Allocates the clusters without moving the end of file.
+	FILE_ALLOCATION_INFO info;
+	info.AllocationSize.QuadPart = (LONGLONG)size;
+	return ::SetFileInformationByHandle(f->m_Handle, FileAllocationInfo, &info, sizeof(FILE_ALLOCATION_INFO)) != 0;
+}
+
 uint64_t fsFileGetSize(File* f)
 {
 	JX_CHECK(f != nullptr && f->m_Handle != INVALID_HANDLE_VALUE, "Trying to read from a null file");
@@ -290,6 +317,74 @@ bool fsFileGetTime(File* f, jx::FileTimeType::Enum type, FileTime* t)
 	return true;
 }
 
+MappedFile* fsMappedFileOpenWrite(BaseDir::Enum baseDir, const char* relPath, uint64_t size)
+{
+	if (baseDir == BaseDir::Install && (s_FS->m_Flags & FileSystemFlags::AllowWritingToInstallDir) == 0) {
+		JX_CHECK(false, "Cannot write in installation directory");
+		return nullptr;
+	}
+
+	if (!setCurrentDirectory(baseDir)) {
+		JX_CHECK(false, "Failed to set current working directory");
+		return nullptr;
+	}
+
+	wchar_t utf16RelPath[512];
+	utf8ToUtf16(relPath, (uint16_t*)&utf16RelPath[0], BX_COUNTOF(utf16RelPath));
+
+	HANDLE file = ::CreateFileW(utf16RelPath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return nullptr;
+	}
+
+	// The mapping extends the file to the requested size.
+	HANDLE mapping = ::CreateFileMappingW(file, NULL, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)(size & 0xFFFFFFFF), NULL);
+	if (mapping == NULL) {
+		::CloseHandle(file);
+		return nullptr;
+	}
+
+	void* ptr = ::MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, (SIZE_T)size);
+	if (!ptr) {
+		::CloseHandle(mapping);
+		::CloseHandle(file);
+		return nullptr;
+	}
+
+	MappedFile* mf = (MappedFile*)JX_ALLOC(sizeof(MappedFile));
+	if (!mf) {
+		::UnmapViewOfFile(ptr);
+		::CloseHandle(mapping);
+		::CloseHandle(file);
+		return nullptr;
+	}
+
+	mf->m_File = file;
+	mf->m_Mapping = mapping;
+	mf->m_Ptr = ptr;
+	mf->m_Size = size;
+	return mf;
+}
+
+void fsMappedFileClose(MappedFile* mf)
+{
+	JX_CHECK(mf != nullptr, "Cannot close NULL mapped file");
+	::UnmapViewOfFile(mf->m_Ptr);
+	::CloseHandle(mf->m_Mapping);
+	::CloseHandle(mf->m_File);
+	JX_FREE(mf);
+}
+
+void* fsMappedFileGetPtr(MappedFile* mf)
+{
+	return mf->m_Ptr;
+}
+
+uint64_t fsMappedFileGetSize(MappedFile* mf)
+{
+	return mf->m_Size;
+}
+
 bool fsRemoveFile(BaseDir::Enum baseDir, const char* relPath)
 {
 	if (baseDir == BaseDir::Install) {
@@ -0,0 +1,395 @@
+#include <jx/latency.h>
+#include <jx/clock.h>
+#include <jx/profiler.h>
+#include <jx/logger.h>
+#include <jx/mutex.h>
+#include <jx/sys.h>
+#include <bx/allocator.h>
+#include <bx/uint32_t.h>
+#include <float.h> // FLT_EPSILON
+
+namespace jx
+{
+// Log-linear buckets: values below 2^LATENCY_SUB_BUCKET_BITS ns are exact; above that, every
+// power of 2 is split into 2^LATENCY_SUB_BUCKET_BITS buckets. Values above 2^LATENCY_MAX_MSB ns
+// (~18 minutes) end up in the last bucket.
+#define LATENCY_SUB_BUCKET_BITS 5
+#define LATENCY_SUB_BUCKET_COUNT (1u << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_MAX_MSB 40
+#define LATENCY_NUM_BUCKETS (LATENCY_SUB_BUCKET_COUNT * (LATENCY_MAX_MSB - LATENCY_SUB_BUCKET_BITS + 2))
+
+struct LatencySubWindow
+{
+	int64_t m_Sum_ns;
+	int64_t m_Min_ns;
+	int64_t m_Max_ns;
+	uint32_t m_Count;
+	uint32_t m_NumSpikes;
+	uint32_t m_Buckets[LATENCY_NUM_BUCKETS];
+};
+
+struct LatencyTracker
+{
+	bx::AllocatorI* m_Allocator;
+	const char* m_Name;
+	Mutex* m_Mutex;
+	LatencySubWindow* m_SubWindows;
+	uint32_t m_NumSubWindows;
+	uint32_t m_Flags;
+	int64_t m_StartTime;
+	int64_t m_SubWindowTicks;
+	int64_t m_CurSubWindow; // Number of sub-windows since m_StartTime
+	LatencySpikeDesc m_SpikeDesc;
+	int64_t m_SpikeThreshold_ns; // Smallest of the absolute and the median based thresholds (0: disabled)
+	uint32_t m_TotalSpikes;
+	int64_t m_LastSpike_ns;
+};
+
+static void latencyTrackerLock(LatencyTracker* tracker);
+static void latencyTrackerUnlock(LatencyTracker* tracker);
+static bool latencyTrackerAddSampleAt(LatencyTracker* tracker, int64_t duration_ns, int64_t now);
+static void latencyTrackerAdvance(LatencyTracker* tracker, int64_t now);
+static void latencyTrackerUpdateSpikeThreshold(LatencyTracker* tracker);
+static void latencyTrackerCalcPercentiles(const LatencyTracker* tracker, const float* percentiles, int64_t* values, uint32_t n);
+static void latencySubWindowClear(LatencySubWindow* sw);
+static uint32_t latencyGetBucket(int64_t value_ns);
+static int64_t latencyGetBucketValue(uint32_t bucket);
+
+LatencyTracker* createLatencyTracker(bx::AllocatorI* allocator, const char* name, const LatencyTrackerDesc* desc)
+{
+	JX_CHECK(desc->m_NumSubWindows != 0 && desc->m_Window_ms != 0, "Invalid latency window");
+
+	const uint32_t totalMem = 0
+		+ sizeof(LatencyTracker)
+		+ sizeof(LatencySubWindow) * desc->m_NumSubWindows
+		;
+
+	uint8_t* buffer = (uint8_t*)BX_ALLOC(allocator, totalMem);
+	if (!buffer) {
+		return nullptr;
+	}
+
+	bx::memSet(buffer, 0, totalMem);
+
+	uint8_t* ptr = buffer;
+	LatencyTracker* tracker = (LatencyTracker*)ptr; ptr += sizeof(LatencyTracker);
+	tracker->m_SubWindows = (LatencySubWindow*)ptr; ptr += sizeof(LatencySubWindow) * desc->m_NumSubWindows;
+
+	tracker->m_Allocator = allocator;
+	tracker->m_Name = name;
+	tracker->m_NumSubWindows = desc->m_NumSubWindows;
+	tracker->m_Flags = desc->m_Flags;
+	tracker->m_StartTime = clockGetTicks();
+	tracker->m_SubWindowTicks = bx::max<int64_t>(1, (clockGetFrequency() * desc->m_Window_ms) / (1000 * (int64_t)desc->m_NumSubWindows));
+	tracker->m_CurSubWindow = 0;
+
+	for (uint32_t i = 0; i < desc->m_NumSubWindows; ++i) {
+		latencySubWindowClear(&tracker->m_SubWindows[i]);
+	}
+
+#if BX_CONFIG_SUPPORTS_THREADING
+	if ((desc->m_Flags & LatencyTrackerFlags::Multithreaded) != 0) {
+		tracker->m_Mutex = BX_NEW(allocator, Mutex)("LatencyTracker");
+	}
+#endif
+
+	return tracker;
+}
+
+void destroyLatencyTracker(LatencyTracker* tracker)
+{
+	bx::AllocatorI* allocator = tracker->m_Allocator;
+
+#if BX_CONFIG_SUPPORTS_THREADING
+	if (tracker->m_Mutex) {
+		BX_DELETE(allocator, tracker->m_Mutex);
+	}
+#endif
+
+	BX_FREE(allocator, tracker);
+}
+
+const char* latencyTrackerGetName(const LatencyTracker* tracker)
+{
+	return tracker->m_Name;
+}
+
+void latencyTrackerSetSpikeDesc(LatencyTracker* tracker, const LatencySpikeDesc* desc)
+{
+	latencyTrackerLock(tracker);
+	tracker->m_SpikeDesc = *desc;
+	latencyTrackerUpdateSpikeThreshold(tracker);
+	latencyTrackerUnlock(tracker);
+}
+
+bool latencyTrackerAddSample(LatencyTracker* tracker, int64_t duration_ns)
+{
+	return latencyTrackerAddSampleAt(tracker, duration_ns, clockGetTicks());
+}
+
+bool latencyTrackerGetStats(LatencyTracker* tracker, LatencyStats* stats)
+{
+	static const float kPercentiles[] = { 0.5f, 0.9f, 0.99f, 0.999f };
+	int64_t values[BX_COUNTOF(kPercentiles)];
+
+	bx::memSet(stats, 0, sizeof(LatencyStats));
+
+	latencyTrackerLock(tracker);
+	latencyTrackerAdvance(tracker, clockGetTicks());
+
+	int64_t minVal = INT64_MAX;
+	int64_t maxVal = 0;
+	int64_t sum = 0;
+	const uint32_t numSubWindows = tracker->m_NumSubWindows;
+	for (uint32_t i = 0; i < numSubWindows; ++i) {
+		const LatencySubWindow* sw = &tracker->m_SubWindows[i];
+		if (sw->m_Count == 0) {
+			continue;
+		}
+
+		minVal = bx::min<int64_t>(minVal, sw->m_Min_ns);
+		maxVal = bx::max<int64_t>(maxVal, sw->m_Max_ns);
+		sum += sw->m_Sum_ns;
+		stats->m_Count += sw->m_Count;
+		stats->m_NumSpikes += sw->m_NumSpikes;
+	}
+
+	stats->m_TotalSpikes = tracker->m_TotalSpikes;
+	stats->m_LastSpike_ns = tracker->m_LastSpike_ns;
+
+	if (stats->m_Count == 0) {
+		latencyTrackerUnlock(tracker);
+		return false;
+	}
+
+	latencyTrackerCalcPercentiles(tracker, kPercentiles, values, BX_COUNTOF(kPercentiles));
+	latencyTrackerUnlock(tracker);
+
+	// Bucket values are approximate; keep them inside the exact bounds.
+	stats->m_Min_ns = minVal;
+	stats->m_Max_ns = maxVal;
+	stats->m_Avg_ns = sum / (int64_t)stats->m_Count;
+	stats->m_P50_ns = bx::clamp<int64_t>(values[0], minVal, maxVal);
+	stats->m_P90_ns = bx::clamp<int64_t>(values[1], minVal, maxVal);
+	stats->m_P99_ns = bx::clamp<int64_t>(values[2], minVal, maxVal);
+	stats->m_P999_ns = bx::clamp<int64_t>(values[3], minVal, maxVal);
+
+	return true;
+}
+
+int64_t latencyTrackerGetPercentile(LatencyTracker* tracker, float percentile)
+{
+	int64_t value = 0;
+
+	latencyTrackerLock(tracker);
+	latencyTrackerAdvance(tracker, clockGetTicks());
+	latencyTrackerCalcPercentiles(tracker, &percentile, &value, 1);
+	latencyTrackerUnlock(tracker);
+
+	return value;
+}
+
+void latencyTrackerReset(LatencyTracker* tracker)
+{
+	latencyTrackerLock(tracker);
+
+	const uint32_t numSubWindows = tracker->m_NumSubWindows;
+	for (uint32_t i = 0; i < numSubWindows; ++i) {
+		latencySubWindowClear(&tracker->m_SubWindows[i]);
+	}
+
+	tracker->m_StartTime = clockGetTicks();
+	tracker->m_CurSubWindow = 0;
+	tracker->m_TotalSpikes = 0;
+	tracker->m_LastSpike_ns = 0;
+	latencyTrackerUpdateSpikeThreshold(tracker);
+
+	latencyTrackerUnlock(tracker);
+}
+
+int64_t latencyIntervalBegin()
+{
+	return clockGetTicks();
+}
+
+bool latencyIntervalEnd(LatencyTracker* tracker, int64_t beginTime)
+{
+	const int64_t now = clockGetTicks();
+	const int64_t duration_ns = clockTicksToNs(now - beginTime);
+	return latencyTrackerAddSampleAt(tracker, duration_ns, now);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Internal
+//
+static void latencyTrackerLock(LatencyTracker* tracker)
+{
+#if BX_CONFIG_SUPPORTS_THREADING
+	if (tracker->m_Mutex) {
+		tracker->m_Mutex->lock();
+	}
+#else
+	BX_UNUSED(tracker);
+#endif
+}
+
+static void latencyTrackerUnlock(LatencyTracker* tracker)
+{
+#if BX_CONFIG_SUPPORTS_THREADING
+	if (tracker->m_Mutex) {
+		tracker->m_Mutex->unlock();
+	}
+#else
+	BX_UNUSED(tracker);
+#endif
+}
+
+static bool latencyTrackerAddSampleAt(LatencyTracker* tracker, int64_t duration_ns, int64_t now)
+{
+	duration_ns = bx::max<int64_t>(duration_ns, 0);
+
+	latencyTrackerLock(tracker);
+
+	latencyTrackerAdvance(tracker, now);
+
+	LatencySubWindow* sw = &tracker->m_SubWindows[tracker->m_CurSubWindow % tracker->m_NumSubWindows];
+	sw->m_Buckets[latencyGetBucket(duration_ns)]++;
+	sw->m_Sum_ns += duration_ns;
+	sw->m_Min_ns = bx::min<int64_t>(sw->m_Min_ns, duration_ns);
+	sw->m_Max_ns = bx::max<int64_t>(sw->m_Max_ns, duration_ns);
+	sw->m_Count++;
+
+	const bool isSpike = true
+		&& tracker->m_SpikeThreshold_ns != 0
+		&& duration_ns > tracker->m_SpikeThreshold_ns
+		;
+	if (isSpike) {
+		sw->m_NumSpikes++;
+		tracker->m_TotalSpikes++;
+		tracker->m_LastSpike_ns = duration_ns;
+	}
+
+	latencyTrackerUnlock(tracker);
+
+	if (isSpike) {
+		if ((tracker->m_Flags & LatencyTrackerFlags::TriggerCapture) != 0) {
+			profilerTriggerCapture();
+		}
+
+		if ((tracker->m_Flags & LatencyTrackerFlags::LogSpikes) != 0) {
+			JX_LOG_WARN("Latency spike in \"%s\": %.3f ms\n", tracker->m_Name, (double)duration_ns / 1.0e6);
+		}
+	}
+
+	return isSpike;
+}
+
+static void latencyTrackerAdvance(LatencyTracker* tracker, int64_t now)
+{
+	const int64_t subWindow = (now - tracker->m_StartTime) / tracker->m_SubWindowTicks;
+	if (subWindow <= tracker->m_CurSubWindow) {
+		return;
+	}
+
+	// Clear the sub-windows which slid out of the window (all of them if nothing has been
+	// recorded for a whole window).
+	const uint32_t numSubWindows = tracker->m_NumSubWindows;
+	const int64_t numCleared = bx::min<int64_t>(subWindow - tracker->m_CurSubWindow, numSubWindows);
+	for (int64_t i = 1; i <= numCleared; ++i) {
+		latencySubWindowClear(&tracker->m_SubWindows[(tracker->m_CurSubWindow + i) % numSubWindows]);
+	}
+
+	tracker->m_CurSubWindow = subWindow;
+
+	latencyTrackerUpdateSpikeThreshold(tracker);
+}
+
+static void latencyTrackerUpdateSpikeThreshold(LatencyTracker* tracker)
+{
+	int64_t threshold = tracker->m_SpikeDesc.m_Threshold_ns;
+
+	if (tracker->m_SpikeDesc.m_MedianFactor > FLT_EPSILON) {
+		const float p50 = 0.5f;
+		int64_t median = 0;
+		latencyTrackerCalcPercentiles(tracker, &p50, &median, 1);
+
+		if (median != 0) {
+			const int64_t medianThreshold = (int64_t)((double)median * (double)tracker->m_SpikeDesc.m_MedianFactor);
+			threshold = threshold != 0
+				? bx::min<int64_t>(threshold, medianThreshold)
+				: medianThreshold
+				;
+		}
+	}
+
+	tracker->m_SpikeThreshold_ns = threshold;
+}
+
+// percentiles must be sorted in ascending order.
+static void latencyTrackerCalcPercentiles(const LatencyTracker* tracker, const float* percentiles, int64_t* values, uint32_t n)
+{
+	const uint32_t numSubWindows = tracker->m_NumSubWindows;
+
+	uint64_t total = 0;
+	for (uint32_t i = 0; i < numSubWindows; ++i) {
+		total += tracker->m_SubWindows[i].m_Count;
+	}
+
+	bx::memSet(values, 0, sizeof(int64_t) * n);
+	if (total == 0) {
+		return;
+	}
+
+	uint32_t nextPercentile = 0;
+	uint64_t rank = bx::max<uint64_t>(1, (uint64_t)((double)percentiles[0] * (double)total + 0.5));
+	uint64_t count = 0;
+	for (uint32_t bucket = 0; bucket < LATENCY_NUM_BUCKETS && nextPercentile < n; ++bucket) {
+		for (uint32_t i = 0; i < numSubWindows; ++i) {
+			count += tracker->m_SubWindows[i].m_Buckets[bucket];
+		}
+
+		while (nextPercentile < n && count >= rank) {
+			values[nextPercentile++] = latencyGetBucketValue(bucket);
+			if (nextPercentile < n) {
+				rank = bx::max<uint64_t>(1, (uint64_t)((double)percentiles[nextPercentile] * (double)total + 0.5));
+			}
+		}
+	}
+}
+
+static void latencySubWindowClear(LatencySubWindow* sw)
+{
+	bx::memSet(sw, 0, sizeof(LatencySubWindow));
+	sw->m_Min_ns = INT64_MAX;
+}
+
+static uint32_t latencyGetBucket(int64_t value_ns)
+{
+	const uint64_t v = (uint64_t)value_ns;
+	if (v < LATENCY_SUB_BUCKET_COUNT) {
+		return (uint32_t)v;
+	}
+
+	const uint32_t msb = 63 - (uint32_t)bx::uint64_cntlz(v);
+	if (msb > LATENCY_MAX_MSB) {
+		return LATENCY_NUM_BUCKETS - 1;
+	}
+
+	const uint32_t shift = msb - LATENCY_SUB_BUCKET_BITS;
+	const uint32_t sub = (uint32_t)(v >> shift) & (LATENCY_SUB_BUCKET_COUNT - 1);
+	return LATENCY_SUB_BUCKET_COUNT + shift * LATENCY_SUB_BUCKET_COUNT + sub;
+}
+
+// Midpoint of the bucket's range
+static int64_t latencyGetBucketValue(uint32_t bucket)
+{
+	if (bucket < LATENCY_SUB_BUCKET_COUNT) {
+		return (int64_t)bucket;
+	}
+
+	const uint32_t shift = (bucket - LATENCY_SUB_BUCKET_COUNT) / LATENCY_SUB_BUCKET_COUNT;
+	const uint32_t sub = (bucket - LATENCY_SUB_BUCKET_COUNT) % LATENCY_SUB_BUCKET_COUNT;
+	const uint64_t lower = (uint64_t)(LATENCY_SUB_BUCKET_COUNT + sub) << shift;
+	return (int64_t)(lower + ((1ull << shift) >> 1));
+}
+}
@@ -2,25 +2,258 @@
 #include <jx/fs.h>
 #include <jx/allocator.h>
 #include <jx/str.h>
+#include <jx/mutex.h>
+#include <jx/thread.h>
+#include <jx/cpu.h>
+#include <jx/spooky_hash.h>
 #include <bx/string.h>
-#include <bx/mutex.h>
+#include <bx/cpu.h>
+#include <bx/os.h>
+#include <bx/timer.h>
+#include <stdio.h>
 #include <time.h>
+#include <chrono>
 
-#if BX_PLATFORM_WINDOWS
-#include <Windows.h>
+namespace jx
+{
+#define LOGGER_MAX_PREFIX_LENGTH      160
+#define LOGGER_MAX_LINE_LENGTH        2048
+#define LOGGER_MAX_SPEC_LENGTH        32
+#define LOGGER_MAX_FORMAT_LENGTH      LOGGER_MAX_LINE_LENGTH
+#define LOGGER_CACHE_LINE_SIZE        64
+#define LOGGER_RECORD_ALIGNMENT       8
+#define LOGGER_MAX_RECORD_SIZE        (sizeof(LogRecordHeader) + LOGGER_MAX_PREFIX_LENGTH + LOGGER_MAX_LINE_LENGTH + LOGGER_RECORD_ALIGNMENT)
+#define LOGGER_DEFERRED_HEADER_SIZE   (sizeof(int64_t) + sizeof(uint32_t)) // Timestamp + format ID
+#define LOGGER_WRITE_BUFFER_SIZE      (256 << 10)
+#define LOGGER_WRITER_INTERVAL_MSEC   20
+#define LOGGER_BINARY_MAGIC           0x424C584A // 'JXLB'
+#define LOGGER_BINARY_VERSION         1
+#define LOGGER_MAX_FILENAME_LENGTH    256
+#define LOGGER_RATE_LIMIT_MAX_PROBES  16
+#define LOGGER_SINK_MAX_BATCH         256
+#define LOGGER_SINK_MIN_QUEUE_SIZE    (16 << 10)
+#define LOGGER_FILE_SINK_BUFFER_SIZE  (64 << 10)
+#define LOGGER_FLIGHT_RECORDER_MAGIC  0x52464A58 // 'XJFR'
+#define LOGGER_FLIGHT_RECORDER_VERSION 1
+#define LOGGER_FLIGHT_RECORDER_MIN_SIZE (64 << 10)
+#define LOGGER_SEGMENT_RETRY_MSEC     1000
+
+#if BX_PLATFORM_WINDOWS || BX_PLATFORM_LINUX || BX_PLATFORM_OSX || BX_PLATFORM_RPI
+#define LOGGER_CONFIG_FILE_OUTPUT     1
+#else
+#define LOGGER_CONFIG_FILE_OUTPUT     0
 #endif
 
-#if BX_PLATFORM_EMSCRIPTEN
-#include <stdio.h>
+// Date/time part of the timestamp, rebuilt only when the second changes.
+struct LogTimeCache
+{
+	int64_t m_Second; // Seconds since the Unix epoch
+	uint32_t m_PrefixLen;
+	char m_Prefix[28]; // "YYYY-MM-DD HH:MM:SS"
+};
+
+// Token bucket of a single call site. Tokens are scaled by the timer frequency, so a
+// record costs m_TimerFrequency tokens and the bucket gains m_RecordsPerSec tokens per tick.
+struct LogRateSlot
+{
+	volatile uint64_t m_Fingerprint; // 0: free
+	volatile int32_t m_Lock;
+	uint32_t m_NumSuppressed;
+	const LogSite* m_Site; // nullptr until the slot is initialized
+	int64_t m_Tokens;
+	int64_t m_LastRefill;
+	int64_t m_LastSummary;
+	LogLevel::Enum m_SuppressedLevel; // Highest level suppressed since the last summary
+};
+
+struct LogRateLimiter
+{
+	LogRateSlot* m_Slots;
+	int64_t m_MaxTokens;
+	int64_t m_RecordsPerSec;
+	int64_t m_SummaryInterval; // Timer ticks
+	int64_t m_LastScan;        // Async loggers; last time the writer looked for finished storms
+	volatile uint32_t m_Enabled;
+};
+
+// Binary log file layout: LogFileHeader followed by records. Each record starts with a
+// LogFileRecordHeader followed by m_Size bytes:
+// - Format: uint32_t format ID + the format string (without terminator). Written before
+//   the first Message which uses the format.
+// - Message: int64_t timestamp (timer counter) + uint32_t format ID + LogArgBuffer data.
+// - Text: an already formatted line (logf()).
+struct LogFileRecordType
+{
+	enum Enum : uint8_t
+	{
+		Format,
+		Message,
+		Text
+	};
+};
+
+struct LogFileHeader
+{
+	uint32_t m_Magic;
+	uint32_t m_Version;
+	int64_t m_TimerFrequency;
+	int64_t m_StartCounter;
+	int64_t m_StartTime_us; // Wall clock time (since the Unix epoch) at m_StartCounter
+};
+
+struct LogFileRecordHeader
+{
+	uint8_t m_Type;
+	uint8_t m_Level;
+	uint16_t m_Reserved;
+	uint32_t m_Size;
+};
+
+// Flight recorder file layout: LogFlightRecorderHeader followed by a byte ring of
+// m_Capacity bytes. Positions increase monotonically; the record at position P starts at
+// offset (P & (m_Capacity - 1)) in the ring. Each record is a LogFlightRecordHeader followed
+// by m_Size bytes of text, padded to LOGGER_RECORD_ALIGNMENT. Records are never split at
+// the end of the ring. A padding record fills the gap (the gap is implicit if it's smaller
+// than a header).
+struct LogFlightRecordFlags
+{
+	enum Enum : uint8_t
+	{
+		Padding = 1 << 0,
+	};
+};
+
+struct LogFlightRecorderHeader
+{
+	uint32_t m_Magic;
+	uint32_t m_Version;
+	uint32_t m_Capacity;
+	uint32_t m_Reserved;
+	volatile uint64_t m_WritePos; // End of the last reserved record
+	uint8_t m_Padding[LOGGER_CACHE_LINE_SIZE - sizeof(uint32_t) * 4 - sizeof(uint64_t)];
+};
+BX_STATIC_ASSERT(sizeof(LogFlightRecorderHeader) == LOGGER_CACHE_LINE_SIZE, "Invalid LogFlightRecorderHeader size");
+
+// m_Pos is written last. A record is valid only if m_Pos matches its position in the
+// stream, so records which were being written during the crash, and leftovers from
+// previous laps, are skipped by the reader.
+struct LogFlightRecordHeader
+{
+	volatile uint64_t m_Pos;
+	uint32_t m_Size;
+	uint8_t m_Level;
+	uint8_t m_Flags;
+	uint16_t m_Reserved;
+};
+BX_STATIC_ASSERT(sizeof(LogFlightRecordHeader) == 2 * LOGGER_RECORD_ALIGNMENT, "Invalid LogFlightRecordHeader size");
+
+struct LogFlightRecorder
+{
+	MappedFile* m_File;
+	LogFlightRecorderHeader* m_Header;
+	uint8_t* m_Data;
+	uint32_t m_Capacity;
+	uint32_t m_Mask;
+};
+
+#if BX_CONFIG_SUPPORTS_THREADING
+static const uint32_t kMsgQuit = 0;
+static const uint32_t kMsgWakeup = 1;
+
+struct LogRecordFlags
+{
+	enum Enum : uint8_t
+	{
+		Padding = 1 << 0, // Fills the space up to the end of the buffer; skip it.
+		Deferred = 1 << 1, // Payload is a timestamp, a format ID and a LogArgBuffer
+	};
+};
+
+struct LogRecordHeader
+{
+	uint32_t m_Size;       // Payload size (prefix + text + '\0'), excluding the header
+	uint16_t m_TextOffset; // Offset of the message text in the payload (after the prefix)
+	uint8_t m_Level;
+	uint8_t m_Flags;
+};
+BX_STATIC_ASSERT(sizeof(LogRecordHeader) == LOGGER_RECORD_ALIGNMENT, "Invalid LogRecordHeader size");
+BX_STATIC_ASSERT(LOGGER_DEFERRED_HEADER_SIZE + JX_LOGGER_MAX_DEFERRED_ARGS_SIZE <= LOGGER_MAX_PREFIX_LENGTH + LOGGER_MAX_LINE_LENGTH, "Deferred record too large");
+BX_STATIC_ASSERT(JX_CONFIG_LOGGER_THREAD_BUFFER_SIZE >= 2 * LOGGER_MAX_RECORD_SIZE, "Logger thread buffer too small");
+
+// Single-producer/single-consumer byte ring. The thread which owns the buffer appends
+// records and the writer thread consumes them. Positions increase monotonically. Records
+// are never split at the end of the buffer; a padding record fills the gap instead.
+// Buffers are kept until the logger is destroyed, even if their thread exits.
+struct LogThreadBuffer
+{
+	// Producer data
+	volatile uint64_t m_WritePos;
+	uint64_t m_CachedReadPos;
+	uint64_t m_PendingWritePos; // End of the record being written
+	uint8_t m_Padding0[LOGGER_CACHE_LINE_SIZE - sizeof(uint64_t) * 3];
+
+	// Consumer data
+	volatile uint64_t m_ReadPos;
+	uint8_t m_Padding1[LOGGER_CACHE_LINE_SIZE - sizeof(uint64_t)];
+
+	// Read-only data
+	LogThreadBuffer* m_Next;
+	uint8_t* m_Data;
+	uint32_t m_Capacity;
+	uint32_t m_Mask;
+
+	// Used by the owner thread for logf() records
+	LogTimeCache m_TimeCache;
+};
 #endif
 
-namespace jx
+// The thread which writes the logger's file (the writer thread in async mode) publishes
+// records to the sink's queue (same layout as LogThreadBuffer) and the sink's thread
+// consumes them.
+struct LogSink
+{
+#if BX_CONFIG_SUPPORTS_THREADING
+	// Producer data
+	volatile uint64_t m_WritePos;
+	volatile uint32_t m_NumDropped;
+	volatile int32_t m_WakeupPending;
+	uint8_t m_Padding0[LOGGER_CACHE_LINE_SIZE - sizeof(uint64_t) - sizeof(uint32_t) * 2];
+
+	// Consumer data
+	volatile uint64_t m_ReadPos;
+	uint32_t m_NumDroppedReported;
+	uint8_t m_Padding1[LOGGER_CACHE_LINE_SIZE - sizeof(uint64_t) - sizeof(uint32_t)];
+
+	Thread* m_Thread;
+	uint8_t* m_Data;
+	uint32_t m_Capacity;
+	uint32_t m_Mask;
+#endif
+
+	LogSinkDesc m_Desc;
+	volatile uint32_t m_MinLevel;
+};
+
+struct LogFileSink
+{
+	File* m_File;
+	uint8_t* m_Buffer;
+};
+
+struct LogMemorySink
 {
-struct CallbackData
+#if BX_CONFIG_SUPPORTS_THREADING
+	Mutex* m_Mutex;
+#endif
+	char* m_Data;
+	uint32_t m_Capacity;
+	uint64_t m_WritePos;
+};
+
+struct LogCallbackSink
 {
 	LoggingCallback m_Func;
 	void* m_UserData;
-	bool m_Active;
 };
 
 struct Logger
@@ -28,49 +261,235 @@ struct Logger
 	char* m_Name;
 	File* m_File;
 #if BX_CONFIG_SUPPORTS_THREADING
-	bx::Mutex* m_Mutex;
+	Mutex* m_Mutex;
+	Thread* m_WriterThread;
+	bx::TlsData* m_ThreadBufferTLS;
+	LogThreadBuffer* volatile m_ThreadBuffers;
+	volatile int32_t m_ThreadBufferLock; // Serializes producers adding their buffer to the list
+	volatile int32_t m_WakeupPending;
+
+	// Writer thread data
+	LogTimeCache m_WriterTimeCache;
+	uint8_t* m_WriteBuffer;
+	uint32_t m_WriteBufferLen;
+	uint32_t m_EmittedFormats[JX_CONFIG_LOGGER_MAX_FORMATS / 32]; // Binary logs
+#endif
+	LogSink* m_Sinks[JX_CONFIG_LOGGER_MAX_SINKS]; // Removed sinks leave a hole
+	uint32_t m_NumSinkSlots;
+	LogRateLimiter* m_RateLimiter;
+	LogFlightRecorder* m_FlightRecorder;
+	LogTimeCache m_TimeCache; // Synchronous logging
+
+	// Current file/segment. Only touched by the thread which writes to the file (the
+	// writer thread in async mode), with the mutex held if there is one. The async writer
+	// only takes the mutex to change m_File/m_Filename (see loggerGetFilename()).
+	char m_Filename[LOGGER_MAX_FILENAME_LENGTH];
+	LogRotationDesc m_Rotation;
+	jx::BaseDir::Enum m_BaseDir;
+	File* m_NextFile; // Next segment, opened and preallocated ahead of time
+	int64_t m_SegmentStartCounter;
+	uint64_t m_SegmentSize; // Record bytes written to the current segment
+	uint32_t m_SegmentID;
+	uint32_t m_OldestSegmentID;
+	bool m_Rotating;
+#if BX_CONFIG_SUPPORTS_THREADING
+	// Rotating sync loggers. The segment thread owns m_OldestSegmentID and shares
+	// m_NextFile/m_RetiredFile/m_SegmentID with the logging thread under m_SegmentMutex,
+	// which is only held while the handles are swapped.
+	Thread* m_SegmentThread;
+	Mutex* m_SegmentMutex;
+	File* m_RetiredFile; // Previous segment, waiting to be closed
 #endif
-	CallbackData* m_Callbacks;
-	uint32_t m_NumCallbacks;
+
+	int64_t m_TimerFrequency;
+	int64_t m_StartCounter;
+	int64_t m_StartTime_us;
 	uint32_t m_Flags;
+	volatile uint32_t m_MinLevel;
 };
 
-Logger* createLog(jx::BaseDir::Enum baseDir, const char* name, uint32_t flags)
+// Format strings are shared by all loggers, so the same ID can be used with any of them.
+static const char* s_LogFormats[JX_CONFIG_LOGGER_MAX_FORMATS];
+static volatile int32_t s_NumLogFormats = 0;
+
+static const char* loggerGetLevelSymbol(LogLevel::Enum level);
+static int64_t loggerGetTime_us(const Logger* logger, int64_t counter);
+static uint32_t logFormatPrefix(LogTimeCache* cache, uint32_t flags, LogLevel::Enum level, int64_t time_us, char* buffer, uint32_t maxLen);
+static uint32_t logFormatTime(LogTimeCache* cache, int64_t time_us, char* buffer, uint32_t maxLen);
+static uint32_t logFormatUInt(uint64_t val, uint32_t minDigits, char* buffer);
+static int64_t logCounterToTime_us(int64_t counter, int64_t startCounter, int64_t startTime_us, int64_t frequency);
+static void logTimeCacheInit(LogTimeCache* cache);
+static uint32_t logFormatDeferred(char* buffer, uint32_t maxLen, const char* fmt, const uint8_t* args, uint32_t argsSize);
+static int64_t logGetWallClockTime_us();
+static LogRateSlot* loggerFindRateSlot(LogRateLimiter* rl, uint64_t fingerprint);
+static uint32_t loggerTakeSuppressed(LogRateLimiter* rl, LogRateSlot* slot, int64_t now, bool force, LogLevel::Enum* level);
+static uint32_t logFormatSuppressed(char* buffer, uint32_t maxLen, const LogSite* site, uint32_t numSuppressed);
+static void logRateSlotLock(LogRateSlot* slot);
+static void logRateSlotUnlock(LogRateSlot* slot);
+static void loggerFlightRecorderWrite(Logger* logger, LogLevel::Enum level, const char* line, uint32_t lineLen);
+static void loggerCloseFlightRecorder(Logger* logger);
+static uint32_t loggerAddSinkSlot(Logger* logger, const LogSinkDesc* desc);
+static bool loggerHasSinks(const Logger* logger, LogLevel::Enum level);
+static void loggerPublish(Logger* logger, LogLevel::Enum level, const char* line, uint32_t lineLen, uint32_t textOffset);
+static void logSinkPush(LogSink* sink, const LogRecord* record);
+static void logFileSinkWrite(const LogRecord* records, uint32_t numRecords, void* userData);
+static void logFileSinkDestroy(void* userData);
+static void logStdoutSinkWrite(const LogRecord* records, uint32_t numRecords, void* userData);
+static void logMemorySinkWrite(const LogRecord* records, uint32_t numRecords, void* userData);
+static void logMemorySinkDestroy(void* userData);
+static void logCallbackSinkWrite(const LogRecord* records, uint32_t numRecords, void* userData);
+static void logCallbackSinkDestroy(void* userData);
+#if LOGGER_CONFIG_FILE_OUTPUT
+static void loggerBeginSegment(Logger* logger);
+static bool loggerShouldRotate(const Logger* logger, uint32_t bufferedLen, uint32_t recordLen);
+static void loggerRotate(Logger* logger);
+static File* loggerOpenSegment(Logger* logger, uint32_t segmentID);
+static void loggerPrepareNextSegment(Logger* logger);
+static void loggerRemoveOldSegments(Logger* logger, uint32_t segmentID);
+static void loggerFindSegments(Logger* logger);
+static void loggerGetSegmentFilename(const Logger* logger, uint32_t segmentID, char* buffer, uint32_t maxLen);
+#if BX_CONFIG_SUPPORTS_THREADING
+static int32_t loggerSegmentThreadFunc(Thread* self, void* userData);
+#endif
+#endif
+#if BX_CONFIG_SUPPORTS_THREADING
+static void loggerAsyncLog(Logger* logger, LogLevel::Enum level, const char* fmt, va_list argList);
+static LogThreadBuffer* loggerGetThreadBuffer(Logger* logger);
+static void loggerWakeupWriter(Logger* logger);
+static void loggerDrain(Logger* logger, bool final);
+static void loggerWriteSuppressed(Logger* logger, bool force);
+static void loggerWriteText(Logger* logger, LogLevel::Enum level, const char* line, uint32_t lineLen, uint32_t textOffset);
+static void loggerWriteDeferred(Logger* logger, LogLevel::Enum level, const uint8_t* payload, uint32_t size);
+static bool loggerWriterHasSinks(Logger* logger, LogLevel::Enum level);
+static void loggerWriterPublish(Logger* logger, LogLevel::Enum level, const char* line, uint32_t lineLen, uint32_t textOffset);
+static void loggerWriterBeginRecord(Logger* logger, uint32_t len);
+static void loggerWriterAppend(Logger* logger, const void* data, uint32_t len);
+static void loggerWriterFlush(Logger* logger, bool flushFile);
+static int32_t loggerWriterThreadFunc(Thread* self, void* userData);
+static uint8_t* ltbBeginWrite(Logger* logger, LogThreadBuffer* tb, const LogRecordHeader* hdr);
+static void ltbEndWrite(LogThreadBuffer* tb);
+static void logSinkWakeup(LogSink* sink);
+static void logSinkProcess(LogSink* sink);
+static int32_t logSinkThreadFunc(Thread* self, void* userData);
+#endif
+
+inline uint32_t loggerAlignSize(uint32_t sz, uint32_t alignment)
+{
+	const uint32_t mask = alignment - 1;
+	return (sz & (~mask)) + ((sz & mask) != 0 ? alignment : 0);
+}
+
+Logger* createLog(jx::BaseDir::Enum baseDir, const char* name, uint32_t flags, const LogRotationDesc* rotation)
 {
 	Logger* logger = (Logger*)JX_ALLOC(sizeof(Logger));
 	if (!logger) {
 		JX_CHECK(false, "Failed to allocator Logger");
 		return nullptr;
 	}
-	
+
 	bx::memSet(logger, 0, sizeof(Logger));
 
+#if BX_CONFIG_SUPPORTS_THREADING
+	if ((flags & LoggerFlags::Binary) != 0) {
+		flags |= LoggerFlags::Async;
+	}
+
+	if ((flags & LoggerFlags::Async) != 0) {
+		flags |= LoggerFlags::Multithreaded;
+	}
+#else
+	flags &= ~(LoggerFlags::Async | LoggerFlags::Binary);
+#endif
+
+#if !LOGGER_CONFIG_FILE_OUTPUT
+	flags &= ~LoggerFlags::Binary;
+#endif
+
+	logger->m_Flags = flags;
+	logger->m_MinLevel = LogLevel::Debug;
+
+	// Timestamps are derived from the monotonic timer, anchored to the wall clock here,
+	// so they never go backwards if the system clock is adjusted.
+	logger->m_TimerFrequency = bx::getHPFrequency();
+	logger->m_StartCounter = bx::getHPCounter();
+	logger->m_StartTime_us = logGetWallClockTime_us();
+	logTimeCacheInit(&logger->m_TimeCache);
+#if BX_CONFIG_SUPPORTS_THREADING
+	logTimeCacheInit(&logger->m_WriterTimeCache);
+#endif
+
 	if (name != nullptr) {
 		logger->m_Name = jx::strDup(name);
 
-#if BX_PLATFORM_WINDOWS || BX_PLATFORM_LINUX || BX_PLATFORM_OSX || BX_PLATFORM_RPI
-		char logFilename[256];
-		bx::snprintf(logFilename, 256, "%s.log", name);
-		logger->m_File = fsFileOpenWrite(baseDir, logFilename);
+#if LOGGER_CONFIG_FILE_OUTPUT
+		logger->m_BaseDir = baseDir;
+		logger->m_Rotating = rotation != nullptr
+			&& (rotation->m_MaxSegmentSize != 0 || rotation->m_MaxSegmentDuration_sec != 0)
+			;
+
+		if (logger->m_Rotating) {
+			logger->m_Rotation = *rotation;
+			if (logger->m_Rotation.m_PreallocSize == 0) {
+				logger->m_Rotation.m_PreallocSize = logger->m_Rotation.m_MaxSegmentSize;
+			}
+
+			loggerFindSegments(logger);
+			loggerGetSegmentFilename(logger, logger->m_SegmentID, logger->m_Filename, LOGGER_MAX_FILENAME_LENGTH);
+			logger->m_File = loggerOpenSegment(logger, logger->m_SegmentID);
+		} else {
+			const bool binary = (flags & LoggerFlags::Binary) != 0;
+			bx::snprintf(logger->m_Filename, LOGGER_MAX_FILENAME_LENGTH, binary ? "%s.jxlog" : "%s.log", name);
+			logger->m_File = fsFileOpenWrite(baseDir, logger->m_Filename);
+		}
+
 		if (!logger->m_File) {
 			JX_CHECK(false, "Failed to open log file");
+			jx::strFree(logger->m_Name);
 			JX_FREE(logger);
 			return nullptr;
 		}
+
+		loggerBeginSegment(logger);
+
+		if (logger->m_Rotating) {
+			loggerPrepareNextSegment(logger);
+			loggerRemoveOldSegments(logger, logger->m_SegmentID);
+		}
 #else
-		BX_UNUSED(name);
+		BX_UNUSED(name, baseDir, rotation);
 		logger->m_File = nullptr;
 #endif
 	}
 
-	logger->m_Flags = flags;
-
 #if BX_CONFIG_SUPPORTS_THREADING
 	if ((flags & LoggerFlags::Multithreaded) != 0) {
-		logger->m_Mutex = JX_NEW(bx::Mutex)();
+		logger->m_Mutex = JX_NEW(Mutex)("Logger");
 	} else {
 		logger->m_Mutex = nullptr;
 	}
+
+	if ((flags & LoggerFlags::Async) != 0) {
+		logger->m_ThreadBufferTLS = JX_NEW(bx::TlsData)();
+		logger->m_WriteBuffer = (uint8_t*)JX_ALLOC(LOGGER_WRITE_BUFFER_SIZE);
+		logger->m_WriterThread = createThread(getGlobalAllocator(), loggerWriterThreadFunc, logger, 0, "Logger");
+		if (!logger->m_WriteBuffer || !logger->m_WriterThread) {
+			JX_CHECK(false, "Failed to initialize async logger");
+			destroyLog(logger);
+			return nullptr;
+		}
+	}
+
+#if LOGGER_CONFIG_FILE_OUTPUT
+	if (logger->m_Rotating && (flags & LoggerFlags::Async) == 0) {
+		logger->m_SegmentMutex = JX_NEW(Mutex)("LoggerSegment");
+		logger->m_SegmentThread = createThread(getGlobalAllocator(), loggerSegmentThreadFunc, logger, 0, "LoggerSegment");
+		if (!logger->m_SegmentThread) {
+			JX_CHECK(false, "Failed to create log segment thread");
+			destroyLog(logger);
+			return nullptr;
+		}
+	}
+#endif
 #endif
 
 	return logger;
@@ -78,11 +497,78 @@ Logger* createLog(jx::BaseDir::Enum baseDir, const char* name, uint32_t flags)
 
 void destroyLog(Logger* logger)
 {
-#if BX_PLATFORM_WINDOWS || BX_PLATFORM_LINUX || BX_PLATFORM_OSX || BX_PLATFORM_RPI
+	// Async loggers report the suppressed records from the writer thread.
+	LogRateLimiter* rl = logger->m_RateLimiter;
+	if (rl && (logger->m_Flags & LoggerFlags::Async) == 0) {
+		const int64_t now = bx::getHPCounter();
+		for (uint32_t i = 0; i < JX_CONFIG_LOGGER_RATE_LIMIT_SITES; ++i) {
+			LogRateSlot* slot = &rl->m_Slots[i];
+			LogLevel::Enum level;
+			const uint32_t numSuppressed = loggerTakeSuppressed(rl, slot, now, true, &level);
+			if (numSuppressed != 0) {
+				char text[LOGGER_MAX_LINE_LENGTH];
+				logFormatSuppressed(text, LOGGER_MAX_LINE_LENGTH, slot->m_Site, numSuppressed);
+				logf(logger, level, "%s", text);
+			}
+		}
+	}
+
+#if BX_CONFIG_SUPPORTS_THREADING
+	// The writer drains all thread buffers and flushes the file before exiting.
+	if (logger->m_WriterThread) {
+		threadInQueuePush(logger->m_WriterThread, kMsgQuit, nullptr, 0);
+		destroyThread(logger->m_WriterThread);
+		logger->m_WriterThread = nullptr;
+	}
+
+	// Closes the retired segment before exiting.
+	if (logger->m_SegmentThread) {
+		threadInQueuePush(logger->m_SegmentThread, kMsgQuit, nullptr, 0);
+		destroyThread(logger->m_SegmentThread);
+		logger->m_SegmentThread = nullptr;
+	}
+#endif
+
+	// All records have been published. Every sink processes its queue before exiting.
+	for (uint32_t i = 0; i < logger->m_NumSinkSlots; ++i) {
+		if (logger->m_Sinks[i]) {
+			loggerRemoveSink(logger, logger->m_Sinks[i]);
+		}
+	}
+
+#if BX_CONFIG_SUPPORTS_THREADING
+	LogThreadBuffer* tb = logger->m_ThreadBuffers;
+	while (tb) {
+		LogThreadBuffer* next = tb->m_Next;
+		JX_ALIGNED_FREE(tb, LOGGER_CACHE_LINE_SIZE);
+		tb = next;
+	}
+	logger->m_ThreadBuffers = nullptr;
+
+	if (logger->m_ThreadBufferTLS) {
+		JX_DELETE(logger->m_ThreadBufferTLS);
+		logger->m_ThreadBufferTLS = nullptr;
+	}
+
+	JX_FREE(logger->m_WriteBuffer);
+	logger->m_WriteBuffer = nullptr;
+#endif
+
+#if LOGGER_CONFIG_FILE_OUTPUT
 	if (logger->m_File) {
 		fsFileClose(logger->m_File);
 		logger->m_File = nullptr;
 	}
+
+	// The prepared segment is still empty.
+	if (logger->m_NextFile) {
+		fsFileClose(logger->m_NextFile);
+		logger->m_NextFile = nullptr;
+
+		char filename[LOGGER_MAX_FILENAME_LENGTH];
+		loggerGetSegmentFilename(logger, logger->m_SegmentID + 1, filename, LOGGER_MAX_FILENAME_LENGTH);
+		fsRemoveFile(logger->m_BaseDir, filename);
+	}
 #endif
 
 #if BX_CONFIG_SUPPORTS_THREADING
@@ -90,8 +576,16 @@ void destroyLog(Logger* logger)
 		JX_DELETE(logger->m_Mutex);
 		logger->m_Mutex = nullptr;
 	}
+
+	if (logger->m_SegmentMutex) {
+		JX_DELETE(logger->m_SegmentMutex);
+		logger->m_SegmentMutex = nullptr;
+	}
 #endif
 
+	loggerCloseFlightRecorder(logger);
+
+	JX_FREE(logger->m_RateLimiter);
 	jx::strFree(logger->m_Name);
 
 	JX_FREE(logger);
@@ -102,140 +596,2225 @@ const char* loggerGetName(Logger* logger)
 	return logger->m_Name;
 }
 
-uint32_t loggerRegisterCallback(Logger* logger, LoggingCallback cb, void* userData)
+bool loggerGetFilename(Logger* logger, char* buffer, uint32_t maxLen)
 {
-	const uint32_t oldCapacity = logger->m_NumCallbacks;
-	const uint32_t newCapacity = oldCapacity + 1;
-	CallbackData* newCallbacks = (CallbackData*)JX_ALLOC(sizeof(CallbackData) * newCapacity);
-	if (!newCallbacks) {
-		return UINT32_MAX;
+#if BX_CONFIG_SUPPORTS_THREADING
+	// The filename changes when the file is rotated.
+	if (logger->m_Mutex) {
+		logger->m_Mutex->lock();
 	}
+#endif
 
-	bx::memCopy(newCallbacks, logger->m_Callbacks, sizeof(CallbackData) * oldCapacity);
-	bx::memSet(&newCallbacks[oldCapacity], 0, sizeof(CallbackData));
-	
-	JX_FREE(logger->m_Callbacks);
-	logger->m_Callbacks = newCallbacks;
-	logger->m_NumCallbacks = newCapacity;
+	const bool hasFile = logger->m_File != nullptr;
+	bx::strCopy(buffer, (int32_t)maxLen, hasFile ? logger->m_Filename : "");
 
-	const uint32_t cbID = oldCapacity;
-	CallbackData* cbData = &logger->m_Callbacks[cbID];
-	cbData->m_Func = cb;
-	cbData->m_UserData = userData;
-	cbData->m_Active = true;
+#if BX_CONFIG_SUPPORTS_THREADING
+	if (logger->m_Mutex) {
+		logger->m_Mutex->unlock();
+	}
+#endif
 
-	return cbID;
+	return hasFile;
 }
 
-void loggerUnregisterCallback(Logger* logger, uint32_t cbID)
+LogSink* loggerAddSink(Logger* logger, const LogSinkDesc* desc)
 {
-	logger->m_Callbacks[cbID].m_Active = false;
+	const uint32_t slot = loggerAddSinkSlot(logger, desc);
+	return slot != UINT32_MAX
+		? logger->m_Sinks[slot]
+		: nullptr
+		;
 }
 
-void logf(Logger* logger, LogLevel::Enum level, const char* fmt, ...)
+void loggerRemoveSink(Logger* logger, LogSink* sink)
 {
-	// NOTE: This can happen when using JX_LOG_xxx macros and the system has been initialized
-	// without jx::SystemInitFlags::InitLog.
-	if (!logger) {
-		return;
+#if BX_CONFIG_SUPPORTS_THREADING
+	if (logger->m_Mutex) {
+		logger->m_Mutex->lock();
 	}
-
-#if BX_PLATFORM_WINDOWS || BX_PLATFORM_LINUX || BX_PLATFORM_OSX || BX_PLATFORM_RPI
-//	JX_CHECK(logger->m_File != nullptr, "Logger doesn't have a valid file handle");
 #endif
 
-	static char logLine[2048] = { 0 };
-
-	const bool forceFlush = (logger->m_Flags & LoggerFlags::FlushOnEveryLog) != 0;
-	const bool appendTimestamp = (logger->m_Flags & LoggerFlags::AppendTimestamp) != 0;
+	for (uint32_t i = 0; i < logger->m_NumSinkSlots; ++i) {
+		if (logger->m_Sinks[i] == sink) {
+			logger->m_Sinks[i] = nullptr;
+			break;
+		}
+	}
 
 #if BX_CONFIG_SUPPORTS_THREADING
-	const bool multithreaded = (logger->m_Flags & LoggerFlags::Multithreaded) != 0;
-
-	if (multithreaded) {
-		logger->m_Mutex->lock();
+	if (logger->m_Mutex) {
+		logger->m_Mutex->unlock();
 	}
-#endif
 
-	va_list ap;
-	va_start(ap, fmt);
-	const int logLineLen = bx::vsnprintf(logLine, BX_COUNTOF(logLine), fmt, ap);
-	va_end(ap);
+	// Nothing is published to the sink anymore. The thread processes the rest of the
+	// queue and calls the destroy callback before exiting.
+	threadInQueuePush(sink->m_Thread, kMsgQuit, nullptr, 0);
+	destroyThread(sink->m_Thread);
 
-	const char* levelSymbol = nullptr;
-	switch (level) {
-	case LogLevel::Debug:   levelSymbol = "(d) "; break;
-	case LogLevel::Info:    levelSymbol = "(i) "; break;
-	case LogLevel::Warning: levelSymbol = "(!) "; break;
-	case LogLevel::Error:   levelSymbol = "(x) "; break;
-	default: break;
+	JX_ALIGNED_FREE(sink, LOGGER_CACHE_LINE_SIZE);
+#else
+	if (sink->m_Desc.m_DestroyFunc) {
+		sink->m_Desc.m_DestroyFunc(sink->m_Desc.m_UserData);
 	}
 
-#if BX_PLATFORM_WINDOWS || BX_PLATFORM_LINUX || BX_PLATFORM_OSX || BX_PLATFORM_RPI
-	if (logger->m_File) {
-		if (levelSymbol) {
-			fsFileWriteBytes(logger->m_File, levelSymbol, 4);
-		}
+	JX_FREE(sink);
+#endif
+}
 
-		if (appendTimestamp) {
-			char timestamp[128];
-#if !BX_PLATFORM_WINDOWS
-			time_t rawtime;
-			time(&rawtime);
-			struct tm* timeinfo = localtime(&rawtime);
-			strftime(timestamp, BX_COUNTOF(timestamp), "%Y-%m-%d %H:%M:%S ", timeinfo);
-#else
-			SYSTEMTIME sysTime;
-#if 0
-			::GetSystemTime(&sysTime);
+void logSinkSetLevel(LogSink* sink, LogLevel::Enum level)
+{
+	sink->m_MinLevel = (uint32_t)level;
+}
+
+uint32_t logSinkGetNumDropped(const LogSink* sink)
+{
+#if BX_CONFIG_SUPPORTS_THREADING
+	return sink->m_NumDropped;
 #else
-			::GetLocalTime(&sysTime);
-#endif
-			bx::snprintf(timestamp, BX_COUNTOF(timestamp), "%04u-%02u-%02u %02u:%02u:%02u.%03u ", sysTime.wYear, sysTime.wMonth, sysTime.wDay, sysTime.wHour, sysTime.wMinute, sysTime.wSecond, sysTime.wMilliseconds);
+	BX_UNUSED(sink);
+	return 0;
 #endif
+}
 
-			fsFileWriteBytes(logger->m_File, timestamp, bx::strLen(timestamp));
-		}
+LogSink* loggerAddFileSink(Logger* logger, jx::BaseDir::Enum baseDir, const char* relPath, LogLevel::Enum minLevel)
+{
+	LogFileSink* fileSink = (LogFileSink*)JX_ALLOC(sizeof(LogFileSink) + LOGGER_FILE_SINK_BUFFER_SIZE);
+	if (!fileSink) {
+		return nullptr;
+	}
+
+	fileSink->m_Buffer = (uint8_t*)(fileSink + 1);
+	fileSink->m_File = fsFileOpenWrite(baseDir, relPath);
+	if (!fileSink->m_File) {
+		JX_CHECK(false, "Failed to open log sink file");
+		JX_FREE(fileSink);
+		return nullptr;
+	}
 
-		fsFileWriteBytes(logger->m_File, logLine, bx::min<int>(logLineLen, BX_COUNTOF(logLine) - 1));
+	LogSinkDesc desc;
+	bx::memSet(&desc, 0, sizeof(LogSinkDesc));
+	desc.m_WriteFunc = logFileSinkWrite;
+	desc.m_DestroyFunc = logFileSinkDestroy;
+	desc.m_UserData = fileSink;
+	desc.m_Name = "LogFileSink";
+	desc.m_MinLevel = minLevel;
 
-		if (forceFlush) {
-			// TODO: fflush?
-		}
+	LogSink* sink = loggerAddSink(logger, &desc);
+	if (!sink) {
+		logFileSinkDestroy(fileSink);
 	}
-#else
-	BX_UNUSED(logLineLen);
-	BX_UNUSED(forceFlush);
 
-	if (levelSymbol) {
-		printf("%s", levelSymbol);
+	return sink;
+}
+
+LogSink* loggerAddStdoutSink(Logger* logger, LogLevel::Enum minLevel)
+{
+	LogSinkDesc desc;
+	bx::memSet(&desc, 0, sizeof(LogSinkDesc));
+	desc.m_WriteFunc = logStdoutSinkWrite;
+	desc.m_Name = "LogStdoutSink";
+	desc.m_MinLevel = minLevel;
+
+	return loggerAddSink(logger, &desc);
+}
+
+LogSink* loggerAddCallbackSink(Logger* logger, LoggingCallback cb, void* userData, LogLevel::Enum minLevel)
+{
+	LogCallbackSink* cbSink = (LogCallbackSink*)JX_ALLOC(sizeof(LogCallbackSink));
+	if (!cbSink) {
+		return nullptr;
 	}
 
-	if (appendTimestamp) {
-		char timestamp[128];
-		time_t rawtime;
-		time(&rawtime);
-		struct tm* timeinfo = localtime(&rawtime);
-		strftime(timestamp, BX_COUNTOF(timestamp), "%Y-%m-%d %H:%M:%S ", timeinfo);
+	cbSink->m_Func = cb;
+	cbSink->m_UserData = userData;
 
-		printf("%s", timestamp);
+	LogSinkDesc desc;
+	bx::memSet(&desc, 0, sizeof(LogSinkDesc));
+	desc.m_WriteFunc = logCallbackSinkWrite;
+	desc.m_DestroyFunc = logCallbackSinkDestroy;
+	desc.m_UserData = cbSink;
+	desc.m_Name = "LogCallbackSink";
+	desc.m_MinLevel = minLevel;
+
+	LogSink* sink = loggerAddSink(logger, &desc);
+	if (!sink) {
+		logCallbackSinkDestroy(cbSink);
 	}
 
-	printf("%s", logLine);
-#endif
+	return sink;
+}
 
-	const uint32_t numCallbacks = logger->m_NumCallbacks;
-	for (uint32_t i = 0; i < numCallbacks; ++i) {
-		CallbackData* cb = &logger->m_Callbacks[i];
-		if (cb->m_Active) {
-			cb->m_Func(level, logLine, cb->m_UserData);
-		}
+LogSink* loggerAddMemorySink(Logger* logger, uint32_t capacity, LogLevel::Enum minLevel)
+{
+	LogMemorySink* memSink = (LogMemorySink*)JX_ALLOC(sizeof(LogMemorySink) + capacity);
+	if (!memSink) {
+		return nullptr;
 	}
 
+	bx::memSet(memSink, 0, sizeof(LogMemorySink));
+	memSink->m_Data = (char*)(memSink + 1);
+	memSink->m_Capacity = capacity;
 #if BX_CONFIG_SUPPORTS_THREADING
-	if (multithreaded) {
-		logger->m_Mutex->unlock();
+	memSink->m_Mutex = JX_NEW(Mutex)();
+#endif
+
+	LogSinkDesc desc;
+	bx::memSet(&desc, 0, sizeof(LogSinkDesc));
+	desc.m_WriteFunc = logMemorySinkWrite;
+	desc.m_DestroyFunc = logMemorySinkDestroy;
+	desc.m_UserData = memSink;
+	desc.m_Name = "LogMemorySink";
+	desc.m_MinLevel = minLevel;
+
+	LogSink* sink = loggerAddSink(logger, &desc);
+	if (!sink) {
+		logMemorySinkDestroy(memSink);
 	}
+
+	return sink;
+}
+
+uint32_t logMemorySinkRead(LogSink* sink, char* buffer, uint32_t maxLen)
+{
+	JX_CHECK(sink->m_Desc.m_WriteFunc == logMemorySinkWrite, "Not a memory sink");
+	JX_CHECK(maxLen != 0, "Invalid buffer");
+
+	LogMemorySink* memSink = (LogMemorySink*)sink->m_Desc.m_UserData;
+
+#if BX_CONFIG_SUPPORTS_THREADING
+	MutexScope ms(*memSink->m_Mutex);
 #endif
+
+	const uint64_t available = bx::min<uint64_t>(memSink->m_WritePos, memSink->m_Capacity);
+	const uint32_t len = (uint32_t)bx::min<uint64_t>(available, maxLen - 1);
+	const uint64_t startPos = memSink->m_WritePos - len;
+
+	const uint32_t start = (uint32_t)(startPos % memSink->m_Capacity);
+	const uint32_t firstPart = bx::min<uint32_t>(len, memSink->m_Capacity - start);
+	bx::memCopy(buffer, &memSink->m_Data[start], firstPart);
+	bx::memCopy(&buffer[firstPart], memSink->m_Data, len - firstPart);
+
+	// Skip the first line if its beginning has been overwritten or didn't fit.
+	const bool partial = startPos != 0
+		&& (startPos == memSink->m_WritePos - available || memSink->m_Data[(startPos - 1) % memSink->m_Capacity] != '\n')
+		;
+
+	uint32_t skip = 0;
+	if (partial) {
+		while (skip < len && buffer[skip] != '\n') {
+			++skip;
+		}
+		skip = bx::min<uint32_t>(skip + 1, len);
+	}
+
+	bx::memMove(buffer, &buffer[skip], len - skip);
+	buffer[len - skip] = '\0';
+
+	return len - skip;
+}
+
+uint32_t loggerRegisterCallback(Logger* logger, LoggingCallback cb, void* userData)
+{
+	LogSink* sink = loggerAddCallbackSink(logger, cb, userData, LogLevel::Debug);
+	if (!sink) {
+		return UINT32_MAX;
+	}
+
+	for (uint32_t i = 0; i < logger->m_NumSinkSlots; ++i) {
+		if (logger->m_Sinks[i] == sink) {
+			return i;
+		}
+	}
+
+	return UINT32_MAX;
+}
+
+void loggerUnregisterCallback(Logger* logger, uint32_t cbID)
+{
+	JX_CHECK(cbID < logger->m_NumSinkSlots && logger->m_Sinks[cbID], "Invalid callback ID");
+	loggerRemoveSink(logger, logger->m_Sinks[cbID]);
 }
+
+void loggerSetLevel(Logger* logger, LogLevel::Enum level)
+{
+	logger->m_MinLevel = (uint32_t)level;
+}
+
+LogLevel::Enum loggerGetLevel(const Logger* logger)
+{
+	return (LogLevel::Enum)logger->m_MinLevel;
+}
+
+bool loggerIsLevelEnabled(const Logger* logger, LogLevel::Enum level)
+{
+	// NOTE: logger can be null when using JX_LOG_xxx macros and the system has been
+	// initialized without jx::SystemInitFlags::InitLog.
+	return logger != nullptr
+		&& (uint32_t)level >= logger->m_MinLevel
+		;
+}
+
+void loggerSetRateLimit(Logger* logger, const LogRateLimitDesc* desc)
+{
+	JX_CHECK(bx::isPowerOf2<uint32_t>(JX_CONFIG_LOGGER_RATE_LIMIT_SITES), "JX_CONFIG_LOGGER_RATE_LIMIT_SITES must be a power of 2");
+
+	if (!desc || desc->m_RecordsPerSec == 0) {
+		if (logger->m_RateLimiter) {
+			logger->m_RateLimiter->m_Enabled = 0;
+		}
+		return;
+	}
+
+	// The slots are kept until the logger is destroyed, so call sites which have already
+	// looked up their slot can keep using it.
+	LogRateLimiter* rl = logger->m_RateLimiter;
+	if (!rl) {
+		const uint32_t totalMem = 0
+			+ loggerAlignSize(sizeof(LogRateLimiter), 16)
+			+ sizeof(LogRateSlot) * JX_CONFIG_LOGGER_RATE_LIMIT_SITES
+			;
+
+		uint8_t* mem = (uint8_t*)JX_ALLOC(totalMem);
+		if (!mem) {
+			JX_CHECK(false, "Failed to allocate log rate limiter");
+			return;
+		}
+
+		bx::memSet(mem, 0, totalMem);
+
+		rl = (LogRateLimiter*)mem;
+		rl->m_Slots = (LogRateSlot*)(mem + loggerAlignSize(sizeof(LogRateLimiter), 16));
+		rl->m_LastScan = bx::getHPCounter();
+	}
+
+	rl->m_MaxTokens = (int64_t)bx::max<uint32_t>(desc->m_Burst, 1) * logger->m_TimerFrequency;
+	rl->m_RecordsPerSec = (int64_t)desc->m_RecordsPerSec;
+	rl->m_SummaryInterval = (int64_t)bx::max<uint32_t>(desc->m_SummaryInterval_sec, 1) * logger->m_TimerFrequency;
+	bx::writeBarrier();
+	rl->m_Enabled = 1;
+
+	logger->m_RateLimiter = rl;
+}
+
+bool loggerEnableFlightRecorder(Logger* logger, jx::BaseDir::Enum baseDir, const char* relPath, uint32_t capacity)
+{
+	loggerCloseFlightRecorder(logger);
+
+	if (!relPath) {
+		return true;
+	}
+
+	// Keep records which don't fit in the space left at the end of the ring from taking
+	// up a large part of it.
+	capacity = bx::uint32_nextpow2(bx::max<uint32_t>(capacity, LOGGER_FLIGHT_RECORDER_MIN_SIZE));
+
+	LogFlightRecorder* fr = (LogFlightRecorder*)JX_ALLOC(sizeof(LogFlightRecorder));
+	if (!fr) {
+		return false;
+	}
+
+	bx::memSet(fr, 0, sizeof(LogFlightRecorder));
+
+	fr->m_File = fsMappedFileOpenWrite(baseDir, relPath, sizeof(LogFlightRecorderHeader) + (uint64_t)capacity);
+	if (!fr->m_File) {
+		JX_CHECK(false, "Failed to create flight recorder file");
+		JX_FREE(fr);
+		return false;
+	}
+
+	// The file is new, so the ring is zero-filled. A zeroed header can only pass for an
+	// (empty) record at position 0.
+	uint8_t* ptr = (uint8_t*)fsMappedFileGetPtr(fr->m_File);
+	fr->m_Header = (LogFlightRecorderHeader*)ptr;
+	fr->m_Data = ptr + sizeof(LogFlightRecorderHeader);
+	fr->m_Capacity = capacity;
+	fr->m_Mask = capacity - 1;
+
+	fr->m_Header->m_Version = LOGGER_FLIGHT_RECORDER_VERSION;
+	fr->m_Header->m_Capacity = capacity;
+	fr->m_Header->m_WritePos = 0;
+	bx::writeBarrier();
+	fr->m_Header->m_Magic = LOGGER_FLIGHT_RECORDER_MAGIC;
+
+	logger->m_FlightRecorder = fr;
+
+	return true;
+}
+
+uint64_t loggerMakeFingerprint(const char* fmt, const char* file, uint32_t line)
+{
+	const uint64_t seed = spookyHash64(file, bx::strLen(file), line);
+	const uint64_t fingerprint = spookyHash64(fmt, bx::strLen(fmt), seed);
+	return fingerprint != 0 ? fingerprint : 1;
+}
+
+bool loggerCheckRateLimit(Logger* logger, LogLevel::Enum level, const LogSite* site)
+{
+	LogRateLimiter* rl = logger->m_RateLimiter;
+	if (!rl || !rl->m_Enabled) {
+		return true;
+	}
+
+	// Too many call sites; don't limit the ones which don't fit.
+	LogRateSlot* slot = loggerFindRateSlot(rl, site->m_Fingerprint);
+	if (!slot) {
+		return true;
+	}
+
+	const int64_t now = bx::getHPCounter();
+
+	logRateSlotLock(slot);
+
+	if (!slot->m_Site) {
+		slot->m_Site = site;
+		slot->m_Tokens = rl->m_MaxTokens;
+		slot->m_LastRefill = now;
+		slot->m_LastSummary = now;
+	}
+
+	// Clamp the elapsed time to avoid overflowing the multiplication after a long pause.
+	const int64_t elapsed = bx::min<int64_t>(now - slot->m_LastRefill, rl->m_MaxTokens);
+	slot->m_Tokens = bx::min<int64_t>(slot->m_Tokens + elapsed * rl->m_RecordsPerSec, rl->m_MaxTokens);
+	slot->m_LastRefill = now;
+
+	const int64_t cost = logger->m_TimerFrequency;
+	const bool allowed = slot->m_Tokens >= cost;
+	if (allowed) {
+		slot->m_Tokens -= cost;
+	} else {
+		slot->m_SuppressedLevel = slot->m_NumSuppressed == 0
+			? level
+			: bx::max<LogLevel::Enum>(slot->m_SuppressedLevel, level)
+			;
+		++slot->m_NumSuppressed;
+	}
+
+	logRateSlotUnlock(slot);
+
+	// The summary goes in front of the first record which makes it through after the
+	// storm (or periodically while it lasts).
+	LogLevel::Enum summaryLevel;
+	const uint32_t numSuppressed = loggerTakeSuppressed(rl, slot, now, allowed, &summaryLevel);
+	if (numSuppressed != 0) {
+		char text[LOGGER_MAX_LINE_LENGTH];
+		logFormatSuppressed(text, LOGGER_MAX_LINE_LENGTH, site, numSuppressed);
+		logf(logger, summaryLevel, "%s", text);
+	}
+
+	return allowed;
+}
+
+void logf(Logger* logger, LogLevel::Enum level, const char* fmt, ...)
+{
+	if (!loggerIsLevelEnabled(logger, level)) {
+		return;
+	}
+
+#if LOGGER_CONFIG_FILE_OUTPUT
+//	JX_CHECK(logger->m_File != nullptr, "Logger doesn't have a valid file handle");
+#endif
+
+#if BX_CONFIG_SUPPORTS_THREADING
+	if ((logger->m_Flags & LoggerFlags::Async) != 0) {
+		va_list ap;
+		va_start(ap, fmt);
+		loggerAsyncLog(logger, level, fmt, ap);
+		va_end(ap);
+		return;
+	}
+#endif
+
+	static char logLine[LOGGER_MAX_PREFIX_LENGTH + LOGGER_MAX_LINE_LENGTH] = { 0 };
+
+	const bool forceFlush = (logger->m_Flags & LoggerFlags::FlushOnEveryLog) != 0;
+
+#if BX_CONFIG_SUPPORTS_THREADING
+	const bool multithreaded = (logger->m_Flags & LoggerFlags::Multithreaded) != 0;
+
+	if (multithreaded) {
+		logger->m_Mutex->lock();
+	}
+#endif
+
+	// The level symbol and the timestamp are written in front of the message so the whole
+	// line can be written with a single call.
+	const int64_t time_us = loggerGetTime_us(logger, bx::getHPCounter());
+	const uint32_t prefixLen = logFormatPrefix(&logger->m_TimeCache, logger->m_Flags, level, time_us, logLine, LOGGER_MAX_PREFIX_LENGTH);
+	char* text = &logLine[prefixLen];
+
+	va_list ap;
+	va_start(ap, fmt);
+	const int textLen = bx::vsnprintf(text, LOGGER_MAX_LINE_LENGTH, fmt, ap);
+	va_end(ap);
+
+	const uint32_t lineLen = prefixLen + (uint32_t)bx::clamp<int>(textLen, 0, LOGGER_MAX_LINE_LENGTH - 1);
+
+	loggerFlightRecorderWrite(logger, level, logLine, lineLen);
+
+#if LOGGER_CONFIG_FILE_OUTPUT
+	if (loggerShouldRotate(logger, 0, lineLen)) {
+		loggerRotate(logger);
+	}
+
+	if (logger->m_File) {
+		fsFileWriteBytes(logger->m_File, logLine, lineLen);
+		logger->m_SegmentSize += lineLen;
+
+		if (forceFlush) {
+			fsFileFlush(logger->m_File);
+		}
+	}
+#else
+	BX_UNUSED(forceFlush);
+
+	printf("%s", logLine);
+#endif
+
+	loggerPublish(logger, level, logLine, lineLen, prefixLen);
+
+#if BX_CONFIG_SUPPORTS_THREADING
+	if (multithreaded) {
+		logger->m_Mutex->unlock();
+	}
+#endif
+}
+
+uint32_t loggerRegisterFormat(const char* fmt)
+{
+	// Binary logs store the format in a single record, which readers limit in size.
+	if (bx::strLen(fmt) > LOGGER_MAX_FORMAT_LENGTH) {
+		JX_CHECK(false, "Log format too long");
+		return JX_LOGGER_INVALID_FORMAT_ID;
+	}
+
+	const int32_t fmtID = bx::atomicFetchAndAdd<int32_t>(&s_NumLogFormats, 1);
+	if (fmtID >= JX_CONFIG_LOGGER_MAX_FORMATS) {
+		JX_CHECK(false, "Too many log formats. Increase JX_CONFIG_LOGGER_MAX_FORMATS");
+		return JX_LOGGER_INVALID_FORMAT_ID;
+	}
+
+	s_LogFormats[fmtID] = fmt;
+
+	return (uint32_t)fmtID;
+}
+
+const char* loggerGetFormat(uint32_t fmtID)
+{
+	return fmtID < JX_CONFIG_LOGGER_MAX_FORMATS
+		? s_LogFormats[fmtID]
+		: nullptr
+		;
+}
+
+void logDeferred(Logger* logger, LogLevel::Enum level, uint32_t fmtID, const LogArgBuffer* args)
+{
+	if (!loggerIsLevelEnabled(logger, level)) {
+		return;
+	}
+
+	const char* fmt = loggerGetFormat(fmtID);
+	if (!fmt) {
+		JX_CHECK(false, "Unknown log format ID");
+		return;
+	}
+
+#if BX_CONFIG_SUPPORTS_THREADING
+	if ((logger->m_Flags & LoggerFlags::Async) != 0) {
+		LogThreadBuffer* tb = loggerGetThreadBuffer(logger);
+		if (!tb) {
+			return;
+		}
+
+		LogRecordHeader hdr;
+		hdr.m_Size = LOGGER_DEFERRED_HEADER_SIZE + args->m_Size;
+		hdr.m_TextOffset = 0;
+		hdr.m_Level = (uint8_t)level;
+		hdr.m_Flags = LogRecordFlags::Deferred;
+
+		const int64_t timestamp = bx::getHPCounter();
+
+		// The flight recorder has to survive the process, so it can't store the format
+		// string pointer. The record is formatted here instead.
+		if (logger->m_FlightRecorder) {
+			char line[LOGGER_MAX_PREFIX_LENGTH + LOGGER_MAX_LINE_LENGTH];
+			const int64_t time_us = loggerGetTime_us(logger, timestamp);
+			uint32_t lineLen = logFormatPrefix(&tb->m_TimeCache, logger->m_Flags, level, time_us, line, LOGGER_MAX_PREFIX_LENGTH);
+			lineLen += logFormatDeferred(&line[lineLen], LOGGER_MAX_LINE_LENGTH, fmt, args->m_Data, args->m_Size);
+			loggerFlightRecorderWrite(logger, level, line, lineLen);
+		}
+
+		uint8_t* payload = ltbBeginWrite(logger, tb, &hdr);
+		bx::memCopy(&payload[0], &timestamp, sizeof(int64_t));
+		bx::memCopy(&payload[sizeof(int64_t)], &fmtID, sizeof(uint32_t));
+		bx::memCopy(&payload[LOGGER_DEFERRED_HEADER_SIZE], args->m_Data, args->m_Size);
+		ltbEndWrite(tb);
+
+		if (level == LogLevel::Error) {
+			loggerWakeupWriter(logger);
+		}
+
+		return;
+	}
+#endif
+
+	char text[LOGGER_MAX_LINE_LENGTH];
+	logFormatDeferred(text, LOGGER_MAX_LINE_LENGTH, fmt, args->m_Data, args->m_Size);
+	logf(logger, level, "%s", text);
+}
+
+bool logDecodeBinary(File* src, File* dst)
+{
+	LogFileHeader fileHdr;
+	if (fsFileReadBytes(src, &fileHdr, sizeof(LogFileHeader)) != sizeof(LogFileHeader)) {
+		return false;
+	}
+
+	if (fileHdr.m_Magic != LOGGER_BINARY_MAGIC || fileHdr.m_Version != LOGGER_BINARY_VERSION || fileHdr.m_TimerFrequency <= 0) {
+		return false;
+	}
+
+	// Large enough for any valid record (see the size checks below).
+	const uint32_t payloadCapacity = sizeof(uint32_t) + LOGGER_MAX_PREFIX_LENGTH + LOGGER_MAX_LINE_LENGTH;
+	BX_STATIC_ASSERT(LOGGER_MAX_FORMAT_LENGTH <= LOGGER_MAX_PREFIX_LENGTH + LOGGER_MAX_LINE_LENGTH, "Format record too large");
+	BX_STATIC_ASSERT(LOGGER_DEFERRED_HEADER_SIZE + JX_LOGGER_MAX_DEFERRED_ARGS_SIZE <= LOGGER_MAX_PREFIX_LENGTH + LOGGER_MAX_LINE_LENGTH, "Message record too large");
+
+	char** formats = (char**)JX_ALLOC(sizeof(char*) * JX_CONFIG_LOGGER_MAX_FORMATS);
+	uint8_t* payload = (uint8_t*)JX_ALLOC(payloadCapacity);
+	char* line = (char*)JX_ALLOC(LOGGER_MAX_PREFIX_LENGTH + LOGGER_MAX_LINE_LENGTH);
+	if (!formats || !payload || !line) {
+		JX_FREE(formats);
+		JX_FREE(payload);
+		JX_FREE(line);
+		return false;
+	}
+
+	bx::memSet(formats, 0, sizeof(char*) * JX_CONFIG_LOGGER_MAX_FORMATS);
+
+	LogTimeCache timeCache;
+	logTimeCacheInit(&timeCache);
+
+	// A truncated record at the end of the file (e.g. after a crash) ends the log. A record
+	// with an impossible size means the file is corrupted; decoding stops and fails.
+	bool success = true;
+	for (;;) {
+		LogFileRecordHeader hdr;
+		if (fsFileReadBytes(src, &hdr, sizeof(LogFileRecordHeader)) != sizeof(LogFileRecordHeader)) {
+			break;
+		}
+
+		uint32_t minSize = 0;
+		uint32_t maxSize = LOGGER_MAX_PREFIX_LENGTH + LOGGER_MAX_LINE_LENGTH;
+		if (hdr.m_Type == LogFileRecordType::Format) {
+			minSize = sizeof(uint32_t);
+			maxSize = sizeof(uint32_t) + LOGGER_MAX_FORMAT_LENGTH;
+		} else if (hdr.m_Type == LogFileRecordType::Message) {
+			minSize = LOGGER_DEFERRED_HEADER_SIZE;
+			maxSize = LOGGER_DEFERRED_HEADER_SIZE + JX_LOGGER_MAX_DEFERRED_ARGS_SIZE;
+		}
+
+		if (hdr.m_Size < minSize || hdr.m_Size > maxSize) {
+			success = false;
+			break;
+		}
+
+		if (fsFileReadBytes(src, payload, hdr.m_Size) != hdr.m_Size) {
+			break;
+		}
+
+		if (hdr.m_Type == LogFileRecordType::Format) {
+			uint32_t fmtID;
+			bx::memCopy(&fmtID, payload, sizeof(uint32_t));
+			if (fmtID >= JX_CONFIG_LOGGER_MAX_FORMATS) {
+				success = false;
+				break;
+			}
+
+			if (formats[fmtID]) {
+				jx::strFree(formats[fmtID]);
+			}
+			formats[fmtID] = jx::strDup((const char*)&payload[sizeof(uint32_t)], hdr.m_Size - sizeof(uint32_t));
+		} else if (hdr.m_Type == LogFileRecordType::Message) {
+			int64_t timestamp;
+			uint32_t fmtID;
+			bx::memCopy(&timestamp, &payload[0], sizeof(int64_t));
+			bx::memCopy(&fmtID, &payload[sizeof(int64_t)], sizeof(uint32_t));
+
+			const int64_t time_us = logCounterToTime_us(timestamp, fileHdr.m_StartCounter, fileHdr.m_StartTime_us, fileHdr.m_TimerFrequency);
+			uint32_t len = logFormatPrefix(&timeCache, LoggerFlags::AppendTimestamp, (LogLevel::Enum)hdr.m_Level, time_us, line, LOGGER_MAX_PREFIX_LENGTH);
+
+			const char* fmt = fmtID < JX_CONFIG_LOGGER_MAX_FORMATS ? formats[fmtID] : nullptr;
+			if (fmt) {
+				len += logFormatDeferred(&line[len], LOGGER_MAX_LINE_LENGTH, fmt, &payload[LOGGER_DEFERRED_HEADER_SIZE], hdr.m_Size - LOGGER_DEFERRED_HEADER_SIZE);
+			} else {
+				len += (uint32_t)bx::clamp<int32_t>(bx::snprintf(&line[len], LOGGER_MAX_LINE_LENGTH, "<unknown format %u>\n", fmtID), 0, LOGGER_MAX_LINE_LENGTH - 1);
+			}
+
+			fsFileWriteBytes(dst, line, len);
+		} else if (hdr.m_Type == LogFileRecordType::Text) {
+			fsFileWriteBytes(dst, payload, hdr.m_Size);
+		}
+	}
+
+	for (uint32_t i = 0; i < JX_CONFIG_LOGGER_MAX_FORMATS; ++i) {
+		if (formats[i]) {
+			jx::strFree(formats[i]);
+		}
+	}
+
+	JX_FREE(formats);
+	JX_FREE(payload);
+	JX_FREE(line);
+
+	return success;
+}
+
+bool logDumpFlightRecorder(File* src, File* dst, uint32_t maxRecords)
+{
+	LogFlightRecorderHeader fileHdr;
+	if (fsFileReadBytes(src, &fileHdr, sizeof(LogFlightRecorderHeader)) != sizeof(LogFlightRecorderHeader)) {
+		return false;
+	}
+
+	const uint32_t capacity = fileHdr.m_Capacity;
+	if (fileHdr.m_Magic != LOGGER_FLIGHT_RECORDER_MAGIC || fileHdr.m_Version != LOGGER_FLIGHT_RECORDER_VERSION || !bx::isPowerOf2<uint32_t>(capacity)) {
+		return false;
+	}
+
+	uint8_t* data = (uint8_t*)JX_ALLOC(capacity);
+	if (!data) {
+		return false;
+	}
+
+	if (fsFileReadBytes(src, data, capacity) != capacity) {
+		JX_FREE(data);
+		return false;
+	}
+
+	const uint32_t mask = capacity - 1;
+	const uint64_t writePos = fileHdr.m_WritePos;
+	const uint64_t startPos = writePos > capacity ? writePos - capacity : 0;
+
+	// First pass counts the valid records, the second one writes the last maxRecords of them.
+	uint32_t numRecords = 0;
+	for (uint32_t pass = 0; pass < 2; ++pass) {
+		const uint32_t numSkipped = numRecords > maxRecords ? numRecords - maxRecords : 0;
+		uint32_t recordID = 0;
+
+		uint64_t pos = startPos;
+		while (pos < writePos) {
+			const uint32_t offset = (uint32_t)(pos & mask);
+			const uint32_t spaceToEnd = capacity - offset;
+			if (spaceToEnd < sizeof(LogFlightRecordHeader)) {
+				pos += spaceToEnd;
+				continue;
+			}
+
+			LogFlightRecordHeader hdr;
+			bx::memCopy(&hdr, &data[offset], sizeof(LogFlightRecordHeader));
+
+			const uint32_t recordSize = loggerAlignSize(sizeof(LogFlightRecordHeader) + hdr.m_Size, LOGGER_RECORD_ALIGNMENT);
+			const bool valid = hdr.m_Pos == pos
+				&& hdr.m_Size <= spaceToEnd - sizeof(LogFlightRecordHeader)
+				&& pos + recordSize <= writePos
+				;
+
+			// Resynchronize on the next valid record after a torn or overwritten one.
+			if (!valid) {
+				pos += LOGGER_RECORD_ALIGNMENT;
+				continue;
+			}
+
+			pos += recordSize;
+
+			if ((hdr.m_Flags & LogFlightRecordFlags::Padding) != 0) {
+				continue;
+			}
+
+			if (pass == 0) {
+				++numRecords;
+			} else if (recordID++ >= numSkipped) {
+				fsFileWriteBytes(dst, &data[offset + sizeof(LogFlightRecordHeader)], hdr.m_Size);
+			}
+		}
+	}
+
+	JX_FREE(data);
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Internal
+//
+static const char* loggerGetLevelSymbol(LogLevel::Enum level)
+{
+	switch (level) {
+	case LogLevel::Debug:   return "(d) ";
+	case LogLevel::Info:    return "(i) ";
+	case LogLevel::Warning: return "(!) ";
+	case LogLevel::Error:   return "(x) ";
+	default: break;
+	}
+
+	return nullptr;
+}
+
+static int64_t loggerGetTime_us(const Logger* logger, int64_t counter)
+{
+	return logCounterToTime_us(counter, logger->m_StartCounter, logger->m_StartTime_us, logger->m_TimerFrequency);
+}
+
+// Level symbol, followed by the timestamp in microseconds since the Unix epoch
+// (NumericTimestamp) and the local date/time with microsecond resolution (AppendTimestamp).
+static uint32_t logFormatPrefix(LogTimeCache* cache, uint32_t flags, LogLevel::Enum level, int64_t time_us, char* buffer, uint32_t maxLen)
+{
+	JX_CHECK(maxLen >= 4 + 21 + sizeof(cache->m_Prefix) + 9, "Log prefix buffer too small");
+	BX_UNUSED(maxLen);
+
+	uint32_t len = 0;
+
+	const char* levelSymbol = loggerGetLevelSymbol(level);
+	if (levelSymbol) {
+		bx::memCopy(buffer, levelSymbol, 4);
+		len += 4;
+	}
+
+	if ((flags & LoggerFlags::NumericTimestamp) != 0) {
+		len += logFormatUInt((uint64_t)bx::max<int64_t>(time_us, 0), 1, &buffer[len]);
+		buffer[len++] = ' ';
+	}
+
+	if ((flags & LoggerFlags::AppendTimestamp) != 0) {
+		len += logFormatTime(cache, time_us, &buffer[len], maxLen - len);
+	}
+
+	buffer[len] = '\0';
+
+	return len;
+}
+
+static uint32_t logFormatTime(LogTimeCache* cache, int64_t time_us, char* buffer, uint32_t maxLen)
+{
+	BX_UNUSED(maxLen);
+
+	const int64_t sec = time_us / 1000000;
+	if (sec != cache->m_Second) {
+		const time_t rawtime = (time_t)sec;
+		struct tm timeinfo;
+#if BX_PLATFORM_WINDOWS
+		const bool valid = localtime_s(&timeinfo, &rawtime) == 0;
+#else
+		const bool valid = localtime_r(&rawtime, &timeinfo) != nullptr;
+#endif
+		cache->m_PrefixLen = valid
+			? (uint32_t)strftime(cache->m_Prefix, BX_COUNTOF(cache->m_Prefix), "%Y-%m-%d %H:%M:%S", &timeinfo)
+			: 0
+			;
+		cache->m_Second = sec;
+	}
+
+	uint32_t len = cache->m_PrefixLen;
+	bx::memCopy(buffer, cache->m_Prefix, len);
+	buffer[len++] = '.';
+	len += logFormatUInt((uint64_t)(time_us - sec * 1000000), 6, &buffer[len]);
+	buffer[len++] = ' ';
+	buffer[len] = '\0';
+
+	return len;
+}
+
+static uint32_t logFormatUInt(uint64_t val, uint32_t minDigits, char* buffer)
+{
+	char digits[20];
+	uint32_t numDigits = 0;
+	do {
+		digits[numDigits++] = (char)('0' + (val % 10));
+		val /= 10;
+	} while (val != 0);
+
+	while (numDigits < minDigits) {
+		digits[numDigits++] = '0';
+	}
+
+	for (uint32_t i = 0; i < numDigits; ++i) {
+		buffer[i] = digits[numDigits - 1 - i];
+	}
+
+	return numDigits;
+}
+
+static int64_t logCounterToTime_us(int64_t counter, int64_t startCounter, int64_t startTime_us, int64_t frequency)
+{
+	// Split the conversion to avoid overflowing the multiplication after a few hours.
+	const int64_t delta = counter - startCounter;
+	return startTime_us
+		+ (delta / frequency) * 1000000
+		+ ((delta % frequency) * 1000000) / frequency
+		;
+}
+
+static void logTimeCacheInit(LogTimeCache* cache)
+{
+	cache->m_Second = INT64_MIN;
+	cache->m_PrefixLen = 0;
+	cache->m_Prefix[0] = '\0';
+}
+
+static int64_t logGetWallClockTime_us()
+{
+	const auto now = std::chrono::system_clock::now();
+	return (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count();
+}
+
+static LogRateSlot* loggerFindRateSlot(LogRateLimiter* rl, uint64_t fingerprint)
+{
+	const uint32_t mask = JX_CONFIG_LOGGER_RATE_LIMIT_SITES - 1;
+	for (uint32_t i = 0; i < LOGGER_RATE_LIMIT_MAX_PROBES; ++i) {
+		LogRateSlot* slot = &rl->m_Slots[(uint32_t)(fingerprint + i) & mask];
+
+		uint64_t slotFingerprint = slot->m_Fingerprint;
+		if (slotFingerprint == 0) {
+			slotFingerprint = bx::atomicCompareAndSwap<uint64_t>(&slot->m_Fingerprint, 0, fingerprint);
+			if (slotFingerprint == 0) {
+				return slot;
+			}
+		}
+
+		if (slotFingerprint == fingerprint) {
+			return slot;
+		}
+	}
+
+	return nullptr;
+}
+
+// Returns the number of records suppressed since the last summary if a summary is due
+// (force or the summary interval has elapsed) and resets the counter.
+static uint32_t loggerTakeSuppressed(LogRateLimiter* rl, LogRateSlot* slot, int64_t now, bool force, LogLevel::Enum* level)
+{
+	if (slot->m_NumSuppressed == 0) {
+		return 0;
+	}
+
+	uint32_t numSuppressed = 0;
+
+	logRateSlotLock(slot);
+	if (slot->m_NumSuppressed != 0 && (force || now - slot->m_LastSummary >= rl->m_SummaryInterval)) {
+		numSuppressed = slot->m_NumSuppressed;
+		*level = slot->m_SuppressedLevel;
+		slot->m_NumSuppressed = 0;
+		slot->m_LastSummary = now;
+	}
+	logRateSlotUnlock(slot);
+
+	return numSuppressed;
+}
+
+static uint32_t logFormatSuppressed(char* buffer, uint32_t maxLen, const LogSite* site, uint32_t numSuppressed)
+{
+	// Most formats end with a new line.
+	const char* fmt = site->m_Format;
+	uint32_t fmtLen = bx::strLen(fmt);
+	while (fmtLen != 0 && (fmt[fmtLen - 1] == '\n' || fmt[fmtLen - 1] == '\r')) {
+		--fmtLen;
+	}
+
+	const int len = bx::snprintf(buffer, maxLen, "Suppressed %u similar messages (%s:%u): %.*s\n", numSuppressed, site->m_File, site->m_Line, (int)fmtLen, fmt);
+	return (uint32_t)bx::clamp<int>(len, 0, (int)maxLen - 1);
+}
+
+static void logRateSlotLock(LogRateSlot* slot)
+{
+	while (slot->m_Lock != 0 || bx::atomicCompareAndSwap<int32_t>(&slot->m_Lock, 0, 1) != 0) {
+		jx::cpuPause();
+	}
+}
+
+static void logRateSlotUnlock(LogRateSlot* slot)
+{
+	bx::memoryBarrier();
+	slot->m_Lock = 0;
+}
+
+// Called by the thread which logs, before the record is queued/written, so the record
+// survives if the process dies right after. Multiple threads can write at the same time.
+static void loggerFlightRecorderWrite(Logger* logger, LogLevel::Enum level, const char* line, uint32_t lineLen)
+{
+	LogFlightRecorder* fr = logger->m_FlightRecorder;
+	if (!fr) {
+		return;
+	}
+
+	LogFlightRecorderHeader* frHdr = fr->m_Header;
+	const uint32_t recordSize = loggerAlignSize(sizeof(LogFlightRecordHeader) + lineLen, LOGGER_RECORD_ALIGNMENT);
+
+	uint64_t writePos;
+	uint32_t padding;
+	for (;;) {
+		writePos = frHdr->m_WritePos;
+		const uint32_t spaceToEnd = fr->m_Capacity - (uint32_t)(writePos & fr->m_Mask);
+		padding = spaceToEnd < recordSize ? spaceToEnd : 0;
+
+		const uint64_t endPos = writePos + padding + recordSize;
+		if (bx::atomicCompareAndSwap<uint64_t>(&frHdr->m_WritePos, writePos, endPos) == writePos) {
+			break;
+		}
+
+		jx::cpuPause();
+	}
+
+	if (padding >= sizeof(LogFlightRecordHeader)) {
+		LogFlightRecordHeader* padHdr = (LogFlightRecordHeader*)&fr->m_Data[writePos & fr->m_Mask];
+		padHdr->m_Size = padding - sizeof(LogFlightRecordHeader);
+		padHdr->m_Level = 0;
+		padHdr->m_Flags = LogFlightRecordFlags::Padding;
+		padHdr->m_Reserved = 0;
+		bx::writeBarrier();
+		padHdr->m_Pos = writePos;
+	}
+
+	const uint64_t recordPos = writePos + padding;
+	LogFlightRecordHeader* hdr = (LogFlightRecordHeader*)&fr->m_Data[recordPos & fr->m_Mask];
+	hdr->m_Size = lineLen;
+	hdr->m_Level = (uint8_t)level;
+	hdr->m_Flags = 0;
+	hdr->m_Reserved = 0;
+	bx::memCopy(hdr + 1, line, lineLen);
+
+	// Commit the record.
+	bx::writeBarrier();
+	hdr->m_Pos = recordPos;
+}
+
+static void loggerCloseFlightRecorder(Logger* logger)
+{
+	LogFlightRecorder* fr = logger->m_FlightRecorder;
+	if (!fr) {
+		return;
+	}
+
+	logger->m_FlightRecorder = nullptr;
+
+	fsMappedFileClose(fr->m_File);
+	JX_FREE(fr);
+}
+
+static uint32_t loggerAddSinkSlot(Logger* logger, const LogSinkDesc* desc)
+{
+	JX_CHECK(desc->m_WriteFunc != nullptr, "Log sink without a write callback");
+
+#if BX_CONFIG_SUPPORTS_THREADING
+	uint32_t capacity = desc->m_QueueSize != 0 ? desc->m_QueueSize : JX_CONFIG_LOGGER_SINK_QUEUE_SIZE;
+	capacity = bx::max<uint32_t>(capacity, LOGGER_SINK_MIN_QUEUE_SIZE);
+	while (!bx::isPowerOf2<uint32_t>(capacity)) {
+		capacity = (capacity | (capacity - 1)) + 1;
+	}
+
+	const uint32_t totalMem = 0
+		+ loggerAlignSize(sizeof(LogSink), LOGGER_CACHE_LINE_SIZE)
+		+ capacity
+		;
+
+	uint8_t* mem = (uint8_t*)JX_ALIGNED_ALLOC(totalMem, LOGGER_CACHE_LINE_SIZE);
+	if (!mem) {
+		JX_CHECK(false, "Failed to allocate log sink");
+		return UINT32_MAX;
+	}
+
+	bx::memSet(mem, 0, sizeof(LogSink));
+
+	LogSink* sink = (LogSink*)mem;
+	sink->m_Data = mem + loggerAlignSize(sizeof(LogSink), LOGGER_CACHE_LINE_SIZE);
+	sink->m_Capacity = capacity;
+	sink->m_Mask = capacity - 1;
+#else
+	LogSink* sink = (LogSink*)JX_ALLOC(sizeof(LogSink));
+	if (!sink) {
+		JX_CHECK(false, "Failed to allocate log sink");
+		return UINT32_MAX;
+	}
+
+	bx::memSet(sink, 0, sizeof(LogSink));
+#endif
+
+	sink->m_Desc = *desc;
+	sink->m_MinLevel = (uint32_t)desc->m_MinLevel;
+
+#if BX_CONFIG_SUPPORTS_THREADING
+	sink->m_Thread = createThread(getGlobalAllocator(), logSinkThreadFunc, sink, 0, desc->m_Name ? desc->m_Name : "LogSink");
+	if (!sink->m_Thread) {
+		JX_CHECK(false, "Failed to create log sink thread");
+		JX_ALIGNED_FREE(sink, LOGGER_CACHE_LINE_SIZE);
+		return UINT32_MAX;
+	}
+
+	if (logger->m_Mutex) {
+		logger->m_Mutex->lock();
+	}
+#endif
+
+	uint32_t slot = 0;
+	while (slot < JX_CONFIG_LOGGER_MAX_SINKS && logger->m_Sinks[slot] != nullptr) {
+		++slot;
+	}
+
+	if (slot != JX_CONFIG_LOGGER_MAX_SINKS) {
+		logger->m_Sinks[slot] = sink;
+		logger->m_NumSinkSlots = bx::max<uint32_t>(logger->m_NumSinkSlots, slot + 1);
+	}
+
+#if BX_CONFIG_SUPPORTS_THREADING
+	if (logger->m_Mutex) {
+		logger->m_Mutex->unlock();
+	}
+#endif
+
+	if (slot == JX_CONFIG_LOGGER_MAX_SINKS) {
+		JX_CHECK(false, "Too many log sinks. Increase JX_CONFIG_LOGGER_MAX_SINKS");
+
+		// The caller owns the user data if the sink can't be added.
+		sink->m_Desc.m_DestroyFunc = nullptr;
+		loggerRemoveSink(logger, sink);
+		return UINT32_MAX;
+	}
+
+	return slot;
+}
+
+static bool loggerHasSinks(const Logger* logger, LogLevel::Enum level)
+{
+	for (uint32_t i = 0; i < logger->m_NumSinkSlots; ++i) {
+		const LogSink* sink = logger->m_Sinks[i];
+		if (sink && (uint32_t)level >= sink->m_MinLevel) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Called by the thread which writes to the file (with the mutex held if there is one).
+static void loggerPublish(Logger* logger, LogLevel::Enum level, const char* line, uint32_t lineLen, uint32_t textOffset)
+{
+	LogRecord record;
+	record.m_Line = line;
+	record.m_LineLen = lineLen;
+	record.m_TextOffset = textOffset;
+	record.m_Level = level;
+
+	for (uint32_t i = 0; i < logger->m_NumSinkSlots; ++i) {
+		LogSink* sink = logger->m_Sinks[i];
+		if (sink && (uint32_t)level >= sink->m_MinLevel) {
+			logSinkPush(sink, &record);
+		}
+	}
+}
+
+static void logSinkPush(LogSink* sink, const LogRecord* record)
+{
+#if BX_CONFIG_SUPPORTS_THREADING
+	LogRecordHeader hdr;
+	hdr.m_Size = record->m_LineLen + 1;
+	hdr.m_TextOffset = (uint16_t)record->m_TextOffset;
+	hdr.m_Level = (uint8_t)record->m_Level;
+	hdr.m_Flags = 0;
+
+	const uint32_t recordSize = loggerAlignSize(sizeof(LogRecordHeader) + hdr.m_Size, LOGGER_RECORD_ALIGNMENT);
+	const uint64_t writePos = sink->m_WritePos;
+	const uint32_t offset = (uint32_t)(writePos & sink->m_Mask);
+	const uint32_t spaceToEnd = sink->m_Capacity - offset;
+	const uint32_t padding = spaceToEnd < recordSize ? spaceToEnd : 0;
+	const uint64_t endPos = writePos + padding + recordSize;
+
+	// Never wait for a slow sink.
+	const uint64_t readPos = sink->m_ReadPos;
+	if (endPos - readPos > sink->m_Capacity) {
+		bx::atomicFetchAndAdd<uint32_t>(&sink->m_NumDropped, 1);
+		logSinkWakeup(sink);
+		return;
+	}
+
+	if (padding != 0) {
+		LogRecordHeader* padHdr = (LogRecordHeader*)&sink->m_Data[offset];
+		padHdr->m_Size = padding - sizeof(LogRecordHeader);
+		padHdr->m_TextOffset = 0;
+		padHdr->m_Level = 0;
+		padHdr->m_Flags = LogRecordFlags::Padding;
+	}
+
+	uint8_t* dst = &sink->m_Data[(writePos + padding) & sink->m_Mask];
+	bx::memCopy(dst, &hdr, sizeof(LogRecordHeader));
+	bx::memCopy(dst + sizeof(LogRecordHeader), record->m_Line, record->m_LineLen);
+	dst[sizeof(LogRecordHeader) + record->m_LineLen] = '\0';
+
+	bx::writeBarrier();
+	sink->m_WritePos = endPos;
+
+	// The sink thread polls its queue. Wake it up early for errors and before the
+	// queue fills up.
+	if (record->m_Level == LogLevel::Error || endPos - readPos > sink->m_Capacity / 2) {
+		logSinkWakeup(sink);
+	}
+#else
+	// No threads; the record is still null-terminated in the caller's buffer.
+	sink->m_Desc.m_WriteFunc(record, 1, sink->m_Desc.m_UserData);
+#endif
+}
+
+static void logFileSinkWrite(const LogRecord* records, uint32_t numRecords, void* userData)
+{
+	LogFileSink* fileSink = (LogFileSink*)userData;
+
+	// One write per batch (or per LOGGER_FILE_SINK_BUFFER_SIZE bytes).
+	bool flush = false;
+	uint32_t len = 0;
+	for (uint32_t i = 0; i < numRecords; ++i) {
+		const LogRecord* record = &records[i];
+		if (len + record->m_LineLen > LOGGER_FILE_SINK_BUFFER_SIZE) {
+			fsFileWriteBytes(fileSink->m_File, fileSink->m_Buffer, len);
+			len = 0;
+		}
+
+		if (record->m_LineLen > LOGGER_FILE_SINK_BUFFER_SIZE) {
+			fsFileWriteBytes(fileSink->m_File, record->m_Line, record->m_LineLen);
+		} else {
+			bx::memCopy(&fileSink->m_Buffer[len], record->m_Line, record->m_LineLen);
+			len += record->m_LineLen;
+		}
+
+		flush = flush || record->m_Level == LogLevel::Error;
+	}
+
+	if (len != 0) {
+		fsFileWriteBytes(fileSink->m_File, fileSink->m_Buffer, len);
+	}
+
+	if (flush) {
+		fsFileFlush(fileSink->m_File);
+	}
+}
+
+static void logFileSinkDestroy(void* userData)
+{
+	LogFileSink* fileSink = (LogFileSink*)userData;
+	fsFileClose(fileSink->m_File);
+	JX_FREE(fileSink);
+}
+
+static void logStdoutSinkWrite(const LogRecord* records, uint32_t numRecords, void* userData)
+{
+	BX_UNUSED(userData);
+
+	for (uint32_t i = 0; i < numRecords; ++i) {
+		fwrite(records[i].m_Line, 1, records[i].m_LineLen, stdout);
+	}
+
+	fflush(stdout);
+}
+
+static void logMemorySinkWrite(const LogRecord* records, uint32_t numRecords, void* userData)
+{
+	LogMemorySink* memSink = (LogMemorySink*)userData;
+
+#if BX_CONFIG_SUPPORTS_THREADING
+	MutexScope ms(*memSink->m_Mutex);
+#endif
+
+	const uint32_t capacity = memSink->m_Capacity;
+	for (uint32_t i = 0; i < numRecords; ++i) {
+		// Only the end of lines longer than the whole buffer is kept.
+		const uint32_t lineLen = records[i].m_LineLen;
+		const uint32_t len = bx::min<uint32_t>(lineLen, capacity);
+		const char* src = &records[i].m_Line[lineLen - len];
+
+		const uint32_t start = (uint32_t)((memSink->m_WritePos + (lineLen - len)) % capacity);
+		const uint32_t firstPart = bx::min<uint32_t>(len, capacity - start);
+		bx::memCopy(&memSink->m_Data[start], src, firstPart);
+		bx::memCopy(memSink->m_Data, &src[firstPart], len - firstPart);
+
+		memSink->m_WritePos += lineLen;
+	}
+}
+
+static void logMemorySinkDestroy(void* userData)
+{
+	LogMemorySink* memSink = (LogMemorySink*)userData;
+#if BX_CONFIG_SUPPORTS_THREADING
+	JX_DELETE(memSink->m_Mutex);
+#endif
+	JX_FREE(memSink);
+}
+
+static void logCallbackSinkWrite(const LogRecord* records, uint32_t numRecords, void* userData)
+{
+	const LogCallbackSink* cbSink = (const LogCallbackSink*)userData;
+	for (uint32_t i = 0; i < numRecords; ++i) {
+		cbSink->m_Func(records[i].m_Level, &records[i].m_Line[records[i].m_TextOffset], cbSink->m_UserData);
+	}
+}
+
+static void logCallbackSinkDestroy(void* userData)
+{
+	JX_FREE(userData);
+}
+
+#if LOGGER_CONFIG_FILE_OUTPUT
+// Resets the per-file state after switching to a new file and writes the file header
+// (Binary logs).
+static void loggerBeginSegment(Logger* logger)
+{
+	logger->m_SegmentSize = 0;
+	logger->m_SegmentStartCounter = bx::getHPCounter();
+
+#if BX_CONFIG_SUPPORTS_THREADING
+	// Every segment can be decoded on its own.
+	bx::memSet(logger->m_EmittedFormats, 0, sizeof(logger->m_EmittedFormats));
+#endif
+
+	if (logger->m_File && (logger->m_Flags & LoggerFlags::Binary) != 0) {
+		LogFileHeader hdr;
+		hdr.m_Magic = LOGGER_BINARY_MAGIC;
+		hdr.m_Version = LOGGER_BINARY_VERSION;
+		hdr.m_TimerFrequency = logger->m_TimerFrequency;
+		hdr.m_StartCounter = logger->m_StartCounter;
+		hdr.m_StartTime_us = logger->m_StartTime_us;
+		fsFileWriteBytes(logger->m_File, &hdr, sizeof(LogFileHeader));
+	}
+}
+
+// bufferedLen: bytes already written to the current segment but not to the file yet.
+// An empty segment is never rotated, so records larger than the limit still get written.
+static bool loggerShouldRotate(const Logger* logger, uint32_t bufferedLen, uint32_t recordLen)
+{
+	if (!logger->m_Rotating) {
+		return false;
+	}
+
+	const uint64_t segmentSize = logger->m_SegmentSize + bufferedLen;
+	if (segmentSize == 0) {
+		return false;
+	}
+
+	const uint32_t fileHeaderSize = (logger->m_Flags & LoggerFlags::Binary) != 0 ? sizeof(LogFileHeader) : 0;
+
+	const LogRotationDesc& desc = logger->m_Rotation;
+	if (desc.m_MaxSegmentSize != 0 && fileHeaderSize + segmentSize + recordLen > desc.m_MaxSegmentSize) {
+		return true;
+	}
+
+	if (desc.m_MaxSegmentDuration_sec != 0) {
+		const int64_t elapsed = bx::getHPCounter() - logger->m_SegmentStartCounter;
+		if (elapsed >= (int64_t)desc.m_MaxSegmentDuration_sec * logger->m_TimerFrequency) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// The next segment has already been created, so switching only involves closing the
+// current file. Creating and preallocating the following one happens right after the
+// switch, while no record is waiting for it. Sync loggers leave both to the segment
+// thread and only swap the handles here.
+static void loggerRotate(Logger* logger)
+{
+#if BX_CONFIG_SUPPORTS_THREADING
+	if (logger->m_SegmentThread) {
+		{
+			MutexScope ms(*logger->m_SegmentMutex);
+
+			// Keep writing to the current segment until the next one is ready.
+			if (!logger->m_NextFile) {
+				return;
+			}
+
+			JX_CHECK(logger->m_RetiredFile == nullptr, "Previous log segment hasn't been closed");
+			logger->m_RetiredFile = logger->m_File;
+			logger->m_File = logger->m_NextFile;
+			logger->m_NextFile = nullptr;
+			++logger->m_SegmentID;
+		}
+
+		threadInQueuePush(logger->m_SegmentThread, kMsgWakeup, nullptr, 0);
+
+		loggerGetSegmentFilename(logger, logger->m_SegmentID, logger->m_Filename, LOGGER_MAX_FILENAME_LENGTH);
+		loggerBeginSegment(logger);
+		return;
+	}
+#endif
+
+	File* prevFile = logger->m_File;
+	File* nextFile = logger->m_NextFile;
+	logger->m_NextFile = nullptr;
+	if (!nextFile) {
+		// Preparing the segment failed; try again.
+		nextFile = loggerOpenSegment(logger, logger->m_SegmentID + 1);
+		JX_WARN(nextFile != nullptr, "Failed to open log segment %u", logger->m_SegmentID + 1);
+	}
+
+#if BX_CONFIG_SUPPORTS_THREADING
+	// The async writer doesn't hold the mutex otherwise.
+	if (logger->m_Mutex) {
+		logger->m_Mutex->lock();
+	}
+#endif
+
+	++logger->m_SegmentID;
+	loggerGetSegmentFilename(logger, logger->m_SegmentID, logger->m_Filename, LOGGER_MAX_FILENAME_LENGTH);
+	logger->m_File = nextFile;
+
+#if BX_CONFIG_SUPPORTS_THREADING
+	if (logger->m_Mutex) {
+		logger->m_Mutex->unlock();
+	}
+#endif
+
+	if (prevFile) {
+		fsFileClose(prevFile);
+	}
+
+	loggerBeginSegment(logger);
+	loggerPrepareNextSegment(logger);
+	loggerRemoveOldSegments(logger, logger->m_SegmentID);
+}
+
+static File* loggerOpenSegment(Logger* logger, uint32_t segmentID)
+{
+	char filename[LOGGER_MAX_FILENAME_LENGTH];
+	loggerGetSegmentFilename(logger, segmentID, filename, LOGGER_MAX_FILENAME_LENGTH);
+
+	File* f = fsFileOpenWrite(logger->m_BaseDir, filename);
+	if (f && logger->m_Rotation.m_PreallocSize != 0) {
+		// Not fatal; writes will allocate blocks as usual.
+		const bool reserved = fsFileReserve(f, logger->m_Rotation.m_PreallocSize);
+		JX_WARN(reserved, "Failed to preallocate log segment %s", filename);
+		BX_UNUSED(reserved);
+	}
+
+	return f;
+}
+
+static void loggerPrepareNextSegment(Logger* logger)
+{
+	if (!logger->m_NextFile) {
+		logger->m_NextFile = loggerOpenSegment(logger, logger->m_SegmentID + 1);
+	}
+}
+
+// segmentID: the current segment, which counts towards the limit.
+static void loggerRemoveOldSegments(Logger* logger, uint32_t segmentID)
+{
+	const uint32_t maxSegments = logger->m_Rotation.m_MaxSegments;
+	if (maxSegments == 0) {
+		return;
+	}
+
+	while (segmentID - logger->m_OldestSegmentID >= maxSegments) {
+		char filename[LOGGER_MAX_FILENAME_LENGTH];
+		loggerGetSegmentFilename(logger, logger->m_OldestSegmentID, filename, LOGGER_MAX_FILENAME_LENGTH);
+		fsRemoveFile(logger->m_BaseDir, filename);
+
+		++logger->m_OldestSegmentID;
+	}
+}
+
+struct LogSegmentScan
+{
+	const char* m_Prefix; // "<name>."
+	const char* m_Ext;
+	uint32_t m_PrefixLen;
+	uint32_t m_MinID;
+	uint32_t m_MaxID;
+	bool m_Found;
+};
+
+static void loggerScanSegmentCallback(const char* relPath, bool isFile, void* userData)
+{
+	LogSegmentScan* scan = (LogSegmentScan*)userData;
+	if (!isFile || bx::strCmp(relPath, scan->m_Prefix, scan->m_PrefixLen) != 0) {
+		return;
+	}
+
+	const char* ptr = &relPath[scan->m_PrefixLen];
+	uint32_t segmentID = 0;
+	uint32_t numDigits = 0;
+	while (*ptr >= '0' && *ptr <= '9' && numDigits < 9) {
+		segmentID = segmentID * 10 + (uint32_t)(*ptr - '0');
+		++numDigits;
+		++ptr;
+	}
+
+	if (numDigits == 0 || bx::strCmp(ptr, scan->m_Ext) != 0) {
+		return;
+	}
+
+	scan->m_MinID = scan->m_Found ? bx::min<uint32_t>(scan->m_MinID, segmentID) : segmentID;
+	scan->m_MaxID = scan->m_Found ? bx::max<uint32_t>(scan->m_MaxID, segmentID) : segmentID;
+	scan->m_Found = true;
+}
+
+// Continues the numbering of the segments written by previous runs, so they are
+// never overwritten and count towards the retention limit.
+static void loggerFindSegments(Logger* logger)
+{
+	const char* name = logger->m_Name;
+	const bx::StringView lastSlash = bx::strRFind(name, '/');
+	const char* filename = lastSlash.isEmpty() ? name : lastSlash.getPtr() + 1;
+
+	char pattern[LOGGER_MAX_FILENAME_LENGTH];
+	if (lastSlash.isEmpty()) {
+		bx::snprintf(pattern, LOGGER_MAX_FILENAME_LENGTH, "./*");
+	} else {
+		bx::snprintf(pattern, LOGGER_MAX_FILENAME_LENGTH, "%.*s/*", (int)(lastSlash.getPtr() - name), name);
+	}
+
+	char prefix[LOGGER_MAX_FILENAME_LENGTH];
+	bx::snprintf(prefix, LOGGER_MAX_FILENAME_LENGTH, "%s.", filename);
+
+	LogSegmentScan scan;
+	scan.m_Prefix = prefix;
+	scan.m_Ext = (logger->m_Flags & LoggerFlags::Binary) != 0 ? ".jxlog" : ".log";
+	scan.m_PrefixLen = bx::strLen(prefix);
+	scan.m_MinID = 0;
+	scan.m_MaxID = 0;
+	scan.m_Found = false;
+	fsEnumerateFiles(logger->m_BaseDir, pattern, loggerScanSegmentCallback, &scan);
+
+	logger->m_SegmentID = scan.m_Found ? scan.m_MaxID + 1 : 0;
+	logger->m_OldestSegmentID = scan.m_Found ? scan.m_MinID : 0;
+}
+
+static void loggerGetSegmentFilename(const Logger* logger, uint32_t segmentID, char* buffer, uint32_t maxLen)
+{
+	const bool binary = (logger->m_Flags & LoggerFlags::Binary) != 0;
+	bx::snprintf(buffer, maxLen, binary ? "%s.%06u.jxlog" : "%s.%06u.log", logger->m_Name, segmentID);
+}
+
+#if BX_CONFIG_SUPPORTS_THREADING
+// Woken up after every rotation. Preparing the next segment is retried periodically if
+// it failed.
+static int32_t loggerSegmentThreadFunc(Thread* self, void* userData)
+{
+	Logger* logger = (Logger*)userData;
+
+	bool quit = false;
+	while (!quit) {
+		ThreadMessage* msg = threadInQueuePop(self, LOGGER_SEGMENT_RETRY_MSEC);
+		if (msg) {
+			quit = msg->m_MsgID == kMsgQuit;
+			threadReleaseMessage(self, msg);
+		}
+
+		File* retiredFile;
+		uint32_t segmentID;
+		bool prepare;
+		{
+			MutexScope ms(*logger->m_SegmentMutex);
+			retiredFile = logger->m_RetiredFile;
+			logger->m_RetiredFile = nullptr;
+			segmentID = logger->m_SegmentID;
+			prepare = !quit && !logger->m_NextFile;
+		}
+
+		if (retiredFile) {
+			fsFileClose(retiredFile);
+		}
+
+		// The logger can't rotate before m_NextFile is set, so segmentID stays current.
+		if (prepare) {
+			File* nextFile = loggerOpenSegment(logger, segmentID + 1);
+
+			MutexScope ms(*logger->m_SegmentMutex);
+			logger->m_NextFile = nextFile;
+		}
+
+		loggerRemoveOldSegments(logger, segmentID);
+	}
+
+	return 0;
+}
+#endif
+#endif // LOGGER_CONFIG_FILE_OUTPUT
+
+struct LogArg
+{
+	LogArgType::Enum m_Type;
+	union
+	{
+		int32_t m_Int32;
+		uint32_t m_UInt32;
+		int64_t m_Int64;
+		uint64_t m_UInt64;
+		double m_Double;
+		const char* m_String;
+	};
+};
+
+static bool logReadArg(const uint8_t* args, uint32_t argsSize, uint32_t* offset, LogArg* arg)
+{
+	uint32_t pos = *offset;
+	if (pos >= argsSize) {
+		return false;
+	}
+
+	arg->m_Type = (LogArgType::Enum)args[pos++];
+
+	uint32_t sz = 0;
+	switch (arg->m_Type) {
+	case LogArgType::Int32:
+	case LogArgType::UInt32:
+		sz = sizeof(uint32_t);
+		break;
+	case LogArgType::Int64:
+	case LogArgType::UInt64:
+	case LogArgType::Double:
+	case LogArgType::Pointer:
+		sz = sizeof(uint64_t);
+		break;
+	case LogArgType::String:
+	{
+		uint16_t strSize;
+		if (pos + sizeof(uint16_t) > argsSize) {
+			return false;
+		}
+		bx::memCopy(&strSize, &args[pos], sizeof(uint16_t));
+		pos += sizeof(uint16_t);
+
+		if (strSize == 0 || pos + strSize > argsSize || args[pos + strSize - 1] != '\0') {
+			return false;
+		}
+
+		arg->m_String = (const char*)&args[pos];
+		*offset = pos + strSize;
+		return true;
+	}
+	default:
+		return false;
+	}
+
+	if (pos + sz > argsSize) {
+		return false;
+	}
+
+	bx::memCopy(&arg->m_UInt64, &args[pos], sz);
+	*offset = pos + sz;
+
+	return true;
+}
+
+template<typename T>
+static int32_t logFormatArg(char* buffer, uint32_t maxLen, const char* spec, const int32_t* stars, uint32_t numStars, T value)
+{
+	switch (numStars) {
+	case 0:  return bx::snprintf(buffer, maxLen, spec, value);
+	case 1:  return bx::snprintf(buffer, maxLen, spec, stars[0], value);
+	default: return bx::snprintf(buffer, maxLen, spec, stars[0], stars[1], value);
+	}
+}
+
+// Formats a deferred record. Every conversion is checked against the type of the stored
+// argument and its length modifier is replaced with the one matching the stored value,
+// so a mismatched or truncated argument list can't read garbage. Conversions which can't
+// be formatted are copied as-is.
+static uint32_t logFormatDeferred(char* buffer, uint32_t maxLen, const char* fmt, const uint8_t* args, uint32_t argsSize)
+{
+	uint32_t len = 0;
+	uint32_t argOffset = 0;
+
+	const char* ptr = fmt;
+	while (*ptr != '\0' && len < maxLen - 1) {
+		if (*ptr != '%') {
+			buffer[len++] = *ptr++;
+			continue;
+		}
+
+		if (ptr[1] == '%') {
+			buffer[len++] = '%';
+			ptr += 2;
+			continue;
+		}
+
+		// %[flags][width][.precision][length]conversion
+		const char* specStart = ptr++;
+		char spec[LOGGER_MAX_SPEC_LENGTH];
+		uint32_t specLen = 0;
+		spec[specLen++] = '%';
+
+		int32_t stars[2];
+		uint32_t numStars = 0;
+		bool valid = true;
+
+		while (*ptr == '-' || *ptr == '+' || *ptr == ' ' || *ptr == '#' || *ptr == '0') {
+			if (specLen < LOGGER_MAX_SPEC_LENGTH - 8) {
+				spec[specLen++] = *ptr;
+			}
+			++ptr;
+		}
+
+		for (uint32_t part = 0; part < 2; ++part) {
+			if (part == 1) {
+				if (*ptr != '.') {
+					break;
+				}
+
+				spec[specLen++] = *ptr++;
+			}
+
+			if (*ptr == '*') {
+				LogArg starArg;
+				if (logReadArg(args, argsSize, &argOffset, &starArg) && (starArg.m_Type == LogArgType::Int32 || starArg.m_Type == LogArgType::UInt32)) {
+					stars[numStars++] = starArg.m_Int32;
+				} else {
+					valid = false;
+				}
+
+				spec[specLen++] = *ptr++;
+			} else {
+				while (*ptr >= '0' && *ptr <= '9') {
+					if (specLen < LOGGER_MAX_SPEC_LENGTH - 8) {
+						spec[specLen++] = *ptr;
+					}
+					++ptr;
+				}
+			}
+		}
+
+		// The length modifier is derived from the argument type.
+		while (*ptr == 'h' || *ptr == 'l' || *ptr == 'L' || *ptr == 'q' || *ptr == 'j' || *ptr == 'z' || *ptr == 't') {
+			++ptr;
+		}
+
+		const char conversion = *ptr;
+		if (conversion == '\0') {
+			break;
+		}
+		++ptr;
+
+		LogArg arg;
+		valid = valid && logReadArg(args, argsSize, &argOffset, &arg);
+
+		int32_t n = -1;
+		if (valid) {
+			switch (conversion) {
+			case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+				if (arg.m_Type == LogArgType::Int32 || arg.m_Type == LogArgType::UInt32) {
+					spec[specLen++] = conversion;
+					spec[specLen] = '\0';
+					n = logFormatArg(&buffer[len], maxLen - len, spec, stars, numStars, arg.m_Int32);
+				} else if (arg.m_Type == LogArgType::Int64 || arg.m_Type == LogArgType::UInt64) {
+					spec[specLen++] = 'l';
+					spec[specLen++] = 'l';
+					spec[specLen++] = conversion;
+					spec[specLen] = '\0';
+					n = logFormatArg(&buffer[len], maxLen - len, spec, stars, numStars, (long long)arg.m_Int64);
+				}
+				break;
+			case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+				if (arg.m_Type == LogArgType::Double) {
+					spec[specLen++] = conversion;
+					spec[specLen] = '\0';
+					n = logFormatArg(&buffer[len], maxLen - len, spec, stars, numStars, arg.m_Double);
+				}
+				break;
+			case 's':
+				if (arg.m_Type == LogArgType::String) {
+					spec[specLen++] = conversion;
+					spec[specLen] = '\0';
+					n = logFormatArg(&buffer[len], maxLen - len, spec, stars, numStars, arg.m_String);
+				}
+				break;
+			case 'p':
+				if (arg.m_Type == LogArgType::Pointer) {
+					spec[specLen++] = conversion;
+					spec[specLen] = '\0';
+					n = logFormatArg(&buffer[len], maxLen - len, spec, stars, numStars, (const void*)(uintptr_t)arg.m_UInt64);
+				}
+				break;
+			default:
+				break;
+			}
+		}
+
+		if (n >= 0) {
+			len += bx::min<uint32_t>((uint32_t)n, maxLen - len - 1);
+		} else {
+			while (specStart != ptr && len < maxLen - 1) {
+				buffer[len++] = *specStart++;
+			}
+		}
+	}
+
+	buffer[len] = '\0';
+
+	return len;
+}
+
+#if BX_CONFIG_SUPPORTS_THREADING
+static void loggerAsyncLog(Logger* logger, LogLevel::Enum level, const char* fmt, va_list argList)
+{
+	LogThreadBuffer* tb = loggerGetThreadBuffer(logger);
+	if (!tb) {
+		return;
+	}
+
+	char line[LOGGER_MAX_PREFIX_LENGTH + LOGGER_MAX_LINE_LENGTH];
+	const int64_t time_us = loggerGetTime_us(logger, bx::getHPCounter());
+	const uint32_t prefixLen = logFormatPrefix(&tb->m_TimeCache, logger->m_Flags, level, time_us, line, LOGGER_MAX_PREFIX_LENGTH);
+	const int textLen = bx::vsnprintf(&line[prefixLen], LOGGER_MAX_LINE_LENGTH, fmt, argList);
+
+	LogRecordHeader hdr;
+	hdr.m_Size = prefixLen + (uint32_t)bx::clamp<int>(textLen, 0, LOGGER_MAX_LINE_LENGTH - 1) + 1;
+	hdr.m_TextOffset = (uint16_t)prefixLen;
+	hdr.m_Level = (uint8_t)level;
+	hdr.m_Flags = 0;
+	line[hdr.m_Size - 1] = '\0';
+
+	loggerFlightRecorderWrite(logger, level, line, hdr.m_Size - 1);
+
+	uint8_t* payload = ltbBeginWrite(logger, tb, &hdr);
+	bx::memCopy(payload, line, hdr.m_Size);
+	ltbEndWrite(tb);
+
+	if (level == LogLevel::Error) {
+		loggerWakeupWriter(logger);
+	}
+}
+
+static LogThreadBuffer* loggerGetThreadBuffer(Logger* logger)
+{
+	LogThreadBuffer* tb = (LogThreadBuffer*)logger->m_ThreadBufferTLS->get();
+	if (tb) {
+		return tb;
+	}
+
+	const uint32_t capacity = JX_CONFIG_LOGGER_THREAD_BUFFER_SIZE;
+	JX_CHECK(bx::isPowerOf2<uint32_t>(capacity), "Logger thread buffer size must be a power of 2");
+
+	const uint32_t totalMem = 0
+		+ loggerAlignSize(sizeof(LogThreadBuffer), LOGGER_CACHE_LINE_SIZE)
+		+ capacity
+		;
+
+	uint8_t* mem = (uint8_t*)JX_ALIGNED_ALLOC(totalMem, LOGGER_CACHE_LINE_SIZE);
+	if (!mem) {
+		JX_CHECK(false, "Failed to allocate logger thread buffer");
+		return nullptr;
+	}
+
+	bx::memSet(mem, 0, sizeof(LogThreadBuffer));
+
+	tb = (LogThreadBuffer*)mem;
+	tb->m_Data = mem + loggerAlignSize(sizeof(LogThreadBuffer), LOGGER_CACHE_LINE_SIZE);
+	tb->m_Capacity = capacity;
+	tb->m_Mask = capacity - 1;
+	logTimeCacheInit(&tb->m_TimeCache);
+
+	// The writer walks the list without locking; the new buffer must be fully initialized
+	// before it becomes reachable. Only other new threads can contend for the lock, and only
+	// for a couple of stores.
+	while (logger->m_ThreadBufferLock != 0 || bx::atomicCompareAndSwap<int32_t>(&logger->m_ThreadBufferLock, 0, 1) != 0) {
+		jx::cpuPause();
+	}
+
+	tb->m_Next = logger->m_ThreadBuffers;
+	bx::writeBarrier();
+	logger->m_ThreadBuffers = tb;
+
+	bx::memoryBarrier();
+	logger->m_ThreadBufferLock = 0;
+
+	logger->m_ThreadBufferTLS->set(tb);
+
+	return tb;
+}
+
+static void loggerWakeupWriter(Logger* logger)
+{
+	// Only one wakeup message can be in flight.
+	if (bx::atomicCompareAndSwap<int32_t>(&logger->m_WakeupPending, 0, 1) == 0) {
+		threadInQueuePush(logger->m_WriterThread, kMsgWakeup, nullptr, 0);
+	}
+}
+
+// Runs on the writer thread without holding the mutex, so file I/O never blocks new
+// threads, sink changes or loggerGetFilename(). The mutex is only taken around the sink
+// accesses and the file switch.
+static void loggerDrain(Logger* logger, bool final)
+{
+	bool flush = (logger->m_Flags & LoggerFlags::FlushOnEveryLog) != 0;
+
+	LogThreadBuffer* tb = logger->m_ThreadBuffers;
+	while (tb) {
+		const uint64_t writePos = tb->m_WritePos;
+		bx::readBarrier();
+
+		uint64_t readPos = tb->m_ReadPos;
+		while (readPos != writePos) {
+			const uint8_t* record = &tb->m_Data[readPos & tb->m_Mask];
+			const LogRecordHeader* hdr = (const LogRecordHeader*)record;
+			readPos += loggerAlignSize(sizeof(LogRecordHeader) + hdr->m_Size, LOGGER_RECORD_ALIGNMENT);
+
+			if ((hdr->m_Flags & LogRecordFlags::Padding) != 0) {
+				continue;
+			}
+
+			const LogLevel::Enum level = (LogLevel::Enum)hdr->m_Level;
+			flush = flush || level == LogLevel::Error;
+
+			const uint8_t* payload = record + sizeof(LogRecordHeader);
+			if ((hdr->m_Flags & LogRecordFlags::Deferred) != 0) {
+				loggerWriteDeferred(logger, level, payload, hdr->m_Size);
+			} else {
+				loggerWriteText(logger, level, (const char*)payload, hdr->m_Size - 1, hdr->m_TextOffset);
+			}
+		}
+
+		// Make sure all records have been copied before handing the space back to the producer.
+		bx::memoryBarrier();
+		tb->m_ReadPos = readPos;
+
+		tb = tb->m_Next;
+	}
+
+	if (logger->m_RateLimiter) {
+		loggerWriteSuppressed(logger, final);
+	}
+
+	loggerWriterFlush(logger, flush || final);
+}
+
+// Reports storms which have ended. Those which are still going on are reported by
+// loggerCheckRateLimit().
+static void loggerWriteSuppressed(Logger* logger, bool force)
+{
+	LogRateLimiter* rl = logger->m_RateLimiter;
+
+	const int64_t now = bx::getHPCounter();
+	if (!force && now - rl->m_LastScan < rl->m_SummaryInterval) {
+		return;
+	}
+	rl->m_LastScan = now;
+
+	for (uint32_t i = 0; i < JX_CONFIG_LOGGER_RATE_LIMIT_SITES; ++i) {
+		LogRateSlot* slot = &rl->m_Slots[i];
+
+		LogLevel::Enum level;
+		const uint32_t numSuppressed = loggerTakeSuppressed(rl, slot, now, force, &level);
+		if (numSuppressed == 0) {
+			continue;
+		}
+
+		char line[LOGGER_MAX_PREFIX_LENGTH + LOGGER_MAX_LINE_LENGTH];
+		const uint32_t prefixLen = logFormatPrefix(&logger->m_WriterTimeCache, logger->m_Flags, level, loggerGetTime_us(logger, now), line, LOGGER_MAX_PREFIX_LENGTH);
+		const uint32_t textLen = logFormatSuppressed(&line[prefixLen], LOGGER_MAX_LINE_LENGTH, slot->m_Site, numSuppressed);
+		loggerWriteText(logger, level, line, prefixLen + textLen, prefixLen);
+	}
+}
+
+static void loggerWriteText(Logger* logger, LogLevel::Enum level, const char* line, uint32_t lineLen, uint32_t textOffset)
+{
+	const bool binary = (logger->m_Flags & LoggerFlags::Binary) != 0;
+	loggerWriterBeginRecord(logger, lineLen + (binary ? sizeof(LogFileRecordHeader) : 0));
+
+	if (binary) {
+		LogFileRecordHeader fileHdr;
+		fileHdr.m_Type = LogFileRecordType::Text;
+		fileHdr.m_Level = (uint8_t)level;
+		fileHdr.m_Reserved = 0;
+		fileHdr.m_Size = lineLen;
+		loggerWriterAppend(logger, &fileHdr, sizeof(LogFileRecordHeader));
+	}
+
+	loggerWriterAppend(logger, line, lineLen);
+	loggerWriterPublish(logger, level, line, lineLen, textOffset);
+}
+
+static void loggerWriteDeferred(Logger* logger, LogLevel::Enum level, const uint8_t* payload, uint32_t size)
+{
+	int64_t timestamp;
+	uint32_t fmtID;
+	bx::memCopy(&timestamp, &payload[0], sizeof(int64_t));
+	bx::memCopy(&fmtID, &payload[sizeof(int64_t)], sizeof(uint32_t));
+	const char* fmt = loggerGetFormat(fmtID);
+
+	if ((logger->m_Flags & LoggerFlags::Binary) != 0) {
+		// The format record must end up in the same segment as the message. Starting a new
+		// segment clears the emitted formats, so check the mask after the rotation.
+		const uint32_t fmtLen = bx::strLen(fmt);
+		const uint32_t fmtBit = 1u << (fmtID & 31);
+		const uint32_t fmtRecordSize = (logger->m_EmittedFormats[fmtID >> 5] & fmtBit) == 0
+			? sizeof(LogFileRecordHeader) + sizeof(uint32_t) + fmtLen
+			: 0
+			;
+		loggerWriterBeginRecord(logger, fmtRecordSize + sizeof(LogFileRecordHeader) + size);
+
+		uint32_t& emittedMask = logger->m_EmittedFormats[fmtID >> 5];
+		if ((emittedMask & fmtBit) == 0) {
+			LogFileRecordHeader fmtHdr;
+			fmtHdr.m_Type = LogFileRecordType::Format;
+			fmtHdr.m_Level = 0;
+			fmtHdr.m_Reserved = 0;
+			fmtHdr.m_Size = sizeof(uint32_t) + fmtLen;
+			loggerWriterAppend(logger, &fmtHdr, sizeof(LogFileRecordHeader));
+			loggerWriterAppend(logger, &fmtID, sizeof(uint32_t));
+			loggerWriterAppend(logger, fmt, fmtLen);
+
+			emittedMask |= fmtBit;
+		}
+
+		LogFileRecordHeader msgHdr;
+		msgHdr.m_Type = LogFileRecordType::Message;
+		msgHdr.m_Level = (uint8_t)level;
+		msgHdr.m_Reserved = 0;
+		msgHdr.m_Size = size;
+		loggerWriterAppend(logger, &msgHdr, sizeof(LogFileRecordHeader));
+		loggerWriterAppend(logger, payload, size);
+
+		// Only format the message if someone is going to see it.
+		if (!loggerWriterHasSinks(logger, level)) {
+			return;
+		}
+	}
+
+	// The timestamp is the time the record was logged, not the time it was formatted.
+	char line[LOGGER_MAX_PREFIX_LENGTH + LOGGER_MAX_LINE_LENGTH];
+	const int64_t time_us = loggerGetTime_us(logger, timestamp);
+	const uint32_t prefixLen = logFormatPrefix(&logger->m_WriterTimeCache, logger->m_Flags, level, time_us, line, LOGGER_MAX_PREFIX_LENGTH);
+	const uint32_t textLen = logFormatDeferred(&line[prefixLen], LOGGER_MAX_LINE_LENGTH, fmt, &payload[LOGGER_DEFERRED_HEADER_SIZE], size - LOGGER_DEFERRED_HEADER_SIZE);
+
+	if ((logger->m_Flags & LoggerFlags::Binary) != 0) {
+		loggerWriterPublish(logger, level, line, prefixLen + textLen, prefixLen);
+	} else {
+		loggerWriteText(logger, level, line, prefixLen + textLen, prefixLen);
+	}
+}
+
+// The mutex keeps loggerRemoveSink() from freeing a sink while the writer pushes to it.
+static bool loggerWriterHasSinks(Logger* logger, LogLevel::Enum level)
+{
+	MutexScope ms(*logger->m_Mutex);
+	return loggerHasSinks(logger, level);
+}
+
+static void loggerWriterPublish(Logger* logger, LogLevel::Enum level, const char* line, uint32_t lineLen, uint32_t textOffset)
+{
+	MutexScope ms(*logger->m_Mutex);
+	loggerPublish(logger, level, line, lineLen, textOffset);
+}
+
+// Called before the first append of every file record, so a record never straddles two
+// segments.
+static void loggerWriterBeginRecord(Logger* logger, uint32_t len)
+{
+#if LOGGER_CONFIG_FILE_OUTPUT
+	if (loggerShouldRotate(logger, logger->m_WriteBufferLen, len)) {
+		loggerWriterFlush(logger, false);
+		loggerRotate(logger);
+	}
+#else
+	BX_UNUSED(logger, len);
+#endif
+}
+
+static void loggerWriterAppend(Logger* logger, const void* data, uint32_t len)
+{
+#if LOGGER_CONFIG_FILE_OUTPUT
+	if (!logger->m_File) {
+		return;
+	}
+
+	if (logger->m_WriteBufferLen + len > LOGGER_WRITE_BUFFER_SIZE) {
+		fsFileWriteBytes(logger->m_File, logger->m_WriteBuffer, logger->m_WriteBufferLen);
+		logger->m_SegmentSize += logger->m_WriteBufferLen;
+		logger->m_WriteBufferLen = 0;
+	}
+
+	bx::memCopy(&logger->m_WriteBuffer[logger->m_WriteBufferLen], data, len);
+	logger->m_WriteBufferLen += len;
+#else
+	printf("%.*s", (int)len, (const char*)data);
+#endif
+}
+
+static void loggerWriterFlush(Logger* logger, bool flushFile)
+{
+#if LOGGER_CONFIG_FILE_OUTPUT
+	if (!logger->m_File) {
+		return;
+	}
+
+	if (logger->m_WriteBufferLen != 0) {
+		fsFileWriteBytes(logger->m_File, logger->m_WriteBuffer, logger->m_WriteBufferLen);
+		logger->m_SegmentSize += logger->m_WriteBufferLen;
+		logger->m_WriteBufferLen = 0;
+	}
+
+	if (flushFile) {
+		fsFileFlush(logger->m_File);
+	}
+#else
+	BX_UNUSED(logger, flushFile);
+#endif
+}
+
+static int32_t loggerWriterThreadFunc(Thread* self, void* userData)
+{
+	Logger* logger = (Logger*)userData;
+
+	// Records are collected periodically. Producers only wake the writer up early for
+	// Error records and when a thread buffer is full.
+	bool quit = false;
+	while (!quit) {
+		ThreadMessage* msg = threadInQueuePop(self, LOGGER_WRITER_INTERVAL_MSEC);
+		if (msg) {
+			if (msg->m_MsgID == kMsgQuit) {
+				quit = true;
+			} else if (msg->m_MsgID == kMsgWakeup) {
+				logger->m_WakeupPending = 0;
+			}
+
+			threadReleaseMessage(self, msg);
+		}
+
+		loggerDrain(logger, quit);
+	}
+
+	return 0;
+}
+
+// Reserves space for the record, writes its header and returns a pointer to its payload.
+// Call ltbEndWrite() after filling in the payload to publish the record.
+static uint8_t* ltbBeginWrite(Logger* logger, LogThreadBuffer* tb, const LogRecordHeader* hdr)
+{
+	const uint32_t recordSize = loggerAlignSize(sizeof(LogRecordHeader) + hdr->m_Size, LOGGER_RECORD_ALIGNMENT);
+	const uint64_t writePos = tb->m_WritePos;
+	const uint32_t offset = (uint32_t)(writePos & tb->m_Mask);
+	const uint32_t spaceToEnd = tb->m_Capacity - offset;
+	const uint32_t padding = spaceToEnd < recordSize ? spaceToEnd : 0;
+	const uint64_t endPos = writePos + padding + recordSize;
+
+	// Wait for the writer to make room. Records are never dropped, so the order of the
+	// thread's records is preserved.
+	while (endPos - tb->m_CachedReadPos > tb->m_Capacity) {
+		tb->m_CachedReadPos = tb->m_ReadPos;
+		if (endPos - tb->m_CachedReadPos <= tb->m_Capacity) {
+			break;
+		}
+
+		loggerWakeupWriter(logger);
+		bx::yield();
+	}
+
+	if (padding != 0) {
+		LogRecordHeader* padHdr = (LogRecordHeader*)&tb->m_Data[offset];
+		padHdr->m_Size = padding - sizeof(LogRecordHeader);
+		padHdr->m_TextOffset = 0;
+		padHdr->m_Level = 0;
+		padHdr->m_Flags = LogRecordFlags::Padding;
+	}
+
+	uint8_t* dst = &tb->m_Data[(writePos + padding) & tb->m_Mask];
+	bx::memCopy(dst, hdr, sizeof(LogRecordHeader));
+	tb->m_PendingWritePos = endPos;
+
+	return dst + sizeof(LogRecordHeader);
+}
+
+static void ltbEndWrite(LogThreadBuffer* tb)
+{
+	// Publish the record.
+	bx::writeBarrier();
+	tb->m_WritePos = tb->m_PendingWritePos;
+}
+
+static void logSinkWakeup(LogSink* sink)
+{
+	if (bx::atomicCompareAndSwap<int32_t>(&sink->m_WakeupPending, 0, 1) == 0) {
+		threadInQueuePush(sink->m_Thread, kMsgWakeup, nullptr, 0);
+	}
+}
+
+static void logSinkProcess(LogSink* sink)
+{
+	const LogSinkDesc& desc = sink->m_Desc;
+
+	LogRecord batch[LOGGER_SINK_MAX_BATCH];
+	uint32_t numRecords = 0;
+
+	// Let the sink know about the records it missed before giving it the next ones.
+	char droppedLine[64];
+	const uint32_t numDropped = sink->m_NumDropped;
+	if (numDropped != sink->m_NumDroppedReported) {
+		LogRecord* record = &batch[numRecords++];
+		record->m_Line = droppedLine;
+		record->m_LineLen = (uint32_t)bx::clamp<int>(bx::snprintf(droppedLine, BX_COUNTOF(droppedLine), "%sDropped %u records\n", loggerGetLevelSymbol(LogLevel::Warning), numDropped - sink->m_NumDroppedReported), 0, BX_COUNTOF(droppedLine) - 1);
+		record->m_TextOffset = 4;
+		record->m_Level = LogLevel::Warning;
+		sink->m_NumDroppedReported = numDropped;
+	}
+
+	const uint64_t writePos = sink->m_WritePos;
+	bx::readBarrier();
+
+	uint64_t readPos = sink->m_ReadPos;
+	while (readPos != writePos) {
+		const uint8_t* data = &sink->m_Data[readPos & sink->m_Mask];
+		const LogRecordHeader* hdr = (const LogRecordHeader*)data;
+		readPos += loggerAlignSize(sizeof(LogRecordHeader) + hdr->m_Size, LOGGER_RECORD_ALIGNMENT);
+
+		if ((hdr->m_Flags & LogRecordFlags::Padding) != 0) {
+			continue;
+		}
+
+		LogRecord* record = &batch[numRecords++];
+		record->m_Line = (const char*)(data + sizeof(LogRecordHeader));
+		record->m_LineLen = hdr->m_Size - 1;
+		record->m_TextOffset = hdr->m_TextOffset;
+		record->m_Level = (LogLevel::Enum)hdr->m_Level;
+
+		if (numRecords == LOGGER_SINK_MAX_BATCH) {
+			desc.m_WriteFunc(batch, numRecords, desc.m_UserData);
+			numRecords = 0;
+
+			// The records have been consumed; hand the space back to the producer.
+			bx::memoryBarrier();
+			sink->m_ReadPos = readPos;
+		}
+	}
+
+	if (numRecords != 0) {
+		desc.m_WriteFunc(batch, numRecords, desc.m_UserData);
+	}
+
+	bx::memoryBarrier();
+	sink->m_ReadPos = readPos;
+}
+
+static int32_t logSinkThreadFunc(Thread* self, void* userData)
+{
+	LogSink* sink = (LogSink*)userData;
+
+	bool quit = false;
+	while (!quit) {
+		ThreadMessage* msg = threadInQueuePop(self, LOGGER_WRITER_INTERVAL_MSEC);
+		if (msg) {
+			if (msg->m_MsgID == kMsgQuit) {
+				quit = true;
+			} else if (msg->m_MsgID == kMsgWakeup) {
+				sink->m_WakeupPending = 0;
+			}
+
+			threadReleaseMessage(self, msg);
+		}
+
+		logSinkProcess(sink);
+	}
+
+	if (sink->m_Desc.m_DestroyFunc) {
+		sink->m_Desc.m_DestroyFunc(sink->m_Desc.m_UserData);
+	}
+
+	return 0;
+}
+#endif
 }
@@ -1,4 +1,5 @@
 #include <jx/math.h>
+#include <jx/worker_pool.h>
 #include <bx/allocator.h>
 
 namespace jx
@@ -155,6 +156,49 @@ void interp1d(const double* x, const double* y, uint32_t n, const double* xq, do
 	interp1<double>(x, y, n, xq, yq, nq);
 }
 
+// Queries per parallel range. Multiple of a cache line worth of floats and doubles so
+// workers never write to the same cache line of yq.
+static const uint32_t kInterp1ParallelGranularity = 1024;
+
+template<typename T>
+struct Interp1Job
+{
+	const T* m_X;
+	const T* m_Y;
+	const T* m_XQ;
+	T* m_YQ;
+	uint32_t m_N;
+};
+
+template<typename T>
+static void interp1Range(uint32_t first, uint32_t last, void* userData)
+{
+	const Interp1Job<T>* job = (const Interp1Job<T>*)userData;
+	interp1<T>(job->m_X, job->m_Y, job->m_N, job->m_XQ + first, job->m_YQ + first, last - first);
+}
+
+template<typename T>
+static void interp1Parallel(WorkerPool* pool, const T* x, const T* y, uint32_t n, const T* xq, T* yq, uint32_t nq)
+{
+	Interp1Job<T> job;
+	job.m_X = x;
+	job.m_Y = y;
+	job.m_XQ = xq;
+	job.m_YQ = yq;
+	job.m_N = n;
+	parallelFor(pool, nq, kInterp1ParallelGranularity, interp1Range<T>, &job);
+}
+
+void interp1fParallel(WorkerPool* pool, const float* x, const float* y, uint32_t n, const float* xq, float* yq, uint32_t nq)
+{
+	interp1Parallel<float>(pool, x, y, n, xq, yq, nq);
+}
+
+void interp1dParallel(WorkerPool* pool, const double* x, const double* y, uint32_t n, const double* xq, double* yq, uint32_t nq)
+{
+	interp1Parallel<double>(pool, x, y, n, xq, yq, nq);
+}
+
 template<typename T>
 static bool cubicSplineInterp(const T* x, const T* y, uint32_t n, const T* resX, T* resY, uint32_t resN, bx::AllocatorI* allocator)
 {
@@ -1,8 +1,8 @@
 #include "memory_tracer.h"
 #include <jx/sys.h>
 #include <jx/object_pool.h>
+#include <jx/mutex.h>
 #include <bx/allocator.h>
-#include <bx/mutex.h>
 #include <bx/debug.h>
 #include <bx/string.h>
 
@@ -52,7 +52,7 @@ struct MemTracer
 	AllocatorInfo* m_Allocators;
 	ObjectPool* m_AllocInfoPool;
 #if BX_CONFIG_SUPPORTS_THREADING
-	bx::Mutex* m_Mutex;
+	Mutex* m_Mutex;
 #endif
 	uint16_t m_NumAllocators;
 	char m_Name[64];
@@ -87,7 +87,7 @@ bool memTracerInit(bx::AllocatorI* allocator)
 
 	mt->m_Allocator = allocator;
 #if BX_CONFIG_SUPPORTS_THREADING
-	mt->m_Mutex = BX_NEW(allocator, bx::Mutex)();
+	mt->m_Mutex = BX_NEW(allocator, Mutex)("Memory Tracer");
 #endif
 	mt->m_AllocInfoPool = createObjectPool(sizeof(AllocationInfo), 2048, allocator);
 
@@ -233,7 +233,7 @@ void memTracerOnRealloc(uint16_t allocatorID, void* ptr, void* ptrNew, size_t si
 	JX_CHECK(allocatorID < ctx->m_NumAllocators, "Invalid allocator handle");
 
 #if BX_CONFIG_SUPPORTS_THREADING
-	bx::MutexScope ms(*ctx->m_Mutex);
+	MutexScope ms(*ctx->m_Mutex);
 #endif
 
 	AllocatorInfo* ai = &ctx->m_Allocators[allocatorID];
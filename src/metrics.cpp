@@ -0,0 +1,607 @@
+#include <jx/metrics.h>
+#include <jx/profiler.h>
+#include <jx/clock.h>
+#include <jx/mutex.h>
+#include <jx/cpu.h>
+#include <jx/sys.h>
+#include <bx/allocator.h>
+#include <bx/cpu.h>
+#include <bx/os.h>
+#include <bx/string.h>
+#include <bx/thread.h>
+#include <float.h> // DBL_MAX
+
+namespace jx
+{
+#define METRICS_CACHE_LINE_SIZE 64
+#define METRICS_NUM_CALL_SLOTS  64
+
+// Values of a single metric reported by a thread during an interval. The owner thread
+// writes to the bucket of the current epoch, and metricsMerge() reads the bucket of the
+// previous epoch after switching to the next one. An update which read the epoch right
+// before the switch can still land in the bucket while (or after) it's being merged; the
+// next merge of the same bucket (or the owner, if it resets the bucket first) picks it up.
+// m_Seq is odd while the owner writes to the bucket; metricsMerge() retries until it reads
+// the same even value before and after copying the bucket.
+struct MetricBucket
+{
+	volatile uint32_t m_Seq;
+	uint32_t m_Epoch;
+	uint32_t m_Count;
+	double m_Sum;
+	double m_Min;
+	double m_Max;
+	double m_Last; // Most recent value
+};
+
+// What metricsMerge() took from a bucket (written by the merge only). Updates past
+// m_Count haven't been merged yet.
+struct MetricMergeState
+{
+	uint32_t m_Epoch;
+	uint32_t m_Count;
+	double m_Sum;
+};
+
+struct MetricsThread
+{
+	MetricsThread* m_Next;
+	MetricBucket m_Buckets[JX_CONFIG_METRICS_MAX][2];
+	MetricMergeState m_Merged[JX_CONFIG_METRICS_MAX][2];
+};
+
+struct MetricHistory
+{
+	MetricSample m_Samples[JX_CONFIG_METRICS_HISTORY];
+	uint32_t m_NumSamples;
+	uint32_t m_Next;
+};
+
+struct Metrics
+{
+	bx::AllocatorI* m_Allocator;
+	Mutex* m_Mutex;
+	bx::TlsData* m_ThreadTLS;
+	MetricsThread* volatile m_Threads;
+	volatile uint32_t m_Epoch;
+	int64_t m_StartTime;
+	int64_t m_IntervalStart;
+	MetricHistory* m_History[JX_CONFIG_METRICS_MAX]; // Allocated on the first merge after registration (protected by m_Mutex)
+};
+
+// Metric descriptors are shared by all threads. The zone descriptor identifies the metric
+// in profiler captures.
+static ProfilerZoneDesc s_MetricDescs[JX_CONFIG_METRICS_MAX];
+static MetricType::Enum s_MetricTypes[JX_CONFIG_METRICS_MAX];
+static volatile uint32_t s_NumMetrics = 0;
+static volatile int32_t s_MetricsRegisterLock = 0;
+
+// Calls in progress, so metricsShutdown() can wait for them before freeing the state (see
+// ProfilerRef).
+struct MetricsCallSlot
+{
+	volatile int32_t m_NumCalls;
+	uint8_t m_Padding[METRICS_CACHE_LINE_SIZE - sizeof(int32_t)];
+};
+
+// m_Metrics is nullptr if the metrics aren't initialized or are shutting down.
+struct MetricsRef
+{
+	MetricsRef();
+	~MetricsRef();
+
+	Metrics* m_Metrics;
+	MetricsCallSlot* m_Slot;
+};
+
+static Metrics* volatile s_Metrics = nullptr;
+static MetricsCallSlot s_MetricsCallSlots[METRICS_NUM_CALL_SLOTS];
+static volatile uint32_t s_MetricsNextCallSlot = 0;
+static BX_THREAD_LOCAL uint32_t s_MetricsThreadCallSlot = UINT32_MAX;
+
+static MetricsThread* metricsGetThread(Metrics* metrics);
+static MetricBucket* metricsBeginUpdate(Metrics* metrics, uint32_t id);
+static void metricsEndUpdate(MetricBucket* bucket, double value);
+static void metricsResetBucket(MetricsThread* mt, uint32_t id, uint32_t epoch);
+static void metricsReadBucket(const MetricBucket* src, MetricBucket* dst);
+static void metricsMergeBucket(MetricsThread* mt, uint32_t id, uint32_t epoch, MetricSample* sample);
+
+bool metricsInit(bx::AllocatorI* allocator)
+{
+	JX_CHECK(s_Metrics == nullptr, "Metrics already initialized");
+
+	Metrics* metrics = (Metrics*)BX_ALLOC(allocator, sizeof(Metrics));
+	if (!metrics) {
+		return false;
+	}
+
+	bx::memSet(metrics, 0, sizeof(Metrics));
+	metrics->m_Allocator = allocator;
+	metrics->m_Mutex = BX_NEW(allocator, Mutex)("Metrics");
+	metrics->m_ThreadTLS = BX_NEW(allocator, bx::TlsData)();
+	metrics->m_Epoch = 1; // Zeroed buckets don't belong to any epoch
+	metrics->m_StartTime = clockGetTicks();
+	metrics->m_IntervalStart = metrics->m_StartTime;
+
+	s_Metrics = metrics;
+
+	return true;
+}
+
+void metricsShutdown()
+{
+	Metrics* metrics = s_Metrics;
+	if (!metrics) {
+		return;
+	}
+
+	// New calls see a null pointer from here on. Wait for the ones in progress before
+	// freeing anything.
+	s_Metrics = nullptr;
+	bx::memoryBarrier();
+
+	for (uint32_t i = 0; i < METRICS_NUM_CALL_SLOTS; ++i) {
+		while (s_MetricsCallSlots[i].m_NumCalls != 0) {
+			bx::yield();
+		}
+	}
+
+	bx::readBarrier();
+
+	bx::AllocatorI* allocator = metrics->m_Allocator;
+
+	MetricsThread* mt = metrics->m_Threads;
+	while (mt) {
+		MetricsThread* next = mt->m_Next;
+		BX_ALIGNED_FREE(allocator, mt, METRICS_CACHE_LINE_SIZE);
+		mt = next;
+	}
+
+	for (uint32_t i = 0; i < JX_CONFIG_METRICS_MAX; ++i) {
+		BX_FREE(allocator, metrics->m_History[i]);
+	}
+
+	BX_DELETE(allocator, metrics->m_ThreadTLS);
+	BX_DELETE(allocator, metrics->m_Mutex);
+	BX_FREE(allocator, metrics);
+}
+
+void metricsMerge()
+{
+	MetricsRef ref;
+	Metrics* metrics = ref.m_Metrics;
+	if (!metrics) {
+		return;
+	}
+
+	const int64_t now = clockGetTicks();
+	const bool capturing = profilerIsCapturing();
+
+	MutexScope ms(*metrics->m_Mutex);
+
+	// Threads switch to the new epoch's buckets with their next update. Updates which
+	// read the epoch right before the switch can still land in the old buckets after
+	// they have been merged; they are added to the sample of the next merge of the same
+	// bucket (see metricsMergeBucket()).
+	const uint32_t epoch = metrics->m_Epoch;
+	bx::memoryBarrier();
+	metrics->m_Epoch = epoch + 1;
+	bx::memoryBarrier();
+
+	const int64_t time_ns = clockTicksToNs(now - metrics->m_StartTime);
+	const int64_t duration_ns = clockTicksToNs(now - metrics->m_IntervalStart);
+	metrics->m_IntervalStart = now;
+
+	const uint32_t numMetrics = s_NumMetrics;
+	for (uint32_t id = 0; id < numMetrics; ++id) {
+		MetricHistory* history = metrics->m_History[id];
+		if (!history) {
+			history = (MetricHistory*)BX_ALLOC(metrics->m_Allocator, sizeof(MetricHistory));
+			if (!history) {
+				continue;
+			}
+
+			bx::memSet(history, 0, sizeof(MetricHistory));
+			metrics->m_History[id] = history;
+		}
+
+		MetricSample sample;
+		sample.m_Time_ns = time_ns;
+		sample.m_Duration_ns = duration_ns;
+		sample.m_Min = DBL_MAX;
+		sample.m_Max = -DBL_MAX;
+		sample.m_Sum = 0.0;
+		sample.m_Count = 0;
+
+		for (MetricsThread* mt = metrics->m_Threads; mt; mt = mt->m_Next) {
+			metricsMergeBucket(mt, id, epoch, &sample);
+		}
+
+		if (sample.m_Count == 0) {
+			double value = 0.0;
+			if (s_MetricTypes[id] == MetricType::Gauge && history->m_NumSamples != 0) {
+				const MetricSample* prev = &history->m_Samples[(history->m_Next + JX_CONFIG_METRICS_HISTORY - 1) % JX_CONFIG_METRICS_HISTORY];
+				value = prev->m_Count != 0 ? prev->m_Sum / (double)prev->m_Count : prev->m_Sum;
+			}
+
+			sample.m_Min = value;
+			sample.m_Max = value;
+			sample.m_Sum = value;
+		}
+
+		history->m_Samples[history->m_Next] = sample;
+		history->m_Next = (history->m_Next + 1) % JX_CONFIG_METRICS_HISTORY;
+		history->m_NumSamples = bx::min<uint32_t>(history->m_NumSamples + 1, JX_CONFIG_METRICS_HISTORY);
+
+		if (capturing) {
+			const double value = s_MetricTypes[id] == MetricType::Gauge && sample.m_Count != 0
+				? sample.m_Sum / (double)sample.m_Count
+				: sample.m_Sum
+				;
+			profilerCounter(&s_MetricDescs[id], value);
+		}
+	}
+}
+
+uint32_t metricsRegister(const char* name, MetricType::Enum type)
+{
+	// Registration is rare (once per call site), so a spin lock is enough.
+	while (bx::atomicCompareAndSwap<int32_t>(&s_MetricsRegisterLock, 0, 1) != 0) {
+		jx::cpuPause();
+	}
+
+	uint32_t id = JX_METRICS_INVALID_ID;
+
+	const uint32_t numMetrics = s_NumMetrics;
+	for (uint32_t i = 0; i < numMetrics; ++i) {
+		if (!bx::strCmp(s_MetricDescs[i].m_Name, name)) {
+			JX_CHECK(s_MetricTypes[i] == type, "Metric registered with a different type");
+			id = i;
+			break;
+		}
+	}
+
+	if (id == JX_METRICS_INVALID_ID) {
+		if (numMetrics < JX_CONFIG_METRICS_MAX) {
+			s_MetricDescs[numMetrics].m_Name = name;
+			s_MetricDescs[numMetrics].m_File = "";
+			s_MetricDescs[numMetrics].m_Line = 0;
+			s_MetricTypes[numMetrics] = type;
+			bx::writeBarrier();
+			s_NumMetrics = numMetrics + 1;
+			id = numMetrics;
+		} else {
+			JX_CHECK(false, "Too many metrics. Increase JX_CONFIG_METRICS_MAX");
+		}
+	}
+
+	bx::memoryBarrier();
+	s_MetricsRegisterLock = 0;
+
+	return id;
+}
+
+uint32_t metricsGetNumMetrics()
+{
+	return s_NumMetrics;
+}
+
+const char* metricsGetName(uint32_t id)
+{
+	return id < s_NumMetrics
+		? s_MetricDescs[id].m_Name
+		: nullptr
+		;
+}
+
+MetricType::Enum metricsGetType(uint32_t id)
+{
+	JX_CHECK(id < s_NumMetrics, "Invalid metric ID");
+	return s_MetricTypes[id];
+}
+
+void metricsAdd(uint32_t id, double value)
+{
+	MetricsRef ref;
+	MetricBucket* bucket = metricsBeginUpdate(ref.m_Metrics, id);
+	if (!bucket) {
+		return;
+	}
+
+	JX_CHECK(s_MetricTypes[id] == MetricType::Counter, "Not a counter");
+	metricsEndUpdate(bucket, value);
+}
+
+void metricsSet(uint32_t id, double value)
+{
+	MetricsRef ref;
+	MetricBucket* bucket = metricsBeginUpdate(ref.m_Metrics, id);
+	if (!bucket) {
+		return;
+	}
+
+	JX_CHECK(s_MetricTypes[id] == MetricType::Gauge, "Not a gauge");
+	metricsEndUpdate(bucket, value);
+}
+
+uint32_t metricsGetHistory(uint32_t id, MetricSample* samples, uint32_t maxSamples)
+{
+	MetricsRef ref;
+	Metrics* metrics = ref.m_Metrics;
+	if (!metrics || id >= JX_CONFIG_METRICS_MAX) {
+		return 0;
+	}
+
+	MutexScope ms(*metrics->m_Mutex);
+
+	const MetricHistory* history = metrics->m_History[id];
+	if (!history) {
+		return 0;
+	}
+
+	const uint32_t numSamples = bx::min<uint32_t>(history->m_NumSamples, maxSamples);
+	const uint32_t first = history->m_Next + JX_CONFIG_METRICS_HISTORY - numSamples;
+	for (uint32_t i = 0; i < numSamples; ++i) {
+		samples[i] = history->m_Samples[(first + i) % JX_CONFIG_METRICS_HISTORY];
+	}
+
+	return numSamples;
+}
+
+bool metricsGetSummary(uint32_t id, uint32_t numIntervals, MetricSummary* summary)
+{
+	MetricsRef ref;
+	Metrics* metrics = ref.m_Metrics;
+	if (!metrics || id >= JX_CONFIG_METRICS_MAX) {
+		return false;
+	}
+
+	MutexScope ms(*metrics->m_Mutex);
+
+	const MetricHistory* history = metrics->m_History[id];
+	if (!history || history->m_NumSamples == 0) {
+		return false;
+	}
+
+	const bool gauge = s_MetricTypes[id] == MetricType::Gauge;
+	const uint32_t numSamples = bx::min<uint32_t>(history->m_NumSamples, numIntervals);
+	const uint32_t first = history->m_Next + JX_CONFIG_METRICS_HISTORY - numSamples;
+
+	double minVal = DBL_MAX;
+	double maxVal = -DBL_MAX;
+	double sum = 0.0;
+	int64_t duration_ns = 0;
+	for (uint32_t i = 0; i < numSamples; ++i) {
+		const MetricSample* sample = &history->m_Samples[(first + i) % JX_CONFIG_METRICS_HISTORY];
+		const double value = gauge && sample->m_Count != 0
+			? sample->m_Sum / (double)sample->m_Count
+			: sample->m_Sum
+			;
+
+		// Gauges: extremes of the individual values; counters: extremes of the interval totals.
+		minVal = bx::min<double>(minVal, gauge ? sample->m_Min : value);
+		maxVal = bx::max<double>(maxVal, gauge ? sample->m_Max : value);
+		sum += value;
+		duration_ns += sample->m_Duration_ns;
+	}
+
+	summary->m_Min = minVal;
+	summary->m_Max = maxVal;
+	summary->m_Avg = sum / (double)numSamples;
+	summary->m_Rate = !gauge && duration_ns != 0
+		? sum * 1.0e9 / (double)duration_ns
+		: 0.0
+		;
+	summary->m_NumSamples = numSamples;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Internal
+//
+MetricsRef::MetricsRef()
+{
+	uint32_t slot = s_MetricsThreadCallSlot;
+	if (slot == UINT32_MAX) {
+		slot = bx::atomicFetchAndAdd<uint32_t>(&s_MetricsNextCallSlot, 1) % METRICS_NUM_CALL_SLOTS;
+		s_MetricsThreadCallSlot = slot;
+	}
+
+	// Full barrier; the slot must be visible to metricsShutdown() before s_Metrics is read.
+	m_Slot = &s_MetricsCallSlots[slot];
+	bx::atomicFetchAndAdd<int32_t>(&m_Slot->m_NumCalls, 1);
+	m_Metrics = s_Metrics;
+}
+
+MetricsRef::~MetricsRef()
+{
+	bx::atomicFetchAndAdd<int32_t>(&m_Slot->m_NumCalls, -1);
+}
+
+static MetricsThread* metricsGetThread(Metrics* metrics)
+{
+	MetricsThread* mt = (MetricsThread*)metrics->m_ThreadTLS->get();
+	if (mt) {
+		return mt;
+	}
+
+	mt = (MetricsThread*)BX_ALIGNED_ALLOC(metrics->m_Allocator, sizeof(MetricsThread), METRICS_CACHE_LINE_SIZE);
+	if (!mt) {
+		JX_CHECK(false, "Failed to allocate metrics thread slots");
+		return nullptr;
+	}
+
+	bx::memSet(mt, 0, sizeof(MetricsThread));
+
+	// metricsMerge() walks the list without locking the slots; the thread must be fully
+	// initialized before it becomes reachable.
+	{
+		MutexScope ms(*metrics->m_Mutex);
+		mt->m_Next = metrics->m_Threads;
+		bx::writeBarrier();
+		metrics->m_Threads = mt;
+	}
+
+	metrics->m_ThreadTLS->set(mt);
+
+	return mt;
+}
+
+// Returns the bucket of the current epoch, marked as being written (odd m_Seq).
+static MetricBucket* metricsBeginUpdate(Metrics* metrics, uint32_t id)
+{
+	if (!metrics || id >= JX_CONFIG_METRICS_MAX) {
+		return nullptr;
+	}
+
+	MetricsThread* mt = metricsGetThread(metrics);
+	if (!mt) {
+		return nullptr;
+	}
+
+	for (;;) {
+		const uint32_t epoch = metrics->m_Epoch;
+		bx::readBarrier();
+
+		MetricBucket* bucket = &mt->m_Buckets[id][epoch & 1];
+		bucket->m_Seq = bucket->m_Seq + 1;
+		bx::writeBarrier();
+
+		if (bucket->m_Epoch == epoch) {
+			return bucket;
+		}
+
+		// Resetting the bucket races with metricsMerge() picking up its late updates, unless
+		// the merge which does that (the one which ends this epoch) hasn't started yet. The
+		// merge switches the epoch before it reads any bucket, so the odd m_Seq is visible
+		// to it if the epoch hasn't changed. Otherwise give the bucket back and start over.
+		bx::memoryBarrier();
+		if (metrics->m_Epoch == epoch) {
+			metricsResetBucket(mt, id, epoch);
+			return bucket;
+		}
+
+		bx::writeBarrier();
+		bucket->m_Seq = bucket->m_Seq + 1;
+	}
+}
+
+static void metricsEndUpdate(MetricBucket* bucket, double value)
+{
+	bucket->m_Count++;
+	bucket->m_Sum += value;
+	bucket->m_Min = bx::min<double>(bucket->m_Min, value);
+	bucket->m_Max = bx::max<double>(bucket->m_Max, value);
+	bucket->m_Last = value;
+
+	bx::writeBarrier();
+	bucket->m_Seq = bucket->m_Seq + 1;
+}
+
+// The bucket still holds an older epoch. Its merges have completed (see
+// metricsBeginUpdate()); updates which arrived after the last one are kept.
+static void metricsResetBucket(MetricsThread* mt, uint32_t id, uint32_t epoch)
+{
+	MetricBucket* bucket = &mt->m_Buckets[id][epoch & 1];
+	const MetricMergeState* merged = &mt->m_Merged[id][epoch & 1];
+
+	const bool wasMerged = bucket->m_Epoch == merged->m_Epoch;
+	const uint32_t numMerged = wasMerged ? merged->m_Count : 0;
+
+	if (bucket->m_Count == numMerged) {
+		bucket->m_Count = 0;
+		bucket->m_Sum = 0.0;
+		bucket->m_Min = DBL_MAX;
+		bucket->m_Max = -DBL_MAX;
+	} else if (numMerged == 0) {
+		// Never merged; everything is carried over.
+	} else if (bucket->m_Count == numMerged + 1) {
+		// The common case: a single update which read the epoch right before the switch.
+		bucket->m_Count = 1;
+		bucket->m_Sum = bucket->m_Last;
+		bucket->m_Min = bucket->m_Last;
+		bucket->m_Max = bucket->m_Last;
+	} else {
+		// The extremes of the merged values can't be separated; keep them.
+		bucket->m_Count -= numMerged;
+		bucket->m_Sum -= merged->m_Sum;
+	}
+
+	bucket->m_Epoch = epoch;
+}
+
+// Adds the updates of the epoch's bucket which haven't been merged yet to the sample. If the
+// owner hasn't written to the bucket during the epoch, these are the late updates of the
+// epoch before the previous one.
+static void metricsMergeBucket(MetricsThread* mt, uint32_t id, uint32_t epoch, MetricSample* sample)
+{
+	MetricBucket bucket;
+	metricsReadBucket(&mt->m_Buckets[id][epoch & 1], &bucket);
+	if (bucket.m_Epoch == 0) {
+		return;
+	}
+
+	// The owner reads this when it resets the bucket.
+	MetricMergeState* merged = &mt->m_Merged[id][epoch & 1];
+	const bool wasMerged = bucket.m_Epoch == merged->m_Epoch;
+	const uint32_t numMerged = wasMerged ? merged->m_Count : 0;
+	const double mergedSum = wasMerged ? merged->m_Sum : 0.0;
+
+	merged->m_Epoch = bucket.m_Epoch;
+	merged->m_Count = bucket.m_Count;
+	merged->m_Sum = bucket.m_Sum;
+
+	const uint32_t count = bucket.m_Count - numMerged;
+	if (count == 0) {
+		return;
+	}
+
+	if (numMerged == 0) {
+		sample->m_Min = bx::min<double>(sample->m_Min, bucket.m_Min);
+		sample->m_Max = bx::max<double>(sample->m_Max, bucket.m_Max);
+		sample->m_Sum += bucket.m_Sum;
+	} else if (count == 1) {
+		sample->m_Min = bx::min<double>(sample->m_Min, bucket.m_Last);
+		sample->m_Max = bx::max<double>(sample->m_Max, bucket.m_Last);
+		sample->m_Sum += bucket.m_Last;
+	} else {
+		// The extremes of the merged values can't be separated; keep them.
+		sample->m_Min = bx::min<double>(sample->m_Min, bucket.m_Min);
+		sample->m_Max = bx::max<double>(sample->m_Max, bucket.m_Max);
+		sample->m_Sum += bucket.m_Sum - mergedSum;
+	}
+
+	sample->m_Count += count;
+}
+
+// Waits for the owner thread if it's in the middle of an update (a few instructions, unless
+// it has been preempted).
+static void metricsReadBucket(const MetricBucket* src, MetricBucket* dst)
+{
+	uint32_t numSpins = 0;
+	for (;;) {
+		const uint32_t seq = src->m_Seq;
+		if ((seq & 1) == 0) {
+			bx::readBarrier();
+			dst->m_Epoch = src->m_Epoch;
+			dst->m_Count = src->m_Count;
+			dst->m_Sum = src->m_Sum;
+			dst->m_Min = src->m_Min;
+			dst->m_Max = src->m_Max;
+			dst->m_Last = src->m_Last;
+			bx::readBarrier();
+
+			if (src->m_Seq == seq) {
+				return;
+			}
+		}
+
+		if (++numSpins < 64) {
+			jx::cpuPause();
+		} else {
+			bx::yield();
+		}
+	}
+}
+}
@@ -0,0 +1,454 @@
+#include <jx/mutex.h>
+#include <jx/cpu.h>
+#include <jx/sys.h>
+#include <bx/cpu.h>
+#include <bx/os.h>
+#include <bx/timer.h>
+
+#if BX_PLATFORM_LINUX || BX_PLATFORM_RPI
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#define JX_FUTEX_LINUX 1
+#elif BX_PLATFORM_WINDOWS
+#include <Windows.h>
+#pragma comment(lib, "Synchronization.lib")
+#define JX_FUTEX_WINDOWS 1
+#endif
+
+namespace jx
+{
+// Upper limit for the adaptive spin phase of Mutex::lock()
+static const int32_t kMutexMaxSpins = 128;
+
+// Number of spin iterations Event::wait() and Semaphore::wait() try before sleeping
+static const uint32_t kWaitNumSpins = 64;
+
+static Mutex* s_LockStatsHead = nullptr;
+static volatile int32_t s_LockStatsLock = 0;
+
+#if JX_CONFIG_DEBUG
+// Its address identifies the calling thread (Mutex::m_Owner).
+static BX_THREAD_LOCAL uint8_t s_MutexThreadToken = 0;
+#endif
+
+static bool futexWait(volatile int32_t* addr, int32_t expected, int32_t timeout_msec);
+static void futexWake(volatile int32_t* addr, int32_t count);
+static int32_t atomicExchange32(volatile int32_t* ptr, int32_t val);
+static int64_t calcDeadline(int32_t msecs);
+static int32_t calcRemainingTime(int64_t deadline);
+static void lockStatsRegistryLock();
+static void lockStatsRegistryUnlock();
+
+//////////////////////////////////////////////////////////////////////////
+// Mutex
+//
+Mutex::Mutex(const char* statsName)
+	: m_State(0)
+	, m_SpinCount(0)
+	, m_StatsResetPending(0)
+	, m_Owner(nullptr)
+	, m_PrevStats(nullptr)
+	, m_NextStats(nullptr)
+{
+	m_Stats.m_Name = statsName;
+	m_Stats.m_NumAcquires = 0;
+	m_Stats.m_NumContendedAcquires = 0;
+	m_Stats.m_WaitTime = 0;
+
+	if (statsName) {
+		lockStatsRegistryLock();
+		m_NextStats = s_LockStatsHead;
+		if (s_LockStatsHead) {
+			s_LockStatsHead->m_PrevStats = this;
+		}
+		s_LockStatsHead = this;
+		lockStatsRegistryUnlock();
+	}
+}
+
+Mutex::~Mutex()
+{
+	JX_CHECK(m_State == 0, "Destroying a locked mutex");
+
+	if (m_Stats.m_Name) {
+		lockStatsRegistryLock();
+		if (m_PrevStats) {
+			m_PrevStats->m_NextStats = m_NextStats;
+		} else {
+			s_LockStatsHead = m_NextStats;
+		}
+		if (m_NextStats) {
+			m_NextStats->m_PrevStats = m_PrevStats;
+		}
+		lockStatsRegistryUnlock();
+	}
+}
+
+void Mutex::lock()
+{
+	int32_t state = bx::atomicCompareAndSwap<int32_t>(&m_State, 0, 1);
+	if (state == 0) {
+		onAcquired(false, 0);
+		return;
+	}
+
+#if JX_CONFIG_DEBUG
+	JX_CHECK(m_Owner != &s_MutexThreadToken, "Recursive Mutex::lock() (jx::Mutex isn't recursive)");
+#endif
+
+	const bool recordStats = m_Stats.m_Name != nullptr;
+	const int64_t startTime = recordStats ? bx::getHPCounter() : 0;
+
+	// Spin phase. Try for a bit longer than it took on average the last few times.
+	const int32_t maxSpins = bx::min<int32_t>(m_SpinCount * 2 + 10, kMutexMaxSpins);
+	int32_t numSpins = 0;
+	bool acquired = false;
+	while (numSpins < maxSpins) {
+		++numSpins;
+		cpuPause();
+
+		if (m_State == 0 && bx::atomicCompareAndSwap<int32_t>(&m_State, 0, 1) == 0) {
+			acquired = true;
+			break;
+		}
+	}
+
+	if (!acquired) {
+		// Sleep phase. Mark the mutex as having waiters so unlock() knows it has to wake someone.
+		if (state != 2) {
+			state = atomicExchange32(&m_State, 2);
+		}
+
+		while (state != 0) {
+			futexWait(&m_State, 2, -1);
+			state = atomicExchange32(&m_State, 2);
+		}
+	}
+
+	// The lock is held from here on.
+	m_SpinCount += (numSpins - m_SpinCount) / 8;
+
+	onAcquired(recordStats, recordStats ? bx::getHPCounter() - startTime : 0);
+}
+
+bool Mutex::tryLock()
+{
+	if (bx::atomicCompareAndSwap<int32_t>(&m_State, 0, 1) != 0) {
+		return false;
+	}
+
+	onAcquired(false, 0);
+	return true;
+}
+
+void Mutex::unlock()
+{
+#if JX_CONFIG_DEBUG
+	JX_CHECK(m_Owner == &s_MutexThreadToken, "Mutex::unlock() from a thread which doesn't hold the lock");
+	m_Owner = nullptr;
+#endif
+
+	if (bx::atomicFetchAndAdd<int32_t>(&m_State, -1) != 1) {
+		// There might be waiters.
+		m_State = 0;
+		bx::memoryBarrier();
+		futexWake(&m_State, 1);
+	}
+}
+
+const LockStats* Mutex::getStats() const
+{
+	return &m_Stats;
+}
+
+// Called with the lock held.
+void Mutex::onAcquired(bool contended, int64_t waitTime)
+{
+#if JX_CONFIG_DEBUG
+	m_Owner = &s_MutexThreadToken;
+#endif
+
+	if (m_StatsResetPending != 0) {
+		m_StatsResetPending = 0;
+		m_Stats.m_NumAcquires = 0;
+		m_Stats.m_NumContendedAcquires = 0;
+		m_Stats.m_WaitTime = 0;
+	}
+
+	++m_Stats.m_NumAcquires;
+	if (contended) {
+		++m_Stats.m_NumContendedAcquires;
+		m_Stats.m_WaitTime += waitTime;
+	}
+}
+
+MutexScope::MutexScope(Mutex& mutex)
+	: m_Mutex(mutex)
+{
+	m_Mutex.lock();
+}
+
+MutexScope::~MutexScope()
+{
+	m_Mutex.unlock();
+}
+
+void lockStatsEnumerate(LockStatsCallback cb, void* userData)
+{
+	lockStatsRegistryLock();
+	Mutex* mutex = s_LockStatsHead;
+	while (mutex) {
+		cb(&mutex->m_Stats, userData);
+		mutex = mutex->m_NextStats;
+	}
+	lockStatsRegistryUnlock();
+}
+
+void lockStatsReset()
+{
+	lockStatsRegistryLock();
+	Mutex* mutex = s_LockStatsHead;
+	while (mutex) {
+		// The counters are only written by the thread which holds the lock. Waiting for the
+		// lock here might deadlock with a thread which holds it and waits for the registry,
+		// so busy mutexes are reset by their next owner instead.
+		mutex->m_StatsResetPending = 1;
+		bx::memoryBarrier();
+		if (mutex->tryLock()) {
+			mutex->m_Stats.m_NumAcquires = 0;
+			mutex->m_Stats.m_NumContendedAcquires = 0;
+			mutex->m_Stats.m_WaitTime = 0;
+			mutex->unlock();
+		}
+
+		mutex = mutex->m_NextStats;
+	}
+	lockStatsRegistryUnlock();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Event
+//
+Event::Event(bool autoReset)
+	: m_State(0)
+	, m_NumWaiters(0)
+	, m_AutoReset(autoReset)
+{
+}
+
+Event::~Event()
+{
+}
+
+void Event::set()
+{
+	m_State = 1;
+	bx::memoryBarrier();
+
+	if (m_NumWaiters != 0) {
+		futexWake(&m_State, m_AutoReset ? 1 : INT32_MAX);
+	}
+}
+
+void Event::reset()
+{
+	m_State = 0;
+	bx::memoryBarrier();
+}
+
+bool Event::wait(int32_t msecs)
+{
+	const int64_t deadline = calcDeadline(msecs);
+
+	uint32_t numSpins = 0;
+	for (;;) {
+		if (m_AutoReset) {
+			if (bx::atomicCompareAndSwap<int32_t>(&m_State, 1, 0) == 1) {
+				return true;
+			}
+		} else if (m_State == 1) {
+			bx::readBarrier();
+			return true;
+		}
+
+		if (numSpins < kWaitNumSpins) {
+			++numSpins;
+			cpuPause();
+			continue;
+		}
+
+		const int32_t remaining = calcRemainingTime(deadline);
+		if (remaining == 0) {
+			return false;
+		}
+
+		bx::atomicFetchAndAdd<int32_t>(&m_NumWaiters, 1);
+		futexWait(&m_State, 0, remaining);
+		bx::atomicFetchAndAdd<int32_t>(&m_NumWaiters, -1);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Semaphore
+//
+Semaphore::Semaphore()
+	: m_Count(0)
+	, m_NumWaiters(0)
+{
+}
+
+Semaphore::~Semaphore()
+{
+}
+
+void Semaphore::post(uint32_t count)
+{
+	bx::atomicFetchAndAdd<int32_t>(&m_Count, (int32_t)count);
+	if (m_NumWaiters != 0) {
+		futexWake(&m_Count, (int32_t)count);
+	}
+}
+
+bool Semaphore::wait(int32_t msecs)
+{
+	const int64_t deadline = calcDeadline(msecs);
+
+	uint32_t numSpins = 0;
+	for (;;) {
+		const int32_t count = m_Count;
+		if (count > 0) {
+			if (bx::atomicCompareAndSwap<int32_t>(&m_Count, count, count - 1) == count) {
+				return true;
+			}
+
+			continue;
+		}
+
+		if (numSpins < kWaitNumSpins) {
+			++numSpins;
+			cpuPause();
+			continue;
+		}
+
+		const int32_t remaining = calcRemainingTime(deadline);
+		if (remaining == 0) {
+			return false;
+		}
+
+		// NOTE: The waiter count must be visible before checking m_Count (done atomically by
+		// futexWait()), otherwise a concurrent post() might skip the wake up.
+		bx::atomicFetchAndAdd<int32_t>(&m_NumWaiters, 1);
+		futexWait(&m_Count, 0, remaining);
+		bx::atomicFetchAndAdd<int32_t>(&m_NumWaiters, -1);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Internal
+//
+#if JX_FUTEX_LINUX
+static bool futexWait(volatile int32_t* addr, int32_t expected, int32_t timeout_msec)
+{
+	struct timespec ts;
+	struct timespec* timeout = nullptr;
+	if (timeout_msec >= 0) {
+		ts.tv_sec = timeout_msec / 1000;
+		ts.tv_nsec = (long)(timeout_msec % 1000) * 1000000L;
+		timeout = &ts;
+	}
+
+	const long res = ::syscall(SYS_futex, (int32_t*)addr, FUTEX_WAIT_PRIVATE, expected, timeout, nullptr, 0);
+	return !(res == -1 && errno == ETIMEDOUT);
+}
+
+static void futexWake(volatile int32_t* addr, int32_t count)
+{
+	::syscall(SYS_futex, (int32_t*)addr, FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+#elif JX_FUTEX_WINDOWS
+static bool futexWait(volatile int32_t* addr, int32_t expected, int32_t timeout_msec)
+{
+	const DWORD timeout = timeout_msec < 0 ? INFINITE : (DWORD)timeout_msec;
+	if (!::WaitOnAddress((volatile VOID*)addr, &expected, sizeof(int32_t), timeout)) {
+		return ::GetLastError() != ERROR_TIMEOUT;
+	}
+
+	return true;
+}
+
+static void futexWake(volatile int32_t* addr, int32_t count)
+{
+	if (count == 1) {
+		::WakeByAddressSingle((PVOID)addr);
+	} else {
+		::WakeByAddressAll((PVOID)addr);
+	}
+}
+#else
+// No address-based wait available. Degrade to polling; the callers re-check their
+// condition after every (spurious) wake up.
+static bool futexWait(volatile int32_t* addr, int32_t expected, int32_t timeout_msec)
+{
+	BX_UNUSED(addr, expected, timeout_msec);
+	bx::yield();
+	return true;
+}
+
+static void futexWake(volatile int32_t* addr, int32_t count)
+{
+	BX_UNUSED(addr, count);
+}
+#endif
+
+static int32_t atomicExchange32(volatile int32_t* ptr, int32_t val)
+{
+	int32_t old;
+	do {
+		old = *ptr;
+	} while (bx::atomicCompareAndSwap<int32_t>(ptr, old, val) != old);
+
+	return old;
+}
+
+static int64_t calcDeadline(int32_t msecs)
+{
+	if (msecs < 0) {
+		return INT64_MAX;
+	}
+
+	return bx::getHPCounter() + (bx::getHPFrequency() / 1000) * msecs;
+}
+
+// Returns -1 for infinite waits and 0 if the deadline has passed.
+static int32_t calcRemainingTime(int64_t deadline)
+{
+	if (deadline == INT64_MAX) {
+		return -1;
+	}
+
+	const int64_t now = bx::getHPCounter();
+	if (now >= deadline) {
+		return 0;
+	}
+
+	const int64_t countersPerMsec = bx::getHPFrequency() / 1000;
+	const int64_t remaining = (deadline - now + countersPerMsec - 1) / countersPerMsec;
+	return (int32_t)bx::min<int64_t>(remaining, INT32_MAX);
+}
+
+static void lockStatsRegistryLock()
+{
+	while (bx::atomicCompareAndSwap<int32_t>(&s_LockStatsLock, 0, 1) != 0) {
+		bx::yield();
+	}
+}
+
+static void lockStatsRegistryUnlock()
+{
+	bx::memoryBarrier();
+	s_LockStatsLock = 0;
+}
+}
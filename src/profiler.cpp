@@ -0,0 +1,1297 @@
+#include <jx/profiler.h>
+#include <jx/clock.h>
+#include <jx/fs.h>
+#include <jx/mutex.h>
+#include <jx/sys.h>
+#include <bx/allocator.h>
+#include <bx/cpu.h>
+#include <bx/os.h>
+#include <bx/string.h>
+#include <bx/thread.h>
+
+#if BX_PLATFORM_LINUX || BX_PLATFORM_RPI || BX_PLATFORM_OSX
+#include <pthread.h> // pthread_getname_np()
+#endif
+
+#if BX_PLATFORM_LINUX
+#include <linux/perf_event.h> // perf_event_attr
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace jx
+{
+#define PROFILER_CACHE_LINE_SIZE   64
+#define PROFILER_MAX_THREAD_NAME   64
+#define PROFILER_EVENT_TYPE_MASK   ((uintptr_t)3)
+#define PROFILER_INVALID_NODE      UINT32_MAX
+#define PROFILER_ROOT_NODE         0
+#define PROFILER_CAPTURE_BUFFER_SIZE (64 << 10)
+#define PROFILER_MAX_TRACE_EVENT   1024
+#define PROFILER_MAX_TRACE_NAME    256
+#define PROFILER_NUM_CALL_SLOTS    64
+
+struct ProfilerEventType
+{
+	enum Enum : uint32_t
+	{
+		ZoneBegin = 0,
+		ZoneEnd = 1,
+		Instant = 2,
+		Counter = 3, // Followed by an event which holds the value in m_Time
+
+		// A Counter event without a descriptor is a hardware counter sample of the preceding
+		// zone event. m_Time holds the counter mask and is followed by an event per counter.
+	};
+};
+
+// The event type is stored in the low bits of the descriptor's address.
+struct ProfilerEvent
+{
+	int64_t m_Time;
+	uintptr_t m_Data;
+};
+
+// Node of a thread's zone tree. Each node represents a zone in a specific parent zone.
+// Nodes are kept for the lifetime of the profiler; their stats are reset every frame.
+struct ProfilerNode
+{
+	const ProfilerZoneDesc* m_Zone;
+	uint32_t m_Parent;
+	uint32_t m_FirstChild;
+	uint32_t m_LastChild;
+	uint32_t m_NextSibling;
+	uint32_t m_Count;
+	bool m_Active; // Began, ended or was open during the current frame
+	int64_t m_Total;
+	int64_t m_Self;
+	int64_t m_Min;
+	int64_t m_Max;
+	uint32_t m_HWCounterMask;
+	uint32_t m_NumHWSamples;
+	uint64_t m_HWCounters[ProfilerHWCounter::Count];
+};
+
+struct ProfilerStackEntry
+{
+	uint32_t m_NodeID;
+	bool m_Traced; // The begin event has been written to the capture
+	int64_t m_BeginTime;
+	int64_t m_ChildTime;
+	uint32_t m_HWCounterMask; // Counters sampled when the zone began
+	uint64_t m_HWCounters[ProfilerHWCounter::Count];
+};
+
+struct ProfilerCapture
+{
+	File* m_File;
+	char* m_Buffer;
+	uint32_t m_BufferLen;
+	ProfilerCaptureDesc m_Desc;
+	int64_t m_WindowStart;
+	uint64_t m_WindowStartFrame;
+	uint32_t m_ID;
+	bool m_Recording;
+	bool m_FirstEvent;
+};
+
+// Single-producer/single-consumer event ring. The owner thread appends events and
+// profilerFrame() consumes them. Positions increase monotonically.
+struct ProfilerThread
+{
+	// Producer data
+	volatile uint32_t m_WritePos;
+	uint32_t m_CachedReadPos;
+	uint32_t m_Depth;        // Recorded zones which haven't ended yet
+	uint32_t m_DroppedDepth; // Nesting level inside a dropped zone
+	volatile uint32_t m_NumDropped;
+	uint32_t m_HWCounterMask;
+	uint32_t m_NumHWCounters;
+	int32_t m_HWGroupFD;
+	uint8_t m_Padding0[PROFILER_CACHE_LINE_SIZE - sizeof(uint32_t) * 8];
+
+	// Consumer data
+	volatile uint32_t m_ReadPos;
+	uint8_t m_Padding1[PROFILER_CACHE_LINE_SIZE - sizeof(uint32_t)];
+
+	ProfilerThread* m_Next;
+	ProfilerEvent* m_Events;
+	uint32_t m_Mask;
+	uint32_t m_ID;
+	uint32_t m_OSThreadID;
+	char m_Name[PROFILER_MAX_THREAD_NAME];
+	uint32_t m_CaptureID; // Capture the thread's name has been written to
+	int32_t m_HWCounterFD[ProfilerHWCounter::Count]; // Valid if the bit is set in m_HWCounterMask
+
+	// Zone tree (consumer)
+	ProfilerNode* m_Nodes;
+	uint32_t m_NumNodes;
+	uint32_t m_NumDroppedReported;
+	uint32_t m_StackSize;
+	ProfilerStackEntry m_Stack[JX_CONFIG_PROFILER_MAX_DEPTH];
+};
+
+struct Profiler
+{
+	bx::AllocatorI* m_Allocator;
+	Mutex* m_Mutex;
+	bx::TlsData* m_ThreadTLS;
+	ProfilerThread* volatile m_Threads;
+	volatile uint32_t m_NumThreads;
+
+	// Frame data (profilerFrame())
+	int64_t m_FrameStart;
+	uint64_t m_FrameID;
+	uint32_t m_NumDroppedNodes;
+	int64_t m_StartTime;
+
+	ProfilerCapture* m_Capture; // Protected by m_Mutex
+	uint32_t m_NextCaptureID;
+	volatile int32_t m_TriggerPending;
+
+	// Snapshot of the last completed frame (protected by m_Mutex)
+	ProfilerZoneStats* m_Stats;
+	uint32_t m_NumStats;
+	uint32_t m_StatsCapacity;
+	ProfilerFrameInfo m_FrameInfo;
+};
+
+// Calls in progress, so profilerShutdown() can wait for them before freeing the profiler.
+// Threads are spread over the slots so they don't contend on the same cache line. Slots are
+// static, so they are still valid for threads which enter after the profiler is gone.
+struct ProfilerCallSlot
+{
+	volatile int32_t m_NumCalls;
+	uint8_t m_Padding[PROFILER_CACHE_LINE_SIZE - sizeof(int32_t)];
+};
+
+// Keeps the profiler alive while the calling thread uses it. m_Profiler is nullptr if the
+// profiler isn't initialized or is shutting down.
+struct ProfilerRef
+{
+	ProfilerRef();
+	~ProfilerRef();
+
+	Profiler* m_Profiler;
+	ProfilerCallSlot* m_Slot;
+};
+
+static Profiler* volatile s_Profiler = nullptr;
+static ProfilerCallSlot s_ProfilerCallSlots[PROFILER_NUM_CALL_SLOTS];
+static volatile uint32_t s_ProfilerNextCallSlot = 0;
+static BX_THREAD_LOCAL uint32_t s_ProfilerThreadCallSlot = UINT32_MAX;
+
+static ProfilerThread* profilerGetThread(Profiler* prof);
+static void profilerGetOSThreadName(uint32_t osThreadID, char* buffer, uint32_t maxLen);
+static bool profThreadReserve(ProfilerThread* pt, uint32_t numEvents);
+static void profThreadPush(ProfilerThread* pt, int64_t time, uintptr_t data);
+static void profThreadPush2(ProfilerThread* pt, int64_t time, uintptr_t data, int64_t time2, uintptr_t data2);
+static void profThreadPushZone(ProfilerThread* pt, int64_t time, uintptr_t data, bool sampleHWCounters);
+static bool profThreadReadHWCounters(ProfilerThread* pt, uint64_t* values);
+static void profThreadCloseHWCounters(ProfilerThread* pt);
+static uint32_t profThreadPopHWSample(ProfilerThread* pt, uint32_t* readPos, uint32_t writePos, uint64_t* values);
+static void profThreadProcessEvents(Profiler* prof, ProfilerThread* pt);
+static uint32_t profThreadFindChild(Profiler* prof, ProfilerThread* pt, uint32_t parentID, const ProfilerZoneDesc* zone);
+static bool profilerReserveStats(Profiler* prof, uint32_t numStats);
+static void profilerEmitNodes(Profiler* prof, ProfilerThread* pt, uint32_t nodeID, uint32_t parentStatID, uint32_t depth);
+static void profilerDrainThreads(Profiler* prof);
+static void profCaptureBeginWindow(Profiler* prof, int64_t time);
+static void profCaptureEndWindow(Profiler* prof, int64_t time);
+static void profCaptureEnd(Profiler* prof);
+static void profCaptureClose(Profiler* prof);
+static void profCaptureWriteEvent(Profiler* prof, ProfilerThread* pt, const char* phase, const ProfilerZoneDesc* desc, int64_t time, const char* extra);
+static void profCaptureFormatHWCounters(uint32_t mask, const uint64_t* values, char* buffer, uint32_t maxLen);
+static void profCaptureWrite(ProfilerCapture* capture, const char* str, uint32_t len);
+static void profCaptureFlush(ProfilerCapture* capture);
+static uint32_t profEscapeString(const char* str, char* buffer, uint32_t maxLen);
+
+bool profilerInit(bx::AllocatorI* allocator)
+{
+	JX_CHECK(s_Profiler == nullptr, "Profiler already initialized");
+	JX_CHECK(bx::isPowerOf2<uint32_t>(JX_CONFIG_PROFILER_THREAD_BUFFER_SIZE), "JX_CONFIG_PROFILER_THREAD_BUFFER_SIZE must be a power of 2");
+
+	Profiler* prof = (Profiler*)BX_ALLOC(allocator, sizeof(Profiler));
+	if (!prof) {
+		return false;
+	}
+
+	bx::memSet(prof, 0, sizeof(Profiler));
+	prof->m_Allocator = allocator;
+	prof->m_Mutex = BX_NEW(allocator, Mutex)("Profiler");
+	prof->m_ThreadTLS = BX_NEW(allocator, bx::TlsData)();
+	prof->m_StartTime = clockGetTicks();
+	prof->m_FrameStart = prof->m_StartTime;
+
+	s_Profiler = prof;
+
+	return true;
+}
+
+void profilerShutdown()
+{
+	Profiler* prof = s_Profiler;
+	if (!prof) {
+		return;
+	}
+
+	// New calls see a null profiler from here on. Wait for the ones in progress before
+	// freeing anything.
+	s_Profiler = nullptr;
+	bx::memoryBarrier();
+
+	for (uint32_t i = 0; i < PROFILER_NUM_CALL_SLOTS; ++i) {
+		while (s_ProfilerCallSlots[i].m_NumCalls != 0) {
+			bx::yield();
+		}
+	}
+
+	bx::readBarrier();
+
+	profCaptureEnd(prof);
+
+	bx::AllocatorI* allocator = prof->m_Allocator;
+
+	ProfilerThread* pt = prof->m_Threads;
+	while (pt) {
+		ProfilerThread* next = pt->m_Next;
+		profThreadCloseHWCounters(pt);
+		BX_ALIGNED_FREE(allocator, pt, PROFILER_CACHE_LINE_SIZE);
+		pt = next;
+	}
+
+	BX_FREE(allocator, prof->m_Stats);
+	BX_DELETE(allocator, prof->m_ThreadTLS);
+	BX_DELETE(allocator, prof->m_Mutex);
+	BX_FREE(allocator, prof);
+}
+
+bool profilerIsInitialized()
+{
+	return s_Profiler != nullptr;
+}
+
+void profilerFrame()
+{
+	ProfilerRef ref;
+	Profiler* prof = ref.m_Profiler;
+	if (!prof) {
+		return;
+	}
+
+	const int64_t now = clockGetTicks();
+
+	MutexScope ms(*prof->m_Mutex);
+
+	// A window starts with the events of the frame which has just ended, since they
+	// were recorded before the trigger was processed.
+	const bool trigger = bx::atomicCompareAndSwap<int32_t>(&prof->m_TriggerPending, 1, 0) == 1;
+	ProfilerCapture* capture = prof->m_Capture;
+	if (trigger && capture && !capture->m_Recording && capture->m_Desc.m_Mode == ProfilerCaptureMode::Triggered) {
+		profCaptureBeginWindow(prof, prof->m_FrameStart);
+	}
+
+	profilerDrainThreads(prof);
+
+	if (capture && capture->m_Recording) {
+		const ProfilerCaptureDesc* desc = &capture->m_Desc;
+		const uint64_t numFrames = prof->m_FrameID - capture->m_WindowStartFrame + 1;
+		const int64_t duration_ms = clockTicksToNs(now - capture->m_WindowStart) / 1000000;
+		const bool done = (desc->m_MaxFrames != 0 && numFrames >= desc->m_MaxFrames)
+			|| (desc->m_MaxDuration_ms != 0 && duration_ms >= (int64_t)desc->m_MaxDuration_ms)
+			;
+
+		if (done) {
+			profCaptureEndWindow(prof, now);
+			if (desc->m_Mode == ProfilerCaptureMode::Continuous) {
+				profCaptureClose(prof);
+			}
+		}
+	}
+
+	// Zones which are still open take part in this frame's hierarchy, even if they
+	// don't have any stats yet.
+	uint32_t numDropped = prof->m_NumDroppedNodes;
+	uint32_t numActive = 0;
+	for (ProfilerThread* pt = prof->m_Threads; pt; pt = pt->m_Next) {
+		for (uint32_t i = 0; i < pt->m_StackSize; ++i) {
+			if (pt->m_Stack[i].m_NodeID != PROFILER_INVALID_NODE) {
+				pt->m_Nodes[pt->m_Stack[i].m_NodeID].m_Active = true;
+			}
+		}
+
+		for (uint32_t i = 1; i < pt->m_NumNodes; ++i) {
+			numActive += pt->m_Nodes[i].m_Active ? 1 : 0;
+		}
+
+		const uint32_t threadDropped = pt->m_NumDropped;
+		numDropped += threadDropped - pt->m_NumDroppedReported;
+		pt->m_NumDroppedReported = threadDropped;
+	}
+
+	prof->m_NumStats = 0;
+	if (profilerReserveStats(prof, numActive)) {
+		for (ProfilerThread* pt = prof->m_Threads; pt; pt = pt->m_Next) {
+			profilerEmitNodes(prof, pt, PROFILER_ROOT_NODE, UINT32_MAX, 0);
+		}
+	}
+
+	// Reset the stats for the next frame.
+	for (ProfilerThread* pt = prof->m_Threads; pt; pt = pt->m_Next) {
+		for (uint32_t i = 0; i < pt->m_NumNodes; ++i) {
+			ProfilerNode* node = &pt->m_Nodes[i];
+			node->m_Count = 0;
+			node->m_Active = false;
+			node->m_Total = 0;
+			node->m_Self = 0;
+			node->m_Min = INT64_MAX;
+			node->m_Max = 0;
+			node->m_HWCounterMask = 0;
+			node->m_NumHWSamples = 0;
+			bx::memSet(node->m_HWCounters, 0, sizeof(node->m_HWCounters));
+		}
+	}
+
+	prof->m_FrameInfo.m_FrameID = prof->m_FrameID;
+	prof->m_FrameInfo.m_Duration_ns = clockTicksToNs(now - prof->m_FrameStart);
+	prof->m_FrameInfo.m_NumZones = prof->m_NumStats;
+	prof->m_FrameInfo.m_NumDroppedZones = numDropped;
+
+	prof->m_NumDroppedNodes = 0;
+	prof->m_FrameStart = now;
+	++prof->m_FrameID;
+}
+
+void profilerSetThreadName(const char* name)
+{
+	ProfilerRef ref;
+	Profiler* prof = ref.m_Profiler;
+	if (!prof) {
+		return;
+	}
+
+	ProfilerThread* pt = profilerGetThread(prof);
+	if (!pt) {
+		return;
+	}
+
+	MutexScope ms(*prof->m_Mutex);
+	bx::strCopy(pt->m_Name, PROFILER_MAX_THREAD_NAME, name);
+}
+
+uint32_t profilerGetNumThreads()
+{
+	ProfilerRef ref;
+	Profiler* prof = ref.m_Profiler;
+	return prof
+		? prof->m_NumThreads
+		: 0
+		;
+}
+
+bool profilerGetThreadName(uint32_t threadID, char* buffer, uint32_t maxLen)
+{
+	ProfilerRef ref;
+	Profiler* prof = ref.m_Profiler;
+	if (!prof) {
+		return false;
+	}
+
+	MutexScope ms(*prof->m_Mutex);
+
+	for (ProfilerThread* pt = prof->m_Threads; pt; pt = pt->m_Next) {
+		if (pt->m_ID == threadID) {
+			bx::strCopy(buffer, (int32_t)maxLen, pt->m_Name);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool profilerBeginCapture(BaseDir::Enum baseDir, const char* relPath, const ProfilerCaptureDesc* desc)
+{
+	ProfilerRef ref;
+	Profiler* prof = ref.m_Profiler;
+	if (!prof) {
+		return false;
+	}
+
+	MutexScope ms(*prof->m_Mutex);
+
+	if (prof->m_Capture) {
+		JX_CHECK(false, "A profiler capture is already open");
+		return false;
+	}
+
+	ProfilerCapture* capture = (ProfilerCapture*)BX_ALLOC(prof->m_Allocator, sizeof(ProfilerCapture) + PROFILER_CAPTURE_BUFFER_SIZE);
+	if (!capture) {
+		return false;
+	}
+
+	bx::memSet(capture, 0, sizeof(ProfilerCapture));
+	capture->m_Buffer = (char*)(capture + 1);
+	capture->m_Desc = *desc;
+	capture->m_ID = ++prof->m_NextCaptureID;
+	capture->m_FirstEvent = true;
+	capture->m_File = fsFileOpenWrite(baseDir, relPath);
+	if (!capture->m_File) {
+		BX_FREE(prof->m_Allocator, capture);
+		return false;
+	}
+
+	static const char kHeader[] = "{\"traceEvents\":[\n";
+	profCaptureWrite(capture, kHeader, sizeof(kHeader) - 1);
+
+	prof->m_Capture = capture;
+	prof->m_TriggerPending = 0;
+
+	if (desc->m_Mode == ProfilerCaptureMode::Continuous) {
+		profCaptureBeginWindow(prof, clockGetTicks());
+	}
+
+	return true;
+}
+
+void profilerEndCapture()
+{
+	ProfilerRef ref;
+	Profiler* prof = ref.m_Profiler;
+	if (!prof) {
+		return;
+	}
+
+	MutexScope ms(*prof->m_Mutex);
+	profCaptureEnd(prof);
+}
+
+bool profilerIsCapturing()
+{
+	ProfilerRef ref;
+	Profiler* prof = ref.m_Profiler;
+	if (!prof) {
+		return false;
+	}
+
+	MutexScope ms(*prof->m_Mutex);
+	return prof->m_Capture && prof->m_Capture->m_Recording;
+}
+
+void profilerTriggerCapture()
+{
+	ProfilerRef ref;
+	Profiler* prof = ref.m_Profiler;
+	if (prof) {
+		prof->m_TriggerPending = 1;
+	}
+}
+
+uint32_t profilerGetFrameStats(ProfilerZoneStats* stats, uint32_t maxStats, ProfilerFrameInfo* info)
+{
+	ProfilerRef ref;
+	Profiler* prof = ref.m_Profiler;
+	if (!prof) {
+		return 0;
+	}
+
+	MutexScope ms(*prof->m_Mutex);
+
+	// Entries past maxStats are cut off; their children would point to missing parents.
+	const uint32_t numStats = bx::min<uint32_t>(prof->m_NumStats, maxStats);
+	bx::memCopy(stats, prof->m_Stats, sizeof(ProfilerZoneStats) * numStats);
+
+	if (info) {
+		*info = prof->m_FrameInfo;
+	}
+
+	return numStats;
+}
+
+uint32_t profilerEnableHWCounters(uint32_t counterMask)
+{
+	ProfilerRef ref;
+	Profiler* prof = ref.m_Profiler;
+	if (!prof) {
+		return 0;
+	}
+
+	ProfilerThread* pt = profilerGetThread(prof);
+	if (!pt) {
+		return 0;
+	}
+
+	profThreadCloseHWCounters(pt);
+
+#if BX_PLATFORM_LINUX
+	static const struct
+	{
+		uint32_t m_Type;
+		uint64_t m_Config;
+	} kPerfEvents[ProfilerHWCounter::Count] = {
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+	};
+
+	// All counters are opened in a single group, so they are scheduled together and can be
+	// read with a single call. The first counter which opens successfully leads the group.
+	int32_t groupFD = -1;
+	uint32_t mask = 0;
+	uint32_t num = 0;
+	for (uint32_t i = 0; i < ProfilerHWCounter::Count; ++i) {
+		if ((counterMask & (1u << i)) == 0) {
+			continue;
+		}
+
+		struct perf_event_attr attr;
+		bx::memSet(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = kPerfEvents[i].m_Type;
+		attr.config = kPerfEvents[i].m_Config;
+		attr.disabled = groupFD == -1 ? 1 : 0;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP;
+
+		const int32_t fd = (int32_t)::syscall(__NR_perf_event_open, &attr, 0, -1, groupFD, PERF_FLAG_FD_CLOEXEC);
+		if (fd < 0) {
+			continue;
+		}
+
+		if (groupFD == -1) {
+			groupFD = fd;
+		}
+
+		pt->m_HWCounterFD[i] = fd;
+		mask |= 1u << i;
+		++num;
+	}
+
+	if (num == 0) {
+		return 0;
+	}
+
+	::ioctl(groupFD, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	::ioctl(groupFD, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+	pt->m_HWGroupFD = groupFD;
+	pt->m_HWCounterMask = mask;
+	pt->m_NumHWCounters = num;
+
+	return mask;
+#else
+	BX_UNUSED(counterMask);
+	return 0;
+#endif
+}
+
+void profilerDisableHWCounters()
+{
+	ProfilerRef ref;
+	Profiler* prof = ref.m_Profiler;
+	if (!prof) {
+		return;
+	}
+
+	ProfilerThread* pt = (ProfilerThread*)prof->m_ThreadTLS->get();
+	if (pt) {
+		profThreadCloseHWCounters(pt);
+	}
+}
+
+void profilerZoneBegin(const ProfilerZoneDesc* zone)
+{
+	ProfilerRef ref;
+	Profiler* prof = ref.m_Profiler;
+	if (!prof) {
+		return;
+	}
+
+	ProfilerThread* pt = profilerGetThread(prof);
+	if (!pt) {
+		return;
+	}
+
+	// There must be room for the end events of all open zones, so they are never dropped.
+	const uint32_t eventsPerZone = pt->m_NumHWCounters != 0
+		? 2 + pt->m_NumHWCounters
+		: 1
+		;
+	const bool record = pt->m_DroppedDepth == 0
+		&& pt->m_Depth < JX_CONFIG_PROFILER_MAX_DEPTH
+		&& profThreadReserve(pt, (pt->m_Depth + 2) * eventsPerZone)
+		;
+
+	if (!record) {
+		++pt->m_DroppedDepth;
+		pt->m_NumDropped = pt->m_NumDropped + 1;
+		return;
+	}
+
+	profThreadPushZone(pt, clockGetTicks(), (uintptr_t)zone | ProfilerEventType::ZoneBegin, pt->m_NumHWCounters != 0);
+	++pt->m_Depth;
+}
+
+void profilerZoneEnd(const ProfilerZoneDesc* zone)
+{
+	ProfilerRef ref;
+	Profiler* prof = ref.m_Profiler;
+	if (!prof) {
+		return;
+	}
+
+	ProfilerThread* pt = (ProfilerThread*)prof->m_ThreadTLS->get();
+	if (!pt) {
+		return;
+	}
+
+	if (pt->m_DroppedDepth != 0) {
+		--pt->m_DroppedDepth;
+		return;
+	}
+
+	// The zone began before the profiler was initialized.
+	if (pt->m_Depth == 0) {
+		return;
+	}
+
+	// Counters enabled while zones were open aren't covered by the space reserved when
+	// they began; the end event must fit anyway.
+	const int64_t time = clockGetTicks();
+	const bool sampleHWCounters = pt->m_NumHWCounters != 0
+		&& profThreadReserve(pt, pt->m_Depth + 1 + pt->m_NumHWCounters)
+		;
+	profThreadPushZone(pt, time, (uintptr_t)zone | ProfilerEventType::ZoneEnd, sampleHWCounters);
+	--pt->m_Depth;
+}
+
+void profilerInstant(const ProfilerZoneDesc* desc)
+{
+	ProfilerRef ref;
+	Profiler* prof = ref.m_Profiler;
+	if (!prof) {
+		return;
+	}
+
+	ProfilerThread* pt = profilerGetThread(prof);
+	if (!pt) {
+		return;
+	}
+
+	if (!profThreadReserve(pt, pt->m_Depth + 1)) {
+		pt->m_NumDropped = pt->m_NumDropped + 1;
+		return;
+	}
+
+	profThreadPush(pt, clockGetTicks(), (uintptr_t)desc | ProfilerEventType::Instant);
+}
+
+void profilerCounter(const ProfilerZoneDesc* desc, double value)
+{
+	JX_CHECK(desc != nullptr, "Invalid counter descriptor");
+
+	ProfilerRef ref;
+	Profiler* prof = ref.m_Profiler;
+	if (!prof) {
+		return;
+	}
+
+	ProfilerThread* pt = profilerGetThread(prof);
+	if (!pt) {
+		return;
+	}
+
+	if (!profThreadReserve(pt, pt->m_Depth + 2)) {
+		pt->m_NumDropped = pt->m_NumDropped + 1;
+		return;
+	}
+
+	int64_t bits;
+	bx::memCopy(&bits, &value, sizeof(double));
+	profThreadPush2(pt, clockGetTicks(), (uintptr_t)desc | ProfilerEventType::Counter, bits, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Internal
+//
+ProfilerRef::ProfilerRef()
+{
+	uint32_t slot = s_ProfilerThreadCallSlot;
+	if (slot == UINT32_MAX) {
+		slot = bx::atomicFetchAndAdd<uint32_t>(&s_ProfilerNextCallSlot, 1) % PROFILER_NUM_CALL_SLOTS;
+		s_ProfilerThreadCallSlot = slot;
+	}
+
+	// Full barrier; the slot must be visible to profilerShutdown() before s_Profiler is read.
+	m_Slot = &s_ProfilerCallSlots[slot];
+	bx::atomicFetchAndAdd<int32_t>(&m_Slot->m_NumCalls, 1);
+	m_Profiler = s_Profiler;
+}
+
+ProfilerRef::~ProfilerRef()
+{
+	bx::atomicFetchAndAdd<int32_t>(&m_Slot->m_NumCalls, -1);
+}
+
+static ProfilerThread* profilerGetThread(Profiler* prof)
+{
+	ProfilerThread* pt = (ProfilerThread*)prof->m_ThreadTLS->get();
+	if (pt) {
+		return pt;
+	}
+
+	const uint32_t capacity = JX_CONFIG_PROFILER_THREAD_BUFFER_SIZE;
+	const uint32_t maxNodes = JX_CONFIG_PROFILER_MAX_ZONES_PER_THREAD;
+
+	const uint32_t totalMem = 0
+		+ sizeof(ProfilerThread)
+		+ sizeof(ProfilerEvent) * capacity
+		+ sizeof(ProfilerNode) * maxNodes
+		;
+
+	uint8_t* mem = (uint8_t*)BX_ALIGNED_ALLOC(prof->m_Allocator, totalMem, PROFILER_CACHE_LINE_SIZE);
+	if (!mem) {
+		JX_CHECK(false, "Failed to allocate profiler thread buffer");
+		return nullptr;
+	}
+
+	bx::memSet(mem, 0, sizeof(ProfilerThread));
+
+	pt = (ProfilerThread*)mem;
+	mem += sizeof(ProfilerThread);
+	pt->m_Events = (ProfilerEvent*)mem;
+	mem += sizeof(ProfilerEvent) * capacity;
+	pt->m_Nodes = (ProfilerNode*)mem;
+	pt->m_Mask = capacity - 1;
+	pt->m_OSThreadID = bx::getTid();
+
+	// Root node (parent of the top-level zones)
+	bx::memSet(&pt->m_Nodes[PROFILER_ROOT_NODE], 0, sizeof(ProfilerNode));
+	pt->m_Nodes[PROFILER_ROOT_NODE].m_Parent = PROFILER_INVALID_NODE;
+	pt->m_Nodes[PROFILER_ROOT_NODE].m_FirstChild = PROFILER_INVALID_NODE;
+	pt->m_Nodes[PROFILER_ROOT_NODE].m_LastChild = PROFILER_INVALID_NODE;
+	pt->m_Nodes[PROFILER_ROOT_NODE].m_NextSibling = PROFILER_INVALID_NODE;
+	pt->m_NumNodes = 1;
+
+	// profilerFrame() walks the list without locking; the thread must be fully
+	// initialized before it becomes reachable.
+	{
+		MutexScope ms(*prof->m_Mutex);
+		pt->m_ID = prof->m_NumThreads;
+		profilerGetOSThreadName(pt->m_OSThreadID, pt->m_Name, PROFILER_MAX_THREAD_NAME);
+		pt->m_Next = prof->m_Threads;
+		bx::writeBarrier();
+		prof->m_Threads = pt;
+		prof->m_NumThreads = prof->m_NumThreads + 1;
+	}
+
+	prof->m_ThreadTLS->set(pt);
+
+	return pt;
+}
+
+// jx::Thread (through bx::Thread) names the OS threads.
+static void profilerGetOSThreadName(uint32_t osThreadID, char* buffer, uint32_t maxLen)
+{
+	buffer[0] = '\0';
+
+#if BX_PLATFORM_LINUX || BX_PLATFORM_RPI || BX_PLATFORM_OSX
+	if (pthread_getname_np(pthread_self(), buffer, maxLen) != 0) {
+		buffer[0] = '\0';
+	}
+#endif
+
+	if (buffer[0] == '\0') {
+		bx::snprintf(buffer, maxLen, "Thread %u", osThreadID);
+	}
+}
+
+static bool profThreadReserve(ProfilerThread* pt, uint32_t numEvents)
+{
+	const uint32_t capacity = pt->m_Mask + 1;
+	if (pt->m_WritePos - pt->m_CachedReadPos + numEvents <= capacity) {
+		return true;
+	}
+
+	pt->m_CachedReadPos = pt->m_ReadPos;
+	return pt->m_WritePos - pt->m_CachedReadPos + numEvents <= capacity;
+}
+
+static void profThreadPush(ProfilerThread* pt, int64_t time, uintptr_t data)
+{
+	const uint32_t writePos = pt->m_WritePos;
+	ProfilerEvent* ev = &pt->m_Events[writePos & pt->m_Mask];
+	ev->m_Time = time;
+	ev->m_Data = data;
+
+	// Publish the event.
+	bx::writeBarrier();
+	pt->m_WritePos = writePos + 1;
+}
+
+// Both events are published at once.
+static void profThreadPush2(ProfilerThread* pt, int64_t time, uintptr_t data, int64_t time2, uintptr_t data2)
+{
+	const uint32_t writePos = pt->m_WritePos;
+	ProfilerEvent* ev = &pt->m_Events[writePos & pt->m_Mask];
+	ev->m_Time = time;
+	ev->m_Data = data;
+
+	ev = &pt->m_Events[(writePos + 1) & pt->m_Mask];
+	ev->m_Time = time2;
+	ev->m_Data = data2;
+
+	bx::writeBarrier();
+	pt->m_WritePos = writePos + 2;
+}
+
+// The zone event and its hardware counter sample are published at once. The caller must have
+// reserved room for both.
+static void profThreadPushZone(ProfilerThread* pt, int64_t time, uintptr_t data, bool sampleHWCounters)
+{
+	uint64_t values[ProfilerHWCounter::Count];
+	if (!sampleHWCounters || !profThreadReadHWCounters(pt, values)) {
+		profThreadPush(pt, time, data);
+		return;
+	}
+
+	const uint32_t writePos = pt->m_WritePos;
+	ProfilerEvent* ev = &pt->m_Events[writePos & pt->m_Mask];
+	ev->m_Time = time;
+	ev->m_Data = data;
+
+	ev = &pt->m_Events[(writePos + 1) & pt->m_Mask];
+	ev->m_Time = (int64_t)pt->m_HWCounterMask;
+	ev->m_Data = ProfilerEventType::Counter;
+
+	const uint32_t numCounters = pt->m_NumHWCounters;
+	for (uint32_t i = 0; i < numCounters; ++i) {
+		ev = &pt->m_Events[(writePos + 2 + i) & pt->m_Mask];
+		ev->m_Time = (int64_t)values[i];
+		ev->m_Data = 0;
+	}
+
+	bx::writeBarrier();
+	pt->m_WritePos = writePos + 2 + numCounters;
+}
+
+// Values are returned in the order of the counters in the mask.
+static bool profThreadReadHWCounters(ProfilerThread* pt, uint64_t* values)
+{
+#if BX_PLATFORM_LINUX
+	// PERF_FORMAT_GROUP: { nr, values[nr] }
+	uint64_t data[1 + ProfilerHWCounter::Count];
+	const ssize_t size = (ssize_t)(sizeof(uint64_t) * (1 + pt->m_NumHWCounters));
+	if (::read(pt->m_HWGroupFD, data, (size_t)size) != size || data[0] != pt->m_NumHWCounters) {
+		return false;
+	}
+
+	bx::memCopy(values, &data[1], sizeof(uint64_t) * pt->m_NumHWCounters);
+	return true;
+#else
+	BX_UNUSED(pt, values);
+	return false;
+#endif
+}
+
+static void profThreadCloseHWCounters(ProfilerThread* pt)
+{
+#if BX_PLATFORM_LINUX
+	for (uint32_t i = 0; i < ProfilerHWCounter::Count; ++i) {
+		if ((pt->m_HWCounterMask & (1u << i)) != 0) {
+			::close(pt->m_HWCounterFD[i]);
+		}
+	}
+#endif
+
+	pt->m_HWCounterMask = 0;
+	pt->m_NumHWCounters = 0;
+	pt->m_HWGroupFD = -1;
+}
+
+// Consumes the hardware counter sample following a zone event, if there is one. Values are
+// returned indexed by counter.
+static uint32_t profThreadPopHWSample(ProfilerThread* pt, uint32_t* readPos, uint32_t writePos, uint64_t* values)
+{
+	if (*readPos == writePos) {
+		return 0;
+	}
+
+	const ProfilerEvent* ev = &pt->m_Events[*readPos & pt->m_Mask];
+	if (ev->m_Data != ProfilerEventType::Counter) {
+		return 0;
+	}
+
+	const uint32_t mask = (uint32_t)ev->m_Time;
+	++*readPos;
+
+	for (uint32_t i = 0; i < ProfilerHWCounter::Count; ++i) {
+		if ((mask & (1u << i)) != 0) {
+			values[i] = (uint64_t)pt->m_Events[*readPos & pt->m_Mask].m_Time;
+			++*readPos;
+		}
+	}
+
+	return mask;
+}
+
+static void profThreadProcessEvents(Profiler* prof, ProfilerThread* pt)
+{
+	const uint32_t writePos = pt->m_WritePos;
+	bx::readBarrier();
+
+	ProfilerCapture* capture = prof->m_Capture && prof->m_Capture->m_Recording
+		? prof->m_Capture
+		: nullptr
+		;
+
+	uint32_t readPos = pt->m_ReadPos;
+	while (readPos != writePos) {
+		const ProfilerEvent* ev = &pt->m_Events[readPos & pt->m_Mask];
+		++readPos;
+
+		const uint32_t type = (uint32_t)(ev->m_Data & PROFILER_EVENT_TYPE_MASK);
+		const ProfilerZoneDesc* zone = (const ProfilerZoneDesc*)(ev->m_Data & ~PROFILER_EVENT_TYPE_MASK);
+
+		if (type == ProfilerEventType::ZoneBegin) {
+			JX_CHECK(pt->m_StackSize < JX_CONFIG_PROFILER_MAX_DEPTH, "Profiler zone stack overflow");
+
+			const uint32_t parentID = pt->m_StackSize != 0
+				? pt->m_Stack[pt->m_StackSize - 1].m_NodeID
+				: PROFILER_ROOT_NODE
+				;
+
+			ProfilerStackEntry* entry = &pt->m_Stack[pt->m_StackSize++];
+			entry->m_NodeID = profThreadFindChild(prof, pt, parentID, zone);
+			entry->m_Traced = capture != nullptr;
+			entry->m_BeginTime = ev->m_Time;
+			entry->m_ChildTime = 0;
+			entry->m_HWCounterMask = profThreadPopHWSample(pt, &readPos, writePos, entry->m_HWCounters);
+
+			if (capture) {
+				profCaptureWriteEvent(prof, pt, "B", zone, ev->m_Time, nullptr);
+			}
+		} else if (type == ProfilerEventType::ZoneEnd) {
+			JX_CHECK(pt->m_StackSize != 0, "Profiler zone stack underflow");
+
+			const ProfilerStackEntry* entry = &pt->m_Stack[--pt->m_StackSize];
+			const int64_t duration = ev->m_Time - entry->m_BeginTime;
+
+			// Counters which have been sampled at both ends of the zone
+			uint64_t hwCounters[ProfilerHWCounter::Count];
+			const uint32_t hwMask = entry->m_HWCounterMask & profThreadPopHWSample(pt, &readPos, writePos, hwCounters);
+			for (uint32_t i = 0; i < ProfilerHWCounter::Count; ++i) {
+				hwCounters[i] = (hwMask & (1u << i)) != 0
+					? hwCounters[i] - entry->m_HWCounters[i]
+					: 0
+					;
+			}
+
+			if (entry->m_NodeID != PROFILER_INVALID_NODE) {
+				ProfilerNode* node = &pt->m_Nodes[entry->m_NodeID];
+				JX_CHECK(node->m_Zone == zone, "Mismatched profiler zone end");
+				node->m_Count++;
+				node->m_Active = true;
+				node->m_Total += duration;
+				node->m_Self += duration - entry->m_ChildTime;
+				node->m_Min = bx::min<int64_t>(node->m_Min, duration);
+				node->m_Max = bx::max<int64_t>(node->m_Max, duration);
+
+				if (hwMask != 0) {
+					node->m_HWCounterMask |= hwMask;
+					node->m_NumHWSamples++;
+					for (uint32_t i = 0; i < ProfilerHWCounter::Count; ++i) {
+						node->m_HWCounters[i] += hwCounters[i];
+					}
+				}
+			}
+
+			if (pt->m_StackSize != 0) {
+				pt->m_Stack[pt->m_StackSize - 1].m_ChildTime += duration;
+			}
+
+			if (capture && entry->m_Traced) {
+				char args[256];
+				profCaptureFormatHWCounters(hwMask, hwCounters, args, BX_COUNTOF(args));
+				profCaptureWriteEvent(prof, pt, "E", zone, ev->m_Time, hwMask != 0 ? args : nullptr);
+			}
+		} else if (type == ProfilerEventType::Instant) {
+			if (capture) {
+				profCaptureWriteEvent(prof, pt, "i", zone, ev->m_Time, ",\"s\":\"t\"");
+			}
+		} else if (type == ProfilerEventType::Counter) {
+			const ProfilerEvent* valueEv = &pt->m_Events[readPos & pt->m_Mask];
+			++readPos;
+
+			if (capture) {
+				double value;
+				bx::memCopy(&value, &valueEv->m_Time, sizeof(double));
+
+				char args[64];
+				bx::snprintf(args, BX_COUNTOF(args), ",\"args\":{\"value\":%.17g}", value);
+				profCaptureWriteEvent(prof, pt, "C", zone, ev->m_Time, args);
+			}
+		}
+	}
+
+	// Make sure all events have been read before handing the space back to the producer.
+	bx::memoryBarrier();
+	pt->m_ReadPos = readPos;
+}
+
+// Returns the node of the zone under the specified parent, adding it if it doesn't exist.
+// Returns PROFILER_INVALID_NODE if the tree is full.
+static uint32_t profThreadFindChild(Profiler* prof, ProfilerThread* pt, uint32_t parentID, const ProfilerZoneDesc* zone)
+{
+	if (parentID == PROFILER_INVALID_NODE) {
+		++prof->m_NumDroppedNodes;
+		return PROFILER_INVALID_NODE;
+	}
+
+	ProfilerNode* parent = &pt->m_Nodes[parentID];
+	for (uint32_t childID = parent->m_FirstChild; childID != PROFILER_INVALID_NODE; childID = pt->m_Nodes[childID].m_NextSibling) {
+		if (pt->m_Nodes[childID].m_Zone == zone) {
+			return childID;
+		}
+	}
+
+	if (pt->m_NumNodes == JX_CONFIG_PROFILER_MAX_ZONES_PER_THREAD) {
+		++prof->m_NumDroppedNodes;
+		return PROFILER_INVALID_NODE;
+	}
+
+	const uint32_t nodeID = pt->m_NumNodes++;
+	ProfilerNode* node = &pt->m_Nodes[nodeID];
+	bx::memSet(node, 0, sizeof(ProfilerNode));
+	node->m_Zone = zone;
+	node->m_Parent = parentID;
+	node->m_FirstChild = PROFILER_INVALID_NODE;
+	node->m_LastChild = PROFILER_INVALID_NODE;
+	node->m_NextSibling = PROFILER_INVALID_NODE;
+	node->m_Min = INT64_MAX;
+
+	// Children are kept in the order they were first seen.
+	if (parent->m_LastChild != PROFILER_INVALID_NODE) {
+		pt->m_Nodes[parent->m_LastChild].m_NextSibling = nodeID;
+	} else {
+		parent->m_FirstChild = nodeID;
+	}
+	parent->m_LastChild = nodeID;
+
+	return nodeID;
+}
+
+static bool profilerReserveStats(Profiler* prof, uint32_t numStats)
+{
+	if (numStats <= prof->m_StatsCapacity) {
+		return true;
+	}
+
+	const uint32_t capacity = bx::max<uint32_t>(numStats, prof->m_StatsCapacity * 2);
+	ProfilerZoneStats* stats = (ProfilerZoneStats*)BX_ALLOC(prof->m_Allocator, sizeof(ProfilerZoneStats) * capacity);
+	if (!stats) {
+		return false;
+	}
+
+	BX_FREE(prof->m_Allocator, prof->m_Stats);
+	prof->m_Stats = stats;
+	prof->m_StatsCapacity = capacity;
+
+	return true;
+}
+
+// Depth-first. The parent of an active node is always active.
+static void profilerEmitNodes(Profiler* prof, ProfilerThread* pt, uint32_t nodeID, uint32_t parentStatID, uint32_t depth)
+{
+	for (uint32_t childID = pt->m_Nodes[nodeID].m_FirstChild; childID != PROFILER_INVALID_NODE; childID = pt->m_Nodes[childID].m_NextSibling) {
+		const ProfilerNode* node = &pt->m_Nodes[childID];
+		if (!node->m_Active) {
+			continue;
+		}
+
+		const uint32_t statID = prof->m_NumStats++;
+		ProfilerZoneStats* stats = &prof->m_Stats[statID];
+		stats->m_Zone = node->m_Zone;
+		stats->m_ThreadID = pt->m_ID;
+		stats->m_ParentID = parentStatID;
+		stats->m_Depth = depth;
+		stats->m_Count = node->m_Count;
+		stats->m_Total_ns = clockTicksToNs(node->m_Total);
+		stats->m_Self_ns = clockTicksToNs(node->m_Self);
+		stats->m_Min_ns = node->m_Count != 0 ? clockTicksToNs(node->m_Min) : 0;
+		stats->m_Max_ns = clockTicksToNs(node->m_Max);
+		stats->m_HWCounterMask = node->m_HWCounterMask;
+		stats->m_NumHWSamples = node->m_NumHWSamples;
+		bx::memCopy(stats->m_HWCounters, node->m_HWCounters, sizeof(stats->m_HWCounters));
+
+		profilerEmitNodes(prof, pt, childID, statID, depth + 1);
+	}
+}
+
+static void profilerDrainThreads(Profiler* prof)
+{
+	for (ProfilerThread* pt = prof->m_Threads; pt; pt = pt->m_Next) {
+		profThreadProcessEvents(prof, pt);
+	}
+}
+
+static void profCaptureBeginWindow(Profiler* prof, int64_t time)
+{
+	ProfilerCapture* capture = prof->m_Capture;
+	capture->m_Recording = true;
+	capture->m_WindowStart = time;
+	capture->m_WindowStartFrame = prof->m_FrameID;
+}
+
+// Zones which are still open are closed at the end of the window, so every begin event in
+// the file has a matching end event.
+static void profCaptureEndWindow(Profiler* prof, int64_t time)
+{
+	ProfilerCapture* capture = prof->m_Capture;
+
+	for (ProfilerThread* pt = prof->m_Threads; pt; pt = pt->m_Next) {
+		for (uint32_t i = pt->m_StackSize; i != 0; --i) {
+			ProfilerStackEntry* entry = &pt->m_Stack[i - 1];
+			if (entry->m_Traced) {
+				const ProfilerZoneDesc* zone = entry->m_NodeID != PROFILER_INVALID_NODE
+					? pt->m_Nodes[entry->m_NodeID].m_Zone
+					: nullptr
+					;
+				profCaptureWriteEvent(prof, pt, "E", zone, time, nullptr);
+				entry->m_Traced = false;
+			}
+		}
+	}
+
+	capture->m_Recording = false;
+}
+
+// Called with the profiler's mutex held.
+static void profCaptureEnd(Profiler* prof)
+{
+	if (!prof->m_Capture) {
+		return;
+	}
+
+	// The events are also aggregated into the current frame's stats.
+	if (prof->m_Capture->m_Recording) {
+		profilerDrainThreads(prof);
+		profCaptureEndWindow(prof, clockGetTicks());
+	}
+
+	profCaptureClose(prof);
+}
+
+static void profCaptureClose(Profiler* prof)
+{
+	ProfilerCapture* capture = prof->m_Capture;
+
+	static const char kFooter[] = "\n]}\n";
+	profCaptureWrite(capture, kFooter, sizeof(kFooter) - 1);
+	profCaptureFlush(capture);
+
+	fsFileClose(capture->m_File);
+	BX_FREE(prof->m_Allocator, capture);
+
+	prof->m_Capture = nullptr;
+}
+
+static void profCaptureWriteEvent(Profiler* prof, ProfilerThread* pt, const char* phase, const ProfilerZoneDesc* desc, int64_t time, const char* extra)
+{
+	ProfilerCapture* capture = prof->m_Capture;
+
+	char str[PROFILER_MAX_TRACE_EVENT];
+	char name[PROFILER_MAX_TRACE_NAME];
+
+	// Every thread's track is named before its first event.
+	if (pt->m_CaptureID != capture->m_ID) {
+		pt->m_CaptureID = capture->m_ID;
+
+		profEscapeString(pt->m_Name, name, PROFILER_MAX_TRACE_NAME);
+		const int32_t len = bx::snprintf(str, PROFILER_MAX_TRACE_EVENT
+			, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}"
+			, capture->m_FirstEvent ? "" : ",\n"
+			, pt->m_OSThreadID
+			, name);
+		profCaptureWrite(capture, str, (uint32_t)bx::clamp<int32_t>(len, 0, PROFILER_MAX_TRACE_EVENT - 1));
+		capture->m_FirstEvent = false;
+	}
+
+	// Timestamps are in microseconds since the profiler was initialized.
+	const double ts = (double)clockTicksToNs(time - prof->m_StartTime) * 1.0e-3;
+
+	profEscapeString(desc ? desc->m_Name : "", name, PROFILER_MAX_TRACE_NAME);
+	const int32_t len = bx::snprintf(str, PROFILER_MAX_TRACE_EVENT
+		, "%s{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%u%s}"
+		, capture->m_FirstEvent ? "" : ",\n"
+		, name
+		, phase
+		, ts
+		, pt->m_OSThreadID
+		, extra ? extra : "");
+	profCaptureWrite(capture, str, (uint32_t)bx::clamp<int32_t>(len, 0, PROFILER_MAX_TRACE_EVENT - 1));
+	capture->m_FirstEvent = false;
+}
+
+// Hardware counters are attached to the end events of zones as args.
+static void profCaptureFormatHWCounters(uint32_t mask, const uint64_t* values, char* buffer, uint32_t maxLen)
+{
+	static const char* kCounterNames[ProfilerHWCounter::Count] = {
+		"cycles",
+		"instructions",
+		"cache_misses",
+		"branch_misses",
+		"page_faults",
+	};
+
+	int32_t len = bx::snprintf(buffer, maxLen, ",\"args\":{");
+	const char* separator = "";
+	for (uint32_t i = 0; i < ProfilerHWCounter::Count; ++i) {
+		if ((mask & (1u << i)) != 0) {
+			len += bx::snprintf(&buffer[len], maxLen - len, "%s\"%s\":%llu", separator, kCounterNames[i], (unsigned long long)values[i]);
+			separator = ",";
+		}
+	}
+
+	bx::snprintf(&buffer[len], maxLen - len, "}");
+}
+
+static void profCaptureWrite(ProfilerCapture* capture, const char* str, uint32_t len)
+{
+	if (capture->m_BufferLen + len > PROFILER_CAPTURE_BUFFER_SIZE) {
+		profCaptureFlush(capture);
+	}
+
+	bx::memCopy(&capture->m_Buffer[capture->m_BufferLen], str, len);
+	capture->m_BufferLen += len;
+}
+
+static void profCaptureFlush(ProfilerCapture* capture)
+{
+	if (capture->m_BufferLen != 0) {
+		fsFileWriteBytes(capture->m_File, capture->m_Buffer, capture->m_BufferLen);
+		capture->m_BufferLen = 0;
+	}
+}
+
+// JSON string escaping. Control characters are replaced by spaces.
+static uint32_t profEscapeString(const char* str, char* buffer, uint32_t maxLen)
+{
+	uint32_t len = 0;
+	for (; *str != '\0' && len + 2 < maxLen; ++str) {
+		const char ch = *str;
+		if (ch == '"' || ch == '\\') {
+			buffer[len++] = '\\';
+			buffer[len++] = ch;
+		} else {
+			buffer[len++] = (uint8_t)ch < 0x20 ? ' ' : ch;
+		}
+	}
+
+	buffer[len] = '\0';
+
+	return len;
+}
+}
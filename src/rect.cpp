@@ -2,6 +2,7 @@
 #include <jx/sys.h>
 #include <jx/bitset.h>
 #include <jx/vec2.h>
+#include <jx/worker_pool.h>
 #include <bx/math.h>
 
 #if JX_CONFIG_MATH_SIMD
@@ -11,6 +12,29 @@
 
 namespace jx
 {
+// Rects per parallel range. Multiple of 16 (one cache line of SoA floats) and 512 (one
+// cache line of bitset bytes), so each range starts SIMD-aligned and workers never write
+// to the same cache line.
+static const uint32_t kRectParallelGranularity = 4096;
+
+struct RectAoSToSoAJob
+{
+	const Rect* m_AoS;
+	RectSoA* m_SoA;
+};
+
+struct RectIntersectJob
+{
+	const RectSoA* m_SoA;
+	const Rect* m_Test;
+	void* m_Results;
+};
+
+static void rectAoSToSoARange(uint32_t first, uint32_t last, void* userData);
+static void rectIntersectRange(uint32_t first, uint32_t last, void* userData);
+static void rectIntersectBitsetRange(uint32_t first, uint32_t last, void* userData);
+static void rectSoAOffset(const RectSoA* soa, uint32_t offset, RectSoA* sub);
+
 #if JX_CONFIG_MATH_SIMD
 BX_PRAGMA_DIAGNOSTIC_IGNORED_CLANG("-Wunused-const-variable")
 
@@ -613,6 +637,32 @@ bool rectLineSegmentIntersection(const Rect* rect, const jx::Vec2f& s, const jx:
 	return true;
 }
 
+void rectAoSToSoAParallel(WorkerPool* pool, const Rect* aos, uint32_t numRects, RectSoA* soa)
+{
+	RectAoSToSoAJob job;
+	job.m_AoS = aos;
+	job.m_SoA = soa;
+	parallelFor(pool, numRects, kRectParallelGranularity, rectAoSToSoARange, &job);
+}
+
+void rectIntersectParallel(WorkerPool* pool, const RectSoA* soa, uint32_t numRects, const Rect* test, bool* results)
+{
+	RectIntersectJob job;
+	job.m_SoA = soa;
+	job.m_Test = test;
+	job.m_Results = results;
+	parallelFor(pool, numRects, kRectParallelGranularity, rectIntersectRange, &job);
+}
+
+void rectIntersectBitsetParallel(WorkerPool* pool, const RectSoA* soa, uint32_t numRects, const Rect* test, uint8_t* bitset)
+{
+	RectIntersectJob job;
+	job.m_SoA = soa;
+	job.m_Test = test;
+	job.m_Results = bitset;
+	parallelFor(pool, numRects, kRectParallelGranularity, rectIntersectBitsetRange, &job);
+}
+
 void rectCalcFromPointList(const float* points, uint32_t numPoints, Rect* rect)
 {
 	// TODO: SIMD
@@ -629,4 +679,42 @@ void rectCalcFromPointList(const float* points, uint32_t numPoints, Rect* rect)
 		points += 2;
 	}
 }
+
+//////////////////////////////////////////////////////////////////////////
+// Internal
+//
+static void rectSoAOffset(const RectSoA* soa, uint32_t offset, RectSoA* sub)
+{
+	sub->m_MinX = soa->m_MinX + offset;
+	sub->m_MinY = soa->m_MinY + offset;
+	sub->m_MaxX = soa->m_MaxX + offset;
+	sub->m_MaxY = soa->m_MaxY + offset;
+}
+
+static void rectAoSToSoARange(uint32_t first, uint32_t last, void* userData)
+{
+	RectAoSToSoAJob* job = (RectAoSToSoAJob*)userData;
+
+	RectSoA sub;
+	rectSoAOffset(job->m_SoA, first, &sub);
+	rectAoSToSoA(&job->m_AoS[first], last - first, &sub);
+}
+
+static void rectIntersectRange(uint32_t first, uint32_t last, void* userData)
+{
+	RectIntersectJob* job = (RectIntersectJob*)userData;
+
+	RectSoA sub;
+	rectSoAOffset(job->m_SoA, first, &sub);
+	rectIntersect(&sub, last - first, job->m_Test, (bool*)job->m_Results + first);
+}
+
+static void rectIntersectBitsetRange(uint32_t first, uint32_t last, void* userData)
+{
+	RectIntersectJob* job = (RectIntersectJob*)userData;
+
+	RectSoA sub;
+	rectSoAOffset(job->m_SoA, first, &sub);
+	rectIntersectBitset(&sub, last - first, job->m_Test, (uint8_t*)job->m_Results + (first >> 3));
+}
 }
@@ -0,0 +1,593 @@
+#include <jx/sampler.h>
+#include <jx/spooky_hash.h>
+#include <jx/cpu.h>
+#include <jx/sys.h>
+#include <bx/allocator.h>
+#include <bx/cpu.h>
+#include <bx/string.h>
+#include <bx/uint32_t.h>
+
+#if BX_PLATFORM_LINUX
+#include <cxxabi.h>   // abi::__cxa_demangle()
+#include <dlfcn.h>    // dladdr()
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>   // free()
+#include <time.h>     // timer_create()
+#include <ucontext.h>
+#include <unistd.h>   // getpid(), sysconf()
+#include <sys/uio.h>  // process_vm_readv()
+#endif
+
+namespace jx
+{
+#define SAMPLER_MAX_FRAME_SIZE  (256 << 10) // Larger steps between frame pointers end the walk
+#define SAMPLER_WRITE_BUFFER_SIZE (64 << 10)
+#define SAMPLER_MAX_FRAME_NAME  512
+#define SAMPLER_HASH_SEED       0x5A4D504Cull
+
+struct SamplerSample
+{
+	volatile uint32_t m_Committed;
+	uint32_t m_NumFrames;
+	void* m_Frames[JX_CONFIG_SAMPLER_MAX_DEPTH]; // Innermost first
+};
+
+// Unique stack in samplerWriteCollapsedStacks()
+struct SamplerStackEntry
+{
+	uint64_t m_Hash;
+	uint32_t m_SampleID;
+	uint32_t m_Count;
+};
+
+struct SamplerWriter
+{
+	File* m_File;
+	char* m_Buffer;
+	uint32_t m_Len;
+};
+
+struct Sampler
+{
+	bx::AllocatorI* m_Allocator;
+	SamplerSample* m_Samples;
+	uint32_t m_Capacity;
+	uint32_t m_Frequency_hz;
+	volatile uint32_t m_NumReserved; // Can exceed m_Capacity
+	volatile uint32_t m_NumDropped;
+	volatile int32_t m_Running;
+
+#if BX_PLATFORM_LINUX
+	timer_t m_Timer;
+	struct sigaction m_PrevAction;
+	pid_t m_PID;
+	uintptr_t m_PageSize;
+#endif
+};
+
+// Signal handlers register themselves before looking at s_Sampler, so samplerShutdown()
+// knows when the last one has left.
+static Sampler* volatile s_Sampler = nullptr;
+static volatile int32_t s_SamplerActiveHandlers = 0;
+
+#if BX_PLATFORM_LINUX
+static void samplerSignalHandler(int sig, siginfo_t* info, void* ucontext);
+static uint32_t samplerWalkStack(Sampler* sampler, const void* ucontext, void** frames, uint32_t maxFrames);
+static bool samplerIsReadable(Sampler* sampler, uintptr_t addr);
+static bool samplerArmTimer(Sampler* sampler, uint32_t frequency_hz);
+static void samplerWaitForHandlers();
+static int32_t samplerCompareStacks(const SamplerSample* a, const SamplerSample* b);
+static void samplerFormatFrame(void* addr, bool isReturnAddress, char* buffer, uint32_t maxLen);
+static void samplerWrite(SamplerWriter* writer, const char* str, uint32_t len);
+static void samplerFlush(SamplerWriter* writer);
+#endif
+
+bool samplerInit(bx::AllocatorI* allocator, const SamplerDesc* desc)
+{
+	JX_CHECK(s_Sampler == nullptr, "Sampler already initialized");
+	JX_CHECK(desc->m_Frequency_hz != 0 && desc->m_MaxSamples != 0, "Invalid sampler description");
+
+#if BX_PLATFORM_LINUX
+	const uint32_t totalMem = 0
+		+ sizeof(Sampler)
+		+ sizeof(SamplerSample) * desc->m_MaxSamples
+		;
+
+	uint8_t* buffer = (uint8_t*)BX_ALLOC(allocator, totalMem);
+	if (!buffer) {
+		return false;
+	}
+
+	// Touch the whole buffer so the signal handler never page-faults on fresh memory.
+	bx::memSet(buffer, 0, totalMem);
+
+	uint8_t* ptr = buffer;
+	Sampler* sampler = (Sampler*)ptr; ptr += sizeof(Sampler);
+	sampler->m_Samples = (SamplerSample*)ptr; ptr += sizeof(SamplerSample) * desc->m_MaxSamples;
+	sampler->m_Allocator = allocator;
+	sampler->m_Capacity = desc->m_MaxSamples;
+	sampler->m_Frequency_hz = desc->m_Frequency_hz;
+
+	sampler->m_PID = getpid();
+	sampler->m_PageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+
+	struct sigevent sev;
+	bx::memSet(&sev, 0, sizeof(sev));
+	sev.sigev_notify = SIGEV_SIGNAL;
+	sev.sigev_signo = SIGPROF;
+	if (timer_create(CLOCK_PROCESS_CPUTIME_ID, &sev, &sampler->m_Timer) != 0) {
+		BX_FREE(allocator, sampler);
+		return false;
+	}
+
+	struct sigaction sa;
+	bx::memSet(&sa, 0, sizeof(sa));
+	sa.sa_sigaction = samplerSignalHandler;
+	sa.sa_flags = SA_SIGINFO | SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(SIGPROF, &sa, &sampler->m_PrevAction) != 0) {
+		timer_delete(sampler->m_Timer);
+		BX_FREE(allocator, sampler);
+		return false;
+	}
+
+	bx::writeBarrier();
+	s_Sampler = sampler;
+
+	return true;
+#else
+	BX_UNUSED(allocator, desc);
+	return false;
+#endif
+}
+
+void samplerShutdown()
+{
+	Sampler* sampler = s_Sampler;
+	if (!sampler) {
+		return;
+	}
+
+#if BX_PLATFORM_LINUX
+	samplerStop();
+	timer_delete(sampler->m_Timer);
+
+	s_Sampler = nullptr;
+	bx::memoryBarrier();
+	samplerWaitForHandlers();
+
+	// A signal generated before the timer was deleted might still be pending. Don't let it
+	// reach the default action, which terminates the process.
+	if (sampler->m_PrevAction.sa_handler == SIG_DFL && (sampler->m_PrevAction.sa_flags & SA_SIGINFO) == 0) {
+		struct sigaction sa;
+		bx::memSet(&sa, 0, sizeof(sa));
+		sa.sa_handler = SIG_IGN;
+		sigemptyset(&sa.sa_mask);
+		sigaction(SIGPROF, &sa, nullptr);
+	} else {
+		sigaction(SIGPROF, &sampler->m_PrevAction, nullptr);
+	}
+#endif
+
+	BX_FREE(sampler->m_Allocator, sampler);
+}
+
+bool samplerStart()
+{
+	Sampler* sampler = s_Sampler;
+	if (!sampler) {
+		return false;
+	}
+
+	if (sampler->m_Running) {
+		return true;
+	}
+
+#if BX_PLATFORM_LINUX
+	sampler->m_Running = 1;
+	bx::memoryBarrier();
+
+	if (!samplerArmTimer(sampler, sampler->m_Frequency_hz)) {
+		sampler->m_Running = 0;
+		return false;
+	}
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+void samplerStop()
+{
+	Sampler* sampler = s_Sampler;
+	if (!sampler || !sampler->m_Running) {
+		return;
+	}
+
+#if BX_PLATFORM_LINUX
+	samplerArmTimer(sampler, 0);
+
+	sampler->m_Running = 0;
+	bx::memoryBarrier();
+	samplerWaitForHandlers();
+#endif
+}
+
+bool samplerIsRunning()
+{
+	Sampler* sampler = s_Sampler;
+	return sampler
+		&& sampler->m_Running != 0
+		;
+}
+
+void samplerReset()
+{
+	Sampler* sampler = s_Sampler;
+	if (!sampler) {
+		return;
+	}
+
+	JX_CHECK(!sampler->m_Running, "Sampler must be stopped");
+
+	const uint32_t numSamples = bx::min<uint32_t>((uint32_t)sampler->m_NumReserved, sampler->m_Capacity);
+	for (uint32_t i = 0; i < numSamples; ++i) {
+		sampler->m_Samples[i].m_Committed = 0;
+	}
+
+	sampler->m_NumReserved = 0;
+	sampler->m_NumDropped = 0;
+}
+
+uint32_t samplerGetNumSamples()
+{
+	Sampler* sampler = s_Sampler;
+	return sampler
+		? bx::min<uint32_t>((uint32_t)sampler->m_NumReserved, sampler->m_Capacity)
+		: 0
+		;
+}
+
+uint32_t samplerGetNumDropped()
+{
+	Sampler* sampler = s_Sampler;
+	return sampler
+		? sampler->m_NumDropped
+		: 0
+		;
+}
+
+bool samplerWriteCollapsedStacks(BaseDir::Enum baseDir, const char* relPath)
+{
+	Sampler* sampler = s_Sampler;
+	if (!sampler) {
+		return false;
+	}
+
+	JX_CHECK(!sampler->m_Running, "Sampler must be stopped");
+
+#if BX_PLATFORM_LINUX
+	bx::AllocatorI* allocator = sampler->m_Allocator;
+
+	// Return addresses inside the same function are merged, so every unique stack of
+	// functions ends up on a single line.
+	const uint32_t numSamples = bx::min<uint32_t>((uint32_t)sampler->m_NumReserved, sampler->m_Capacity);
+	for (uint32_t i = 0; i < numSamples; ++i) {
+		SamplerSample* sample = &sampler->m_Samples[i];
+		if (!sample->m_Committed) {
+			continue;
+		}
+
+		for (uint32_t j = 0; j < sample->m_NumFrames; ++j) {
+			const uintptr_t addr = (uintptr_t)sample->m_Frames[j];
+			const uintptr_t lookupAddr = j != 0 ? addr - 1 : addr;
+
+			Dl_info dlInfo;
+			if (dladdr((void*)lookupAddr, &dlInfo) != 0 && dlInfo.dli_saddr != nullptr) {
+				// Keep the "return address" offset so the names are looked up the same way later.
+				sample->m_Frames[j] = (void*)((uintptr_t)dlInfo.dli_saddr + (j != 0 ? 1 : 0));
+			}
+		}
+	}
+
+	const uint32_t tableSize = bx::uint32_nextpow2(bx::max<uint32_t>(numSamples * 2, 16));
+	const uint32_t totalMem = 0
+		+ sizeof(SamplerStackEntry) * tableSize
+		+ SAMPLER_WRITE_BUFFER_SIZE
+		;
+
+	uint8_t* buffer = (uint8_t*)BX_ALLOC(allocator, totalMem);
+	if (!buffer) {
+		return false;
+	}
+
+	SamplerStackEntry* table = (SamplerStackEntry*)buffer;
+	for (uint32_t i = 0; i < tableSize; ++i) {
+		table[i].m_SampleID = UINT32_MAX;
+	}
+
+	const uint32_t mask = tableSize - 1;
+	for (uint32_t i = 0; i < numSamples; ++i) {
+		const SamplerSample* sample = &sampler->m_Samples[i];
+		if (!sample->m_Committed || sample->m_NumFrames == 0) {
+			continue;
+		}
+
+		const uint64_t hash = spookyHash64(sample->m_Frames, sizeof(void*) * sample->m_NumFrames, SAMPLER_HASH_SEED);
+		uint32_t slot = (uint32_t)hash & mask;
+		while (table[slot].m_SampleID != UINT32_MAX) {
+			const bool isSame = table[slot].m_Hash == hash
+				&& samplerCompareStacks(&sampler->m_Samples[table[slot].m_SampleID], sample) == 0
+				;
+			if (isSame) {
+				break;
+			}
+
+			slot = (slot + 1) & mask;
+		}
+
+		if (table[slot].m_SampleID == UINT32_MAX) {
+			table[slot].m_Hash = hash;
+			table[slot].m_SampleID = i;
+			table[slot].m_Count = 0;
+		}
+
+		table[slot].m_Count++;
+	}
+
+	SamplerWriter writer;
+	writer.m_File = fsFileOpenWrite(baseDir, relPath);
+	writer.m_Buffer = (char*)(buffer + sizeof(SamplerStackEntry) * tableSize);
+	writer.m_Len = 0;
+	if (!writer.m_File) {
+		BX_FREE(allocator, buffer);
+		return false;
+	}
+
+	char name[SAMPLER_MAX_FRAME_NAME];
+	for (uint32_t i = 0; i < tableSize; ++i) {
+		const SamplerStackEntry* entry = &table[i];
+		if (entry->m_SampleID == UINT32_MAX) {
+			continue;
+		}
+
+		// Root first
+		const SamplerSample* sample = &sampler->m_Samples[entry->m_SampleID];
+		for (uint32_t j = sample->m_NumFrames; j != 0; --j) {
+			samplerFormatFrame(sample->m_Frames[j - 1], j != 1, name, SAMPLER_MAX_FRAME_NAME);
+			if (j != sample->m_NumFrames) {
+				samplerWrite(&writer, ";", 1);
+			}
+			samplerWrite(&writer, name, bx::strLen(name));
+		}
+
+		const int32_t len = bx::snprintf(name, SAMPLER_MAX_FRAME_NAME, " %u\n", entry->m_Count);
+		samplerWrite(&writer, name, (uint32_t)len);
+	}
+
+	samplerFlush(&writer);
+	fsFileClose(writer.m_File);
+
+	BX_FREE(allocator, buffer);
+
+	return true;
+#else
+	BX_UNUSED(baseDir, relPath);
+	return false;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Internal
+//
+#if BX_PLATFORM_LINUX
+// Async-signal context: no allocations, locks or non-reentrant calls.
+static void samplerSignalHandler(int sig, siginfo_t* info, void* ucontext)
+{
+	BX_UNUSED(sig, info);
+
+	bx::atomicFetchAndAdd<int32_t>(&s_SamplerActiveHandlers, 1);
+
+	Sampler* sampler = s_Sampler;
+	if (sampler && sampler->m_Running) {
+		const int savedErrno = errno;
+
+		const uint32_t id = bx::atomicFetchAndAdd<uint32_t>(&sampler->m_NumReserved, 1);
+		if (id < sampler->m_Capacity) {
+			SamplerSample* sample = &sampler->m_Samples[id];
+			sample->m_NumFrames = samplerWalkStack(sampler, ucontext, sample->m_Frames, JX_CONFIG_SAMPLER_MAX_DEPTH);
+
+			bx::writeBarrier();
+			sample->m_Committed = 1;
+		} else {
+			bx::atomicFetchAndAdd<uint32_t>(&sampler->m_NumDropped, 1);
+		}
+
+		errno = savedErrno;
+	}
+
+	bx::atomicFetchAndAdd<int32_t>(&s_SamplerActiveHandlers, -1);
+}
+
+// Follows the frame pointer chain from the interrupted context. The first frame is the
+// interrupted PC; the rest are return addresses. Functions which don't keep a frame pointer
+// (-fomit-frame-pointer) hide their caller or end the walk, and a function interrupted in
+// its prologue hides its caller.
+// Frame pointers must increase, stay aligned and be readable (checked once per page), so a
+// register which doesn't hold a frame pointer ends the walk instead of crashing.
+static uint32_t samplerWalkStack(Sampler* sampler, const void* ucontext, void** frames, uint32_t maxFrames)
+{
+	const ucontext_t* uc = (const ucontext_t*)ucontext;
+
+	uintptr_t pc = 0;
+	uintptr_t fp = 0;
+	uintptr_t sp = 0;
+#if BX_CPU_X86 && BX_ARCH_64BIT
+	pc = (uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+	fp = (uintptr_t)uc->uc_mcontext.gregs[REG_RBP];
+	sp = (uintptr_t)uc->uc_mcontext.gregs[REG_RSP];
+#elif BX_CPU_X86
+	pc = (uintptr_t)uc->uc_mcontext.gregs[REG_EIP];
+	fp = (uintptr_t)uc->uc_mcontext.gregs[REG_EBP];
+	sp = (uintptr_t)uc->uc_mcontext.gregs[REG_ESP];
+#elif BX_CPU_ARM && BX_ARCH_64BIT
+	pc = (uintptr_t)uc->uc_mcontext.pc;
+	fp = (uintptr_t)uc->uc_mcontext.regs[29];
+	sp = (uintptr_t)uc->uc_mcontext.sp;
+#else
+	BX_UNUSED(sampler, uc);
+#endif
+
+	if (pc == 0 || maxFrames == 0) {
+		return 0;
+	}
+
+	uint32_t numFrames = 0;
+	frames[numFrames++] = (void*)pc;
+
+	// Both x86 and AArch64 frame records hold the caller's frame pointer followed by the
+	// return address.
+	uintptr_t checkedPage = 0;
+	uintptr_t minFP = sp;
+	while (numFrames < maxFrames) {
+		const bool isValid = fp >= minFP
+			&& fp - minFP <= SAMPLER_MAX_FRAME_SIZE
+			&& (fp & (sizeof(uintptr_t) - 1)) == 0
+			;
+		if (!isValid) {
+			break;
+		}
+
+		// Frame pointers only increase, so the last page of the previous record is the
+		// only one which may have been checked already.
+		const uintptr_t pageMask = ~(sampler->m_PageSize - 1);
+		const uintptr_t lastPage = (fp + sizeof(uintptr_t) * 2 - 1) & pageMask;
+		if ((fp & pageMask) != checkedPage || lastPage != checkedPage) {
+			if (!samplerIsReadable(sampler, fp)) {
+				break;
+			}
+
+			checkedPage = lastPage;
+		}
+
+		const uintptr_t* record = (const uintptr_t*)fp;
+		const uintptr_t retAddr = record[1];
+		if (retAddr == 0) {
+			break;
+		}
+
+		frames[numFrames++] = (void*)retAddr;
+		minFP = fp + sizeof(uintptr_t) * 2;
+		fp = record[0];
+	}
+
+	return numFrames;
+}
+
+// Reads a frame record through the kernel, which fails instead of faulting if the memory
+// isn't mapped or readable.
+static bool samplerIsReadable(Sampler* sampler, uintptr_t addr)
+{
+	uintptr_t record[2];
+
+	struct iovec local;
+	local.iov_base = record;
+	local.iov_len = sizeof(record);
+
+	struct iovec remote;
+	remote.iov_base = (void*)addr;
+	remote.iov_len = sizeof(record);
+
+	return process_vm_readv(sampler->m_PID, &local, 1, &remote, 1, 0) == (ssize_t)sizeof(record);
+}
+
+// A frequency of 0 disarms the timer.
+static bool samplerArmTimer(Sampler* sampler, uint32_t frequency_hz)
+{
+	const int64_t interval_ns = frequency_hz != 0
+		? bx::max<int64_t>(1, 1000000000ll / (int64_t)frequency_hz)
+		: 0
+		;
+
+	struct itimerspec its;
+	its.it_interval.tv_sec = (time_t)(interval_ns / 1000000000ll);
+	its.it_interval.tv_nsec = (long)(interval_ns % 1000000000ll);
+	its.it_value = its.it_interval;
+
+	return timer_settime(sampler->m_Timer, 0, &its, nullptr) == 0;
+}
+
+static void samplerWaitForHandlers()
+{
+	while (s_SamplerActiveHandlers != 0) {
+		jx::cpuPause();
+	}
+}
+
+static int32_t samplerCompareStacks(const SamplerSample* a, const SamplerSample* b)
+{
+	if (a->m_NumFrames != b->m_NumFrames) {
+		return a->m_NumFrames < b->m_NumFrames ? -1 : 1;
+	}
+
+	return bx::memCmp(a->m_Frames, b->m_Frames, sizeof(void*) * a->m_NumFrames);
+}
+
+// Demangled function name, "module+0xoffset" or the address. Semicolons separate frames in
+// the collapsed format, so they are replaced.
+static void samplerFormatFrame(void* addr, bool isReturnAddress, char* buffer, uint32_t maxLen)
+{
+	void* lookupAddr = isReturnAddress
+		? (void*)((uintptr_t)addr - 1)
+		: addr
+		;
+
+	Dl_info dlInfo;
+	if (dladdr(lookupAddr, &dlInfo) == 0) {
+		bx::snprintf(buffer, maxLen, "0x%llx", (unsigned long long)(uintptr_t)lookupAddr);
+	} else if (dlInfo.dli_sname != nullptr) {
+		int status = 0;
+		char* demangled = abi::__cxa_demangle(dlInfo.dli_sname, nullptr, nullptr, &status);
+		bx::strCopy(buffer, (int32_t)maxLen, status == 0 && demangled ? demangled : dlInfo.dli_sname);
+		::free(demangled);
+	} else {
+		const char* module = dlInfo.dli_fname ? dlInfo.dli_fname : "?";
+		for (const char* ch = module; *ch != '\0'; ++ch) {
+			if (*ch == '/') {
+				module = ch + 1;
+			}
+		}
+
+		bx::snprintf(buffer, maxLen, "%s+0x%llx"
+			, module
+			, (unsigned long long)((uintptr_t)lookupAddr - (uintptr_t)dlInfo.dli_fbase));
+	}
+
+	for (char* ch = buffer; *ch != '\0'; ++ch) {
+		if (*ch == ';') {
+			*ch = ':';
+		}
+	}
+}
+
+static void samplerWrite(SamplerWriter* writer, const char* str, uint32_t len)
+{
+	if (writer->m_Len + len > SAMPLER_WRITE_BUFFER_SIZE) {
+		samplerFlush(writer);
+	}
+
+	bx::memCopy(&writer->m_Buffer[writer->m_Len], str, len);
+	writer->m_Len += len;
+}
+
+static void samplerFlush(SamplerWriter* writer)
+{
+	if (writer->m_Len != 0) {
+		fsFileWriteBytes(writer->m_File, writer->m_Buffer, writer->m_Len);
+		writer->m_Len = 0;
+	}
+}
+#endif
+}
@@ -1,4 +1,5 @@
 #include <jx/spooky_hash.h>
+#include <jx/worker_pool.h>
 #include <bx/bx.h>
 
 namespace jx
@@ -26,7 +27,18 @@ static const size_t sc_bufSize = 2 * sc_blockSize;
 //
 static const uint64_t sc_const = 0xdeadbeefdeadbeefuLL;
 
+// Messages per parallel range (4 messages = one cache line of hashes).
+static const uint32_t kSpookyBatchGranularity = 4;
+
+struct SpookyHashBatchJob
+{
+	const void* const* m_Messages;
+	const size_t* m_Lengths;
+	uint64_t* m_Hashes;
+};
+
 static void spookyHashShort(const void* message, size_t length, uint64_t* hash1, uint64_t* hash2);
+static void spookyHash128Range(uint32_t first, uint32_t last, void* userData);
 
 //
 // left rotate a 64-bit value by k bytes
@@ -225,6 +237,39 @@ void spookyHash128(const void* message, size_t length, uint64_t* hash1, uint64_t
 	*hash2 = h1;
 }
 
+uint64_t spookyHash64(const void* message, size_t length, uint64_t seed)
+{
+	uint64_t hash1 = seed;
+	uint64_t hash2 = seed;
+	spookyHash128(message, length, &hash1, &hash2);
+	return hash1;
+}
+
+uint32_t spookyHash32(const void* message, size_t length, uint32_t seed)
+{
+	uint64_t hash1 = seed;
+	uint64_t hash2 = seed;
+	spookyHash128(message, length, &hash1, &hash2);
+	return (uint32_t)hash1;
+}
+
+void spookyHash128Batch(WorkerPool* pool, const void* const* messages, const size_t* lengths, uint32_t numMessages, uint64_t* hashes)
+{
+	SpookyHashBatchJob job;
+	job.m_Messages = messages;
+	job.m_Lengths = lengths;
+	job.m_Hashes = hashes;
+	parallelFor(pool, numMessages, kSpookyBatchGranularity, spookyHash128Range, &job);
+}
+
+static void spookyHash128Range(uint32_t first, uint32_t last, void* userData)
+{
+	const SpookyHashBatchJob* job = (const SpookyHashBatchJob*)userData;
+	for (uint32_t i = first; i < last; ++i) {
+		spookyHash128(job->m_Messages[i], job->m_Lengths[i], &job->m_Hashes[i * 2 + 0], &job->m_Hashes[i * 2 + 1]);
+	}
+}
+
 //
 // short hash ... it could be used on any message, 
 // but it's used by Spooky just for short messages.
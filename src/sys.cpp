@@ -3,6 +3,11 @@
 #include <jx/fs.h>
 #include <jx/logger.h>
 #include <jx/linear_allocator.h>
+#include <jx/epoch.h>
+#include <jx/profiler.h>
+#include <jx/metrics.h>
+#include <jx/latency.h>
+#include <jx/clock.h>
 #include <bx/allocator.h>
 #include <chrono>
 
@@ -28,6 +33,10 @@ struct Context
 	bx::AllocatorI* m_GlobalAllocator;
 	LinearAllocator* m_FrameAllocator;
 	Logger* m_Logger;
+	EpochDomain* m_EpochDomain;
+	uint32_t m_MainThreadEpochID;
+	LatencyTracker* m_FrameLatency;
+	int64_t m_LastFrameTime;
 };
 
 static Context* s_Context = nullptr;
@@ -40,6 +49,9 @@ bool initSystem(const char* appName, uint32_t sysFlags, uint32_t fsFlags)
 
 	bx::AllocatorI* systemAllocator = getSystemAllocator();
 
+	// Calibrated before anything takes timestamps.
+	clockInit();
+
 #if JX_CONFIG_TRACE_ALLOCATIONS
 	memTracerInit(systemAllocator);
 #endif
@@ -59,6 +71,14 @@ bool initSystem(const char* appName, uint32_t sysFlags, uint32_t fsFlags)
 
 	// Initialize temporary/frame allocator
 	s_Context->m_FrameAllocator = BX_NEW(systemAllocator, LinearAllocator)(systemAllocator, JX_CONFIG_FRAME_ALLOCATOR_CAPACITY);
+
+	// Initialize the global epoch domain
+	s_Context->m_EpochDomain = createEpochDomain(s_Context->m_GlobalAllocator, JX_CONFIG_EPOCH_MAX_THREADS);
+	if (!s_Context->m_EpochDomain) {
+		JX_CHECK(false, "Failed to initialize epoch domain");
+		return false;
+	}
+	s_Context->m_MainThreadEpochID = epochRegisterThread(s_Context->m_EpochDomain);
 	
 	// Initialize the filesystem
 	if (!fsInit(appName, fsFlags)) {
@@ -76,6 +96,34 @@ bool initSystem(const char* appName, uint32_t sysFlags, uint32_t fsFlags)
 		s_Context->m_Logger = nullptr;
 	}
 
+	if ((sysFlags & SystemInitFlags::InitProfiler) != 0) {
+		if (!profilerInit(s_Context->m_GlobalAllocator)) {
+			JX_CHECK(false, "Failed to initialize profiler");
+			return false;
+		}
+	}
+
+	if ((sysFlags & SystemInitFlags::InitMetrics) != 0) {
+		if (!metricsInit(s_Context->m_GlobalAllocator)) {
+			JX_CHECK(false, "Failed to initialize metrics");
+			return false;
+		}
+	}
+
+	if ((sysFlags & SystemInitFlags::InitFrameLatency) != 0) {
+		LatencyTrackerDesc desc;
+		desc.m_Flags = LatencyTrackerFlags::TriggerCapture;
+		desc.m_Window_ms = JX_CONFIG_FRAME_LATENCY_WINDOW_MS;
+		desc.m_NumSubWindows = JX_CONFIG_FRAME_LATENCY_SUB_WINDOWS;
+		s_Context->m_FrameLatency = createLatencyTracker(s_Context->m_GlobalAllocator, "Frame", &desc);
+		if (!s_Context->m_FrameLatency) {
+			JX_CHECK(false, "Failed to initialize frame latency tracker");
+			return false;
+		}
+
+		s_Context->m_LastFrameTime = latencyIntervalBegin();
+	}
+
 	JX_LOG_INFO("System initialized\n");
 
 	// Initialize the PRNG...
@@ -93,6 +141,14 @@ void shutdownSystem()
 
 	bx::AllocatorI* systemAllocator = getSystemAllocator();
 
+	if (s_Context->m_FrameLatency) {
+		destroyLatencyTracker(s_Context->m_FrameLatency);
+		s_Context->m_FrameLatency = nullptr;
+	}
+
+	metricsShutdown();
+	profilerShutdown();
+
 	if (s_Context->m_Logger) {
 		destroyLog(s_Context->m_Logger);
 		s_Context->m_Logger = nullptr;
@@ -100,6 +156,11 @@ void shutdownSystem()
 
 	fsShutdown();
 
+	if (s_Context->m_EpochDomain) {
+		destroyEpochDomain(s_Context->m_EpochDomain);
+		s_Context->m_EpochDomain = nullptr;
+	}
+
 	BX_DELETE(systemAllocator, s_Context->m_FrameAllocator);
 	destroyAllocator(s_Context->m_GlobalAllocator);
 
@@ -114,6 +175,22 @@ void shutdownSystem()
 void frame()
 {
 	s_Context->m_FrameAllocator->freeAll();
+
+	clockResync();
+
+	// Spikes trigger a profiler capture window, which starts with the profilerFrame() below.
+	if (s_Context->m_FrameLatency) {
+		const int64_t now = latencyIntervalBegin();
+		latencyIntervalEnd(s_Context->m_FrameLatency, s_Context->m_LastFrameTime);
+		s_Context->m_LastFrameTime = now;
+	}
+
+	// Merged metrics are written to an open profiler capture, which profilerFrame() flushes.
+	metricsMerge();
+	profilerFrame();
+
+	epochQuiescent(s_Context->m_EpochDomain, s_Context->m_MainThreadEpochID);
+	epochReclaim(s_Context->m_EpochDomain);
 }
 
 void setSystemLogger(Logger* logger)
@@ -159,6 +236,16 @@ Logger* getGlobalLogger()
 	return s_Context->m_Logger;
 }
 
+EpochDomain* getGlobalEpochDomain()
+{
+	return s_Context->m_EpochDomain;
+}
+
+LatencyTracker* getFrameLatencyTracker()
+{
+	return s_Context->m_FrameLatency;
+}
+
 void getCPUBrandString(char* str, uint32_t maxLen)
 {
 #if BX_CPU_X86
@@ -277,11 +364,16 @@ bool getOSFriendlyName(char* str, uint32_t maxLen)
 #if BX_PLATFORM_WINDOWS
 void getLogFullPathW(Logger* logger, wchar_t* path, uint32_t maxLen)
 {
-	const char* loggerName = loggerGetName(logger);
-	wchar_t nameW[256];
-	mbstowcs(nameW, loggerName, BX_COUNTOF(nameW));
+	char filename[256];
+	if (!loggerGetFilename(logger, filename, BX_COUNTOF(filename))) {
+		path[0] = L'\0';
+		return;
+	}
+
+	wchar_t filenameW[256];
+	mbstowcs(filenameW, filename, BX_COUNTOF(filenameW));
 
-	swprintf(path, maxLen, L"%s%s.log", fsGetBaseDirPath(BaseDir::UserData), nameW);
+	swprintf(path, maxLen, L"%s%s", fsGetBaseDirPath(BaseDir::UserData), filenameW);
 }
 #endif
 
@@ -1,26 +1,112 @@
 #include <jx/thread.h>
+#include <jx/clock.h>
 #include <jx/object_pool.h>
+#include <jx/cpu.h>
+#include <jx/mutex.h>
+#include <jx/thread_recorder.h>
 #include <jx/sys.h>
+#include <bx/cpu.h>
+#include <bx/os.h>
+#include <bx/string.h>
+#include <bx/timer.h>
+#include <bx/uint32_t.h>
+
+#if BX_PLATFORM_LINUX || BX_PLATFORM_RPI
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h> // setpriority()
+#elif BX_PLATFORM_WINDOWS
+#include <Windows.h>
+#endif
 
 namespace jx
 {
 static const uint32_t kDefaultMessagePoolBlockSize = 128;
 
+#define JX_THREAD_MESSAGE_HEADER (JX_CONFIG_THREAD_QUEUE_STATS || JX_CONFIG_THREAD_RECORDER)
+
+#if JX_THREAD_MESSAGE_HEADER
+// Hidden header in front of every pooled message.
+struct MessageHeader
+{
+	int64_t m_PushTime;
+	uint32_t m_Size;
+	uint32_t m_Padding;
+};
+
+static const uint32_t kMessageHeaderSize = sizeof(MessageHeader);
+#else
+static const uint32_t kMessageHeaderSize = 0;
+#endif
+
+struct MessageQueue
+{
+	bx::SpScUnboundedQueue m_Queue;
+	Semaphore m_Sem;
+	ThreadWaitStrategy m_WaitStrategy;
+	volatile int32_t m_Parked; // 1 while the consumer waits (or is about to wait) on m_Sem
+	ThreadQueue::Enum m_ID;
+#if JX_CONFIG_THREAD_QUEUE_STATS
+	// Written by producers (serialized by the message pool mutex)
+	volatile uint64_t m_NumEnqueued;
+	volatile uint32_t m_MaxDepth;
+
+	// Written by the consumer
+	volatile uint64_t m_NumDequeued;
+	volatile uint64_t m_LatencyHistogram[JX_THREAD_QUEUE_LATENCY_NUM_BUCKETS];
+#endif
+};
+
 struct Thread
 {
 	bx::AllocatorI* m_Allocator;
 	jx::ObjectPool* m_MsgPool;
 	bx::Thread m_bxThread;
-	bx::SpScBlockingUnboundedQueue m_InMsgQueue;
-	bx::SpScBlockingUnboundedQueue m_OutMsgQueue;
-	bx::Mutex m_MsgPoolMutex;
+	MessageQueue m_InMsgQueue;
+	MessageQueue m_OutMsgQueue;
+	Thread* m_PrevThread;
+	Thread* m_NextThread;
+	char m_Name[64];
+	Mutex m_MsgPoolMutex;
+	Semaphore m_StartedSem;
 	ThreadFn m_Func;
 	void* m_UserData;
+#if JX_CONFIG_THREAD_RECORDER
+	ThreadRecorder* volatile m_Recorder;
+#endif
+#if BX_PLATFORM_LINUX || BX_PLATFORM_RPI
+	pthread_t m_NativeHandle;
+	pid_t m_TID;
+#elif BX_PLATFORM_WINDOWS
+	DWORD m_ThreadID;
+#endif
 };
 
-static ThreadMessage* threadPopMessage(Thread* thread, bx::SpScBlockingUnboundedQueue* queue, int32_t timeout_msec);
-static bool threadPushMessage(Thread* thread, bx::SpScBlockingUnboundedQueue* queue, uint32_t msgID, const void* data, uint32_t sz);
+static Thread* s_ThreadListHead = nullptr;
+static Mutex s_ThreadListMutex;
+
+static ThreadMessage* threadPopMessage(Thread* thread, MessageQueue* queue, int32_t timeout_msec);
+static ThreadMessage* threadWaitAndPopMessage(MessageQueue* queue, int32_t timeout_msec);
+static ThreadMessage* threadParkAndPopMessage(MessageQueue* queue, int32_t timeout_msec);
+static bool threadPushMessage(Thread* thread, MessageQueue* queue, uint32_t msgID, const void* data, uint32_t sz);
+static void msgQueueInit(MessageQueue* queue, ThreadQueue::Enum id, bx::AllocatorI* allocator);
+static void msgQueueShutdown(MessageQueue* queue);
 static int32_t threadFunc(bx::Thread* self, void* userData);
+static void threadListAdd(Thread* thread);
+static void threadListRemove(Thread* thread);
+#if JX_CONFIG_THREAD_QUEUE_STATS
+static void msgQueueUpdatePopStats(MessageQueue* queue, ThreadMessage* msg);
+#endif
+#if BX_PLATFORM_LINUX || BX_PLATFORM_RPI
+static bool setNativeThreadAffinity(pthread_t handle, const CPUSet* cpus);
+static bool getNativeThreadAffinity(pthread_t handle, CPUSet* cpus);
+static bool setNativeThreadPriority(pid_t tid, ThreadPriority::Enum priority);
+#elif BX_PLATFORM_WINDOWS
+static bool setNativeThreadAffinity(HANDLE handle, const CPUSet* cpus);
+static bool setNativeThreadPriority(HANDLE handle, ThreadPriority::Enum priority);
+#endif
 
 Thread* createThread(bx::AllocatorI* allocator, ThreadFn func, void* userData, uint32_t stackSize, const char* name)
 {
@@ -33,13 +119,15 @@ Thread* createThread(bx::AllocatorI* allocator, ThreadFn func, void* userData, u
 	thread->m_Allocator = allocator;
 	thread->m_Func = func;
 	thread->m_UserData = userData;
+	bx::strCopy(thread->m_Name, BX_COUNTOF(thread->m_Name), name ? name : "");
 
 	BX_PLACEMENT_NEW(&thread->m_bxThread, bx::Thread)();
-	BX_PLACEMENT_NEW(&thread->m_InMsgQueue, bx::SpScBlockingUnboundedQueue)(allocator);
-	BX_PLACEMENT_NEW(&thread->m_OutMsgQueue, bx::SpScBlockingUnboundedQueue)(allocator);
-	BX_PLACEMENT_NEW(&thread->m_MsgPoolMutex, bx::Mutex)();
+	msgQueueInit(&thread->m_InMsgQueue, ThreadQueue::In, allocator);
+	msgQueueInit(&thread->m_OutMsgQueue, ThreadQueue::Out, allocator);
+	BX_PLACEMENT_NEW(&thread->m_MsgPoolMutex, Mutex)("Thread Message Pool");
+	BX_PLACEMENT_NEW(&thread->m_StartedSem, Semaphore)();
 
-	thread->m_MsgPool = jx::createObjectPool(sizeof(ThreadMessage), kDefaultMessagePoolBlockSize, allocator);
+	thread->m_MsgPool = jx::createObjectPool(kMessageHeaderSize + sizeof(ThreadMessage), kDefaultMessagePoolBlockSize, allocator);
 	if (!thread->m_MsgPool) {
 		destroyThread(thread);
 		return nullptr;
@@ -50,11 +138,19 @@ Thread* createThread(bx::AllocatorI* allocator, ThreadFn func, void* userData, u
 		return nullptr;
 	}
 
+	// Wait for the thread to publish its native handle before returning, so it can be
+	// used with threadSetAffinity()/threadSetPriority() right away.
+	thread->m_StartedSem.wait();
+
+	threadListAdd(thread);
+
 	return thread;
 }
 
 void destroyThread(Thread* thread)
 {
+	threadListRemove(thread);
+
 	if (thread->m_bxThread.isRunning()) {
 		thread->m_bxThread.shutdown();
 	}
@@ -64,9 +160,10 @@ void destroyThread(Thread* thread)
 		thread->m_MsgPool = nullptr;
 	}
 
-	thread->m_InMsgQueue.~SpScBlockingUnboundedQueue();
-	thread->m_OutMsgQueue.~SpScBlockingUnboundedQueue();
+	msgQueueShutdown(&thread->m_InMsgQueue);
+	msgQueueShutdown(&thread->m_OutMsgQueue);
 	thread->m_MsgPoolMutex.~Mutex();
+	thread->m_StartedSem.~Semaphore();
 	thread->m_bxThread.~Thread();
 
 	BX_FREE(thread->m_Allocator, thread);
@@ -94,44 +191,345 @@ bool threadOutQueuePush(Thread* thread, uint32_t msgID, const void* data, uint32
 
 void threadReleaseMessage(Thread* thread, ThreadMessage* msg)
 {
-	bx::MutexScope ms(thread->m_MsgPoolMutex);
-	jx::objPoolFree(thread->m_MsgPool, msg);
+	MutexScope ms(thread->m_MsgPoolMutex);
+	jx::objPoolFree(thread->m_MsgPool, (uint8_t*)msg - kMessageHeaderSize);
+}
+
+void threadSetWaitStrategy(Thread* thread, ThreadQueue::Enum queue, const ThreadWaitStrategy* strategy)
+{
+	MessageQueue* q = queue == ThreadQueue::In ? &thread->m_InMsgQueue : &thread->m_OutMsgQueue;
+	q->m_WaitStrategy = *strategy;
 }
 
-static ThreadMessage* threadPopMessage(Thread* thread, bx::SpScBlockingUnboundedQueue* queue, int32_t timeout_msec)
+void threadGetWaitStrategy(Thread* thread, ThreadQueue::Enum queue, ThreadWaitStrategy* strategy)
+{
+	const MessageQueue* q = queue == ThreadQueue::In ? &thread->m_InMsgQueue : &thread->m_OutMsgQueue;
+	*strategy = q->m_WaitStrategy;
+}
+
+const char* threadGetName(const Thread* thread)
+{
+	return thread->m_Name;
+}
+
+bool threadGetQueueStats(const Thread* thread, ThreadQueue::Enum queue, ThreadQueueStats* stats)
+{
+#if JX_CONFIG_THREAD_QUEUE_STATS
+	const MessageQueue* q = queue == ThreadQueue::In ? &thread->m_InMsgQueue : &thread->m_OutMsgQueue;
+
+	// Read the consumer's counter first so the calculated depth is never negative.
+	stats->m_NumDequeued = q->m_NumDequeued;
+	bx::readBarrier();
+	stats->m_NumEnqueued = q->m_NumEnqueued;
+	stats->m_MaxDepth = q->m_MaxDepth;
+	stats->m_Depth = (uint32_t)(stats->m_NumEnqueued - stats->m_NumDequeued);
+	for (uint32_t i = 0; i < JX_THREAD_QUEUE_LATENCY_NUM_BUCKETS; ++i) {
+		stats->m_LatencyHistogram[i] = q->m_LatencyHistogram[i];
+	}
+
+	return true;
+#else
+	BX_UNUSED(thread, queue);
+	bx::memSet(stats, 0, sizeof(ThreadQueueStats));
+	return false;
+#endif
+}
+
+bool threadSetRecorder(Thread* thread, ThreadRecorder* recorder)
+{
+#if JX_CONFIG_THREAD_RECORDER
+	bx::memoryBarrier();
+	thread->m_Recorder = recorder;
+	return true;
+#else
+	BX_UNUSED(thread, recorder);
+	return false;
+#endif
+}
+
+void threadEnumerate(ThreadEnumCallback cb, void* userData)
+{
+	MutexScope ms(s_ThreadListMutex);
+
+	Thread* thread = s_ThreadListHead;
+	while (thread) {
+		cb(thread, userData);
+		thread = thread->m_NextThread;
+	}
+}
+
+bool threadSetAffinity(Thread* thread, const CPUSet* cpus)
+{
+#if BX_PLATFORM_LINUX || BX_PLATFORM_RPI
+	return setNativeThreadAffinity(thread->m_NativeHandle, cpus);
+#elif BX_PLATFORM_WINDOWS
+	HANDLE handle = ::OpenThread(THREAD_SET_INFORMATION | THREAD_QUERY_INFORMATION, FALSE, thread->m_ThreadID);
+	if (handle == NULL) {
+		return false;
+	}
+
+	const bool res = setNativeThreadAffinity(handle, cpus);
+	::CloseHandle(handle);
+
+	return res;
+#else
+	BX_UNUSED(thread, cpus);
+	return false;
+#endif
+}
+
+bool threadGetAffinity(Thread* thread, CPUSet* cpus)
+{
+#if BX_PLATFORM_LINUX || BX_PLATFORM_RPI
+	return getNativeThreadAffinity(thread->m_NativeHandle, cpus);
+#else
+	BX_UNUSED(thread, cpus);
+	return false;
+#endif
+}
+
+bool threadSetPriority(Thread* thread, ThreadPriority::Enum priority)
+{
+#if BX_PLATFORM_LINUX || BX_PLATFORM_RPI
+	return setNativeThreadPriority(thread->m_TID, priority);
+#elif BX_PLATFORM_WINDOWS
+	HANDLE handle = ::OpenThread(THREAD_SET_INFORMATION | THREAD_QUERY_INFORMATION, FALSE, thread->m_ThreadID);
+	if (handle == NULL) {
+		return false;
+	}
+
+	const bool res = setNativeThreadPriority(handle, priority);
+	::CloseHandle(handle);
+
+	return res;
+#else
+	BX_UNUSED(thread, priority);
+	return false;
+#endif
+}
+
+bool setCurrentThreadAffinity(const CPUSet* cpus)
+{
+#if BX_PLATFORM_LINUX || BX_PLATFORM_RPI
+	return setNativeThreadAffinity(pthread_self(), cpus);
+#elif BX_PLATFORM_WINDOWS
+	return setNativeThreadAffinity(::GetCurrentThread(), cpus);
+#else
+	BX_UNUSED(cpus);
+	return false;
+#endif
+}
+
+bool getCurrentThreadAffinity(CPUSet* cpus)
+{
+#if BX_PLATFORM_LINUX || BX_PLATFORM_RPI
+	return getNativeThreadAffinity(pthread_self(), cpus);
+#else
+	BX_UNUSED(cpus);
+	return false;
+#endif
+}
+
+bool setCurrentThreadPriority(ThreadPriority::Enum priority)
+{
+#if BX_PLATFORM_LINUX || BX_PLATFORM_RPI
+	return setNativeThreadPriority((pid_t)::syscall(SYS_gettid), priority);
+#elif BX_PLATFORM_WINDOWS
+	return setNativeThreadPriority(::GetCurrentThread(), priority);
+#else
+	BX_UNUSED(priority);
+	return false;
+#endif
+}
+
+static void msgQueueInit(MessageQueue* queue, ThreadQueue::Enum id, bx::AllocatorI* allocator)
+{
+	BX_PLACEMENT_NEW(&queue->m_Queue, bx::SpScUnboundedQueue)(allocator);
+	BX_PLACEMENT_NEW(&queue->m_Sem, Semaphore)();
+	queue->m_WaitStrategy.m_NumSpins = 0;
+	queue->m_WaitStrategy.m_NumYields = 0;
+	queue->m_Parked = 0;
+	queue->m_ID = id;
+#if JX_CONFIG_THREAD_QUEUE_STATS
+	queue->m_NumEnqueued = 0;
+	queue->m_MaxDepth = 0;
+	queue->m_NumDequeued = 0;
+	bx::memSet((void*)queue->m_LatencyHistogram, 0, sizeof(queue->m_LatencyHistogram));
+#endif
+}
+
+static void msgQueueShutdown(MessageQueue* queue)
+{
+	queue->m_Queue.~SpScUnboundedQueue();
+	queue->m_Sem.~Semaphore();
+}
+
+static ThreadMessage* threadPopMessage(Thread* thread, MessageQueue* queue, int32_t timeout_msec)
 {
 	BX_UNUSED(thread);
-	return (timeout_msec == 0 && queue->peek() == nullptr)
-		? nullptr
-		: (ThreadMessage*)queue->pop(timeout_msec)
+
+	ThreadMessage* msg = threadWaitAndPopMessage(queue, timeout_msec);
+#if JX_CONFIG_THREAD_QUEUE_STATS
+	if (msg) {
+		msgQueueUpdatePopStats(queue, msg);
+	}
+#endif
+
+#if JX_CONFIG_THREAD_RECORDER
+	ThreadRecorder* recorder = thread->m_Recorder;
+	if (msg && recorder) {
+		const MessageHeader* hdr = (const MessageHeader*)((uint8_t*)msg - kMessageHeaderSize);
+		threadRecorderRecord(recorder, ThreadRecordEvent::Pop, queue->m_ID, msg->m_MsgID, msg->m_Data, hdr->m_Size);
+	}
+#endif
+
+	return msg;
+}
+
+static ThreadMessage* threadWaitAndPopMessage(MessageQueue* queue, int32_t timeout_msec)
+{
+	ThreadMessage* msg = (ThreadMessage*)queue->m_Queue.pop();
+	if (msg || timeout_msec == 0) {
+		return msg;
+	}
+
+	const uint32_t numSpins = queue->m_WaitStrategy.m_NumSpins;
+	for (uint32_t i = 0; i < numSpins; ++i) {
+		cpuPause();
+
+		msg = (ThreadMessage*)queue->m_Queue.pop();
+		if (msg) {
+			return msg;
+		}
+	}
+
+	const uint32_t numYields = queue->m_WaitStrategy.m_NumYields;
+	for (uint32_t i = 0; i < numYields; ++i) {
+		bx::yield();
+
+		msg = (ThreadMessage*)queue->m_Queue.pop();
+		if (msg) {
+			return msg;
+		}
+	}
+
+	return threadParkAndPopMessage(queue, timeout_msec);
+}
+
+static ThreadMessage* threadParkAndPopMessage(MessageQueue* queue, int32_t timeout_msec)
+{
+	const int64_t freq = bx::getHPFrequency();
+	const int64_t deadline = timeout_msec > 0
+		? bx::getHPCounter() + (timeout_msec * freq) / 1000
+		: 0
 		;
+
+	for (;;) {
+		// Announce that we are about to sleep and re-check the queue. Producers push first
+		// and check the flag afterwards, so at least one of the two sides will see the other.
+		bx::atomicCompareAndSwap<int32_t>(&queue->m_Parked, 0, 1);
+
+		ThreadMessage* msg = (ThreadMessage*)queue->m_Queue.pop();
+		if (msg) {
+			if (bx::atomicCompareAndSwap<int32_t>(&queue->m_Parked, 1, 0) != 1) {
+				// A producer cleared the flag first, so the semaphore has been (or is about to be)
+				// posted. Consume the signal to keep the semaphore balanced.
+				queue->m_Sem.wait();
+			}
+
+			return msg;
+		}
+
+		int32_t waitTime_msec = -1;
+		if (timeout_msec > 0) {
+			const int64_t remaining = deadline - bx::getHPCounter();
+			waitTime_msec = remaining > 0
+				? (int32_t)bx::max<int64_t>((remaining * 1000) / freq, 1)
+				: 0
+				;
+		}
+
+		if (!queue->m_Sem.wait(waitTime_msec)) {
+			// Timed out
+			if (bx::atomicCompareAndSwap<int32_t>(&queue->m_Parked, 1, 0) != 1) {
+				queue->m_Sem.wait();
+			}
+
+			return (ThreadMessage*)queue->m_Queue.pop();
+		}
+
+		// The producer which woke us up has already cleared the parked flag.
+		msg = (ThreadMessage*)queue->m_Queue.pop();
+		if (msg) {
+			return msg;
+		}
+	}
 }
 
-static bool threadPushMessage(Thread* thread, bx::SpScBlockingUnboundedQueue* queue, uint32_t msgID, const void* data, uint32_t sz)
+static bool threadPushMessage(Thread* thread, MessageQueue* queue, uint32_t msgID, const void* data, uint32_t sz)
 {
 	if (sz > JX_THREAD_MESSAGE_BUFFER_SIZE) {
 		JX_CHECK(false, "Thread message data too large!");
 		return false;
 	}
 
-	bx::MutexScope ms(thread->m_MsgPoolMutex);
-	ThreadMessage* msg = (ThreadMessage*)jx::objPoolAlloc(thread->m_MsgPool);
-	if (!msg) {
+	MutexScope ms(thread->m_MsgPoolMutex);
+	uint8_t* item = (uint8_t*)jx::objPoolAlloc(thread->m_MsgPool);
+	if (!item) {
 		return false;
 	}
 
+	ThreadMessage* msg = (ThreadMessage*)(item + kMessageHeaderSize);
 	msg->m_MsgID = msgID;
 	bx::memCopy(msg->m_Data, data, sz);
 
-	queue->push(msg);
+#if JX_THREAD_MESSAGE_HEADER
+	MessageHeader* hdr = (MessageHeader*)item;
+	hdr->m_PushTime = clockGetTicks();
+	hdr->m_Size = sz;
+#endif
+
+#if JX_CONFIG_THREAD_RECORDER
+	ThreadRecorder* recorder = thread->m_Recorder;
+	if (recorder) {
+		threadRecorderRecord(recorder, ThreadRecordEvent::Push, queue->m_ID, msgID, data, sz);
+	}
+#endif
+
+#if JX_CONFIG_THREAD_QUEUE_STATS
+	const uint64_t numEnqueued = queue->m_NumEnqueued + 1;
+	const uint32_t depth = (uint32_t)(numEnqueued - queue->m_NumDequeued);
+	if (depth > queue->m_MaxDepth) {
+		queue->m_MaxDepth = depth;
+	}
+	queue->m_NumEnqueued = numEnqueued;
+#endif
+
+	queue->m_Queue.push(msg);
+
+	// Only wake up the consumer if it's parked. Spinning/yielding consumers will pick up
+	// the message on their own without a syscall.
+	if (bx::atomicCompareAndSwap<int32_t>(&queue->m_Parked, 1, 0) == 1) {
+		queue->m_Sem.post();
+	}
 
 	return true;
 }
 
 static int32_t threadFunc(bx::Thread* self, void* userData)
 {
+	BX_UNUSED(self);
+
 	Thread* thread = (Thread*)userData;
 
+#if BX_PLATFORM_LINUX || BX_PLATFORM_RPI
+	thread->m_NativeHandle = pthread_self();
+	thread->m_TID = (pid_t)::syscall(SYS_gettid);
+#elif BX_PLATFORM_WINDOWS
+	thread->m_ThreadID = ::GetCurrentThreadId();
+#endif
+	thread->m_StartedSem.post();
+
 	bool done = false;
 	while (!done) {
 		const int32_t retCode = thread->m_Func(thread, thread->m_UserData);
@@ -142,4 +540,127 @@ static int32_t threadFunc(bx::Thread* self, void* userData)
 
 	return 0;
 }
+
+#if BX_PLATFORM_LINUX || BX_PLATFORM_RPI
+static bool setNativeThreadAffinity(pthread_t handle, const CPUSet* cpus)
+{
+	cpu_set_t cs;
+	CPU_ZERO(&cs);
+	for (uint32_t cpu = cpuSetNext(cpus, 0); cpu != UINT32_MAX && cpu < CPU_SETSIZE; cpu = cpuSetNext(cpus, cpu + 1)) {
+		CPU_SET(cpu, &cs);
+	}
+
+	return pthread_setaffinity_np(handle, sizeof(cpu_set_t), &cs) == 0;
+}
+
+static bool getNativeThreadAffinity(pthread_t handle, CPUSet* cpus)
+{
+	cpu_set_t cs;
+	CPU_ZERO(&cs);
+	if (pthread_getaffinity_np(handle, sizeof(cpu_set_t), &cs) != 0) {
+		return false;
+	}
+
+	cpuSetClear(cpus);
+	for (uint32_t cpu = 0; cpu < JX_CONFIG_MAX_CPUS && cpu < CPU_SETSIZE; ++cpu) {
+		if (CPU_ISSET(cpu, &cs)) {
+			cpuSetAdd(cpus, cpu);
+		}
+	}
+
+	return true;
+}
+
+// NOTE: Linux applies nice values per thread (tid). Raising the priority above Normal
+// requires CAP_SYS_NICE (or a suitable RLIMIT_NICE), otherwise this fails.
+static bool setNativeThreadPriority(pid_t tid, ThreadPriority::Enum priority)
+{
+	static const int kNiceValue[] = {
+		10,  // Lowest
+		5,   // Low
+		0,   // Normal
+		-5,  // High
+		-10, // Highest
+	};
+	BX_STATIC_ASSERT(BX_COUNTOF(kNiceValue) == ThreadPriority::Highest + 1, "Missing nice value");
+
+	return setpriority(PRIO_PROCESS, (id_t)tid, kNiceValue[priority]) == 0;
+}
+#elif BX_PLATFORM_WINDOWS
+static bool setNativeThreadAffinity(HANDLE handle, const CPUSet* cpus)
+{
+	// NOTE: Only the first processor group (64 CPUs) is supported.
+	const DWORD_PTR mask = (DWORD_PTR)cpus->m_Bits[0];
+	if (mask == 0) {
+		return false;
+	}
+
+	return ::SetThreadAffinityMask(handle, mask) != 0;
+}
+
+static bool setNativeThreadPriority(HANDLE handle, ThreadPriority::Enum priority)
+{
+	static const int kPriority[] = {
+		THREAD_PRIORITY_LOWEST,
+		THREAD_PRIORITY_BELOW_NORMAL,
+		THREAD_PRIORITY_NORMAL,
+		THREAD_PRIORITY_ABOVE_NORMAL,
+		THREAD_PRIORITY_HIGHEST,
+	};
+	BX_STATIC_ASSERT(BX_COUNTOF(kPriority) == ThreadPriority::Highest + 1, "Missing priority value");
+
+	return ::SetThreadPriority(handle, kPriority[priority]) != FALSE;
+}
+#endif
+
+static void threadListAdd(Thread* thread)
+{
+	MutexScope ms(s_ThreadListMutex);
+
+	thread->m_PrevThread = nullptr;
+	thread->m_NextThread = s_ThreadListHead;
+	if (s_ThreadListHead) {
+		s_ThreadListHead->m_PrevThread = thread;
+	}
+	s_ThreadListHead = thread;
+}
+
+static void threadListRemove(Thread* thread)
+{
+	MutexScope ms(s_ThreadListMutex);
+
+	if (thread->m_PrevThread) {
+		thread->m_PrevThread->m_NextThread = thread->m_NextThread;
+	} else if (s_ThreadListHead == thread) {
+		s_ThreadListHead = thread->m_NextThread;
+	}
+
+	if (thread->m_NextThread) {
+		thread->m_NextThread->m_PrevThread = thread->m_PrevThread;
+	}
+
+	thread->m_PrevThread = nullptr;
+	thread->m_NextThread = nullptr;
+}
+
+#if JX_CONFIG_THREAD_QUEUE_STATS
+static void msgQueueUpdatePopStats(MessageQueue* queue, ThreadMessage* msg)
+{
+	const MessageHeader* hdr = (const MessageHeader*)((uint8_t*)msg - kMessageHeaderSize);
+	const int64_t latency = clockGetTicks() - hdr->m_PushTime;
+	const uint64_t latency_ns = latency > 0
+		? (uint64_t)clockTicksToNs(latency)
+		: 0
+		;
+
+	const uint32_t bucket = latency_ns != 0
+		? bx::min<uint32_t>(63 - (uint32_t)bx::uint64_cntlz(latency_ns), JX_THREAD_QUEUE_LATENCY_NUM_BUCKETS - 1)
+		: 0
+		;
+
+	queue->m_LatencyHistogram[bucket] = queue->m_LatencyHistogram[bucket] + 1;
+	bx::writeBarrier();
+	queue->m_NumDequeued = queue->m_NumDequeued + 1;
+}
+#endif
 }
@@ -0,0 +1,279 @@
+#include <jx/thread_recorder.h>
+#include <jx/clock.h>
+#include <jx/cpu.h>
+#include <jx/fs.h>
+#include <jx/sys.h>
+#include <bx/allocator.h>
+#include <bx/cpu.h>
+#include <bx/os.h>
+#include <bx/timer.h>
+
+namespace jx
+{
+#define THREAD_RECORDER_FILE_MAGIC   0x5254584A // 'JXTR'
+#define THREAD_RECORDER_FILE_VERSION 1
+
+// Waits longer than this are done with bx::sleep(). Shorter ones spin.
+static const int64_t kReplaySpinThreshold_ns = 2000000;
+
+struct RecordSlot
+{
+	volatile uint64_t m_Seq; // Reservation index + 1. 0 while the slot is being written.
+	int64_t m_Time_ns;
+	uint32_t m_MsgID;
+	uint16_t m_Size;
+	uint8_t m_Queue;
+	uint8_t m_Event;
+	// Followed by the payload if ThreadRecorderFlags::RecordPayload is set
+};
+
+struct ThreadRecorder
+{
+	bx::AllocatorI* m_Allocator;
+	uint8_t* m_Slots;
+	volatile uint64_t m_WriteIndex;
+	int64_t m_StartTime;
+	uint32_t m_SlotSize;
+	uint32_t m_Capacity;
+	uint32_t m_Mask;
+	uint32_t m_Flags;
+};
+
+struct ThreadRecordFileHeader
+{
+	uint32_t m_Magic;
+	uint32_t m_Version;
+	uint32_t m_RecordSize;
+	uint32_t m_NumRecords;
+};
+
+static void replayWaitUntil(int64_t startTime, int64_t freq, int64_t time_ns);
+
+ThreadRecorder* createThreadRecorder(bx::AllocatorI* allocator, uint32_t capacity, uint32_t flags)
+{
+	JX_CHECK(bx::isPowerOf2<uint32_t>(capacity), "Thread recorder capacity must be a power of 2");
+
+	const uint32_t payloadSize = (flags & ThreadRecorderFlags::RecordPayload) != 0 ? JX_THREAD_MESSAGE_BUFFER_SIZE : 0;
+	const uint32_t slotSize = ((uint32_t)sizeof(RecordSlot) + payloadSize + 7) & ~7u;
+
+	const uint32_t totalMem = sizeof(ThreadRecorder) + slotSize * capacity;
+	uint8_t* mem = (uint8_t*)BX_ALLOC(allocator, totalMem);
+	if (!mem) {
+		return nullptr;
+	}
+
+	bx::memSet(mem, 0, totalMem);
+
+	ThreadRecorder* recorder = (ThreadRecorder*)mem;
+	recorder->m_Allocator = allocator;
+	recorder->m_Slots = mem + sizeof(ThreadRecorder);
+	recorder->m_WriteIndex = 0;
+	recorder->m_StartTime = clockGetTicks();
+	recorder->m_SlotSize = slotSize;
+	recorder->m_Capacity = capacity;
+	recorder->m_Mask = capacity - 1;
+	recorder->m_Flags = flags;
+
+	return recorder;
+}
+
+void destroyThreadRecorder(ThreadRecorder* recorder)
+{
+	BX_FREE(recorder->m_Allocator, recorder);
+}
+
+void threadRecorderRecord(ThreadRecorder* recorder, ThreadRecordEvent::Enum ev, ThreadQueue::Enum queue, uint32_t msgID, const void* data, uint32_t sz)
+{
+	// Producers and the consumer record concurrently, so slots are reserved atomically.
+	const uint64_t idx = bx::atomicFetchAndAdd<uint64_t>(&recorder->m_WriteIndex, 1);
+
+	RecordSlot* slot = (RecordSlot*)&recorder->m_Slots[(idx & recorder->m_Mask) * recorder->m_SlotSize];
+	slot->m_Seq = 0;
+	bx::writeBarrier();
+
+	slot->m_Time_ns = clockTicksToNs(clockGetTicks() - recorder->m_StartTime);
+	slot->m_MsgID = msgID;
+	slot->m_Size = (uint16_t)sz;
+	slot->m_Queue = (uint8_t)queue;
+	slot->m_Event = (uint8_t)ev;
+	if ((recorder->m_Flags & ThreadRecorderFlags::RecordPayload) != 0 && sz != 0) {
+		bx::memCopy((uint8_t*)slot + sizeof(RecordSlot), data, sz);
+	}
+
+	bx::writeBarrier();
+	slot->m_Seq = idx + 1;
+}
+
+uint32_t threadRecorderGetRecords(ThreadRecorder* recorder, ThreadRecord* records, uint32_t maxRecords)
+{
+	const bool hasPayload = (recorder->m_Flags & ThreadRecorderFlags::RecordPayload) != 0;
+
+	const uint64_t end = recorder->m_WriteIndex;
+	bx::readBarrier();
+
+	const uint64_t numAvailable = bx::min<uint64_t>(end, recorder->m_Capacity);
+	const uint64_t start = end - bx::min<uint64_t>(numAvailable, maxRecords);
+
+	uint32_t numRecords = 0;
+	for (uint64_t i = start; i < end; ++i) {
+		const RecordSlot* slot = (const RecordSlot*)&recorder->m_Slots[(i & recorder->m_Mask) * recorder->m_SlotSize];
+
+		// Skip slots which are being written or have already been overwritten.
+		const uint64_t seq = slot->m_Seq;
+		if (seq != i + 1) {
+			continue;
+		}
+		bx::readBarrier();
+
+		ThreadRecord* rec = &records[numRecords];
+		rec->m_Time_ns = slot->m_Time_ns;
+		rec->m_MsgID = slot->m_MsgID;
+		rec->m_Size = slot->m_Size;
+		rec->m_Queue = slot->m_Queue;
+		rec->m_Event = slot->m_Event;
+		rec->m_Flags = ThreadRecordFlags::None;
+		if (hasPayload) {
+			rec->m_Flags |= ThreadRecordFlags::HasPayload;
+			bx::memCopy(rec->m_Data, (const uint8_t*)slot + sizeof(RecordSlot), bx::min<uint32_t>(rec->m_Size, JX_THREAD_MESSAGE_BUFFER_SIZE));
+		}
+
+		bx::readBarrier();
+		if (slot->m_Seq != seq) {
+			continue;
+		}
+
+		++numRecords;
+	}
+
+	return numRecords;
+}
+
+uint64_t threadRecorderGetNumRecorded(const ThreadRecorder* recorder)
+{
+	return recorder->m_WriteIndex;
+}
+
+bool threadRecordsSave(File* f, const ThreadRecord* records, uint32_t numRecords)
+{
+	// The records are written with a single call.
+	const uint64_t dataSize = (uint64_t)numRecords * sizeof(ThreadRecord);
+	if (dataSize > UINT32_MAX) {
+		JX_WARN(false, "Too many thread records");
+		return false;
+	}
+
+	ThreadRecordFileHeader hdr;
+	hdr.m_Magic = THREAD_RECORDER_FILE_MAGIC;
+	hdr.m_Version = THREAD_RECORDER_FILE_VERSION;
+	hdr.m_RecordSize = sizeof(ThreadRecord);
+	hdr.m_NumRecords = numRecords;
+	if (fsFileWriteBytes(f, &hdr, sizeof(ThreadRecordFileHeader)) != sizeof(ThreadRecordFileHeader)) {
+		return false;
+	}
+
+	return fsFileWriteBytes(f, records, (uint32_t)dataSize) == dataSize;
+}
+
+ThreadRecord* threadRecordsLoad(File* f, bx::AllocatorI* allocator, uint32_t* numRecords)
+{
+	*numRecords = 0;
+
+	ThreadRecordFileHeader hdr;
+	if (fsFileReadBytes(f, &hdr, sizeof(ThreadRecordFileHeader)) != sizeof(ThreadRecordFileHeader)) {
+		return nullptr;
+	}
+
+	if (hdr.m_Magic != THREAD_RECORDER_FILE_MAGIC || hdr.m_Version != THREAD_RECORDER_FILE_VERSION || hdr.m_RecordSize != sizeof(ThreadRecord)) {
+		JX_WARN(false, "Invalid thread record file");
+		return nullptr;
+	}
+
+	// Don't trust the header's record count before checking it against the file.
+	const uint64_t dataSize = (uint64_t)hdr.m_NumRecords * sizeof(ThreadRecord);
+	const int64_t dataOffset = fsFileTell(f);
+	const uint64_t fileSize = fsFileGetSize(f);
+	const bool valid = true
+		&& dataSize <= UINT32_MAX
+		&& dataOffset >= 0
+		&& fileSize >= (uint64_t)dataOffset
+		&& dataSize <= fileSize - (uint64_t)dataOffset
+		;
+	if (!valid) {
+		JX_WARN(false, "Invalid thread record file");
+		return nullptr;
+	}
+
+	ThreadRecord* records = (ThreadRecord*)BX_ALLOC(allocator, (size_t)dataSize);
+	if (!records) {
+		return nullptr;
+	}
+
+	if (fsFileReadBytes(f, records, (uint32_t)dataSize) != dataSize) {
+		BX_FREE(allocator, records);
+		return nullptr;
+	}
+
+	*numRecords = hdr.m_NumRecords;
+
+	return records;
+}
+
+uint32_t threadReplay(Thread* target, ThreadQueue::Enum queue, const ThreadRecord* records, uint32_t numRecords, ThreadReplayMode::Enum mode)
+{
+	static const uint8_t kZeroPayload[JX_THREAD_MESSAGE_BUFFER_SIZE] = { 0 };
+
+	const int64_t startTime = bx::getHPCounter();
+	const int64_t freq = bx::getHPFrequency();
+
+	int64_t firstTime_ns = -1;
+	uint32_t numPushed = 0;
+	for (uint32_t i = 0; i < numRecords; ++i) {
+		const ThreadRecord* rec = &records[i];
+		if (rec->m_Event != ThreadRecordEvent::Push || rec->m_Queue != (uint8_t)queue) {
+			continue;
+		}
+
+		if (mode == ThreadReplayMode::RealTime) {
+			if (firstTime_ns < 0) {
+				firstTime_ns = rec->m_Time_ns;
+			}
+
+			replayWaitUntil(startTime, freq, rec->m_Time_ns - firstTime_ns);
+		}
+
+		// Without a recorded payload the message is replayed with zeroed data of the same size.
+		const void* data = (rec->m_Flags & ThreadRecordFlags::HasPayload) != 0 ? rec->m_Data : kZeroPayload;
+		const uint32_t sz = bx::min<uint32_t>(rec->m_Size, JX_THREAD_MESSAGE_BUFFER_SIZE);
+
+		const bool pushed = queue == ThreadQueue::In
+			? threadInQueuePush(target, rec->m_MsgID, data, sz)
+			: threadOutQueuePush(target, rec->m_MsgID, data, sz)
+			;
+		if (pushed) {
+			++numPushed;
+		}
+	}
+
+	return numPushed;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Internal
+//
+static void replayWaitUntil(int64_t startTime, int64_t freq, int64_t time_ns)
+{
+	for (;;) {
+		const int64_t elapsed_ns = (int64_t)((double)(bx::getHPCounter() - startTime) * 1.0e9 / (double)freq);
+		const int64_t remaining_ns = time_ns - elapsed_ns;
+		if (remaining_ns <= 0) {
+			break;
+		}
+
+		if (remaining_ns > kReplaySpinThreshold_ns) {
+			bx::sleep((uint32_t)((remaining_ns - kReplaySpinThreshold_ns / 2) / 1000000));
+		} else {
+			cpuPause();
+		}
+	}
+}
+}
@@ -0,0 +1,466 @@
+#include <jx/timer_service.h>
+#include <jx/thread.h>
+#include <jx/mutex.h>
+#include <jx/sys.h>
+#include <bx/allocator.h>
+#include <bx/timer.h>
+
+namespace jx
+{
+#define TIMER_WHEEL_NUM_LEVELS   4
+#define TIMER_WHEEL_SLOT_BITS    8
+#define TIMER_WHEEL_NUM_SLOTS    (1u << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_SLOT_MASK    (TIMER_WHEEL_NUM_SLOTS - 1)
+#define TIMER_CHUNK_SIZE_BITS    12
+#define TIMER_CHUNK_SIZE         (1u << TIMER_CHUNK_SIZE_BITS)
+#define TIMER_INDEX_BITS         22
+#define TIMER_INDEX_MASK         ((1u << TIMER_INDEX_BITS) - 1)
+#define TIMER_MAX_TIMERS         TIMER_INDEX_MASK
+#define TIMER_NULL               UINT32_MAX
+#define TIMER_SLOT_NONE          UINT16_MAX
+
+static const uint32_t kMsgQuit = 0;
+static const uint32_t kMsgWakeup = 1;
+
+struct TimerNode
+{
+	uint64_t m_Expiry;   // Absolute tick
+	Thread* m_Target;
+	uint32_t m_Period;   // In ticks; 0 for one-shot timers
+	uint32_t m_MsgID;
+	uint32_t m_Next;
+	uint32_t m_Prev;
+	uint16_t m_Slot;     // Index into TimerService::m_Slots or TIMER_SLOT_NONE if the node isn't linked
+	uint16_t m_Gen;
+	uint32_t m_DataSize;
+	uint8_t m_Data[JX_THREAD_MESSAGE_BUFFER_SIZE];
+};
+
+struct TimerService
+{
+	bx::AllocatorI* m_Allocator;
+	Thread* m_Thread;
+	TimerNode** m_Chunks;
+	Mutex m_Mutex;
+	int64_t m_StartCounter;
+	int64_t m_CountersPerTick;
+	uint64_t m_CurTick;
+	uint64_t m_WakeupTick;
+	uint32_t m_NumChunks;
+	uint32_t m_NumNodes;
+	uint32_t m_FirstFreeNode;
+	uint32_t m_NumPending;
+	uint32_t m_TickDuration;
+	uint32_t m_Slots[TIMER_WHEEL_NUM_LEVELS * TIMER_WHEEL_NUM_SLOTS];
+};
+
+static int32_t timerServiceThreadFunc(Thread* self, void* userData);
+static TimerNode* tsGetNode(TimerService* ts, uint32_t nodeID);
+static uint32_t tsAllocNode(TimerService* ts);
+static void tsFreeNode(TimerService* ts, uint32_t nodeID);
+static void tsLinkNode(TimerService* ts, uint32_t nodeID);
+static void tsUnlinkNode(TimerService* ts, uint32_t nodeID);
+static void tsCascade(TimerService* ts, uint32_t level, uint32_t slot);
+static void tsExpireSlot(TimerService* ts, uint32_t slot);
+static void tsAdvance(TimerService* ts, uint64_t targetTick);
+static uint64_t tsGetCurrentTick(const TimerService* ts);
+static uint64_t tsCalcWakeupTick(const TimerService* ts);
+
+inline uint32_t tsMakeTimerID(uint32_t nodeID, uint16_t gen)
+{
+	return ((uint32_t)gen << TIMER_INDEX_BITS) | nodeID;
+}
+
+inline uint64_t tsMsecToTicks(const TimerService* ts, uint32_t msec)
+{
+	return (msec + ts->m_TickDuration - 1) / ts->m_TickDuration;
+}
+
+TimerService* createTimerService(bx::AllocatorI* allocator, uint32_t tickDuration_msec, const char* name)
+{
+	JX_CHECK(tickDuration_msec != 0, "Invalid tick duration");
+
+	TimerService* ts = (TimerService*)BX_ALLOC(allocator, sizeof(TimerService));
+	if (!ts) {
+		return nullptr;
+	}
+
+	bx::memSet(ts, 0, sizeof(TimerService));
+	ts->m_Allocator = allocator;
+	ts->m_TickDuration = tickDuration_msec;
+	ts->m_CountersPerTick = bx::max<int64_t>((bx::getHPFrequency() / 1000) * tickDuration_msec, 1);
+	ts->m_StartCounter = bx::getHPCounter();
+	ts->m_FirstFreeNode = TIMER_NULL;
+	ts->m_WakeupTick = UINT64_MAX;
+	bx::memSet(ts->m_Slots, 0xFF, sizeof(ts->m_Slots));
+
+	BX_PLACEMENT_NEW(&ts->m_Mutex, Mutex)("Timer Service");
+
+	ts->m_Thread = createThread(allocator, timerServiceThreadFunc, ts, 0, name);
+	if (!ts->m_Thread) {
+		destroyTimerService(ts);
+		return nullptr;
+	}
+
+	return ts;
+}
+
+void destroyTimerService(TimerService* ts)
+{
+	bx::AllocatorI* allocator = ts->m_Allocator;
+
+	if (ts->m_Thread) {
+		threadInQueuePush(ts->m_Thread, kMsgQuit, nullptr, 0);
+		destroyThread(ts->m_Thread);
+		ts->m_Thread = nullptr;
+	}
+
+	const uint32_t numChunks = ts->m_NumChunks;
+	for (uint32_t i = 0; i < numChunks; ++i) {
+		BX_FREE(allocator, ts->m_Chunks[i]);
+	}
+	BX_FREE(allocator, ts->m_Chunks);
+
+	ts->m_Mutex.~Mutex();
+
+	BX_FREE(allocator, ts);
+}
+
+uint32_t timerServiceAdd(TimerService* ts, Thread* target, uint32_t delay_msec, uint32_t period_msec, uint32_t msgID, const void* data, uint32_t sz)
+{
+	if (sz > JX_THREAD_MESSAGE_BUFFER_SIZE) {
+		JX_CHECK(false, "Timer message data too large!");
+		return JX_TIMER_INVALID_ID;
+	}
+
+	bool wakeup = false;
+	uint32_t timerID = JX_TIMER_INVALID_ID;
+	{
+		MutexScope ms(ts->m_Mutex);
+
+		const uint32_t nodeID = tsAllocNode(ts);
+		if (nodeID == TIMER_NULL) {
+			return JX_TIMER_INVALID_ID;
+		}
+
+		// NOTE: m_CurTick is only updated by the service thread, so it might lag behind the real
+		// time. Calculate expiration time based on the current time in order to avoid firing
+		// timers early; the wheel catches up on the next advance.
+		const uint64_t now = bx::max<uint64_t>(tsGetCurrentTick(ts), ts->m_CurTick);
+
+		TimerNode* node = tsGetNode(ts, nodeID);
+		node->m_Expiry = now + bx::max<uint64_t>(tsMsecToTicks(ts, delay_msec), 1);
+		node->m_Target = target;
+		node->m_Period = (uint32_t)tsMsecToTicks(ts, period_msec);
+		node->m_MsgID = msgID;
+		node->m_DataSize = sz;
+		if (sz != 0) {
+			bx::memCopy(node->m_Data, data, sz);
+		}
+
+		tsLinkNode(ts, nodeID);
+		ts->m_NumPending++;
+
+		if (node->m_Expiry < ts->m_WakeupTick) {
+			ts->m_WakeupTick = node->m_Expiry;
+			wakeup = true;
+		}
+
+		timerID = tsMakeTimerID(nodeID, node->m_Gen);
+	}
+
+	// Make sure the service thread doesn't oversleep.
+	if (wakeup) {
+		threadInQueuePush(ts->m_Thread, kMsgWakeup, nullptr, 0);
+	}
+
+	return timerID;
+}
+
+bool timerServiceCancel(TimerService* ts, uint32_t timerID)
+{
+	if (timerID == JX_TIMER_INVALID_ID) {
+		return false;
+	}
+
+	const uint32_t nodeID = timerID & TIMER_INDEX_MASK;
+	const uint16_t gen = (uint16_t)(timerID >> TIMER_INDEX_BITS);
+
+	MutexScope ms(ts->m_Mutex);
+
+	if (nodeID >= ts->m_NumNodes) {
+		return false;
+	}
+
+	TimerNode* node = tsGetNode(ts, nodeID);
+	if (node->m_Gen != gen || node->m_Slot == TIMER_SLOT_NONE) {
+		return false;
+	}
+
+	tsUnlinkNode(ts, nodeID);
+	tsFreeNode(ts, nodeID);
+	ts->m_NumPending--;
+
+	return true;
+}
+
+uint32_t timerServiceGetNumPending(TimerService* ts)
+{
+	MutexScope ms(ts->m_Mutex);
+	return ts->m_NumPending;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Internal
+//
+static int32_t timerServiceThreadFunc(Thread* self, void* userData)
+{
+	TimerService* ts = (TimerService*)userData;
+
+	int32_t timeout_msec = -1;
+	{
+		MutexScope ms(ts->m_Mutex);
+
+		ts->m_WakeupTick = tsCalcWakeupTick(ts);
+		if (ts->m_WakeupTick != UINT64_MAX) {
+			const uint64_t now = tsGetCurrentTick(ts);
+			timeout_msec = ts->m_WakeupTick > now
+				? (int32_t)bx::min<uint64_t>((ts->m_WakeupTick - now) * ts->m_TickDuration, INT32_MAX)
+				: 0
+				;
+		}
+	}
+
+	ThreadMessage* msg = threadInQueuePop(self, timeout_msec);
+	while (msg) {
+		const uint32_t msgID = msg->m_MsgID;
+		threadReleaseMessage(self, msg);
+
+		if (msgID == kMsgQuit) {
+			return 0;
+		}
+
+		msg = threadInQueuePop(self, 0);
+	}
+
+	{
+		MutexScope ms(ts->m_Mutex);
+		tsAdvance(ts, tsGetCurrentTick(ts));
+	}
+
+	return 1;
+}
+
+static uint64_t tsGetCurrentTick(const TimerService* ts)
+{
+	const int64_t elapsed = bx::getHPCounter() - ts->m_StartCounter;
+	return (uint64_t)(elapsed / ts->m_CountersPerTick);
+}
+
+// Returns the tick the service thread should wake up at. Only level 0 is searched; if
+// it's empty the thread wakes up at the next cascade point.
+static uint64_t tsCalcWakeupTick(const TimerService* ts)
+{
+	if (ts->m_NumPending == 0) {
+		return UINT64_MAX;
+	}
+
+	const uint64_t curTick = ts->m_CurTick;
+	for (uint32_t i = 1; i <= TIMER_WHEEL_NUM_SLOTS; ++i) {
+		const uint64_t tick = curTick + i;
+		if (ts->m_Slots[tick & TIMER_WHEEL_SLOT_MASK] != TIMER_NULL) {
+			return tick;
+		}
+
+		if ((tick & TIMER_WHEEL_SLOT_MASK) == 0) {
+			return tick;
+		}
+	}
+
+	return curTick + TIMER_WHEEL_NUM_SLOTS;
+}
+
+static void tsAdvance(TimerService* ts, uint64_t targetTick)
+{
+	if (ts->m_NumPending == 0) {
+		// Nothing to expire. Jump directly to the target tick.
+		ts->m_CurTick = bx::max<uint64_t>(ts->m_CurTick, targetTick);
+		return;
+	}
+
+	while (ts->m_CurTick < targetTick) {
+		const uint64_t tick = ++ts->m_CurTick;
+
+		// Cascade timers from the upper levels when the lower level wraps around.
+		uint64_t t = tick;
+		for (uint32_t level = 1; level < TIMER_WHEEL_NUM_LEVELS; ++level) {
+			if ((t & TIMER_WHEEL_SLOT_MASK) != 0) {
+				break;
+			}
+
+			t >>= TIMER_WHEEL_SLOT_BITS;
+			tsCascade(ts, level, (uint32_t)(t & TIMER_WHEEL_SLOT_MASK));
+		}
+
+		tsExpireSlot(ts, (uint32_t)(tick & TIMER_WHEEL_SLOT_MASK));
+	}
+}
+
+static void tsCascade(TimerService* ts, uint32_t level, uint32_t slot)
+{
+	const uint32_t slotID = level * TIMER_WHEEL_NUM_SLOTS + slot;
+
+	uint32_t nodeID = ts->m_Slots[slotID];
+	ts->m_Slots[slotID] = TIMER_NULL;
+
+	while (nodeID != TIMER_NULL) {
+		TimerNode* node = tsGetNode(ts, nodeID);
+		const uint32_t nextID = node->m_Next;
+
+		node->m_Slot = TIMER_SLOT_NONE;
+		tsLinkNode(ts, nodeID);
+
+		nodeID = nextID;
+	}
+}
+
+static void tsExpireSlot(TimerService* ts, uint32_t slot)
+{
+	uint32_t nodeID = ts->m_Slots[slot];
+	ts->m_Slots[slot] = TIMER_NULL;
+
+	while (nodeID != TIMER_NULL) {
+		TimerNode* node = tsGetNode(ts, nodeID);
+		const uint32_t nextID = node->m_Next;
+		node->m_Slot = TIMER_SLOT_NONE;
+
+		JX_CHECK(node->m_Expiry <= ts->m_CurTick, "Timer expired too early");
+		if (!threadInQueuePush(node->m_Target, node->m_MsgID, node->m_Data, node->m_DataSize)) {
+			JX_TRACE("Failed to deliver timer message %u", node->m_MsgID);
+		}
+
+		if (node->m_Period != 0) {
+			node->m_Expiry = bx::max<uint64_t>(node->m_Expiry + node->m_Period, ts->m_CurTick + 1);
+			tsLinkNode(ts, nodeID);
+		} else {
+			tsFreeNode(ts, nodeID);
+			ts->m_NumPending--;
+		}
+
+		nodeID = nextID;
+	}
+}
+
+static void tsLinkNode(TimerService* ts, uint32_t nodeID)
+{
+	TimerNode* node = tsGetNode(ts, nodeID);
+	JX_CHECK(node->m_Slot == TIMER_SLOT_NONE, "Timer already linked");
+
+	const uint64_t expiry = node->m_Expiry;
+	const uint64_t delta = expiry > ts->m_CurTick ? expiry - ts->m_CurTick : 0;
+
+	uint32_t slotID = 0;
+	if (delta < (1ull << (1 * TIMER_WHEEL_SLOT_BITS))) {
+		// NOTE: Timers cascaded from upper levels can expire on the current tick. Their slot is
+		// processed right after cascading (see tsAdvance()).
+		slotID = 0 * TIMER_WHEEL_NUM_SLOTS + (uint32_t)(bx::max<uint64_t>(expiry, ts->m_CurTick) & TIMER_WHEEL_SLOT_MASK);
+	} else if (delta < (1ull << (2 * TIMER_WHEEL_SLOT_BITS))) {
+		slotID = 1 * TIMER_WHEEL_NUM_SLOTS + (uint32_t)((expiry >> (1 * TIMER_WHEEL_SLOT_BITS)) & TIMER_WHEEL_SLOT_MASK);
+	} else if (delta < (1ull << (3 * TIMER_WHEEL_SLOT_BITS))) {
+		slotID = 2 * TIMER_WHEEL_NUM_SLOTS + (uint32_t)((expiry >> (2 * TIMER_WHEEL_SLOT_BITS)) & TIMER_WHEEL_SLOT_MASK);
+	} else {
+		// Clamp very long delays to the last level. They will be cascaded down when their time comes.
+		const uint64_t maxDelta = (1ull << (4 * TIMER_WHEEL_SLOT_BITS)) - 1;
+		const uint64_t e = delta > maxDelta ? ts->m_CurTick + maxDelta : expiry;
+		slotID = 3 * TIMER_WHEEL_NUM_SLOTS + (uint32_t)((e >> (3 * TIMER_WHEEL_SLOT_BITS)) & TIMER_WHEEL_SLOT_MASK);
+	}
+
+	const uint32_t headID = ts->m_Slots[slotID];
+	node->m_Slot = (uint16_t)slotID;
+	node->m_Prev = TIMER_NULL;
+	node->m_Next = headID;
+	if (headID != TIMER_NULL) {
+		tsGetNode(ts, headID)->m_Prev = nodeID;
+	}
+	ts->m_Slots[slotID] = nodeID;
+}
+
+static void tsUnlinkNode(TimerService* ts, uint32_t nodeID)
+{
+	TimerNode* node = tsGetNode(ts, nodeID);
+	JX_CHECK(node->m_Slot != TIMER_SLOT_NONE, "Timer not linked");
+
+	if (node->m_Prev != TIMER_NULL) {
+		tsGetNode(ts, node->m_Prev)->m_Next = node->m_Next;
+	} else {
+		ts->m_Slots[node->m_Slot] = node->m_Next;
+	}
+
+	if (node->m_Next != TIMER_NULL) {
+		tsGetNode(ts, node->m_Next)->m_Prev = node->m_Prev;
+	}
+
+	node->m_Slot = TIMER_SLOT_NONE;
+	node->m_Next = TIMER_NULL;
+	node->m_Prev = TIMER_NULL;
+}
+
+static TimerNode* tsGetNode(TimerService* ts, uint32_t nodeID)
+{
+	JX_CHECK(nodeID < ts->m_NumNodes, "Invalid timer node");
+	return &ts->m_Chunks[nodeID >> TIMER_CHUNK_SIZE_BITS][nodeID & (TIMER_CHUNK_SIZE - 1)];
+}
+
+static uint32_t tsAllocNode(TimerService* ts)
+{
+	if (ts->m_FirstFreeNode != TIMER_NULL) {
+		const uint32_t nodeID = ts->m_FirstFreeNode;
+		TimerNode* node = tsGetNode(ts, nodeID);
+		ts->m_FirstFreeNode = node->m_Next;
+		node->m_Next = TIMER_NULL;
+		return nodeID;
+	}
+
+	if (ts->m_NumNodes >= TIMER_MAX_TIMERS) {
+		JX_CHECK(false, "Too many timers");
+		return TIMER_NULL;
+	}
+
+	// Allocate a new chunk. Nodes are never moved, so existing node pointers stay valid.
+	if ((ts->m_NumNodes & (TIMER_CHUNK_SIZE - 1)) == 0) {
+		TimerNode** newChunks = (TimerNode**)BX_REALLOC(ts->m_Allocator, ts->m_Chunks, sizeof(TimerNode*) * (ts->m_NumChunks + 1));
+		if (!newChunks) {
+			return TIMER_NULL;
+		}
+		ts->m_Chunks = newChunks;
+
+		TimerNode* chunk = (TimerNode*)BX_ALLOC(ts->m_Allocator, sizeof(TimerNode) * TIMER_CHUNK_SIZE);
+		if (!chunk) {
+			return TIMER_NULL;
+		}
+		ts->m_Chunks[ts->m_NumChunks++] = chunk;
+	}
+
+	const uint32_t nodeID = ts->m_NumNodes++;
+	TimerNode* node = tsGetNode(ts, nodeID);
+	bx::memSet(node, 0, sizeof(TimerNode));
+	node->m_Next = TIMER_NULL;
+	node->m_Prev = TIMER_NULL;
+	node->m_Slot = TIMER_SLOT_NONE;
+
+	return nodeID;
+}
+
+static void tsFreeNode(TimerService* ts, uint32_t nodeID)
+{
+	TimerNode* node = tsGetNode(ts, nodeID);
+	JX_CHECK(node->m_Slot == TIMER_SLOT_NONE, "Freeing linked timer");
+
+	// Bump the generation so stale timer IDs can be detected. Generation 0x3FF is skipped so
+	// a valid timer ID never equals JX_TIMER_INVALID_ID.
+	node->m_Gen = (uint16_t)((node->m_Gen + 1) % ((1u << (32 - TIMER_INDEX_BITS)) - 1));
+	node->m_Target = nullptr;
+	node->m_Next = ts->m_FirstFreeNode;
+	ts->m_FirstFreeNode = nodeID;
+}
+}
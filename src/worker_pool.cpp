@@ -0,0 +1,201 @@
+#include <jx/worker_pool.h>
+#include <jx/thread.h>
+#include <jx/cpu.h>
+#include <jx/sys.h>
+#include <bx/allocator.h>
+#include <bx/cpu.h>
+#include <bx/os.h>
+#include <bx/string.h>
+
+namespace jx
+{
+static const uint32_t kMsgQuit = 0;
+static const uint32_t kMsgRunRange = 1;
+
+// Workers are expected to be fed in bursts, so spin for a while before parking.
+static const uint32_t kWorkerNumSpins = 2000;
+static const uint32_t kWorkerNumYields = 16;
+
+// Number of pause iterations the calling thread spins while waiting for the workers to
+// finish, before yielding the rest of its time slice.
+static const uint32_t kJoinNumSpins = 4000;
+
+struct WorkerPool
+{
+	bx::AllocatorI* m_Allocator;
+	Thread** m_Workers;
+	uint32_t m_NumWorkers;
+};
+
+struct ParallelForJob
+{
+	ParallelForFn m_Func;
+	void* m_UserData;
+	volatile int32_t m_NumPending;
+};
+
+struct ParallelForRange
+{
+	ParallelForJob* m_Job;
+	uint32_t m_First;
+	uint32_t m_Last;
+};
+BX_STATIC_ASSERT(sizeof(ParallelForRange) <= JX_THREAD_MESSAGE_BUFFER_SIZE, "ParallelForRange doesn't fit in a ThreadMessage");
+
+static int32_t workerThreadFunc(Thread* self, void* userData);
+
+WorkerPool* createWorkerPool(bx::AllocatorI* allocator, uint32_t numWorkers, const char* name)
+{
+	const uint32_t totalMem = sizeof(WorkerPool) + sizeof(Thread*) * numWorkers;
+	uint8_t* mem = (uint8_t*)BX_ALLOC(allocator, totalMem);
+	if (!mem) {
+		return nullptr;
+	}
+
+	bx::memSet(mem, 0, totalMem);
+
+	WorkerPool* pool = (WorkerPool*)mem;
+	pool->m_Allocator = allocator;
+	pool->m_Workers = (Thread**)(mem + sizeof(WorkerPool));
+
+	ThreadWaitStrategy waitStrategy;
+	waitStrategy.m_NumSpins = kWorkerNumSpins;
+	waitStrategy.m_NumYields = kWorkerNumYields;
+
+	for (uint32_t i = 0; i < numWorkers; ++i) {
+		char threadName[64];
+		bx::snprintf(threadName, BX_COUNTOF(threadName), "%s %u", name, i);
+
+		Thread* worker = createThread(allocator, workerThreadFunc, pool, 0, threadName);
+		if (!worker) {
+			destroyWorkerPool(pool);
+			return nullptr;
+		}
+
+		threadSetWaitStrategy(worker, ThreadQueue::In, &waitStrategy);
+
+		pool->m_Workers[pool->m_NumWorkers++] = worker;
+	}
+
+	return pool;
+}
+
+void destroyWorkerPool(WorkerPool* pool)
+{
+	const uint32_t numWorkers = pool->m_NumWorkers;
+	for (uint32_t i = 0; i < numWorkers; ++i) {
+		threadInQueuePush(pool->m_Workers[i], kMsgQuit, nullptr, 0);
+	}
+
+	for (uint32_t i = 0; i < numWorkers; ++i) {
+		destroyThread(pool->m_Workers[i]);
+		pool->m_Workers[i] = nullptr;
+	}
+
+	BX_FREE(pool->m_Allocator, pool);
+}
+
+uint32_t workerPoolGetNumWorkers(const WorkerPool* pool)
+{
+	return pool->m_NumWorkers;
+}
+
+void parallelFor(WorkerPool* pool, uint32_t numItems, uint32_t granularity, ParallelForFn func, void* userData)
+{
+	if (numItems == 0) {
+		return;
+	}
+
+	granularity = bx::max<uint32_t>(granularity, 1);
+
+	const uint32_t numWorkers = pool ? pool->m_NumWorkers : 0;
+	const uint32_t numBlocks = numItems / granularity + ((numItems % granularity) != 0 ? 1 : 0);
+	const uint32_t numRanges = bx::min<uint32_t>(numBlocks, numWorkers + 1);
+	if (numRanges <= 1) {
+		func(0, numItems, userData);
+		return;
+	}
+
+	const uint32_t blocksPerRange = numBlocks / numRanges + ((numBlocks % numRanges) != 0 ? 1 : 0);
+	const uint32_t itemsPerRange = blocksPerRange * granularity;
+
+	ParallelForJob job;
+	job.m_Func = func;
+	job.m_UserData = userData;
+	job.m_NumPending = (int32_t)numRanges;
+
+	// The calling thread processes the first range. The rest are handed over to the workers.
+	const uint32_t callerLast = bx::min<uint32_t>(itemsPerRange, numItems);
+	uint32_t first = callerLast;
+	uint32_t workerID = 0;
+	while (first < numItems) {
+		ParallelForRange range;
+		range.m_Job = &job;
+		range.m_First = first;
+		range.m_Last = bx::min<uint32_t>(first + itemsPerRange, numItems);
+
+		if (!threadInQueuePush(pool->m_Workers[workerID], kMsgRunRange, &range, sizeof(ParallelForRange))) {
+			func(range.m_First, range.m_Last, userData);
+			bx::atomicFetchAndAdd<int32_t>(&job.m_NumPending, -1);
+		}
+
+		first = range.m_Last;
+		++workerID;
+	}
+
+	// NOTE: Integer rounding might produce fewer ranges than initially calculated.
+	const int32_t numUnused = (int32_t)(numRanges - 1 - workerID);
+	if (numUnused != 0) {
+		bx::atomicFetchAndAdd<int32_t>(&job.m_NumPending, -numUnused);
+	}
+
+	func(0, callerLast, userData);
+	bx::atomicFetchAndAdd<int32_t>(&job.m_NumPending, -1);
+
+	// Join. The job lives on this thread's stack and the workers' last access to it is the
+	// decrement of the pending counter, so it's safe to return as soon as it reaches 0.
+	// Ranges are balanced so the wait is expected to be short; spin before yielding.
+	uint32_t numSpins = 0;
+	while (job.m_NumPending != 0) {
+		if (numSpins < kJoinNumSpins) {
+			cpuPause();
+			++numSpins;
+		} else {
+			bx::yield();
+		}
+	}
+	bx::readBarrier();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Internal
+//
+static int32_t workerThreadFunc(Thread* self, void* userData)
+{
+	BX_UNUSED(userData);
+
+	ThreadMessage* msg = threadInQueuePop(self, -1);
+	if (!msg) {
+		return 1;
+	}
+
+	const uint32_t msgID = msg->m_MsgID;
+	if (msgID == kMsgQuit) {
+		threadReleaseMessage(self, msg);
+		return 0;
+	} else if (msgID == kMsgRunRange) {
+		ParallelForRange range;
+		bx::memCopy(&range, msg->m_Data, sizeof(ParallelForRange));
+		threadReleaseMessage(self, msg);
+
+		ParallelForJob* job = range.m_Job;
+		job->m_Func(range.m_First, range.m_Last, job->m_UserData);
+		bx::atomicFetchAndAdd<int32_t>(&job->m_NumPending, -1);
+	} else {
+		JX_CHECK(false, "Unknown worker message");
+		threadReleaseMessage(self, msg);
+	}
+
+	return 1;
+}
+}
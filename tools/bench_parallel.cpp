@@ -0,0 +1,381 @@
+// Speedup of the parallel data-parallel kernels over their serial versions.
+//
+// Every kernel runs on inputs from 1K elements up to the size given on the command line
+// (default 10M; 100M rects alone need ~3.2 GB), first serially and then on worker pools
+// of increasing size. Each configuration is timed as the best of a few runs and its output
+// is compared against the serial result.
+//
+// Elements are rects (rectAoSToSoA, rectIntersect), queries (interp1f), input bytes
+// (base64Encode) and 64-byte messages (spookyHash128Batch).
+//
+// Build (from the repository root, against bx):
+//   c++ -std=c++17 -O2 -Iinclude -I<bx>/include tools/bench_parallel.cpp src/*.cpp <bx>/src/amalgamated.cpp -lpthread -ldl
+#include <jx/sys.h>
+#include <jx/rect.h>
+#include <jx/math.h>
+#include <jx/base64.h>
+#include <jx/spooky_hash.h>
+#include <jx/worker_pool.h>
+#include <jx/cpu.h>
+#include <jx/clock.h>
+#include <bx/allocator.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_NUM_RUNS        3
+#define BENCH_MAX_POOLS       8
+#define BENCH_MSG_LENGTH      64
+
+struct BenchKernel
+{
+	enum Enum : uint32_t
+	{
+		RectAoSToSoA,
+		RectIntersect,
+		Interp1f,
+		Base64Encode,
+		SpookyHash128Batch,
+
+		Count
+	};
+};
+
+static const char* kKernelName[] = {
+	"rectAoSToSoA",
+	"rectIntersect",
+	"interp1f",
+	"base64Encode",
+	"spookyHash128Batch",
+};
+BX_STATIC_ASSERT(BX_COUNTOF(kKernelName) == BenchKernel::Count, "Missing kernel name");
+
+#define BENCH_INTERP_TABLE_SIZE 1024
+
+struct BenchData
+{
+	bx::AllocatorI* m_Allocator;
+	uint32_t m_NumElements;
+
+	// Inputs
+	jx::Rect* m_Rects;
+	jx::RectSoA m_SoA;
+	jx::Rect m_TestRect;
+	float* m_InterpX;
+	float* m_InterpY;
+	float* m_Queries;
+	uint8_t* m_Bytes;
+	const void** m_Messages;
+	size_t* m_MessageLengths;
+
+	// Outputs (serial reference and current run)
+	jx::RectSoA m_RefSoA;
+	jx::RectSoA m_OutSoA;
+	bool* m_RefResults;
+	bool* m_OutResults;
+	float* m_RefInterp;
+	float* m_OutInterp;
+	uint8_t* m_RefBase64;
+	size_t m_RefBase64Len;
+	uint64_t* m_RefHashes;
+	uint64_t* m_OutHashes;
+};
+
+static float benchRandFloat(uint32_t* state)
+{
+	*state = *state * 1664525u + 1013904223u;
+	return (float)(*state >> 8) * (1.0f / 16777216.0f);
+}
+
+static float* benchAllocFloats(bx::AllocatorI* allocator, uint32_t n)
+{
+	return (float*)BX_ALIGNED_ALLOC(allocator, sizeof(float) * bx::max<uint32_t>(n, 1), 64);
+}
+
+static void benchAllocSoA(bx::AllocatorI* allocator, jx::RectSoA* soa, uint32_t n)
+{
+	soa->m_MinX = benchAllocFloats(allocator, n);
+	soa->m_MinY = benchAllocFloats(allocator, n);
+	soa->m_MaxX = benchAllocFloats(allocator, n);
+	soa->m_MaxY = benchAllocFloats(allocator, n);
+}
+
+static void benchFreeSoA(bx::AllocatorI* allocator, jx::RectSoA* soa)
+{
+	BX_ALIGNED_FREE(allocator, soa->m_MinX, 64);
+	BX_ALIGNED_FREE(allocator, soa->m_MinY, 64);
+	BX_ALIGNED_FREE(allocator, soa->m_MaxX, 64);
+	BX_ALIGNED_FREE(allocator, soa->m_MaxY, 64);
+}
+
+static bool benchSoAEqual(const jx::RectSoA* a, const jx::RectSoA* b, uint32_t n)
+{
+	const size_t sz = sizeof(float) * n;
+	return true
+		&& memcmp(a->m_MinX, b->m_MinX, sz) == 0
+		&& memcmp(a->m_MinY, b->m_MinY, sz) == 0
+		&& memcmp(a->m_MaxX, b->m_MaxX, sz) == 0
+		&& memcmp(a->m_MaxY, b->m_MaxY, sz) == 0
+		;
+}
+
+static bool benchDataInit(BenchData* data, bx::AllocatorI* allocator, uint32_t n)
+{
+	memset(data, 0, sizeof(BenchData));
+	data->m_Allocator = allocator;
+	data->m_NumElements = n;
+
+	data->m_Rects = (jx::Rect*)BX_ALIGNED_ALLOC(allocator, sizeof(jx::Rect) * n, 64);
+	data->m_InterpX = benchAllocFloats(allocator, BENCH_INTERP_TABLE_SIZE);
+	data->m_InterpY = benchAllocFloats(allocator, BENCH_INTERP_TABLE_SIZE);
+	data->m_Queries = benchAllocFloats(allocator, n);
+	data->m_Bytes = (uint8_t*)BX_ALLOC(allocator, n);
+	data->m_Messages = (const void**)BX_ALLOC(allocator, sizeof(void*) * n);
+	data->m_MessageLengths = (size_t*)BX_ALLOC(allocator, sizeof(size_t) * n);
+	data->m_RefResults = (bool*)BX_ALIGNED_ALLOC(allocator, n, 64);
+	data->m_OutResults = (bool*)BX_ALIGNED_ALLOC(allocator, n, 64);
+	data->m_RefInterp = benchAllocFloats(allocator, n);
+	data->m_OutInterp = benchAllocFloats(allocator, n);
+	data->m_RefHashes = (uint64_t*)BX_ALLOC(allocator, sizeof(uint64_t) * 2 * n);
+	data->m_OutHashes = (uint64_t*)BX_ALLOC(allocator, sizeof(uint64_t) * 2 * n);
+	benchAllocSoA(allocator, &data->m_SoA, n);
+	benchAllocSoA(allocator, &data->m_RefSoA, n);
+	benchAllocSoA(allocator, &data->m_OutSoA, n);
+
+	const bool allocated = true
+		&& data->m_Rects && data->m_InterpX && data->m_InterpY && data->m_Queries
+		&& data->m_Bytes && data->m_Messages && data->m_MessageLengths
+		&& data->m_RefResults && data->m_OutResults && data->m_RefInterp && data->m_OutInterp
+		&& data->m_RefHashes && data->m_OutHashes
+		&& data->m_SoA.m_MaxY && data->m_RefSoA.m_MaxY && data->m_OutSoA.m_MaxY
+		;
+	if (!allocated) {
+		return false;
+	}
+
+	uint32_t rng = 12345u;
+	for (uint32_t i = 0; i < n; ++i) {
+		const float x = benchRandFloat(&rng) * 1000.0f;
+		const float y = benchRandFloat(&rng) * 1000.0f;
+		jx::rectInitPosSize(&data->m_Rects[i], x, y, 1.0f + benchRandFloat(&rng) * 50.0f, 1.0f + benchRandFloat(&rng) * 50.0f);
+		data->m_Queries[i] = benchRandFloat(&rng) * (float)(BENCH_INTERP_TABLE_SIZE - 1);
+		data->m_Bytes[i] = (uint8_t)(rng >> 24);
+	}
+	jx::rectInitPosSize(&data->m_TestRect, 250.0f, 250.0f, 500.0f, 500.0f);
+	jx::rectAoSToSoA(data->m_Rects, n, &data->m_SoA);
+
+	for (uint32_t i = 0; i < BENCH_INTERP_TABLE_SIZE; ++i) {
+		data->m_InterpX[i] = (float)i;
+		data->m_InterpY[i] = benchRandFloat(&rng);
+	}
+
+	// Messages overlap inside the byte buffer; only their contents matter.
+	for (uint32_t i = 0; i < n; ++i) {
+		const uint32_t offset = n > BENCH_MSG_LENGTH ? i % (n - BENCH_MSG_LENGTH) : 0;
+		data->m_Messages[i] = &data->m_Bytes[offset];
+		data->m_MessageLengths[i] = bx::min<uint32_t>(n, BENCH_MSG_LENGTH);
+	}
+
+	return true;
+}
+
+static void benchDataShutdown(BenchData* data)
+{
+	bx::AllocatorI* allocator = data->m_Allocator;
+
+	benchFreeSoA(allocator, &data->m_SoA);
+	benchFreeSoA(allocator, &data->m_RefSoA);
+	benchFreeSoA(allocator, &data->m_OutSoA);
+	BX_ALIGNED_FREE(allocator, data->m_Rects, 64);
+	BX_ALIGNED_FREE(allocator, data->m_InterpX, 64);
+	BX_ALIGNED_FREE(allocator, data->m_InterpY, 64);
+	BX_ALIGNED_FREE(allocator, data->m_Queries, 64);
+	BX_ALIGNED_FREE(allocator, data->m_RefResults, 64);
+	BX_ALIGNED_FREE(allocator, data->m_OutResults, 64);
+	BX_ALIGNED_FREE(allocator, data->m_RefInterp, 64);
+	BX_ALIGNED_FREE(allocator, data->m_OutInterp, 64);
+	BX_FREE(allocator, data->m_Bytes);
+	BX_FREE(allocator, data->m_Messages);
+	BX_FREE(allocator, data->m_MessageLengths);
+	BX_FREE(allocator, data->m_RefHashes);
+	BX_FREE(allocator, data->m_OutHashes);
+	BX_FREE(allocator, data->m_RefBase64);
+}
+
+static void benchSeedHashes(uint64_t* hashes, uint32_t n)
+{
+	for (uint32_t i = 0; i < n; ++i) {
+		hashes[i * 2 + 0] = i;
+		hashes[i * 2 + 1] = ~(uint64_t)i;
+	}
+}
+
+// Serial reference, executed once per size.
+static void benchRunSerial(BenchData* data)
+{
+	const uint32_t n = data->m_NumElements;
+	jx::rectAoSToSoA(data->m_Rects, n, &data->m_RefSoA);
+	jx::rectIntersect(&data->m_SoA, n, &data->m_TestRect, data->m_RefResults);
+	jx::interp1f(data->m_InterpX, data->m_InterpY, BENCH_INTERP_TABLE_SIZE, data->m_Queries, data->m_RefInterp, n);
+	data->m_RefBase64 = jx::base64Encode(data->m_Bytes, n, &data->m_RefBase64Len, data->m_Allocator);
+
+	benchSeedHashes(data->m_RefHashes, n);
+	for (uint32_t i = 0; i < n; ++i) {
+		jx::spookyHash128(data->m_Messages[i], data->m_MessageLengths[i], &data->m_RefHashes[i * 2 + 0], &data->m_RefHashes[i * 2 + 1]);
+	}
+}
+
+// Runs the kernel once on pool (nullptr = serial entry point) and returns the elapsed time
+// in nanoseconds, or -1 if the output doesn't match the serial reference.
+static int64_t benchRunKernel(BenchData* data, BenchKernel::Enum kernel, jx::WorkerPool* pool, bool serial)
+{
+	const uint32_t n = data->m_NumElements;
+	bool valid = true;
+	int64_t start = 0;
+	int64_t end = 0;
+
+	switch (kernel) {
+	case BenchKernel::RectAoSToSoA:
+		start = jx::clockGetTicks();
+		if (serial) {
+			jx::rectAoSToSoA(data->m_Rects, n, &data->m_OutSoA);
+		} else {
+			jx::rectAoSToSoAParallel(pool, data->m_Rects, n, &data->m_OutSoA);
+		}
+		end = jx::clockGetTicks();
+		valid = benchSoAEqual(&data->m_RefSoA, &data->m_OutSoA, n);
+		break;
+	case BenchKernel::RectIntersect:
+		start = jx::clockGetTicks();
+		if (serial) {
+			jx::rectIntersect(&data->m_SoA, n, &data->m_TestRect, data->m_OutResults);
+		} else {
+			jx::rectIntersectParallel(pool, &data->m_SoA, n, &data->m_TestRect, data->m_OutResults);
+		}
+		end = jx::clockGetTicks();
+		valid = memcmp(data->m_RefResults, data->m_OutResults, n) == 0;
+		break;
+	case BenchKernel::Interp1f:
+		start = jx::clockGetTicks();
+		if (serial) {
+			jx::interp1f(data->m_InterpX, data->m_InterpY, BENCH_INTERP_TABLE_SIZE, data->m_Queries, data->m_OutInterp, n);
+		} else {
+			jx::interp1fParallel(pool, data->m_InterpX, data->m_InterpY, BENCH_INTERP_TABLE_SIZE, data->m_Queries, data->m_OutInterp, n);
+		}
+		end = jx::clockGetTicks();
+		valid = memcmp(data->m_RefInterp, data->m_OutInterp, sizeof(float) * n) == 0;
+		break;
+	case BenchKernel::Base64Encode:
+	{
+		size_t len = 0;
+		start = jx::clockGetTicks();
+		uint8_t* out = serial
+			? jx::base64Encode(data->m_Bytes, n, &len, data->m_Allocator)
+			: jx::base64EncodeParallel(pool, data->m_Bytes, n, &len, data->m_Allocator)
+			;
+		end = jx::clockGetTicks();
+		valid = out != nullptr
+			&& len == data->m_RefBase64Len
+			&& memcmp(out, data->m_RefBase64, len) == 0
+			;
+		BX_FREE(data->m_Allocator, out);
+		break;
+	}
+	case BenchKernel::SpookyHash128Batch:
+		benchSeedHashes(data->m_OutHashes, n);
+		start = jx::clockGetTicks();
+		jx::spookyHash128Batch(serial ? nullptr : pool, data->m_Messages, data->m_MessageLengths, n, data->m_OutHashes);
+		end = jx::clockGetTicks();
+		valid = memcmp(data->m_RefHashes, data->m_OutHashes, sizeof(uint64_t) * 2 * n) == 0;
+		break;
+	default:
+		break;
+	}
+
+	return valid ? jx::clockTicksToNs(end - start) : -1;
+}
+
+static int64_t benchBestOf(BenchData* data, BenchKernel::Enum kernel, jx::WorkerPool* pool, bool serial)
+{
+	int64_t best = INT64_MAX;
+	for (uint32_t run = 0; run < BENCH_NUM_RUNS; ++run) {
+		const int64_t elapsed = benchRunKernel(data, kernel, pool, serial);
+		if (elapsed < 0) {
+			return -1;
+		}
+
+		best = bx::min<int64_t>(best, elapsed);
+	}
+
+	return best;
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t maxElements = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 10000000;
+
+	if (!jx::initSystem("jx_bench_parallel", 0, 0)) {
+		return 1;
+	}
+
+	bx::AllocatorI* allocator = jx::getGlobalAllocator();
+
+	// Pools with 1, 3, 7, ... workers, i.e. 2, 4, 8, ... threads including the caller.
+	uint32_t numCPUs = 2;
+	jx::CPUTopology* topo = jx::createCPUTopology(allocator);
+	if (topo) {
+		numCPUs = bx::max<uint32_t>(jx::cpuTopoGetNumLogicalCores(topo), 2);
+		jx::destroyCPUTopology(topo);
+	}
+
+	jx::WorkerPool* pools[BENCH_MAX_POOLS];
+	uint32_t numPools = 0;
+	for (uint32_t numThreads = 2; numThreads <= numCPUs && numPools < BENCH_MAX_POOLS; numThreads *= 2) {
+		pools[numPools++] = jx::createWorkerPool(allocator, numThreads - 1, "Bench Worker");
+	}
+
+	printf("%-20s %10s %12s", "kernel", "elements", "serial ns");
+	for (uint32_t i = 0; i < numPools; ++i) {
+		printf(" %9ux", jx::workerPoolGetNumWorkers(pools[i]) + 1);
+	}
+	printf("\n");
+
+	bool allValid = true;
+	for (uint64_t n = 1000; n <= maxElements; n *= 10) {
+		BenchData data;
+		if (!benchDataInit(&data, allocator, (uint32_t)n)) {
+			printf("Failed to allocate %llu elements\n", (unsigned long long)n);
+			benchDataShutdown(&data);
+			break;
+		}
+
+		benchRunSerial(&data);
+
+		for (uint32_t k = 0; k < BenchKernel::Count; ++k) {
+			const BenchKernel::Enum kernel = (BenchKernel::Enum)k;
+			const int64_t serial = benchBestOf(&data, kernel, nullptr, true);
+			printf("%-20s %10llu %12lld", kKernelName[k], (unsigned long long)n, (long long)serial);
+
+			for (uint32_t i = 0; i < numPools; ++i) {
+				const int64_t parallel = benchBestOf(&data, kernel, pools[i], false);
+				if (parallel < 0) {
+					printf(" %10s", "MISMATCH");
+					allValid = false;
+				} else {
+					printf(" %9.2fx", (double)serial / (double)bx::max<int64_t>(parallel, 1));
+				}
+			}
+			printf("\n");
+		}
+
+		benchDataShutdown(&data);
+	}
+
+	for (uint32_t i = 0; i < numPools; ++i) {
+		jx::destroyWorkerPool(pools[i]);
+	}
+
+	jx::shutdownSystem();
+
+	return allValid ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+// Round-trip latency of jx::Thread queues for different wait strategies.
+//
+// The main thread pushes a message to the worker's input queue and waits for the reply on
+// the worker's output queue. Both sides use the same wait strategy. "park" (no spin, no
+// yield) is the default strategy and behaves like the blocking queue it replaced. Spinning
+// only pays off when both threads have a core of their own; on a single core it delays the
+// other side by a full time slice.
+//
+// Build (from the repository root, against bx):
+//   c++ -std=c++17 -O2 -Iinclude -I<bx>/include tools/bench_thread_wait.cpp src/*.cpp <bx>/src/amalgamated.cpp -lpthread -ldl
+#include <jx/sys.h>
+#include <jx/thread.h>
+#include <jx/clock.h>
+#include <bx/bx.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_MSG_PING 1
+#define BENCH_MSG_QUIT 2
+
+struct BenchStrategy
+{
+	const char* m_Name;
+	jx::ThreadWaitStrategy m_Strategy;
+};
+
+static const BenchStrategy kStrategies[] = {
+	{ "park",       { 0,     0    } },
+	{ "yield",      { 0,     1000 } },
+	{ "spin",       { 20000, 0    } },
+	{ "spin+yield", { 2000,  100  } },
+};
+
+static int32_t benchWorkerFunc(jx::Thread* self, void* userData)
+{
+	BX_UNUSED(userData);
+
+	jx::ThreadMessage* msg = jx::threadInQueuePop(self, -1);
+	if (!msg) {
+		return 1;
+	}
+
+	const uint32_t msgID = msg->m_MsgID;
+	if (msgID == BENCH_MSG_PING) {
+		jx::threadOutQueuePush(self, BENCH_MSG_PING, msg->m_Data, sizeof(uint64_t));
+	}
+
+	jx::threadReleaseMessage(self, msg);
+
+	return msgID == BENCH_MSG_QUIT ? 0 : 1;
+}
+
+static int compareU64(const void* a, const void* b)
+{
+	const uint64_t va = *(const uint64_t*)a;
+	const uint64_t vb = *(const uint64_t*)b;
+	return va < vb ? -1 : (va > vb ? 1 : 0);
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t numIterations = argc > 1 ? (uint32_t)atoi(argv[1]) : 100000;
+	if (numIterations == 0) {
+		return 1;
+	}
+
+	if (!jx::initSystem("jx_bench_thread_wait", 0, 0)) {
+		return 1;
+	}
+
+	bx::AllocatorI* allocator = jx::getGlobalAllocator();
+	uint64_t* samples = (uint64_t*)BX_ALLOC(allocator, sizeof(uint64_t) * numIterations);
+
+	printf("%-12s %10s %10s %10s %10s\n", "strategy", "avg ns", "p50 ns", "p99 ns", "max ns");
+	for (uint32_t i = 0; i < BX_COUNTOF(kStrategies); ++i) {
+		const BenchStrategy* bench = &kStrategies[i];
+
+		jx::Thread* worker = jx::createThread(allocator, benchWorkerFunc, nullptr, 0, "Bench Worker");
+		jx::threadSetWaitStrategy(worker, jx::ThreadQueue::In, &bench->m_Strategy);
+		jx::threadSetWaitStrategy(worker, jx::ThreadQueue::Out, &bench->m_Strategy);
+
+		// Warm up the message pools and the caches.
+		for (uint32_t iter = 0; iter < 1000; ++iter) {
+			uint64_t payload = iter;
+			jx::threadInQueuePush(worker, BENCH_MSG_PING, &payload, sizeof(uint64_t));
+			jx::threadReleaseMessage(worker, jx::threadOutQueuePop(worker, -1));
+		}
+
+		uint64_t total = 0;
+		for (uint32_t iter = 0; iter < numIterations; ++iter) {
+			const int64_t start = jx::clockGetTicks();
+
+			uint64_t payload = iter;
+			jx::threadInQueuePush(worker, BENCH_MSG_PING, &payload, sizeof(uint64_t));
+			jx::ThreadMessage* reply = jx::threadOutQueuePop(worker, -1);
+
+			const int64_t end = jx::clockGetTicks();
+			jx::threadReleaseMessage(worker, reply);
+
+			samples[iter] = (uint64_t)jx::clockTicksToNs(end - start);
+			total += samples[iter];
+		}
+
+		uint64_t quit = 0;
+		jx::threadInQueuePush(worker, BENCH_MSG_QUIT, &quit, sizeof(uint64_t));
+		jx::destroyThread(worker);
+
+		qsort(samples, numIterations, sizeof(uint64_t), compareU64);
+		printf("%-12s %10.0f %10llu %10llu %10llu\n"
+			, bench->m_Name
+			, (double)total / (double)numIterations
+			, (unsigned long long)samples[numIterations / 2]
+			, (unsigned long long)samples[(uint64_t)numIterations * 99 / 100]
+			, (unsigned long long)samples[numIterations - 1]
+		);
+	}
+
+	BX_FREE(allocator, samples);
+	jx::shutdownSystem();
+
+	return 0;
+}